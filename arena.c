@@ -0,0 +1,111 @@
+#include "sk2cc.h"
+#include "arena.h"
+
+#define CHUNK_SIZE 65536
+
+// memory is obtained from the system in chunks,
+// and each chunk is linked to the previously obtained one.
+typedef struct chunk Chunk;
+typedef struct arena Arena;
+
+struct chunk {
+  Chunk *next;
+};
+
+struct arena {
+  Chunk *chunks;
+  char *ptr; // next free byte of the current chunk
+  int remain;
+
+  // statistics for --mem-report
+  long allocated;
+  long objects;
+  long reserved;
+  long peak;
+};
+
+static Arena arenas[ARENAS];
+
+static char *arena_names[ARENAS] = { "lex", "parse", "gen", "as" };
+
+static void arena_grow(Arena *arena, int size) {
+  int chunk_size = CHUNK_SIZE;
+  if (size > chunk_size - (int) sizeof(Chunk)) {
+    chunk_size = size + sizeof(Chunk);
+  }
+
+  Chunk *chunk = calloc(1, chunk_size);
+  if (!chunk) {
+    perror("calloc");
+    exit(1);
+  }
+  chunk->next = arena->chunks;
+  arena->chunks = chunk;
+  arena->ptr = (char *) (chunk + 1);
+  arena->remain = chunk_size - sizeof(Chunk);
+
+  arena->reserved += chunk_size;
+  if (arena->reserved > arena->peak) {
+    arena->peak = arena->reserved;
+  }
+}
+
+// returns zero-cleared memory which lives until the arena is released.
+void *arena_alloc(ArenaType type, int size) {
+  Arena *arena = &arenas[type];
+
+  size = (size + 7) / 8 * 8;
+  if (size > arena->remain) {
+    arena_grow(arena, size);
+  }
+
+  void *ptr = arena->ptr;
+  arena->ptr += size;
+  arena->remain -= size;
+
+  arena->allocated += size;
+  arena->objects++;
+
+  return ptr;
+}
+
+// frees all the memory of the arena at once.
+void arena_release(ArenaType type) {
+  Arena *arena = &arenas[type];
+
+  Chunk *chunk = arena->chunks;
+  while (chunk) {
+    Chunk *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+
+  arena->chunks = NULL;
+  arena->ptr = NULL;
+  arena->remain = 0;
+  arena->reserved = 0;
+}
+
+// total of all arenas
+void arena_stats(long *allocated, long *objects) {
+  *allocated = 0;
+  *objects = 0;
+  for (int i = 0; i < ARENAS; i++) {
+    *allocated += arenas[i].allocated;
+    *objects += arenas[i].objects;
+  }
+}
+
+void arena_report(void) {
+  long allocated = 0, objects = 0, peak = 0;
+
+  fprintf(stderr, "%-8s %12s %10s %12s\n", "arena", "allocated", "objects", "peak");
+  for (int i = 0; i < ARENAS; i++) {
+    Arena *arena = &arenas[i];
+    fprintf(stderr, "%-8s %12ld %10ld %12ld\n", arena_names[i], arena->allocated, arena->objects, arena->peak);
+    allocated += arena->allocated;
+    objects += arena->objects;
+    peak += arena->peak;
+  }
+  fprintf(stderr, "%-8s %12ld %10ld %12ld\n", "total", allocated, objects, peak);
+}
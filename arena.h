@@ -0,0 +1,14 @@
+// arenas are released phase by phase
+typedef enum {
+  ARENA_LEX,   // tokens and locations (lex.c, cpp.c, as_lex.c)
+  ARENA_PARSE, // syntax trees, types and symbols (parse.c, sema.c)
+  ARENA_GEN,   // code generation (gen.c)
+  ARENA_AS,    // statements, operands, sections and relocations (as_*.c)
+} ArenaType;
+
+#define ARENAS 4
+
+extern void *arena_alloc(ArenaType type, int size);
+extern void arena_release(ArenaType type);
+extern void arena_stats(long *allocated, long *objects);
+extern void arena_report(void);
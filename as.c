@@ -1,9 +1,26 @@
 #include "as.h"
 
 void assemble(char *input, char *output) {
+  phase_begin("as_tokenize");
   Vector *tokens = as_tokenize(input);
+  phase_end();
+  stats_count(STAT_TOKENS, tokens->length);
+
+  phase_begin("as_parse");
   Vector *stmts = as_parse(tokens);
+  phase_end();
+
+  phase_begin("as_sema");
   as_sema(stmts);
+  phase_end();
+
+  phase_begin("as_encode");
   TransUnit *trans_unit = as_encode(stmts);
+  phase_end();
+  arena_release(ARENA_LEX);
+
+  phase_begin("gen_obj");
   gen_obj(trans_unit, output);
+  phase_end();
+  arena_release(ARENA_AS);
 }
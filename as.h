@@ -6,37 +6,22 @@
 #include "map.h"
 #include "binary.h"
 
-// struct and enum declaration
+// identifier interning
+#include "ident.h"
 
-// register size
-typedef enum {
-  REG_BYTE, // 8-bit
-  REG_WORD, // 16-bit
-  REG_LONG, // 32-bit
-  REG_QUAD, // 64-bit
-} RegSize;
-
-// register code
-// the values of constants are important
-// because they are used in the instruction encoding.
-typedef enum {
-  REG_AX,
-  REG_CX,
-  REG_DX,
-  REG_BX,
-  REG_SP,
-  REG_BP,
-  REG_SI,
-  REG_DI,
-  REG_R8,
-  REG_R9,
-  REG_R10,
-  REG_R11,
-  REG_R12,
-  REG_R13,
-  REG_R14,
-  REG_R15,
-} RegCode;
+// source file loading
+#include "source.h"
+
+// registers and instructions of x86-64
+#include "x86.h"
+
+// memory allocation
+#include "arena.h"
+
+// statistics
+#include "stats.h"
+
+// struct and enum declaration
 
 // token type
 typedef enum {
@@ -49,6 +34,7 @@ typedef enum {
   TK_COMMA,     // ','
   TK_LPAREN,    // '('
   TK_RPAREN,    // ')'
+  TK_STAR,      // '*'
   TK_SEMICOLON, // ';'
   TK_NEWLINE,   // '\n'
   TK_EOF,       // end of file
@@ -78,7 +64,7 @@ typedef struct {
   int num;
 
   // immediate value
-  unsigned int imm;
+  unsigned long long imm;
 
   // string
   String *string;
@@ -86,63 +72,6 @@ typedef struct {
   Location *loc; // location information
 } Token;
 
-// statement type
-typedef enum {
-  // label
-  ST_LABEL,
-
-  // directives
-  ST_TEXT,
-  ST_DATA,
-  ST_SECTION,
-  ST_GLOBAL,
-  ST_ZERO,
-  ST_LONG,
-  ST_QUAD,
-  ST_ASCII,
-
-  // instructions
-  ST_PUSH,
-  ST_POP,
-  ST_CLTD,
-  ST_CQTO,
-  ST_MOV,
-  ST_MOVZB,
-  ST_MOVZW,
-  ST_MOVSB,
-  ST_MOVSW,
-  ST_MOVSL,
-  ST_LEA,
-  ST_NEG,
-  ST_NOT,
-  ST_ADD,
-  ST_SUB,
-  ST_MUL,
-  ST_IMUL,
-  ST_DIV,
-  ST_IDIV,
-  ST_AND,
-  ST_XOR,
-  ST_OR,
-  ST_SAL,
-  ST_SAR,
-  ST_CMP,
-  ST_SETE,
-  ST_SETNE,
-  ST_SETB,
-  ST_SETL,
-  ST_SETG,
-  ST_SETBE,
-  ST_SETLE,
-  ST_SETGE,
-  ST_JMP,
-  ST_JE,
-  ST_JNE,
-  ST_CALL,
-  ST_LEAVE,
-  ST_RET,
-} StmtType;
-
 typedef struct {
   StmtType type;
 } Stmt;
@@ -163,16 +92,6 @@ typedef struct {
   Token *token;
 } Dir;
 
-// scale of memory operand
-// the values of constants are important
-// because they are used in instruction encoding.
-typedef enum {
-  SCALE1,
-  SCALE2,
-  SCALE4,
-  SCALE8,
-} Scale;
-
 typedef enum {
   OP_REG, // register operand
   OP_MEM, // memory operand
@@ -200,19 +119,13 @@ typedef struct {
   char *ident; // identifier
 
   // immediate operand
-  unsigned int imm;
+  unsigned long long imm;
+
+  bool indirect; // '*' operand of indirect jump
 
   Token *token;
 } Op;
 
-// instructino suffix
-typedef enum {
-  INST_BYTE,
-  INST_WORD,
-  INST_LONG,
-  INST_QUAD,
-} InstSuffix;
-
 // instruction
 typedef struct {
   StmtType type;  // instruction type
@@ -226,6 +139,8 @@ typedef struct {
   Op *src;
   Op *dest;
 
+  bool rel32; // the jump is encoded in the near form
+
   Token *token;
 } Inst;
 
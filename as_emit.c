@@ -0,0 +1,180 @@
+#include "as.h"
+#include "emit.h"
+
+// integrated assembler
+// the statements of the code generator are converted to the ones of the assembler
+// without formatting them as text, and then encoded to an object file.
+
+static Vector *stmts;
+static Vector *local_labels;  // Vector<char*>, .L<n>
+static Vector *string_labels; // Vector<char*>, .S<n>
+static Token *token;
+
+// all statements share the token for error report.
+static Token *token_new(char *filename) {
+  Location *loc = arena_alloc(ARENA_AS, sizeof(Location));
+  loc->filename = filename;
+  loc->line = "";
+
+  Token *token = arena_alloc(ARENA_AS, sizeof(Token));
+  token->type = TK_IDENT;
+  token->loc = loc;
+  return token;
+}
+
+static char *label_name(Vector *labels, char prefix, int label) {
+  while (labels->length <= label) {
+    vector_push(labels, NULL);
+  }
+
+  if (!labels->buffer[label]) {
+    String *name = string_new();
+    string_push(name, '.');
+    string_push(name, prefix);
+
+    char digits[12];
+    int n = 0;
+    int value = label;
+    do {
+      digits[n++] = '0' + value % 10;
+      value /= 10;
+    } while (value > 0);
+    while (n > 0) {
+      string_push(name, digits[--n]);
+    }
+
+    labels->buffer[label] = intern(name->buffer)->name;
+  }
+
+  return labels->buffer[label];
+}
+
+static char *symbol_name(EmitOp *op) {
+  if (op->ident) {
+    return intern(op->ident)->name;
+  }
+  if (op->prefix == 'S') {
+    return label_name(string_labels, 'S', op->label);
+  }
+  return label_name(local_labels, 'L', op->label);
+}
+
+static Op *convert_op(EmitOp *eop) {
+  Op *op = arena_alloc(ARENA_AS, sizeof(Op));
+  op->token = token;
+
+  switch (eop->type) {
+    case EOP_REG: {
+      op->type = OP_REG;
+      op->regtype = eop->regtype;
+      op->regcode = eop->regcode;
+      break;
+    }
+    case EOP_IMM: {
+      op->type = OP_IMM;
+      op->imm = eop->imm;
+      break;
+    }
+    case EOP_MEM: {
+      op->type = OP_MEM;
+      op->sib = eop->sib;
+      op->scale = eop->scale;
+      op->index = eop->index;
+      op->base = eop->base;
+      op->disp = eop->disp;
+      break;
+    }
+    case EOP_RIP: {
+      op->type = OP_MEM;
+      op->rip = true;
+      op->ident = symbol_name(eop);
+      break;
+    }
+    case EOP_SYM: {
+      op->type = OP_SYM;
+      op->ident = symbol_name(eop);
+      break;
+    }
+  }
+
+  return op;
+}
+
+static Stmt *convert_stmt(EmitStmt *stmt) {
+  switch (stmt->type) {
+    case ST_LABEL: {
+      Label *label = arena_alloc(ARENA_AS, sizeof(Label));
+      label->type = ST_LABEL;
+      label->ident = symbol_name(&stmt->ops[0]);
+      label->token = token;
+      return (Stmt *) label;
+    }
+    case ST_TEXT:
+    case ST_DATA:
+    case ST_SECTION:
+    case ST_GLOBAL:
+    case ST_ZERO:
+    case ST_LONG:
+    case ST_QUAD:
+    case ST_ASCII: {
+      Dir *dir = arena_alloc(ARENA_AS, sizeof(Dir));
+      dir->type = stmt->type;
+      dir->token = token;
+      if (stmt->type == ST_SECTION) {
+        dir->ident = ".rodata";
+      } else if (stmt->type == ST_GLOBAL || stmt->type == ST_QUAD) {
+        dir->ident = symbol_name(&stmt->ops[0]);
+      } else if (stmt->type == ST_ZERO || stmt->type == ST_LONG) {
+        dir->num = stmt->ops[0].imm;
+      } else if (stmt->type == ST_ASCII) {
+        dir->string = stmt->string;
+      }
+      return (Stmt *) dir;
+    }
+    default: {
+      Vector *ops = vector_new();
+      for (int i = 0; i < stmt->nops; i++) {
+        vector_push(ops, convert_op(&stmt->ops[i]));
+      }
+
+      // the register or memory operand of jmp is the target address.
+      if (stmt->type == ST_JMP && stmt->ops[0].type != EOP_SYM) {
+        Op *op = ops->buffer[0];
+        op->indirect = true;
+      }
+
+      Inst *inst = arena_alloc(ARENA_AS, sizeof(Inst));
+      inst->type = stmt->type;
+      inst->suffix = stmt->suffix;
+      inst->ops = ops;
+      inst->token = token;
+      return (Stmt *) inst;
+    }
+  }
+}
+
+void as_emit_begin(char *output) {
+  stmts = vector_new();
+  local_labels = vector_new();
+  string_labels = vector_new();
+  token = token_new(output);
+}
+
+void as_emit(EmitStmt *stmt) {
+  vector_push(stmts, convert_stmt(stmt));
+}
+
+void as_emit_end(char *output) {
+  phase_begin("as_sema");
+  as_sema(stmts);
+  phase_end();
+
+  phase_begin("as_encode");
+  TransUnit *trans_unit = as_encode(stmts);
+  phase_end();
+
+  phase_begin("gen_obj");
+  gen_obj(trans_unit, output);
+  phase_end();
+  arena_release(ARENA_AS);
+}
@@ -1,7 +1,7 @@
 #include "as.h"
 
 static Reloc *reloc_new(int offset, char *ident, int type, int addend) {
-  Reloc *reloc = (Reloc *) calloc(1, sizeof(Reloc));
+  Reloc *reloc = arena_alloc(ARENA_AS, sizeof(Reloc));
   reloc->offset = offset;
   reloc->ident = ident;
   reloc->type = type;
@@ -10,14 +10,14 @@ static Reloc *reloc_new(int offset, char *ident, int type, int addend) {
 }
 
 static Section *section_new(void) {
-  Section *section = (Section *) calloc(1, sizeof(Section));
+  Section *section = arena_alloc(ARENA_AS, sizeof(Section));
   section->bin = binary_new();
   section->relocs = vector_new();
   return section;
 }
 
 static Symbol *symbol_new(bool global, int section, int offset) {
-  Symbol *symbol = (Symbol *) calloc(1, sizeof(Symbol));
+  Symbol *symbol = arena_alloc(ARENA_AS, sizeof(Symbol));
   symbol->global = global;
   symbol->section = section;
   symbol->offset = offset;
@@ -25,7 +25,7 @@ static Symbol *symbol_new(bool global, int section, int offset) {
 }
 
 static TransUnit *trans_unit_new(void) {
-  TransUnit *trans_unit = (TransUnit *) calloc(1, sizeof(TransUnit));
+  TransUnit *trans_unit = arena_alloc(ARENA_AS, sizeof(TransUnit));
   trans_unit->text = section_new();
   trans_unit->data = section_new();
   trans_unit->rodata = section_new();
@@ -33,11 +33,30 @@ static TransUnit *trans_unit_new(void) {
   return trans_unit;
 }
 
+// jump in the short form
+// the displacement is resolved at the end of each pass.
+typedef struct {
+  Inst *inst;
+  Binary *bin;
+  int section;
+  int offset; // offset of rel8
+} Branch;
+
+static Branch *branch_new(Inst *inst, Binary *bin, int section, int offset) {
+  Branch *branch = arena_alloc(ARENA_AS, sizeof(Branch));
+  branch->inst = inst;
+  branch->bin = bin;
+  branch->section = section;
+  branch->offset = offset;
+  return branch;
+}
+
 static TransUnit *trans_unit;
 static Binary *bin;
 static Vector *relocs;
 static Map *symbols;
 static int current;
+static Vector *branches; // Vector<Branch*>
 
 // encode label
 
@@ -83,29 +102,20 @@ static void gen_global(Dir *dir) {
 }
 
 static void gen_zero(Dir *dir) {
-  for (int i = 0; i < dir->num; i++) {
-    binary_push(bin, 0);
-  }
+  binary_fill(bin, 0, dir->num);
 }
 
 static void gen_long(Dir *dir) {
-  binary_push(bin, (((unsigned int) dir->num) >> 0) & 0xff);
-  binary_push(bin, (((unsigned int) dir->num) >> 8) & 0xff);
-  binary_push(bin, (((unsigned int) dir->num) >> 16) & 0xff);
-  binary_push(bin, (((unsigned int) dir->num) >> 24) & 0xff);
+  binary_u32(bin, dir->num);
 }
 
 static void gen_quad(Dir *dir) {
   vector_push(relocs, reloc_new(bin->length, dir->ident, R_X86_64_64, 0));
-  for (int i = 0; i < 8; i++) {
-    binary_push(bin, 0);
-  }
+  binary_u64(bin, 0);
 }
 
 static void gen_ascii(Dir *dir) {
-  for (int i = 0; i < dir->string->length; i++) {
-    binary_push(bin, dir->string->buffer[i]);
-  }
+  binary_write(bin, dir->string->buffer, dir->string->length);
 }
 
 // encode instructions
@@ -155,29 +165,26 @@ static void gen_sib(Scale scale, RegCode index, RegCode base) {
 
 static void gen_disp(Mod mod, int disp) {
   if (mod == MOD_DISP8) {
-    binary_push(bin, (unsigned char) disp);
+    binary_u8(bin, disp);
   } else if (mod == MOD_DISP32) {
-    binary_push(bin, ((unsigned int) disp >> 0) & 0xff);
-    binary_push(bin, ((unsigned int) disp >> 8) & 0xff);
-    binary_push(bin, ((unsigned int) disp >> 16) & 0xff);
-    binary_push(bin, ((unsigned int) disp >> 24) & 0xff);
+    binary_u32(bin, disp);
   }
 }
 
 static void gen_imm8(unsigned char imm) {
-  binary_push(bin, (imm >> 0) & 0xff);
+  binary_u8(bin, imm);
 }
 
 static void gen_imm16(unsigned short imm) {
-  binary_push(bin, (imm >> 0) & 0xff);
-  binary_push(bin, (imm >> 8) & 0xff);
+  binary_u16(bin, imm);
 }
 
 static void gen_imm32(unsigned int imm) {
-  binary_push(bin, (imm >> 0) & 0xff);
-  binary_push(bin, (imm >> 8) & 0xff);
-  binary_push(bin, (imm >> 16) & 0xff);
-  binary_push(bin, (imm >> 24) & 0xff);
+  binary_u32(bin, imm);
+}
+
+static void gen_imm64(unsigned long long imm) {
+  binary_u64(bin, imm);
 }
 
 static void gen_rel32(char *ident) {
@@ -240,7 +247,12 @@ static void gen_mov(Inst *inst) {
   Op *src = inst->src, *dest = inst->dest;
   switch (inst->suffix) {
     case INST_QUAD: {
-      if (src->type == OP_IMM && dest->type == OP_REG) {
+      if (src->type == OP_IMM && dest->type == OP_REG && src->imm + 0x80000000 > 0xffffffff) {
+        // REX.W + B8 +rd io (movabs)
+        gen_rex(1, 0, 0, dest->regcode, false);
+        gen_opcode_reg(0xb8, dest->regcode);
+        gen_imm64(src->imm);
+      } else if (src->type == OP_IMM && dest->type == OP_REG) {
         // REX.W + C7 /0 id
         gen_rex(1, 0, 0, dest->regcode, false);
         gen_opcode(0xc7);
@@ -383,7 +395,8 @@ static void gen_movzb(Inst *inst) {
   if (inst->suffix == INST_QUAD) {
     if (src->type == OP_REG && dest->type == OP_REG) {
       // REX.W + 0F B6 /r
-      gen_rex(1, dest->regcode, 0, src->regcode, false);
+      bool required = (src->regcode & 12) == 4;
+      gen_rex(1, dest->regcode, 0, src->regcode, required);
       gen_opcode(0x0f);
       gen_opcode(0xb6);
       gen_ops(dest->regcode, src);
@@ -397,7 +410,8 @@ static void gen_movzb(Inst *inst) {
   } else if (inst->suffix == INST_LONG) {
     if (src->type == OP_REG && dest->type == OP_REG) {
       // 0F B6 /r
-      gen_rex(0, dest->regcode, 0, src->regcode, false);
+      bool required = (src->regcode & 12) == 4;
+      gen_rex(0, dest->regcode, 0, src->regcode, required);
       gen_opcode(0x0f);
       gen_opcode(0xb6);
       gen_ops(dest->regcode, src);
@@ -412,7 +426,8 @@ static void gen_movzb(Inst *inst) {
     if (src->type == OP_REG && dest->type == OP_REG) {
       // 0F B6 /r
       gen_prefix(0x66);
-      gen_rex(0, dest->regcode, 0, src->regcode, false);
+      bool required = (src->regcode & 12) == 4;
+      gen_rex(0, dest->regcode, 0, src->regcode, required);
       gen_opcode(0x0f);
       gen_opcode(0xb6);
       gen_ops(dest->regcode, src);
@@ -465,7 +480,8 @@ static void gen_movsb(Inst *inst) {
   if (inst->suffix == INST_QUAD) {
     if (src->type == OP_REG && dest->type == OP_REG) {
       // REX.W + 0F BE /r
-      gen_rex(1, dest->regcode, 0, src->regcode, false);
+      bool required = (src->regcode & 12) == 4;
+      gen_rex(1, dest->regcode, 0, src->regcode, required);
       gen_opcode(0x0f);
       gen_opcode(0xbe);
       gen_ops(dest->regcode, src);
@@ -479,7 +495,8 @@ static void gen_movsb(Inst *inst) {
   } else if (inst->suffix == INST_LONG) {
     if (src->type == OP_REG && dest->type == OP_REG) {
       // 0F BE /r
-      gen_rex(0, dest->regcode, 0, src->regcode, false);
+      bool required = (src->regcode & 12) == 4;
+      gen_rex(0, dest->regcode, 0, src->regcode, required);
       gen_opcode(0x0f);
       gen_opcode(0xbe);
       gen_ops(dest->regcode, src);
@@ -494,7 +511,8 @@ static void gen_movsb(Inst *inst) {
     if (src->type == OP_REG && dest->type == OP_REG) {
       // 0F BE /r
       gen_prefix(0x66);
-      gen_rex(0, dest->regcode, 0, src->regcode, false);
+      bool required = (src->regcode & 12) == 4;
+      gen_rex(0, dest->regcode, 0, src->regcode, required);
       gen_opcode(0x0f);
       gen_opcode(0xbe);
       gen_ops(dest->regcode, src);
@@ -558,8 +576,8 @@ static void gen_movsl(Inst *inst) {
 }
 
 static void gen_lea(Inst *inst) {
-  // REX.W + 8D /r
-  gen_rex(1, inst->dest->regcode, inst->src->index, inst->src->base, false);
+  // REX.W + 8D /r, or 8D /r
+  gen_rex(inst->suffix == INST_QUAD, inst->dest->regcode, inst->src->index, inst->src->base, false);
   gen_opcode(0x8d);
   gen_ops(inst->dest->regcode, inst->src);
 }
@@ -777,8 +795,39 @@ static void gen_mul(Inst *inst) {
   }
 }
 
+// imul with two operands multiplies the destination register,
+// and keeps only the lower half of the product.
+static void gen_imul2(Inst *inst) {
+  Op *src = inst->src, *dest = inst->dest;
+  bool w = inst->suffix == INST_QUAD;
+  if (inst->suffix != INST_QUAD && inst->suffix != INST_LONG) return;
+  if (src->type == OP_IMM) {
+    // REX.W + 69 /r id, or 69 /r id
+    gen_rex(w, dest->regcode, 0, dest->regcode, false);
+    gen_opcode(0x69);
+    gen_ops(dest->regcode, dest);
+    gen_imm32(src->imm);
+  } else if (src->type == OP_REG) {
+    // REX.W + 0F AF /r, or 0F AF /r
+    gen_rex(w, dest->regcode, 0, src->regcode, false);
+    gen_opcode(0x0f);
+    gen_opcode(0xaf);
+    gen_ops(dest->regcode, src);
+  } else if (src->type == OP_MEM) {
+    // REX.W + 0F AF /r, or 0F AF /r
+    gen_rex(w, dest->regcode, src->index, src->base, false);
+    gen_opcode(0x0f);
+    gen_opcode(0xaf);
+    gen_ops(dest->regcode, src);
+  }
+}
+
 static void gen_imul(Inst *inst) {
   Op *op = inst->op;
+  if (inst->ops->length == 2) {
+    gen_imul2(inst);
+    return;
+  }
   if (inst->suffix == INST_QUAD) {
     if (op->type == OP_REG) {
       // REX.W + F7 /5 id
@@ -1053,62 +1102,43 @@ static void gen_or(Inst *inst) {
   }
 }
 
-static void gen_sal(Inst *inst) {
-  Op *dest = inst->dest;
-  if (inst->suffix == INST_QUAD) {
+// sal, sar and shr differ only in the opcode extension.
+static void gen_shift(Inst *inst, RegCode ext) {
+  Op *src = inst->src, *dest = inst->dest;
+  bool w = inst->suffix == INST_QUAD;
+  if (inst->suffix != INST_QUAD && inst->suffix != INST_LONG) return;
+  if (src->type == OP_IMM) {
+    // REX.W + C1 /ext ib, or C1 /ext ib
     if (dest->type == OP_REG) {
-      // REX.W + D3 /4
-      gen_rex(1, 0, 0, dest->regcode, false);
-      gen_opcode(0xd3);
-      gen_ops(4, dest);
+      gen_rex(w, 0, 0, dest->regcode, false);
     } else if (dest->type == OP_MEM) {
-      // REX.W + D3 /4
-      gen_rex(1, 0, dest->index, dest->base, false);
-      gen_opcode(0xd3);
-      gen_ops(4, dest);
+      gen_rex(w, 0, dest->index, dest->base, false);
     }
-  } else if (inst->suffix == INST_LONG) {
+    gen_opcode(0xc1);
+    gen_ops(ext, dest);
+    gen_imm8(src->imm);
+  } else {
+    // REX.W + D3 /ext, or D3 /ext
     if (dest->type == OP_REG) {
-      // D3 /4
-      gen_rex(0, 0, 0, dest->regcode, false);
-      gen_opcode(0xd3);
-      gen_ops(4, dest);
+      gen_rex(w, 0, 0, dest->regcode, false);
     } else if (dest->type == OP_MEM) {
-      // D3 /4
-      gen_rex(0, 0, dest->index, dest->base, false);
-      gen_opcode(0xd3);
-      gen_ops(4, dest);
+      gen_rex(w, 0, dest->index, dest->base, false);
     }
+    gen_opcode(0xd3);
+    gen_ops(ext, dest);
   }
 }
 
+static void gen_sal(Inst *inst) {
+  gen_shift(inst, 4);
+}
+
+static void gen_shr(Inst *inst) {
+  gen_shift(inst, 5);
+}
+
 static void gen_sar(Inst *inst) {
-  Op *dest = inst->dest;
-  if (inst->suffix == INST_QUAD) {
-    if (dest->type == OP_REG) {
-      // REX.W + D3 /7
-      gen_rex(1, 0, 0, dest->regcode, false);
-      gen_opcode(0xd3);
-      gen_ops(7, dest);
-    } else if (dest->type == OP_MEM) {
-      // REX.W + D3 /7
-      gen_rex(1, 0, dest->index, dest->base, false);
-      gen_opcode(0xd3);
-      gen_ops(7, dest);
-    }
-  } else if (inst->suffix == INST_LONG) {
-    if (dest->type == OP_REG) {
-      // D3 /7
-      gen_rex(0, 0, 0, dest->regcode, false);
-      gen_opcode(0xd3);
-      gen_ops(7, dest);
-    } else if (dest->type == OP_MEM) {
-      // D3 /7
-      gen_rex(0, 0, dest->index, dest->base, false);
-      gen_opcode(0xd3);
-      gen_ops(7, dest);
-    }
-  }
+  gen_shift(inst, 7);
 }
 
 static void gen_cmp(Inst *inst) {
@@ -1253,6 +1283,132 @@ static void gen_cmp(Inst *inst) {
   }
 }
 
+// test is commutative, so a memory source is encoded as the destination.
+static void gen_test(Inst *inst) {
+  Op *src = inst->src, *dest = inst->dest;
+  if (src->type == OP_MEM && dest->type == OP_REG) {
+    src = inst->dest;
+    dest = inst->src;
+  }
+
+  switch (inst->suffix) {
+    case INST_QUAD: {
+      if (src->type == OP_IMM && dest->type == OP_REG) {
+        // REX.W + F7 /0 id
+        gen_rex(1, 0, 0, dest->regcode, false);
+        gen_opcode(0xf7);
+        gen_ops(0, dest);
+        gen_imm32(src->imm);
+      } else if (src->type == OP_IMM && dest->type == OP_MEM) {
+        // REX.W + F7 /0 id
+        gen_rex(1, 0, dest->index, dest->base, false);
+        gen_opcode(0xf7);
+        gen_ops(0, dest);
+        gen_imm32(src->imm);
+      } else if (src->type == OP_REG && dest->type == OP_REG) {
+        // REX.W + 85 /r
+        gen_rex(1, src->regcode, 0, dest->regcode, false);
+        gen_opcode(0x85);
+        gen_ops(src->regcode, dest);
+      } else if (src->type == OP_REG && dest->type == OP_MEM) {
+        // REX.W + 85 /r
+        gen_rex(1, src->regcode, dest->index, dest->base, false);
+        gen_opcode(0x85);
+        gen_ops(src->regcode, dest);
+      }
+    }
+    break;
+
+    case INST_LONG: {
+      if (src->type == OP_IMM && dest->type == OP_REG) {
+        // F7 /0 id
+        gen_rex(0, 0, 0, dest->regcode, false);
+        gen_opcode(0xf7);
+        gen_ops(0, dest);
+        gen_imm32(src->imm);
+      } else if (src->type == OP_IMM && dest->type == OP_MEM) {
+        // F7 /0 id
+        gen_rex(0, 0, dest->index, dest->base, false);
+        gen_opcode(0xf7);
+        gen_ops(0, dest);
+        gen_imm32(src->imm);
+      } else if (src->type == OP_REG && dest->type == OP_REG) {
+        // 85 /r
+        gen_rex(0, src->regcode, 0, dest->regcode, false);
+        gen_opcode(0x85);
+        gen_ops(src->regcode, dest);
+      } else if (src->type == OP_REG && dest->type == OP_MEM) {
+        // 85 /r
+        gen_rex(0, src->regcode, dest->index, dest->base, false);
+        gen_opcode(0x85);
+        gen_ops(src->regcode, dest);
+      }
+    }
+    break;
+
+    case INST_WORD: {
+      if (src->type == OP_IMM && dest->type == OP_REG) {
+        // F7 /0 iw
+        gen_prefix(0x66);
+        gen_rex(0, 0, 0, dest->regcode, false);
+        gen_opcode(0xf7);
+        gen_ops(0, dest);
+        gen_imm16(src->imm);
+      } else if (src->type == OP_IMM && dest->type == OP_MEM) {
+        // F7 /0 iw
+        gen_prefix(0x66);
+        gen_rex(0, 0, dest->index, dest->base, false);
+        gen_opcode(0xf7);
+        gen_ops(0, dest);
+        gen_imm16(src->imm);
+      } else if (src->type == OP_REG && dest->type == OP_REG) {
+        // 85 /r
+        gen_prefix(0x66);
+        gen_rex(0, src->regcode, 0, dest->regcode, false);
+        gen_opcode(0x85);
+        gen_ops(src->regcode, dest);
+      } else if (src->type == OP_REG && dest->type == OP_MEM) {
+        // 85 /r
+        gen_prefix(0x66);
+        gen_rex(0, src->regcode, dest->index, dest->base, false);
+        gen_opcode(0x85);
+        gen_ops(src->regcode, dest);
+      }
+    }
+    break;
+
+    case INST_BYTE: {
+      if (src->type == OP_IMM && dest->type == OP_REG) {
+        // F6 /0 ib
+        bool required = (dest->regcode & 12) == 4;
+        gen_rex(0, 0, 0, dest->regcode, required);
+        gen_opcode(0xf6);
+        gen_ops(0, dest);
+        gen_imm8(src->imm);
+      } else if (src->type == OP_IMM && dest->type == OP_MEM) {
+        // F6 /0 ib
+        gen_rex(0, 0, dest->index, dest->base, 0);
+        gen_opcode(0xf6);
+        gen_ops(0, dest);
+        gen_imm8(src->imm);
+      } else if (src->type == OP_REG && dest->type == OP_REG) {
+        // 84 /r
+        bool required = (src->regcode & 12) == 4 || (dest->regcode & 12) == 4;
+        gen_rex(0, src->regcode, 0, dest->regcode, required);
+        gen_opcode(0x84);
+        gen_ops(src->regcode, dest);
+      } else if (src->type == OP_REG && dest->type == OP_MEM) {
+        // 84 /r
+        bool required = (src->regcode & 12) == 4;
+        gen_rex(0, src->regcode, dest->index, dest->base, required);
+        gen_opcode(0x84);
+        gen_ops(src->regcode, dest);
+      }
+    }
+    break;
+  }
+}
+
 static void gen_sete(Inst *inst) {
   Op *op = inst->op;
   if (op->type == OP_REG) {
@@ -1397,23 +1553,57 @@ static void gen_setge(Inst *inst) {
   }
 }
 
+// rel8 is left as zero until the end of the pass.
+static void gen_rel8(Inst *inst) {
+  Symbol *symbol = map_lookup(symbols, inst->op->ident);
+  if (!symbol) {
+    map_put(symbols, inst->op->ident, symbol_new(false, UNDEF, 0));
+  }
+  vector_push(branches, branch_new(inst, bin, current, bin->length));
+
+  gen_imm8(0);
+}
+
 static void gen_jmp(Inst *inst) {
+  Op *op = inst->op;
+  if (op->indirect) {
+    // FF /4
+    if (op->type == OP_REG) {
+      gen_rex(0, 0, 0, op->regcode, false);
+    } else {
+      gen_rex(0, 0, op->index, op->base, false);
+    }
+    gen_opcode(0xff);
+    gen_ops(4, op);
+    return;
+  }
+
+  if (!inst->rel32) {
+    // EB cb
+    gen_opcode(0xeb);
+    gen_rel8(inst);
+    return;
+  }
+
   // E9 cd
   gen_opcode(0xe9);
   gen_rel32(inst->op->ident);
 }
 
-static void gen_je(Inst *inst) {
-  // E9 cd
-  gen_opcode(0x0f);
-  gen_opcode(0x84);
-  gen_rel32(inst->op->ident);
-}
+// jcc rel8 and jcc rel32
+// the second byte of the near form is 0x80 + condition code,
+// and the opcode of the short form is 0x70 + condition code.
+static void gen_jcc(Inst *inst, unsigned char opcode) {
+  if (!inst->rel32) {
+    // 7x cb
+    gen_opcode(opcode - 0x10);
+    gen_rel8(inst);
+    return;
+  }
 
-static void gen_jne(Inst *inst) {
-  // E9 cd
+  // 0F 8x cd
   gen_opcode(0x0f);
-  gen_opcode(0x85);
+  gen_opcode(opcode);
   gen_rel32(inst->op->ident);
 }
 
@@ -1433,15 +1623,119 @@ static void gen_ret(Inst *inst) {
   gen_opcode(0xc3);
 }
 
-TransUnit *as_encode(Vector *stmts) {
+// string instructions with the rep prefix
+static void gen_rep_string(Inst *inst, Byte opcode) {
+  gen_prefix(0xf3);
+  switch (inst->suffix) {
+    case INST_QUAD: {
+      // F3 REX.W + opcode+1
+      gen_rex(1, 0, 0, 0, false);
+      gen_opcode(opcode + 1);
+      break;
+    }
+    case INST_LONG: {
+      // F3 opcode+1
+      gen_opcode(opcode + 1);
+      break;
+    }
+    case INST_WORD: {
+      // F3 66 opcode+1
+      gen_prefix(0x66);
+      gen_opcode(opcode + 1);
+      break;
+    }
+    case INST_BYTE: {
+      // F3 opcode
+      gen_opcode(opcode);
+      break;
+    }
+  }
+}
+
+// SSE instructions
+// reg is the register in the reg field, and rm is the other operand.
+static void gen_sse(Byte prefix, Byte opcode, Op *reg, Op *rm) {
+  gen_prefix(prefix);
+  if (rm->type == OP_REG) {
+    gen_rex(0, reg->regcode, 0, rm->regcode, false);
+  } else {
+    gen_rex(0, reg->regcode, rm->index, rm->base, false);
+  }
+  gen_opcode(0x0f);
+  gen_opcode(opcode);
+  gen_ops(reg->regcode, rm);
+}
+
+static void gen_movd(Inst *inst) {
+  if (inst->dest->type == OP_REG && inst->dest->regtype == REG_XMM) {
+    // 66 0F 6E /r
+    gen_sse(0x66, 0x6e, inst->dest, inst->src);
+  } else {
+    // 66 0F 7E /r
+    gen_sse(0x66, 0x7e, inst->src, inst->dest);
+  }
+}
+
+static void gen_movdqu(Inst *inst) {
+  if (inst->dest->type == OP_REG) {
+    // F3 0F 6F /r
+    gen_sse(0xf3, 0x6f, inst->dest, inst->src);
+  } else {
+    // F3 0F 7F /r
+    gen_sse(0xf3, 0x7f, inst->src, inst->dest);
+  }
+}
+
+// the packed integer operations with the destination in the reg field
+static void gen_packed(Inst *inst, Byte opcode) {
+  // 66 0F opcode /r
+  gen_sse(0x66, opcode, inst->dest, inst->src);
+}
+
+static void gen_pshufd(Inst *inst) {
+  // 66 0F 70 /r ib
+  gen_sse(0x66, 0x70, inst->dest, inst->src);
+  gen_imm8(inst->op->imm);
+}
+
+// resolve the short jumps of the pass.
+// returns false if some of them are changed to the near form.
+static bool resolve_branches(void) {
+  bool resolved = true;
+  for (int i = 0; i < branches->length; i++) {
+    Branch *branch = branches->buffer[i];
+    Symbol *symbol = map_lookup(symbols, branch->inst->op->ident);
+
+    // the jumps to global or undefined symbols are left to the linker,
+    // and the other sections are too far to be reached by rel8.
+    int rel = symbol->offset - (branch->offset + 1);
+    if (symbol->global || symbol->section != branch->section || rel < -128 || 127 < rel) {
+      branch->inst->rel32 = true;
+      resolved = false;
+    }
+  }
+  if (!resolved) return false;
+
+  for (int i = 0; i < branches->length; i++) {
+    Branch *branch = branches->buffer[i];
+    Symbol *symbol = map_lookup(symbols, branch->inst->op->ident);
+    branch->bin->buffer[branch->offset] = symbol->offset - (branch->offset + 1);
+  }
+  return true;
+}
+
+static bool encode_pass(Vector *stmts) {
   trans_unit = trans_unit_new();
   bin = trans_unit->text->bin;
   relocs = trans_unit->text->relocs;
   symbols = trans_unit->symbols;
   current = TEXT;
+  branches = vector_new();
 
   for (int i = 0; i < stmts->length; i++) {
     Stmt *stmt = stmts->buffer[i];
+    Vector *stmt_relocs = relocs;
+    int reloc_begin = relocs->length;
     switch (stmt->type) {
       // label
       case ST_LABEL: gen_label((Label *) stmt); break;
@@ -1481,7 +1775,9 @@ TransUnit *as_encode(Vector *stmts) {
       case ST_OR: gen_or((Inst *) stmt); break;
       case ST_SAL: gen_sal((Inst *) stmt); break;
       case ST_SAR: gen_sar((Inst *) stmt); break;
+      case ST_SHR: gen_shr((Inst *) stmt); break;
       case ST_CMP: gen_cmp((Inst *) stmt); break;
+      case ST_TEST: gen_test((Inst *) stmt); break;
       case ST_SETE: gen_sete((Inst *) stmt); break;
       case ST_SETNE: gen_setne((Inst *) stmt); break;
       case ST_SETB: gen_setb((Inst *) stmt); break;
@@ -1491,13 +1787,60 @@ TransUnit *as_encode(Vector *stmts) {
       case ST_SETLE: gen_setle((Inst *) stmt); break;
       case ST_SETGE: gen_setge((Inst *) stmt); break;
       case ST_JMP: gen_jmp((Inst *) stmt); break;
-      case ST_JE: gen_je((Inst *) stmt); break;
-      case ST_JNE: gen_jne((Inst *) stmt); break;
+      case ST_JE: gen_jcc((Inst *) stmt, 0x84); break;
+      case ST_JNE: gen_jcc((Inst *) stmt, 0x85); break;
+      case ST_JB: gen_jcc((Inst *) stmt, 0x82); break;
+      case ST_JBE: gen_jcc((Inst *) stmt, 0x86); break;
+      case ST_JA: gen_jcc((Inst *) stmt, 0x87); break;
+      case ST_JAE: gen_jcc((Inst *) stmt, 0x83); break;
+      case ST_JL: gen_jcc((Inst *) stmt, 0x8c); break;
+      case ST_JLE: gen_jcc((Inst *) stmt, 0x8e); break;
+      case ST_JG: gen_jcc((Inst *) stmt, 0x8f); break;
+      case ST_JGE: gen_jcc((Inst *) stmt, 0x8d); break;
+      case ST_JS: gen_jcc((Inst *) stmt, 0x88); break;
+      case ST_JNS: gen_jcc((Inst *) stmt, 0x89); break;
       case ST_CALL: gen_call((Inst *) stmt); break;
       case ST_LEAVE: gen_leave((Inst *) stmt); break;
       case ST_RET: gen_ret((Inst *) stmt); break;
+      case ST_REP_STOS: gen_rep_string((Inst *) stmt, 0xaa); break;
+      case ST_REP_MOVS: gen_rep_string((Inst *) stmt, 0xa4); break;
+      case ST_MOVD: gen_movd((Inst *) stmt); break;
+      case ST_MOVDQU: gen_movdqu((Inst *) stmt); break;
+      case ST_PADDB: gen_packed((Inst *) stmt, 0xfc); break;
+      case ST_PADDD: gen_packed((Inst *) stmt, 0xfe); break;
+      case ST_PXOR: gen_packed((Inst *) stmt, 0xef); break;
+      case ST_PCMPEQB: gen_packed((Inst *) stmt, 0x74); break;
+      case ST_PMOVMSKB: gen_packed((Inst *) stmt, 0xd7); break;
+      case ST_PSHUFD: gen_pshufd((Inst *) stmt); break;
     }
+
+    // rel32 is relative to the end of the instruction,
+    // which may be followed by an immediate value.
+    for (int j = reloc_begin; j < stmt_relocs->length; j++) {
+      Reloc *reloc = stmt_relocs->buffer[j];
+      if (reloc->type == R_X86_64_PC32) {
+        reloc->addend = reloc->offset - bin->length;
+      }
+    }
+  }
+
+  return resolve_branches();
+}
+
+// branch relaxation
+// Every jump is first encoded in the short form (rel8), and the jumps whose
+// targets are out of range are changed to the near form (rel32) in the
+// next pass. Since a jump is never changed back to the short form, the
+// layout converges in a few passes.
+TransUnit *as_encode(Vector *stmts) {
+  bool converged = false;
+  while (!converged) {
+    converged = encode_pass(stmts);
   }
 
+  stats_count(STAT_RELAXED, branches->length);
+  stats_count(STAT_RELOCS, trans_unit->text->relocs->length);
+  stats_count(STAT_RELOCS, trans_unit->data->relocs->length);
+  stats_count(STAT_RELOCS, trans_unit->rodata->relocs->length);
   return trans_unit;
 }
@@ -8,7 +8,7 @@ noreturn void as_error(Location *loc, char *file, int lineno, char *format, ...)
   fprintf(stderr, " (at %s:%d)\n", file, lineno);
   va_end(ap);
 
-  fprintf(stderr, " %s\n", loc->line);
+  fprintf(stderr, " %.*s\n", line_length(loc->line), loc->line);
   fprintf(stderr, "%*s^\n", loc->column, " ");
 
   exit(1);
@@ -16,14 +16,14 @@ static Binary *gen_rela(Section *section, Map *symbols, Map *gsyms, int current)
     if (symbol->global || symbol->section == UNDEF) {
       int index = (int) (intptr_t) map_lookup(gsyms, reloc->ident);
 
-      Elf64_Rela *rela = (Elf64_Rela *) calloc(1, sizeof(Elf64_Rela));
+      Elf64_Rela *rela = (Elf64_Rela *) arena_alloc(ARENA_AS, sizeof(Elf64_Rela));
       rela->r_offset = reloc->offset;
       rela->r_info = ELF64_R_INFO(index, reloc->type);
       rela->r_addend = reloc->addend;
 
       binary_write(bin, rela, sizeof(Elf64_Rela));
-    } else if (symbol->section != current) {
-      Elf64_Rela *rela = (Elf64_Rela *) calloc(1, sizeof(Elf64_Rela));
+    } else if (symbol->section != current || reloc->type != R_X86_64_PC32) {
+      Elf64_Rela *rela = (Elf64_Rela *) arena_alloc(ARENA_AS, sizeof(Elf64_Rela));
       rela->r_offset = reloc->offset;
       rela->r_info = ELF64_R_INFO(section_syms[symbol->section], reloc->type);
       rela->r_addend = symbol->offset + reloc->addend;
@@ -49,10 +49,10 @@ void gen_obj(TransUnit *trans_unit, char *output) {
   Binary *symtab = binary_new();
   String *strtab = string_new();
 
-  binary_write(symtab, calloc(1, sizeof(Elf64_Sym)), sizeof(Elf64_Sym));
+  binary_write(symtab, arena_alloc(ARENA_AS, sizeof(Elf64_Sym)), sizeof(Elf64_Sym));
   string_push(strtab, '\0');
 
-  Elf64_Sym *text_sym = (Elf64_Sym *) calloc(1, sizeof(Elf64_Sym));
+  Elf64_Sym *text_sym = (Elf64_Sym *) arena_alloc(ARENA_AS, sizeof(Elf64_Sym));
   text_sym->st_name = strtab->length;
   text_sym->st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
   text_sym->st_other = STV_DEFAULT;
@@ -63,7 +63,7 @@ void gen_obj(TransUnit *trans_unit, char *output) {
   string_write(strtab, ".text");
   string_push(strtab, '\0');
 
-  Elf64_Sym *data_sym = (Elf64_Sym *) calloc(1, sizeof(Elf64_Sym));
+  Elf64_Sym *data_sym = (Elf64_Sym *) arena_alloc(ARENA_AS, sizeof(Elf64_Sym));
   data_sym->st_name = strtab->length;
   data_sym->st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
   data_sym->st_other = STV_DEFAULT;
@@ -74,7 +74,7 @@ void gen_obj(TransUnit *trans_unit, char *output) {
   string_write(strtab, ".data");
   string_push(strtab, '\0');
 
-  Elf64_Sym *rodata_sym = (Elf64_Sym *) calloc(1, sizeof(Elf64_Sym));
+  Elf64_Sym *rodata_sym = (Elf64_Sym *) arena_alloc(ARENA_AS, sizeof(Elf64_Sym));
   rodata_sym->st_name = strtab->length;
   rodata_sym->st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
   rodata_sym->st_other = STV_DEFAULT;
@@ -90,7 +90,7 @@ void gen_obj(TransUnit *trans_unit, char *output) {
     Symbol *symbol = symbols->values[i];
 
     if (symbol->global || symbol->section == UNDEF) {
-      Elf64_Sym *sym = (Elf64_Sym *) calloc(1, sizeof(Elf64_Sym));
+      Elf64_Sym *sym = (Elf64_Sym *) arena_alloc(ARENA_AS, sizeof(Elf64_Sym));
       sym->st_name = strtab->length;
       sym->st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
       sym->st_other = STV_DEFAULT;
@@ -132,7 +132,7 @@ void gen_obj(TransUnit *trans_unit, char *output) {
 
   // section header table
   int offset = sizeof(Elf64_Ehdr);
-  Elf64_Shdr *shdrtab = (Elf64_Shdr *) calloc(SHNUM, sizeof(Elf64_Shdr));
+  Elf64_Shdr *shdrtab = arena_alloc(ARENA_AS, sizeof(Elf64_Shdr) * SHNUM);
 
   // section header for .text
   shdrtab[TEXT].sh_name = names[TEXT];
@@ -193,7 +193,7 @@ void gen_obj(TransUnit *trans_unit, char *output) {
     shdrtab[RELA_RODATA].sh_size = rela_rodata->length;
     shdrtab[RELA_RODATA].sh_link = SYMTAB;
     shdrtab[RELA_RODATA].sh_info = RODATA;
-    shdrtab[RELA_DATA].sh_entsize = sizeof(Elf64_Rela);
+    shdrtab[RELA_RODATA].sh_entsize = sizeof(Elf64_Rela);
     offset += rela_rodata->length;
   }
 
@@ -222,7 +222,7 @@ void gen_obj(TransUnit *trans_unit, char *output) {
   offset += shstrtab->length;
 
   // ELF header
-  Elf64_Ehdr *ehdr = (Elf64_Ehdr *) calloc(1, sizeof(Elf64_Ehdr));
+  Elf64_Ehdr *ehdr = (Elf64_Ehdr *) arena_alloc(ARENA_AS, sizeof(Elf64_Ehdr));
   ehdr->e_ident[0] = 0x7f;
   ehdr->e_ident[1] = 'E';
   ehdr->e_ident[2] = 'L';
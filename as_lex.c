@@ -1,137 +1,102 @@
 #include "as.h"
 
-static char *regs[16][4] = {
-  { "al", "ax", "eax", "rax" },
-  { "cl", "cx", "ecx", "rcx" },
-  { "dl", "dx", "edx", "rdx" },
-  { "bl", "bx", "ebx", "rbx" },
-  { "spl", "sp", "esp", "rsp" },
-  { "bpl", "bp", "ebp", "rbp" },
-  { "sil", "si", "esi", "rsi" },
-  { "dil", "di", "edi", "rdi" },
-  { "r8b", "r8w", "r8d", "r8" },
-  { "r9b", "r9w", "r9d", "r9" },
-  { "r10b", "r10w", "r10d", "r10" },
-  { "r11b", "r11w", "r11d", "r11" },
-  { "r12b", "r12w", "r12d", "r12" },
-  { "r13b", "r13w", "r13d", "r13" },
-  { "r14b", "r14w", "r14d", "r14" },
-  { "r15b", "r15w", "r15d", "r15" },
+static char *regs[16][5] = {
+  { "al", "ax", "eax", "rax", "xmm0" },
+  { "cl", "cx", "ecx", "rcx", "xmm1" },
+  { "dl", "dx", "edx", "rdx", "xmm2" },
+  { "bl", "bx", "ebx", "rbx", "xmm3" },
+  { "spl", "sp", "esp", "rsp", "xmm4" },
+  { "bpl", "bp", "ebp", "rbp", "xmm5" },
+  { "sil", "si", "esi", "rsi", "xmm6" },
+  { "dil", "di", "edi", "rdi", "xmm7" },
+  { "r8b", "r8w", "r8d", "r8", "xmm8" },
+  { "r9b", "r9w", "r9d", "r9", "xmm9" },
+  { "r10b", "r10w", "r10d", "r10", "xmm10" },
+  { "r11b", "r11w", "r11d", "r11", "xmm11" },
+  { "r12b", "r12w", "r12d", "r12", "xmm12" },
+  { "r13b", "r13w", "r13d", "r13", "xmm13" },
+  { "r14b", "r14w", "r14d", "r14", "xmm14" },
+  { "r15b", "r15w", "r15d", "r15", "xmm15" },
 };
 
+static Map *registers;
+
 static char *filename;
 
 static char *src;
 static int pos;
 
-static char **cur_line;
+static char *line; // head of the current line
 static int lineno;
 static int column;
 
 Location *loc;
 
-static char *read_file(void) {
-  FILE *fp;
-  if (strcmp(filename, "-") == 0) {
-    filename = "stdin";
-    fp = stdin;
-  } else {
-    fp = fopen(filename, "r");
-    if (!fp) {
-      perror(filename);
-      exit(1);
-    }
-  }
-
-  String *file = string_new();
-  char buffer[4096];
-  while (1) {
-    int n = fread(buffer, 1, sizeof(buffer), fp);
-    if (n == 0) break;
-    for (int i = 0; i < n; i++) {
-      string_push(file, buffer[i]);
-    }
-  }
-
-  fclose(fp);
-
-  String *src = string_new();
-  for (int i = 0; i < file->length; i++) {
-    char c = file->buffer[i];
-    if (c == '\r' && i + 1 < file->length && file->buffer[i + 1] == '\n') {
-      c = '\n';
-      i++;
-    }
-    string_push(src, c);
-  }
-
-  return src->buffer;
-}
-
-static char **split_lines(char *orig_src) {
-  String *src = string_new();
-  string_write(src, orig_src);
-
-  Vector *lines = vector_new();
-  for (int i = 0; i < src->length; i++) {
-    vector_push(lines, &src->buffer[i]);
-
-    while (src->buffer[i] != '\n') i++;
-    src->buffer[i] = '\0';
-  }
-
-  return (char **) lines->buffer;
-}
-
 static Location *create_location(void) {
-  Location *loc = calloc(1, sizeof(Location));
+  Location *loc = arena_alloc(ARENA_LEX, sizeof(Location));
   loc->filename = filename;
-  loc->line = *cur_line;
+  loc->line = line;
   loc->lineno = lineno;
   loc->column = column;
   return loc;
 }
 
 static Token *create_token(TokenType type) {
-  Token *token = (Token *) calloc(1, sizeof(Token));
+  Token *token = arena_alloc(ARENA_LEX, sizeof(Token));
   token->type = type;
   token->loc = loc;
   return token;
 }
 
+// '\r' of "\r\n" is skipped, so that the newline is read as '\n'.
 static char peek_char(void) {
+  if (src[pos] == '\r' && src[pos + 1] == '\n') {
+    pos++;
+  }
   return src[pos];
 }
 
 static char get_char(void) {
+  char c = peek_char();
+  pos++;
+
   column++;
-  if (src[pos] == '\n') {
-    cur_line++;
+  if (c == '\n') {
+    line = &src[pos];
     lineno++;
     column = 1;
   }
 
-  return src[pos++];
+  return c;
 }
 
-static RegSize regtype(char *reg) {
+// Map<(RegCode * 5 + RegSize + 1)>
+static Map *create_registers(void) {
+  Map *map = map_new();
+
   for (int i = 0; i < 16; i++) {
-    for (int j = 0; j < 4; j++) {
-      if (strcmp(reg, regs[i][j]) == 0) return j;
+    for (int j = 0; j < 5; j++) {
+      map_puti(map, regs[i][j], i * 5 + j + 1);
     }
   }
 
-  as_error(loc, __FILE__, __LINE__, "unknown register: %s.", reg);
+  return map;
 }
 
-static RegCode regcode(char *reg) {
-  for (int i = 0; i < 16; i++) {
-    for (int j = 0; j < 4; j++) {
-      if (strcmp(reg, regs[i][j]) == 0) return i;
-    }
+static RegSize regtype(char *reg) {
+  int value = map_lookupi(registers, reg);
+  if (!value) {
+    as_error(loc, __FILE__, __LINE__, "unknown register: %s.", reg);
   }
+  return (value - 1) % 5;
+}
 
-  as_error(loc, __FILE__, __LINE__, "unknown register: %s.", reg);
+static RegCode regcode(char *reg) {
+  int value = map_lookupi(registers, reg);
+  if (!value) {
+    as_error(loc, __FILE__, __LINE__, "unknown register: %s.", reg);
+  }
+  return (value - 1) / 5;
 }
 
 static char escape_sequence(void) {
@@ -174,7 +139,7 @@ static Token *next_token(void) {
     }
 
     Token *token = create_token(TK_IDENT);
-    token->ident = ident->buffer;
+    token->ident = intern(ident->buffer)->name;
     return token;
   }
 
@@ -210,7 +175,7 @@ static Token *next_token(void) {
 
   // immediate
   if (c == '$') {
-    unsigned int imm = 0;
+    unsigned long long imm = 0;
     if (!isdigit(peek_char())) {
       as_error(loc, __FILE__, __LINE__, "invalid immediate.");
     }
@@ -242,6 +207,7 @@ static Token *next_token(void) {
   if (c == ',') return create_token(TK_COMMA);
   if (c == '(') return create_token(TK_LPAREN);
   if (c == ')') return create_token(TK_RPAREN);
+  if (c == '*') return create_token(TK_STAR);
   if (c == ':') return create_token(TK_SEMICOLON);
 
   as_error(loc, __FILE__, __LINE__,  "failed to tokenize.");
@@ -250,13 +216,20 @@ static Token *next_token(void) {
 Vector *as_tokenize(char *_filename) {
   filename = _filename;
 
-  src = read_file();
+  src = load_source(filename);
   pos = 0;
+  if (strcmp(filename, "-") == 0) {
+    filename = "stdin";
+  }
 
-  cur_line = split_lines(src);
+  line = src;
   lineno = 1;
   column = 1;
 
+  if (!registers) {
+    registers = create_registers();
+  }
+
   Vector *tokens = vector_new();
   while (1) {
     Token *token = next_token();
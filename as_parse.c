@@ -1,21 +1,21 @@
 #include "as.h"
 
 static Label *label_new(char *ident, Token *token) {
-  Label *label = (Label *) calloc(1, sizeof(Label));
+  Label *label = arena_alloc(ARENA_AS, sizeof(Label));
   label->ident = ident;
   label->token = token;
   return label;
 }
 
 static Dir *dir_new(StmtType type, Token *token) {
-  Dir *dir = (Dir *) calloc(1, sizeof(Dir));
+  Dir *dir = arena_alloc(ARENA_AS, sizeof(Dir));
   dir->type = type;
   dir->token = token;
   return dir;
 }
 
 static Op *op_new(OpType type, Token *token) {
-  Op *op = (Op *) calloc(1, sizeof(Op));
+  Op *op = arena_alloc(ARENA_AS, sizeof(Op));
   op->type = type;
   op->token = token;
   return op;
@@ -58,14 +58,15 @@ static Op *op_sym(char *ident, Token *token) {
   return op;
 }
 
-static Op *op_imm(int imm, Token *token) {
+static Op *op_imm(unsigned long long imm, Token *token) {
   Op *op = op_new(OP_IMM, token);
   op->imm = imm;
   return op;
 }
 
 static Inst *inst_new(StmtType type, InstSuffix suffix, Vector *ops, Token *token) {
-  Inst *inst = (Inst *) calloc(1, sizeof(Inst));
+  Inst *inst = arena_alloc(ARENA_AS, sizeof(Inst));
+  stats_count(STAT_INSTS, 1);
   inst->type = type;
   inst->suffix = suffix;
   inst->ops = ops;
@@ -116,14 +117,14 @@ static Map *insts;
 static Map *create_dirs(void) {
   Map *map = map_new();
 
-  map_puti(map, ".text", ST_TEXT);
-  map_puti(map, ".data", ST_DATA);
-  map_puti(map, ".section", ST_SECTION);
-  map_puti(map, ".global", ST_GLOBAL);
-  map_puti(map, ".zero", ST_ZERO);
-  map_puti(map, ".long", ST_LONG);
-  map_puti(map, ".quad", ST_QUAD);
-  map_puti(map, ".ascii", ST_ASCII);
+  map_puti(map, intern(".text")->name, ST_TEXT);
+  map_puti(map, intern(".data")->name, ST_DATA);
+  map_puti(map, intern(".section")->name, ST_SECTION);
+  map_puti(map, intern(".global")->name, ST_GLOBAL);
+  map_puti(map, intern(".zero")->name, ST_ZERO);
+  map_puti(map, intern(".long")->name, ST_LONG);
+  map_puti(map, intern(".quad")->name, ST_QUAD);
+  map_puti(map, intern(".ascii")->name, ST_ASCII);
 
   return map;
 }
@@ -137,18 +138,27 @@ static void put_insts(Map *map, char *inst, StmtType type) {
     string_write(key, inst);
     string_push(key, suffix_char[i]);
 
-    InstTypeSuffix *value = calloc(1, sizeof(InstTypeSuffix));
+    InstTypeSuffix *value = arena_alloc(ARENA_AS, sizeof(InstTypeSuffix));
     value->type = type;
     value->suffix = suffix[i];
 
-    map_put(map, key->buffer, value);
+    map_put(map, intern(key->buffer)->name, value);
   }
 
-  InstTypeSuffix *value = calloc(1, sizeof(InstTypeSuffix));
+  InstTypeSuffix *value = arena_alloc(ARENA_AS, sizeof(InstTypeSuffix));
   value->type = type;
   value->suffix = -1;
 
-  map_put(map, inst, value);
+  map_put(map, intern(inst)->name, value);
+}
+
+// the SSE instructions have no suffix.
+static void put_inst(Map *map, char *inst, StmtType type) {
+  InstTypeSuffix *value = arena_alloc(ARENA_AS, sizeof(InstTypeSuffix));
+  value->type = type;
+  value->suffix = -1;
+
+  map_put(map, intern(inst)->name, value);
 }
 
 static Map *create_insts(void) {
@@ -178,7 +188,9 @@ static Map *create_insts(void) {
   put_insts(map, "or", ST_OR);
   put_insts(map, "sal", ST_SAL);
   put_insts(map, "sar", ST_SAR);
+  put_insts(map, "shr", ST_SHR);
   put_insts(map, "cmp", ST_CMP);
+  put_insts(map, "test", ST_TEST);
   put_insts(map, "sete", ST_SETE);
   put_insts(map, "setne", ST_SETNE);
   put_insts(map, "setb", ST_SETB);
@@ -190,9 +202,29 @@ static Map *create_insts(void) {
   put_insts(map, "jmp", ST_JMP);
   put_insts(map, "je", ST_JE);
   put_insts(map, "jne", ST_JNE);
+  put_insts(map, "jb", ST_JB);
+  put_insts(map, "jbe", ST_JBE);
+  put_insts(map, "ja", ST_JA);
+  put_insts(map, "jae", ST_JAE);
+  put_insts(map, "jl", ST_JL);
+  put_insts(map, "jle", ST_JLE);
+  put_insts(map, "jg", ST_JG);
+  put_insts(map, "jge", ST_JGE);
+  put_insts(map, "js", ST_JS);
+  put_insts(map, "jns", ST_JNS);
   put_insts(map, "call", ST_CALL);
   put_insts(map, "leave", ST_LEAVE);
   put_insts(map, "ret", ST_RET);
+  put_insts(map, "rep stos", ST_REP_STOS);
+  put_insts(map, "rep movs", ST_REP_MOVS);
+  put_inst(map, "movd", ST_MOVD);
+  put_inst(map, "movdqu", ST_MOVDQU);
+  put_inst(map, "paddb", ST_PADDB);
+  put_inst(map, "paddd", ST_PADDD);
+  put_inst(map, "pxor", ST_PXOR);
+  put_inst(map, "pcmpeqb", ST_PCMPEQB);
+  put_inst(map, "pmovmskb", ST_PMOVMSKB);
+  put_inst(map, "pshufd", ST_PSHUFD);
 
   return map;
 }
@@ -357,6 +389,14 @@ static Vector *parse_ops(void) {
         vector_push(ops, parse_immediate());
         break;
       }
+      case TK_STAR: {
+        // '*' register or memory operand of indirect jump
+        expect(TK_STAR);
+        Op *op = check(TK_REG) ? parse_reg() : parse_memory();
+        op->indirect = true;
+        vector_push(ops, op);
+        break;
+      }
       default: {
         ERROR(peek(), "invalid operand.");
       }
@@ -388,7 +428,17 @@ static Stmt *parse_stmt(void) {
   }
 
   // instructions
-  InstTypeSuffix *inst = map_lookup(insts, token->ident);
+  // the rep prefix is combined with the following string instruction.
+  char *name = token->ident;
+  if (strcmp(name, "rep") == 0) {
+    String *key = string_new();
+    string_write(key, name);
+    string_push(key, ' ');
+    string_write(key, expect(TK_IDENT)->ident);
+    name = intern(key->buffer)->name;
+  }
+
+  InstTypeSuffix *inst = map_lookup(insts, name);
   if (inst) {
     return (Stmt *) parse_inst(inst->type, inst->suffix, token);
   }
@@ -7,6 +7,7 @@ static InstSuffix operand_suffix(Op *op) {
       case REG_WORD: return INST_WORD;
       case REG_LONG: return INST_LONG;
       case REG_QUAD: return INST_QUAD;
+      case REG_XMM: break;
     }
   }
 
@@ -93,6 +94,14 @@ static void sema_inst_op2(Inst *inst, InstSuffix default_suffix) {
   if (inst->suffix == -1) {
     ERROR(inst->token, "operand type mismatched.");
   }
+
+  // a 64-bit immediate is sign-extended from 32 bits,
+  // except for the one moved to a register.
+  if (inst->src->type == OP_IMM && inst->suffix == INST_QUAD && inst->src->imm + 0x80000000 > 0xffffffff) {
+    if (inst->type != ST_MOV || inst->dest->type != OP_REG) {
+      ERROR(inst->token, "immediate value is out of range.");
+    }
+  }
 }
 
 static void sema_inst_src_dest(Inst *inst, InstSuffix src_suffix, InstSuffix default_suffix) {
@@ -133,9 +142,76 @@ static void sema_inst_src_dest(Inst *inst, InstSuffix src_suffix, InstSuffix def
   }
 }
 
+static bool check_xmm(Op *op) {
+  return op->type == OP_REG && op->regtype == REG_XMM;
+}
+
+static bool check_xmm_mem(Op *op) {
+  return check_xmm(op) || op->type == OP_MEM;
+}
+
+// the SSE instructions take the vector registers or the memory,
+// except for the 32-bit register of movd and pmovmskb.
+// the first operand of pshufd is an 8-bit immediate.
+static void sema_inst_sse(Inst *inst) {
+  Vector *ops = inst->ops;
+  int n = inst->type == ST_PSHUFD ? 3 : 2;
+  if (ops->length != n) {
+    ERROR(inst->token, n == 3 ? "3 operands are expected." : "2 operands are expected.");
+  }
+  if (n == 3) {
+    inst->op = ops->buffer[0];
+    if (inst->op->type != OP_IMM || inst->op->imm > 255) {
+      ERROR(inst->token, "8-bit immediate is expected.");
+    }
+  }
+  inst->src = ops->buffer[n - 2];
+  inst->dest = ops->buffer[n - 1];
+
+  if (inst->src->type == OP_MEM && inst->dest->type == OP_MEM) {
+    ERROR(inst->token, "both of source and destination cannot be memory operands.");
+  }
+
+  bool valid;
+  switch (inst->type) {
+    case ST_MOVD: {
+      Op *other = check_xmm(inst->dest) ? inst->src : inst->dest;
+      bool reg = other->type == OP_REG && other->regtype == REG_LONG;
+      valid = (check_xmm(inst->src) || check_xmm(inst->dest)) && (reg || other->type == OP_MEM);
+      break;
+    }
+    case ST_MOVDQU: {
+      valid = check_xmm_mem(inst->src) && check_xmm_mem(inst->dest);
+      break;
+    }
+    case ST_PMOVMSKB: {
+      valid = check_xmm(inst->src) && inst->dest->type == OP_REG && inst->dest->regtype == REG_LONG;
+      break;
+    }
+    default: {
+      valid = check_xmm_mem(inst->src) && check_xmm(inst->dest);
+      break;
+    }
+  }
+  if (!valid) {
+    ERROR(inst->token, "operand type mismatched.");
+  }
+}
+
 void as_sema(Vector *stmts) {
   for (int i = 0; i < stmts->length; i++) {
     Stmt *stmt = stmts->buffer[i];
+
+    // the vector registers are only for the SSE instructions.
+    if (ST_PUSH <= stmt->type && stmt->type < ST_MOVD) {
+      Inst *inst = (Inst *) stmt;
+      for (int j = 0; j < inst->ops->length; j++) {
+        if (check_xmm(inst->ops->buffer[j])) {
+          ERROR(inst->token, "vector register is not supported.");
+        }
+      }
+    }
+
     switch (stmt->type) {
       case ST_CLTD: {
         sema_inst_op0((Inst *) stmt, INST_LONG);
@@ -147,6 +223,22 @@ void as_sema(Vector *stmts) {
         sema_inst_op0((Inst *) stmt, INST_QUAD);
         break;
       }
+      case ST_REP_STOS:
+      case ST_REP_MOVS: {
+        sema_inst_op0((Inst *) stmt, -1);
+        break;
+      }
+      case ST_MOVD:
+      case ST_MOVDQU:
+      case ST_PADDB:
+      case ST_PADDD:
+      case ST_PXOR:
+      case ST_PCMPEQB:
+      case ST_PMOVMSKB:
+      case ST_PSHUFD: {
+        sema_inst_sse((Inst *) stmt);
+        break;
+      }
       case ST_PUSH:
       case ST_POP: {
         Inst *inst = (Inst *) stmt;
@@ -159,10 +251,21 @@ void as_sema(Vector *stmts) {
         }
         break;
       }
+      case ST_IMUL: {
+        Inst *inst = (Inst *) stmt;
+        if (inst->ops->length != 2) {
+          sema_inst_op1(inst, -1);
+          break;
+        }
+        sema_inst_op2(inst, -1);
+        if (inst->dest->type != OP_REG) {
+          ERROR(inst->token, "destination should be register operand.");
+        }
+        break;
+      }
       case ST_NEG:
       case ST_NOT:
       case ST_MUL:
-      case ST_IMUL:
       case ST_DIV:
       case ST_IDIV: {
         sema_inst_op1((Inst *) stmt, -1);
@@ -171,10 +274,27 @@ void as_sema(Vector *stmts) {
       case ST_JMP:
       case ST_JE:
       case ST_JNE:
+      case ST_JB:
+      case ST_JBE:
+      case ST_JA:
+      case ST_JAE:
+      case ST_JL:
+      case ST_JLE:
+      case ST_JG:
+      case ST_JGE:
+      case ST_JS:
+      case ST_JNS:
       case ST_CALL: {
         Inst *inst = (Inst *) stmt;
         sema_inst_op1(inst, INST_QUAD);
-        if (inst->op->type != OP_SYM) {
+        if (inst->op->indirect) {
+          if (inst->type != ST_JMP) {
+            ERROR(inst->token, "only jmp supports indirect jump.");
+          }
+          if (inst->op->type == OP_REG && inst->op->regtype != REG_QUAD) {
+            ERROR(inst->token, "only 64-bit register is supported.");
+          }
+        } else if (inst->op->type != OP_SYM) {
           ERROR(inst->token, "only symbol is supported.");
         }
         if (inst->suffix != INST_QUAD) {
@@ -199,7 +319,8 @@ void as_sema(Vector *stmts) {
       case ST_AND:
       case ST_XOR:
       case ST_OR:
-      case ST_CMP: {
+      case ST_CMP:
+      case ST_TEST: {
         sema_inst_op2((Inst *) stmt, -1);
         break;
       }
@@ -212,11 +333,16 @@ void as_sema(Vector *stmts) {
         break;
       }
       case ST_SAL:
-      case ST_SAR: {
+      case ST_SAR:
+      case ST_SHR: {
         Inst *inst = (Inst *) stmt;
         sema_inst_src_dest(inst, INST_BYTE, -1);
-        if (inst->src->regcode != REG_CX) {
-          ERROR(inst->token, "only %%cl is supported.");
+        if (inst->src->type == OP_IMM) {
+          if (inst->src->imm > 63) {
+            ERROR(inst->token, "shift count is out of range.");
+          }
+        } else if (inst->src->type != OP_REG || inst->src->regcode != REG_CX) {
+          ERROR(inst->token, "only %%cl or an immediate is supported.");
         }
         break;
       }
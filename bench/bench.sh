@@ -0,0 +1,54 @@
+#!/bin/bash
+
+# compile-throughput benchmark
+#   usage: ./bench/bench.sh [compiler...]
+# the inputs are generated at each scale of $BENCH_SCALES,
+# and lines/sec and peak RSS are measured for each compiler.
+# the results are written to tmp/bench/results.tsv.
+# if lines/sec drops as the scale grows, the compiler does not scale linearly.
+
+scales=${BENCH_SCALES:-"1 2"}
+inputs="funcs nested switch macros structs init"
+
+dir=tmp/bench
+results=$dir/results.tsv
+
+mkdir -p $dir
+gcc -std=c11 -O2 -Wall bench/run.c -o $dir/run || exit 1
+
+printf "compiler\tinput\tscale\tlines\twall_ms\tlines_per_sec\tmax_rss_kb\n" > $results
+
+# measure [compiler] [input] [scale] [lines] [command...]
+measure() {
+  compiler=$1
+  input=$2
+  scale=$3
+  lines=$4
+  shift 4
+
+  result=`$dir/run "$@"` || exit 1
+  echo "$result" | awk -v c=$compiler -v i=$input -v s=$scale -v l=$lines '{
+    wall = $1 > 0 ? $1 : 1
+    printf "%s\t%s\t%d\t%d\t%.1f\t%d\t%d\n", c, i, s, l, wall / 1000, l * 1000000 / wall, $2
+  }' >> $results
+}
+
+for scale in $scales; do
+  src=$dir/s$scale
+  ./bench/gen.sh $src $scale
+
+  # long assembly source for --as
+  ./sk2cc -S $src/funcs.c -o $src/asm.s || exit 1
+
+  for compiler in "$@"; do
+    name=`basename $compiler`
+    for input in $inputs; do
+      lines=`wc -l < $src/$input.c`
+      measure $name $input $scale $lines $compiler -c $src/$input.c -o $src/$input.o
+    done
+    lines=`wc -l < $src/asm.s`
+    measure $name asm $scale $lines $compiler --as $src/asm.s $src/asm.o
+  done
+done
+
+cat $results
@@ -0,0 +1,82 @@
+#!/bin/bash
+
+# generate synthetic translation units for the benchmark.
+#   usage: ./bench/gen.sh [output directory] [scale]
+# the size of each input grows linearly with the scale.
+
+dir=$1
+scale=${2:-1}
+
+mkdir -p $dir
+
+# thousands of small functions calling each other
+awk -v n=$((2000 * scale)) 'BEGIN {
+  for (i = 0; i < n; i++) {
+    printf "int f%d(int a, int b) {\n", i
+    printf "  int x = a * %d + b;\n", i % 7 + 1
+    printf "  if (x < b) {\n"
+    printf "    x = x + %d;\n", i
+    printf "  } else {\n"
+    printf "    x = x - b;\n"
+    printf "  }\n"
+    if (i > 0) printf "  return f%d(x, a) + x;\n", i - 1
+    else printf "  return x;\n"
+    printf "}\n\n"
+  }
+}' > $dir/funcs.c
+
+# deeply nested expressions
+awk -v n=$((200 * scale)) -v depth=100 'BEGIN {
+  for (i = 0; i < n; i++) {
+    printf "int nested%d(int a, int b) {\n  return ", i
+    for (j = 0; j < depth; j++) printf "("
+    printf "a"
+    for (j = 0; j < depth; j++) {
+      op = substr("+-*&|^", j % 6 + 1, 1)
+      printf " %s (b + %d))", op, j
+    }
+    printf ";\n}\n\n"
+  }
+}' > $dir/nested.c
+
+# large switch statements
+awk -v n=$((20 * scale)) -v cases=500 'BEGIN {
+  for (i = 0; i < n; i++) {
+    printf "int switch%d(int x) {\n  int y = 0;\n  switch (x) {\n", i
+    for (j = 0; j < cases; j++) {
+      printf "    case %d:\n      y = x + %d;\n      break;\n", j, j * 3
+    }
+    printf "    default:\n      y = -1;\n  }\n  return y;\n}\n\n"
+  }
+}' > $dir/switch.c
+
+# heavy macro use
+awk -v n=$((500 * scale)) -v chain=20 'BEGIN {
+  printf "#define M0(x) ((x) + 1)\n"
+  for (j = 1; j < chain; j++) printf "#define M%d(x) M%d((x) * 2)\n", j, j - 1
+  printf "#define ZERO 0\n#define ONE (ZERO + 1)\n#define TWO (ONE + ONE)\n\n"
+  for (i = 0; i < n; i++) {
+    printf "int macro%d(int a) {\n  return M%d(a) + M%d(TWO) + ONE;\n}\n\n", i, chain - 1, i % chain
+  }
+}' > $dir/macros.c
+
+# wide structs
+awk -v n=$((50 * scale)) -v members=200 'BEGIN {
+  for (i = 0; i < n; i++) {
+    printf "struct wide%d {\n", i
+    for (j = 0; j < members; j++) printf "  %s m%d;\n", (j % 3 == 0 ? "char" : (j % 3 == 1 ? "int" : "long")), j
+    printf "};\n\n"
+    printf "long sum%d(struct wide%d *p) {\n  long s = 0;\n", i, i
+    for (j = 0; j < members; j += 10) printf "  s = s + p->m%d;\n", j
+    printf "  return s;\n}\n\n"
+  }
+}' > $dir/structs.c
+
+# huge initializers
+awk -v n=$((20 * scale)) -v elems=2000 'BEGIN {
+  for (i = 0; i < n; i++) {
+    printf "int table%d[%d] = {", i, elems
+    for (j = 0; j < elems; j++) printf "%s%s%d", (j > 0 ? "," : ""), (j % 16 == 0 ? "\n  " : " "), (j * 7919 + i) % 65536
+    printf "\n};\n\n"
+  }
+}' > $dir/init.c
@@ -0,0 +1,129 @@
+// runtime benchmark kernels
+//   usage: kernels [kernel] [n]
+// each kernel is a loop over the expression patterns of tests/test.c
+// (arithmetic, array subscription, pointers, calls and conditions).
+
+int printf(char *format, ...);
+int strcmp(char *s1, char *s2);
+int atoi(char *s);
+
+int fib(int n) {
+  return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+int sieve(int n) {
+  char flags[8192];
+  int count = 0;
+  for (int k = 0; k < n; k++) {
+    count = 0;
+    for (int i = 2; i < 8192; i++) {
+      flags[i] = 1;
+    }
+    for (int i = 2; i < 8192; i++) {
+      if (flags[i]) {
+        for (int j = i + i; j < 8192; j += i) {
+          flags[j] = 0;
+        }
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+int matmul(int n) {
+  int a[32][32], b[32][32], c[32][32];
+  for (int i = 0; i < 32; i++) {
+    for (int j = 0; j < 32; j++) {
+      a[i][j] = i + j;
+      b[i][j] = i - j;
+    }
+  }
+  int sum = 0;
+  for (int k = 0; k < n; k++) {
+    for (int i = 0; i < 32; i++) {
+      for (int j = 0; j < 32; j++) {
+        int x = 0;
+        for (int l = 0; l < 32; l++) {
+          x += a[i][l] * b[l][j];
+        }
+        c[i][j] = x;
+      }
+    }
+    sum += c[k % 32][(k * 7) % 32];
+  }
+  return sum;
+}
+
+int collatz(int n) {
+  int max = 0;
+  for (int i = 1; i < n; i++) {
+    long x = i;
+    int steps = 0;
+    while (x != 1) {
+      x = x % 2 == 0 ? x / 2 : x * 3 + 1;
+      steps++;
+    }
+    if (steps > max) max = steps;
+  }
+  return max;
+}
+
+int hash(int n) {
+  int h = 5381;
+  for (int i = 0; i < n; i++) {
+    h = (h * 33 + (i ^ (h << 3)) + (h >> 7)) & 16777215;
+  }
+  return h;
+}
+
+int sort(int n) {
+  int a[1024];
+  int sum = 0;
+  for (int k = 0; k < n; k++) {
+    for (int i = 0; i < 1024; i++) {
+      a[i] = (i * 7919 + k) % 1024;
+    }
+    for (int i = 1; i < 1024; i++) {
+      int x = a[i];
+      int *p = &a[i];
+      while (p > a && *(p - 1) > x) {
+        *p = *(p - 1);
+        p--;
+      }
+      *p = x;
+    }
+    sum += a[k % 1024];
+  }
+  return sum;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    printf("usage: %s [fib|sieve|matmul|collatz|hash|sort] [n]\n", argv[0]);
+    return 1;
+  }
+
+  char *kernel = argv[1];
+  int n = atoi(argv[2]);
+  int result = 0;
+  if (strcmp(kernel, "fib") == 0) {
+    result = fib(n);
+  } else if (strcmp(kernel, "sieve") == 0) {
+    result = sieve(n);
+  } else if (strcmp(kernel, "matmul") == 0) {
+    result = matmul(n);
+  } else if (strcmp(kernel, "collatz") == 0) {
+    result = collatz(n);
+  } else if (strcmp(kernel, "hash") == 0) {
+    result = hash(n);
+  } else if (strcmp(kernel, "sort") == 0) {
+    result = sort(n);
+  } else {
+    printf("unknown kernel: %s\n", kernel);
+    return 1;
+  }
+
+  printf("%d\n", result);
+  return 0;
+}
@@ -0,0 +1,53 @@
+// run a command, and print its wall time (us) and peak RSS (KB).
+//   usage: ./run [command] [args...]
+// this is a host tool compiled by gcc, so it uses the system headers.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+static long clock_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s [command] [args...]\n", argv[0]);
+    exit(1);
+  }
+
+  long start = clock_us();
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    exit(1);
+  }
+  if (pid == 0) {
+    execv(argv[1], &argv[1]);
+    perror(argv[1]);
+    exit(127);
+  }
+
+  int status;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) < 0) {
+    perror("wait4");
+    exit(1);
+  }
+
+  long wall = clock_us() - start;
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "%s: failed\n", argv[1]);
+    exit(1);
+  }
+
+  printf("%ld %ld\n", wall, usage.ru_maxrss);
+  return 0;
+}
@@ -0,0 +1,45 @@
+#!/bin/bash
+
+# runtime benchmark of the generated code
+#   usage: ./bench/runtime.sh [compiler...]
+# a compiler may have options, e.g. './sk2cc -O1'.
+# bench/kernels.c is compiled by each compiler with -c and linked by gcc,
+# and the wall time of each kernel is measured.
+# the result of each kernel is checked against the one compiled by gcc.
+# the results are written to tmp/bench/runtime.tsv.
+
+kernels="fib:35 sieve:1000 matmul:400 collatz:300000 hash:30000000 sort:100"
+
+dir=tmp/bench
+results=$dir/runtime.tsv
+
+mkdir -p $dir
+gcc -std=c11 -O2 -Wall bench/run.c -o $dir/run || exit 1
+gcc -w bench/kernels.c -o $dir/kernels-gcc || exit 1
+
+printf "compiler\tkernel\tn\twall_ms\n" > $results
+
+for compiler in "$@"; do
+  name=`basename "$compiler" | tr -d ' '`
+  $compiler -c bench/kernels.c -o $dir/kernels-$name.o || exit 1
+  gcc -no-pie $dir/kernels-$name.o -o $dir/kernels-$name 2> /dev/null || exit 1
+
+  for kernel in $kernels; do
+    k=${kernel%:*}
+    n=${kernel#*:}
+
+    expected=`$dir/kernels-gcc $k $n`
+    actual=`$dir/kernels-$name $k $n`
+    if [ "$actual" != "$expected" ]; then
+      echo "$name: $k $n should be $expected, but got $actual."
+      exit 1
+    fi
+
+    result=`$dir/run $dir/kernels-$name $k $n | tail -n 1` || exit 1
+    echo "$result" | awk -v c=$name -v k=$k -v n=$n '{
+      printf "%s\t%s\t%d\t%.1f\n", c, k, n, $1 / 1000
+    }' >> $results
+  done
+done
+
+cat $results
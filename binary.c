@@ -9,26 +9,70 @@ Binary *binary_new(void) {
   return binary;
 }
 
-void binary_push(Binary *binary, Byte byte) {
-  if (binary->length >= binary->capacity) {
-    binary->capacity *= 2;
+// make room for size more bytes.
+void binary_reserve(Binary *binary, int size) {
+  if (binary->length + size > binary->capacity) {
+    while (binary->length + size > binary->capacity) {
+      binary->capacity *= 2;
+    }
     binary->buffer = realloc(binary->buffer, binary->capacity);
   }
+}
+
+void binary_push(Binary *binary, Byte byte) {
+  binary_reserve(binary, 1);
   binary->buffer[binary->length++] = byte;
 }
 
 void binary_append(Binary *binary, int size, ...) {
+  binary_reserve(binary, size);
+
   va_list ap;
   va_start(ap, size);
   for (int i = 0; i < size; i++) {
-    Byte byte = va_arg(ap, int);
-    binary_push(binary, byte);
+    binary->buffer[binary->length++] = va_arg(ap, int);
   }
   va_end(ap);
 }
 
 void binary_write(Binary *binary, void *buffer, int size) {
-  for (int i = 0; i < size; i++) {
-    binary_push(binary, ((Byte *) buffer)[i]);
+  binary_reserve(binary, size);
+  memcpy(binary->buffer + binary->length, buffer, size);
+  binary->length += size;
+}
+
+void binary_fill(Binary *binary, Byte byte, int size) {
+  binary_reserve(binary, size);
+  memset(binary->buffer + binary->length, byte, size);
+  binary->length += size;
+}
+
+void binary_u8(Binary *binary, unsigned char value) {
+  binary_push(binary, value);
+}
+
+void binary_u16(Binary *binary, unsigned short value) {
+  binary_reserve(binary, 2);
+  Byte *p = binary->buffer + binary->length;
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+  binary->length += 2;
+}
+
+void binary_u32(Binary *binary, unsigned int value) {
+  binary_reserve(binary, 4);
+  Byte *p = binary->buffer + binary->length;
+  for (int i = 0; i < 4; i++) {
+    p[i] = (value >> (i * 8)) & 0xff;
+  }
+  binary->length += 4;
+}
+
+void binary_u64(Binary *binary, unsigned long long value) {
+  binary_reserve(binary, 8);
+  Byte *p = binary->buffer + binary->length;
+  for (int i = 0; i < 8; i++) {
+    p[i] = (value >> (i * 8)) & 0xff;
   }
+  binary->length += 8;
 }
@@ -6,6 +6,14 @@ typedef struct {
 } Binary;
 
 extern Binary *binary_new(void);
+extern void binary_reserve(Binary *binary, int size);
 extern void binary_push(Binary *binary, Byte byte);
 extern void binary_append(Binary *binary, int size, ...);
 extern void binary_write(Binary *binary, void *buffer, int size);
+extern void binary_fill(Binary *binary, Byte byte, int size);
+
+// little-endian values of fixed width
+extern void binary_u8(Binary *binary, unsigned char value);
+extern void binary_u16(Binary *binary, unsigned short value);
+extern void binary_u32(Binary *binary, unsigned int value);
+extern void binary_u64(Binary *binary, unsigned long long value);
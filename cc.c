@@ -1,10 +1,16 @@
 #include "cc.h"
 
-void compile(char *input, bool cpp) {
+void compile(char *input, char *output, Options *options) {
+  phase_begin("tokenize");
   Vector *pp_tokens = tokenize(input);
+  phase_end();
+
+  phase_begin("preprocess");
   Vector *tokens = preprocess(pp_tokens);
+  phase_end();
+  stats_count(STAT_TOKENS, tokens->length);
 
-  if (cpp) {
+  if (options->cpp) {
     for (int i = 0; i < tokens->length; i++) {
       Token *token = tokens->buffer[i];
       if (token->tk_type == TK_EOF) break;
@@ -13,7 +19,22 @@ void compile(char *input, bool cpp) {
     exit(0);
   }
 
+  phase_begin("parse");
   TransUnit *trans_unit = parse(tokens);
+  phase_end();
+
+  phase_begin("sema");
   sema(trans_unit);
-  gen(trans_unit);
+  phase_end();
+  arena_release(ARENA_LEX);
+
+  phase_begin("fold");
+  fold(trans_unit);
+  phase_end();
+
+  phase_begin("gen");
+  gen(trans_unit, output, options);
+  phase_end();
+  arena_release(ARENA_GEN);
+  arena_release(ARENA_PARSE);
 }
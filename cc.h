@@ -6,6 +6,25 @@
 #include "map.h"
 #include "binary.h"
 
+// identifier interning
+#include "ident.h"
+
+// source file loading
+#include "source.h"
+
+// memory allocation
+#include "arena.h"
+
+// statistics
+#include "stats.h"
+
+// command line options
+#include "options.h"
+
+// code emission
+#include "x86.h"
+#include "emit.h"
+
 // struct declaration
 typedef struct location Location;
 
@@ -29,6 +48,9 @@ typedef struct member Member;
 
 typedef struct symbol Symbol;
 
+// intermediate representation
+#include "ir.h"
+
 // Location
 struct location {
   char *filename; // source file name
@@ -120,7 +142,8 @@ struct token {
   char *pp_number;
 
   // identifier
-  char *identifier;
+  char *identifier; // interned by ident->name
+  Ident *ident;
 
   // integer-constant
   unsigned long long int_value;
@@ -148,6 +171,12 @@ typedef enum node_type {
   ND_VA_ARG,
   ND_VA_END,
 
+  // built-in functions
+  ND_MEMCPY,
+  ND_MEMSET,
+  ND_STRLEN,
+  ND_STRCMP,
+
   // expression
   ND_IDENTIFIER,
   ND_INTEGER,
@@ -260,7 +289,7 @@ struct expr {
   // subscription
   Expr *index;
 
-  // call
+  // call, built-in functions
   Vector *args; // Vector<Expr*>
 
   // dot, arrow
@@ -358,6 +387,9 @@ struct func {
 
   int stack_size;      // stack size for local variables
   Vector *label_stmts; // Vector<Stmt*>
+  Vector *locals;      // Vector<Symbol*>, local variables and parameters
+  Vector *refs;        // Vector<Symbol*>, global variables and functions used in the body
+  Vector *strings;     // Vector<int>, string literals used in the body
 
   int label_return; // label
 
@@ -528,8 +560,16 @@ struct symbol {
   Type *type;
   SymbolLink link;
   bool definition;
+  bool no_return; // the function never returns (_Noreturn)
   int offset; // for local variable
 
+  // register promotion of local variable
+  bool escape;   // the address is taken
+  int uses;      // the number of uses weighted by the loop depth
+  int stores;    // the uses as the left operand of assignment, weighted as well
+  bool promoted; // the variable lives in a callee-saved register
+  RegCode reg;
+
   // enumeration-constant
   Expr *const_expr;
   int const_value;
@@ -555,5 +595,9 @@ extern TransUnit *parse(Vector *tokens);
 // sema.c
 extern void sema(TransUnit *trans_unit);
 
+// fold.c
+extern Expr *fold_expr(Expr *expr);
+extern void fold(TransUnit *trans_unit);
+
 // gen.c
-extern void gen(TransUnit *node);
+extern void gen(TransUnit *node, char *output, Options *options);
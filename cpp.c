@@ -13,7 +13,12 @@ typedef struct macro {
   bool expanded;
 } Macro;
 
-static Map *macros;
+// a macro definition is bound to the interned identifier (ident->macro)
+static Vector *macros; // Vector<Ident*>
+
+static Ident *ident_file;
+static Ident *ident_line;
+static Ident *ident_va_args;
 
 // tokens
 
@@ -73,7 +78,7 @@ static Vector *preprocessing_unit(void);
 
 static bool check_file_macro(Token *token) {
   if (token->tk_type == TK_IDENTIFIER) {
-    return strcmp(token->identifier, "__FILE__") == 0;
+    return token->ident == ident_file;
   }
 
   return false;
@@ -81,7 +86,7 @@ static bool check_file_macro(Token *token) {
 
 static bool check_line_macro(Token *token) {
   if (token->tk_type == TK_IDENTIFIER) {
-    return strcmp(token->identifier, "__LINE__") == 0;
+    return token->ident == ident_line;
   }
 
   return false;
@@ -89,7 +94,7 @@ static bool check_line_macro(Token *token) {
 
 static bool check_object_macro(Token *token) {
   if (token->tk_type == TK_IDENTIFIER) {
-    Macro *macro = map_lookup(macros, token->identifier);
+    Macro *macro = token->ident->macro;
     return macro && !macro->expanded && macro->mc_type == OBJECT_MACRO;
   }
 
@@ -98,7 +103,7 @@ static bool check_object_macro(Token *token) {
 
 static bool check_function_macro(Token *token) {
   if (token->tk_type == TK_IDENTIFIER && has_next() && check('(')) {
-    Macro *macro = map_lookup(macros, token->identifier);
+    Macro *macro = token->ident->macro;
     return macro && !macro->expanded && macro->mc_type == FUNCTION_MACRO;
   }
 
@@ -119,7 +124,7 @@ static Token *expand_file_macro(Token *token, char *filename) {
   string_write(literal, filename);
   string_push(literal, '\0');
 
-  Token *str = calloc(1, sizeof(Token));
+  Token *str = arena_alloc(ARENA_LEX, sizeof(Token));
   str->tk_type = TK_STRING_LITERAL;
   str->text = text->buffer;
   str->loc = token->loc;
@@ -142,7 +147,7 @@ static Token *expand_line_macro(Token *token, int lineno) {
     text->buffer[j] = c;
   }
 
-  Token *num = calloc(1, sizeof(Token));
+  Token *num = arena_alloc(ARENA_LEX, sizeof(Token));
   num->tk_type = TK_PP_NUMBER;
   num->text = text->buffer;
   num->loc = token->loc;
@@ -158,7 +163,7 @@ static Vector *expand_object_macro(Token *token, char *filename, int lineno) {
     lineno = token->loc->lineno;
   }
 
-  Macro *macro = map_lookup(macros, token->identifier);
+  Macro *macro = token->ident->macro;
 
   macro->expanded = true;
   Vector *tokens = replace_macro(macro->replace, filename, lineno);
@@ -175,7 +180,7 @@ static Vector *expand_function_macro(Token *token, char *filename, int lineno) {
     lineno = token->loc->lineno;
   }
 
-  Macro *macro = map_lookup(macros, token->identifier);
+  Macro *macro = token->ident->macro;
   Map *args = map_new();
 
   read(TK_SPACE);
@@ -224,7 +229,7 @@ static Vector *expand_function_macro(Token *token, char *filename, int lineno) {
       if (finished) break;
     }
 
-    map_put(args, "__VA_ARGS__", va_args);
+    map_put(args, ident_va_args->name, va_args);
   }
   expect(')');
 
@@ -277,7 +282,7 @@ static Vector *replace_macro(Vector *tokens, char *filename, int lineno) {
 // directives
 
 static void define_directive(void) {
-  char *identifier = expect(TK_IDENTIFIER)->identifier;
+  Ident *ident = expect(TK_IDENTIFIER)->ident;
 
   MacroType mc_type;
   Vector *params = NULL;
@@ -313,13 +318,14 @@ static void define_directive(void) {
   }
   expect(TK_NEWLINE);
 
-  Macro *macro = (Macro *) calloc(1, sizeof(Macro));
+  Macro *macro = arena_alloc(ARENA_LEX, sizeof(Macro));
   macro->mc_type = mc_type;
   macro->params = params;
   macro->ellipsis = ellipsis;
   macro->replace = replace;
 
-  map_put(macros, identifier, macro);
+  ident->macro = macro;
+  vector_push(macros, ident);
 }
 
 static Vector *include_directive(void) {
@@ -394,7 +400,18 @@ static Vector *preprocessing_unit(void) {
 Vector *preprocess(Vector *_tokens) {
   Token *eof = vector_pop(_tokens);
 
-  macros = map_new();
+  // forget the macros of the previous translation unit
+  if (macros) {
+    for (int i = 0; i < macros->length; i++) {
+      Ident *ident = macros->buffer[i];
+      ident->macro = NULL;
+    }
+  }
+  macros = vector_new();
+
+  ident_file = intern("__FILE__");
+  ident_line = intern("__LINE__");
+  ident_va_args = intern("__VA_ARGS__");
 
   stash_tokens = vector_new();
   stash_pos = vector_new();
@@ -0,0 +1,649 @@
+#include "sk2cc.h"
+#include "string.h"
+#include "stats.h"
+#include "x86.h"
+#include "emit.h"
+
+static char *regs[16][5] = {
+  { "al", "ax", "eax", "rax", "xmm0" },
+  { "cl", "cx", "ecx", "rcx", "xmm1" },
+  { "dl", "dx", "edx", "rdx", "xmm2" },
+  { "bl", "bx", "ebx", "rbx", "xmm3" },
+  { "spl", "sp", "esp", "rsp", "xmm4" },
+  { "bpl", "bp", "ebp", "rbp", "xmm5" },
+  { "sil", "si", "esi", "rsi", "xmm6" },
+  { "dil", "di", "edi", "rdi", "xmm7" },
+  { "r8b", "r8w", "r8d", "r8", "xmm8" },
+  { "r9b", "r9w", "r9d", "r9", "xmm9" },
+  { "r10b", "r10w", "r10d", "r10", "xmm10" },
+  { "r11b", "r11w", "r11d", "r11", "xmm11" },
+  { "r12b", "r12w", "r12d", "r12", "xmm12" },
+  { "r13b", "r13w", "r13d", "r13", "xmm13" },
+  { "r14b", "r14w", "r14d", "r14", "xmm14" },
+  { "r15b", "r15w", "r15d", "r15", "xmm15" },
+};
+
+static char *suffixes = "bwlq";
+
+// output buffer
+// the buffer is written out when it grows larger than FLUSH_SIZE.
+
+#define FLUSH_SIZE 65536
+
+static char *output_file;
+static bool output_object;
+static bool output_optimize;
+static bool output_discard;
+static int output_fd;
+static char *buffer;
+static int length;
+static int capacity;
+
+static void flush(void) {
+  int written = 0;
+  while (written < length) {
+    long n = write(output_fd, buffer + written, length - written);
+    if (n < 0) {
+      perror("write");
+      exit(1);
+    }
+    written += n;
+  }
+  length = 0;
+}
+
+static void reserve(int size) {
+  if (length + size > capacity) {
+    while (length + size > capacity) {
+      capacity *= 2;
+    }
+    buffer = realloc(buffer, capacity);
+  }
+}
+
+static void put_char(char c) {
+  reserve(1);
+  buffer[length++] = c;
+}
+
+static void put_str(char *s) {
+  int n = strlen(s);
+  reserve(n);
+  memcpy(buffer + length, s, n);
+  length += n;
+}
+
+static void put_uint(unsigned long long value) {
+  char digits[24];
+  int n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+
+  reserve(n);
+  while (n > 0) {
+    buffer[length++] = digits[--n];
+  }
+}
+
+static void put_int(long long value) {
+  if (value < 0) {
+    put_char('-');
+    put_uint(0 - (unsigned long long) value);
+  } else {
+    put_uint(value);
+  }
+}
+
+static void put_octal(unsigned int value) {
+  char digits[12];
+  int n = 0;
+  do {
+    digits[n++] = '0' + value % 8;
+    value /= 8;
+  } while (value > 0);
+
+  reserve(n);
+  while (n > 0) {
+    buffer[length++] = digits[--n];
+  }
+}
+
+// text output
+
+static char *inst_name(StmtType type) {
+  switch (type) {
+    case ST_PUSH: return "push";
+    case ST_POP: return "pop";
+    case ST_CLTD: return "cltd";
+    case ST_CQTO: return "cqto";
+    case ST_MOV: return "mov";
+    case ST_MOVZB: return "movzb";
+    case ST_MOVZW: return "movzw";
+    case ST_MOVSB: return "movsb";
+    case ST_MOVSW: return "movsw";
+    case ST_MOVSL: return "movsl";
+    case ST_LEA: return "lea";
+    case ST_NEG: return "neg";
+    case ST_NOT: return "not";
+    case ST_ADD: return "add";
+    case ST_SUB: return "sub";
+    case ST_MUL: return "mul";
+    case ST_IMUL: return "imul";
+    case ST_DIV: return "div";
+    case ST_IDIV: return "idiv";
+    case ST_AND: return "and";
+    case ST_XOR: return "xor";
+    case ST_OR: return "or";
+    case ST_SAL: return "sal";
+    case ST_SAR: return "sar";
+    case ST_SHR: return "shr";
+    case ST_CMP: return "cmp";
+    case ST_TEST: return "test";
+    case ST_SETE: return "sete";
+    case ST_SETNE: return "setne";
+    case ST_SETB: return "setb";
+    case ST_SETL: return "setl";
+    case ST_SETG: return "setg";
+    case ST_SETBE: return "setbe";
+    case ST_SETLE: return "setle";
+    case ST_SETGE: return "setge";
+    case ST_JMP: return "jmp";
+    case ST_JE: return "je";
+    case ST_JNE: return "jne";
+    case ST_JB: return "jb";
+    case ST_JBE: return "jbe";
+    case ST_JA: return "ja";
+    case ST_JAE: return "jae";
+    case ST_JL: return "jl";
+    case ST_JLE: return "jle";
+    case ST_JG: return "jg";
+    case ST_JGE: return "jge";
+    case ST_JS: return "js";
+    case ST_JNS: return "jns";
+    case ST_CALL: return "call";
+    case ST_LEAVE: return "leave";
+    case ST_RET: return "ret";
+    case ST_REP_STOS: return "rep stos";
+    case ST_REP_MOVS: return "rep movs";
+    case ST_MOVD: return "movd";
+    case ST_MOVDQU: return "movdqu";
+    case ST_PADDB: return "paddb";
+    case ST_PADDD: return "paddd";
+    case ST_PXOR: return "pxor";
+    case ST_PCMPEQB: return "pcmpeqb";
+    case ST_PMOVMSKB: return "pmovmskb";
+    case ST_PSHUFD: return "pshufd";
+    default: assert(false);
+  }
+}
+
+static void text_symbol(EmitOp *op) {
+  if (op->ident) {
+    put_str(op->ident);
+  } else {
+    put_char('.');
+    put_char(op->prefix);
+    put_int(op->label);
+  }
+}
+
+static void text_op(EmitOp *op) {
+  switch (op->type) {
+    case EOP_REG: {
+      put_char('%');
+      put_str(regs[op->regcode][op->regtype]);
+      break;
+    }
+    case EOP_IMM: {
+      put_char('$');
+      put_uint(op->imm);
+      break;
+    }
+    case EOP_MEM: {
+      if (op->disp != 0) {
+        put_int(op->disp);
+      }
+      put_str("(%");
+      put_str(regs[op->base][REG_QUAD]);
+      if (op->sib) {
+        put_str(", %");
+        put_str(regs[op->index][REG_QUAD]);
+        put_str(", ");
+        put_int(1 << op->scale);
+      }
+      put_char(')');
+      break;
+    }
+    case EOP_RIP: {
+      text_symbol(op);
+      put_str("(%rip)");
+      break;
+    }
+    case EOP_SYM: {
+      text_symbol(op);
+      break;
+    }
+  }
+}
+
+static void text_ascii(String *string) {
+  put_str("  .ascii \"");
+  for (int i = 0; i < string->length; i++) {
+    char c = string->buffer[i];
+    switch (c) {
+      case '\\': put_str("\\\\"); break;
+      case '"': put_str("\\\""); break;
+      case '\a': put_str("\\a"); break;
+      case '\b': put_str("\\b"); break;
+      case '\f': put_str("\\f"); break;
+      case '\n': put_str("\\n"); break;
+      case '\r': put_str("\\r"); break;
+      case '\t': put_str("\\t"); break;
+      case '\v': put_str("\\v"); break;
+      default: {
+        if (isprint(c)) {
+          put_char(c);
+        } else {
+          put_char('\\');
+          put_octal(c);
+        }
+      }
+    }
+  }
+  put_str("\"\n");
+}
+
+static void text_stmt(EmitStmt *stmt) {
+  switch (stmt->type) {
+    case ST_LABEL: {
+      text_symbol(&stmt->ops[0]);
+      put_str(":\n");
+      break;
+    }
+    case ST_TEXT: {
+      put_str("  .text\n");
+      break;
+    }
+    case ST_DATA: {
+      put_str("  .data\n");
+      break;
+    }
+    case ST_SECTION: {
+      put_str("  .section .rodata\n");
+      break;
+    }
+    case ST_GLOBAL: {
+      put_str("  .global ");
+      text_symbol(&stmt->ops[0]);
+      put_char('\n');
+      break;
+    }
+    case ST_ZERO: {
+      put_str("  .zero ");
+      put_uint(stmt->ops[0].imm);
+      put_char('\n');
+      break;
+    }
+    case ST_LONG: {
+      put_str("  .long ");
+      put_uint(stmt->ops[0].imm);
+      put_char('\n');
+      break;
+    }
+    case ST_QUAD: {
+      put_str("  .quad ");
+      text_symbol(&stmt->ops[0]);
+      put_char('\n');
+      break;
+    }
+    case ST_ASCII: {
+      text_ascii(stmt->string);
+      break;
+    }
+    default: {
+      put_str("  ");
+      put_str(inst_name(stmt->type));
+      if (stmt->suffix != NO_SUFFIX) {
+        put_char(suffixes[stmt->suffix]);
+      }
+      for (int i = 0; i < stmt->nops; i++) {
+        put_str(i == 0 ? " " : ", ");
+        if (stmt->type == ST_JMP && stmt->ops[i].type != EOP_SYM) {
+          put_char('*');
+        }
+        text_op(&stmt->ops[i]);
+      }
+      put_char('\n');
+    }
+  }
+}
+
+// every statement goes through here.
+// the statements are passed to the peephole optimizer with -O1,
+// and the optimizer writes them back by emit_output().
+static void emit_stmt(EmitStmt *stmt) {
+  if (output_discard) return;
+  if (output_optimize) {
+    peephole(stmt);
+    return;
+  }
+
+  emit_output(stmt);
+}
+
+void emit_output(EmitStmt *stmt) {
+  if (stmt->type >= ST_PUSH) {
+    stats_count(STAT_INSTS, 1);
+  }
+
+  if (output_object) {
+    as_emit(stmt);
+    return;
+  }
+
+  text_stmt(stmt);
+
+  if (length >= FLUSH_SIZE) {
+    flush();
+  }
+}
+
+// statements
+
+static EmitStmt current;
+
+static EmitStmt *stmt_new(StmtType type, int suffix) {
+  EmitStmt *stmt = &current;
+  memset(stmt, 0, sizeof(EmitStmt));
+  stmt->type = type;
+  stmt->suffix = suffix;
+  return stmt;
+}
+
+static void stmt_op(EmitStmt *stmt, EmitOp *op) {
+  memcpy(&stmt->ops[stmt->nops], op, sizeof(EmitOp));
+  stmt->nops++;
+}
+
+// operands
+
+#define OPS 8
+
+static EmitOp ops[OPS];
+static int ops_pos;
+
+static EmitOp *op_new(EmitOpType type) {
+  EmitOp *op = &ops[ops_pos];
+  ops_pos = (ops_pos + 1) % OPS;
+
+  memset(op, 0, sizeof(EmitOp));
+  op->type = type;
+  return op;
+}
+
+EmitOp *emit_reg(RegCode regcode, RegSize regtype) {
+  EmitOp *op = op_new(EOP_REG);
+  op->regcode = regcode;
+  op->regtype = regtype;
+  return op;
+}
+
+EmitOp *emit_imm(unsigned long long imm) {
+  EmitOp *op = op_new(EOP_IMM);
+  op->imm = imm;
+  return op;
+}
+
+EmitOp *emit_mem(RegCode base, int disp) {
+  EmitOp *op = op_new(EOP_MEM);
+  op->base = base;
+  op->disp = disp;
+  return op;
+}
+
+EmitOp *emit_mem_sib(RegCode base, RegCode index, Scale scale, int disp) {
+  EmitOp *op = op_new(EOP_MEM);
+  op->sib = true;
+  op->base = base;
+  op->index = index;
+  op->scale = scale;
+  op->disp = disp;
+  return op;
+}
+
+EmitOp *emit_rip(char *ident) {
+  EmitOp *op = op_new(EOP_RIP);
+  op->ident = ident;
+  return op;
+}
+
+EmitOp *emit_rip_string(int label) {
+  EmitOp *op = op_new(EOP_RIP);
+  op->prefix = 'S';
+  op->label = label;
+  return op;
+}
+
+EmitOp *emit_rip_local(int label) {
+  EmitOp *op = op_new(EOP_RIP);
+  op->prefix = 'L';
+  op->label = label;
+  return op;
+}
+
+EmitOp *emit_sym(char *ident) {
+  EmitOp *op = op_new(EOP_SYM);
+  op->ident = ident;
+  return op;
+}
+
+EmitOp *emit_local(int label) {
+  EmitOp *op = op_new(EOP_SYM);
+  op->prefix = 'L';
+  op->label = label;
+  return op;
+}
+
+static EmitOp *emit_string(int label) {
+  EmitOp *op = op_new(EOP_SYM);
+  op->prefix = 'S';
+  op->label = label;
+  return op;
+}
+
+// labels and directives
+
+void emit_label(int label) {
+  EmitStmt *stmt = stmt_new(ST_LABEL, NO_SUFFIX);
+  stmt_op(stmt, emit_local(label));
+  emit_stmt(stmt);
+}
+
+void emit_string_label(int label) {
+  EmitStmt *stmt = stmt_new(ST_LABEL, NO_SUFFIX);
+  stmt_op(stmt, emit_string(label));
+  emit_stmt(stmt);
+}
+
+void emit_symbol(char *ident) {
+  EmitStmt *stmt = stmt_new(ST_LABEL, NO_SUFFIX);
+  stmt_op(stmt, emit_sym(ident));
+  emit_stmt(stmt);
+}
+
+void emit_text(void) {
+  emit_stmt(stmt_new(ST_TEXT, NO_SUFFIX));
+}
+
+void emit_data(void) {
+  emit_stmt(stmt_new(ST_DATA, NO_SUFFIX));
+}
+
+void emit_rodata(void) {
+  emit_stmt(stmt_new(ST_SECTION, NO_SUFFIX));
+}
+
+void emit_global(char *ident) {
+  EmitStmt *stmt = stmt_new(ST_GLOBAL, NO_SUFFIX);
+  stmt_op(stmt, emit_sym(ident));
+  emit_stmt(stmt);
+}
+
+void emit_zero(int size) {
+  EmitStmt *stmt = stmt_new(ST_ZERO, NO_SUFFIX);
+  stmt_op(stmt, emit_imm(size));
+  emit_stmt(stmt);
+}
+
+void emit_long(unsigned long long value) {
+  EmitStmt *stmt = stmt_new(ST_LONG, NO_SUFFIX);
+  stmt_op(stmt, emit_imm(value));
+  emit_stmt(stmt);
+}
+
+void emit_quad_string(int label) {
+  EmitStmt *stmt = stmt_new(ST_QUAD, NO_SUFFIX);
+  stmt_op(stmt, emit_string(label));
+  emit_stmt(stmt);
+}
+
+void emit_quad_label(int label) {
+  EmitStmt *stmt = stmt_new(ST_QUAD, NO_SUFFIX);
+  stmt_op(stmt, emit_local(label));
+  emit_stmt(stmt);
+}
+
+void emit_ascii(String *string) {
+  EmitStmt *stmt = stmt_new(ST_ASCII, NO_SUFFIX);
+  stmt->string = string;
+  emit_stmt(stmt);
+}
+
+// instructions
+
+void emit_inst0(StmtType type, int suffix) {
+  emit_stmt(stmt_new(type, suffix));
+}
+
+void emit_inst1(StmtType type, int suffix, EmitOp *op) {
+  EmitStmt *stmt = stmt_new(type, suffix);
+  stmt_op(stmt, op);
+  emit_stmt(stmt);
+}
+
+void emit_inst2(StmtType type, int suffix, EmitOp *src, EmitOp *dest) {
+  EmitStmt *stmt = stmt_new(type, suffix);
+  stmt_op(stmt, src);
+  stmt_op(stmt, dest);
+  emit_stmt(stmt);
+}
+
+void emit_inst3(StmtType type, int suffix, EmitOp *imm, EmitOp *src, EmitOp *dest) {
+  EmitStmt *stmt = stmt_new(type, suffix);
+  stmt_op(stmt, imm);
+  stmt_op(stmt, src);
+  stmt_op(stmt, dest);
+  emit_stmt(stmt);
+}
+
+// condition codes
+
+bool emit_check_jcc(StmtType type) {
+  return ST_JE <= type && type <= ST_JNS;
+}
+
+// returns the conditional jump taken when the condition does not hold.
+StmtType emit_negate_jcc(StmtType type) {
+  switch (type) {
+    case ST_JE: return ST_JNE;
+    case ST_JNE: return ST_JE;
+    case ST_JB: return ST_JAE;
+    case ST_JBE: return ST_JA;
+    case ST_JA: return ST_JBE;
+    case ST_JAE: return ST_JB;
+    case ST_JL: return ST_JGE;
+    case ST_JLE: return ST_JG;
+    case ST_JG: return ST_JLE;
+    case ST_JGE: return ST_JL;
+    case ST_JS: return ST_JNS;
+    case ST_JNS: return ST_JS;
+    default: assert(false);
+  }
+}
+
+// returns the conditional jump which tests the same condition as setcc.
+StmtType emit_setcc_jcc(StmtType type) {
+  switch (type) {
+    case ST_SETE: return ST_JE;
+    case ST_SETNE: return ST_JNE;
+    case ST_SETB: return ST_JB;
+    case ST_SETL: return ST_JL;
+    case ST_SETG: return ST_JG;
+    case ST_SETBE: return ST_JBE;
+    case ST_SETLE: return ST_JLE;
+    case ST_SETGE: return ST_JGE;
+    default: assert(false);
+  }
+}
+
+// output
+
+// assembly is written to stdout if output is NULL.
+// if object is true, the statements are assembled into the object file.
+// if optimize is true, the instructions are rewritten by the peephole optimizer.
+void emit_open(char *output, bool object, bool optimize) {
+  output_file = output;
+  output_object = object;
+  output_optimize = optimize;
+  if (object) {
+    as_emit_begin(output);
+    return;
+  }
+
+  if (output) {
+    output_fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 420); // 0644
+    if (output_fd < 0) {
+      perror(output);
+      exit(1);
+    }
+  } else {
+    output_fd = 1;
+  }
+
+  length = 0;
+  capacity = FLUSH_SIZE * 2;
+  buffer = realloc(buffer, capacity);
+}
+
+// the peephole optimizer is turned on and off between the functions.
+// the pending statements are written out when it is turned off.
+void emit_set_optimize(bool optimize) {
+  if (output_optimize && !optimize) {
+    peephole_flush();
+  }
+  output_optimize = optimize;
+}
+
+// the statements are thrown away while discard is true.
+// the code generator uses it to examine a function before writing it.
+void emit_set_discard(bool discard) {
+  output_discard = discard;
+}
+
+void emit_close(void) {
+  if (output_optimize) {
+    peephole_flush();
+  }
+
+  if (output_object) {
+    as_emit_end(output_file);
+    return;
+  }
+
+  flush();
+  if (output_fd != 1) {
+    close(output_fd);
+  }
+}
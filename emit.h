@@ -0,0 +1,110 @@
+// code emitter
+// The code generator describes each statement (label, directive or instruction)
+// in a structured form, and the emitter writes it to the output.
+
+typedef enum {
+  EOP_REG, // register
+  EOP_IMM, // immediate value
+  EOP_MEM, // disp(base) or disp(base, index, scale)
+  EOP_RIP, // symbol(%rip)
+  EOP_SYM, // symbol (jump target, call target, etc.)
+} EmitOpType;
+
+// operand
+// a symbol is an identifier, or a numbered label .L<label> or .S<label>
+// if ident is NULL.
+typedef struct {
+  EmitOpType type;
+
+  // register
+  RegSize regtype;
+  RegCode regcode;
+
+  // memory
+  bool sib;
+  Scale scale;
+  RegCode index;
+  RegCode base;
+  int disp;
+
+  // immediate value
+  unsigned long long imm;
+
+  // symbol
+  char *ident;
+  char prefix; // 'L' or 'S'
+  int label;
+} EmitOp;
+
+#define NO_SUFFIX -1
+
+// statement
+//   label:     ops[0] is the symbol
+//   .global:   ops[0] is the symbol
+//   .zero:     ops[0] is the size
+//   .long:     ops[0] is the value
+//   .quad:     ops[0] is the symbol
+//   .ascii:    string
+//   instructions: ops in the order of AT&T syntax
+typedef struct {
+  StmtType type;
+  int suffix; // InstSuffix, or NO_SUFFIX
+  int nops;
+  EmitOp ops[3];
+  String *string;
+} EmitStmt;
+
+// operands
+// the returned operands are valid until the next few operands are made,
+// so they should be passed to emit_inst* immediately.
+extern EmitOp *emit_reg(RegCode regcode, RegSize regtype);
+extern EmitOp *emit_imm(unsigned long long imm);
+extern EmitOp *emit_mem(RegCode base, int disp);
+extern EmitOp *emit_mem_sib(RegCode base, RegCode index, Scale scale, int disp);
+extern EmitOp *emit_rip(char *ident);
+extern EmitOp *emit_rip_string(int label);
+extern EmitOp *emit_rip_local(int label);
+extern EmitOp *emit_sym(char *ident);
+extern EmitOp *emit_local(int label);
+
+// labels and directives
+extern void emit_label(int label);
+extern void emit_string_label(int label);
+extern void emit_symbol(char *ident);
+extern void emit_text(void);
+extern void emit_data(void);
+extern void emit_rodata(void);
+extern void emit_global(char *ident);
+extern void emit_zero(int size);
+extern void emit_long(unsigned long long value);
+extern void emit_quad_string(int label);
+extern void emit_quad_label(int label);
+extern void emit_ascii(String *string);
+
+// instructions
+extern void emit_inst0(StmtType type, int suffix);
+extern void emit_inst1(StmtType type, int suffix, EmitOp *op);
+extern void emit_inst2(StmtType type, int suffix, EmitOp *src, EmitOp *dest);
+extern void emit_inst3(StmtType type, int suffix, EmitOp *imm, EmitOp *src, EmitOp *dest);
+
+// condition codes
+extern bool emit_check_jcc(StmtType type);
+extern StmtType emit_negate_jcc(StmtType type);
+extern StmtType emit_setcc_jcc(StmtType type);
+
+// output
+extern void emit_open(char *output, bool object, bool optimize);
+extern void emit_set_optimize(bool optimize);
+extern void emit_set_discard(bool discard);
+extern void emit_output(EmitStmt *stmt);
+extern void emit_close(void);
+
+// peephole optimizer (peephole.c)
+extern void peephole(EmitStmt *stmt);
+extern void peephole_flush(void);
+extern void peephole_report(void);
+
+// integrated assembler (as_emit.c)
+extern void as_emit_begin(char *output);
+extern void as_emit(EmitStmt *stmt);
+extern void as_emit_end(char *output);
@@ -10,7 +10,7 @@ noreturn void error(Location *loc, char *file, int lineno, char *format, ...) {
   va_end(ap);
 
   // location
-  fprintf(stderr, " %s\n", loc->line);
+  fprintf(stderr, " %.*s\n", line_length(loc->line), loc->line);
   fprintf(stderr, "%*s^\n", loc->column, " ");
 
   exit(1);
@@ -0,0 +1,269 @@
+#include "cc.h"
+
+// constant folding
+// The subexpressions whose operands are integer constants are evaluated
+// at compile time, and replaced with integer constants.
+// Since sizeof, _Alignof and enumeration constants are converted to
+// integer constants by sema, they are also folded.
+//
+// The value of an integer constant is held in 64 bits.
+// The value of a signed type is sign-extended, and the value of
+// an unsigned type is zero-extended. Therefore the values can be compared
+// as 64-bit integers regardless of their width.
+
+static bool check_integer(Type *type) {
+  return TY_BOOL <= type->ty_type && type->ty_type <= TY_ULONG;
+}
+
+static bool check_signed(Type *type) {
+  TypeType ty_type = type->ty_type;
+  return ty_type == TY_CHAR || ty_type == TY_SHORT || ty_type == TY_INT || ty_type == TY_LONG;
+}
+
+static bool check_const(Expr *expr) {
+  return expr->nd_type == ND_INTEGER && check_integer(expr->type);
+}
+
+// truncate the value to the width of the type, and extend it to 64 bits.
+static unsigned long long normalize(unsigned long long value, Type *type) {
+  switch (type->ty_type) {
+    case TY_BOOL: return value != 0;
+    case TY_CHAR: return (long) (char) value;
+    case TY_UCHAR: return value & 0xff;
+    case TY_SHORT: return (long) (short) value;
+    case TY_USHORT: return value & 0xffff;
+    case TY_INT: return (long) (int) value;
+    case TY_UINT: return value & 0xffffffff;
+    default: return value;
+  }
+}
+
+// replace the expression with an integer constant.
+// the node is reused, and the type of the expression is kept.
+static Expr *fold_integer(Expr *expr, unsigned long long value) {
+  expr->nd_type = ND_INTEGER;
+  expr->int_value = normalize(value, expr->type);
+  return expr;
+}
+
+static Expr *fold_cast(Expr *expr) {
+  if (check_const(expr->expr) && check_integer(expr->type)) {
+    return fold_integer(expr, expr->expr->int_value);
+  }
+  return expr;
+}
+
+static Expr *fold_unary(Expr *expr) {
+  if (!check_const(expr->expr)) return expr;
+
+  unsigned long long value = expr->expr->int_value;
+  switch (expr->nd_type) {
+    case ND_UMINUS: return fold_integer(expr, -value);
+    case ND_NOT: return fold_integer(expr, ~value);
+    case ND_LNOT: return fold_integer(expr, value == 0);
+    default: return expr;
+  }
+}
+
+static Expr *fold_binary(Expr *expr) {
+  if (!check_const(expr->lhs) || !check_const(expr->rhs)) return expr;
+
+  // the operands have the same type by the usual arithmetic conversion.
+  Type *type = expr->lhs->type;
+  bool sign = check_signed(type);
+  unsigned long long lhs = expr->lhs->int_value;
+  unsigned long long rhs = expr->rhs->int_value;
+  long slhs = lhs;
+  long srhs = rhs;
+
+  switch (expr->nd_type) {
+    case ND_MUL: return fold_integer(expr, lhs * rhs);
+    case ND_DIV:
+    case ND_MOD: {
+      // division by zero is left to run time.
+      if (rhs == 0) return expr;
+
+      // the quotient of the minimum value and -1 overflows.
+      if (sign && srhs == -1) {
+        return fold_integer(expr, expr->nd_type == ND_DIV ? -lhs : 0);
+      }
+
+      if (expr->nd_type == ND_DIV) {
+        return fold_integer(expr, sign ? slhs / srhs : lhs / rhs);
+      }
+      return fold_integer(expr, sign ? slhs % srhs : lhs % rhs);
+    }
+    case ND_ADD: return fold_integer(expr, lhs + rhs);
+    case ND_SUB: return fold_integer(expr, lhs - rhs);
+    case ND_LSHIFT:
+    case ND_RSHIFT: {
+      // shift by a negative value or by the width is undefined.
+      if (rhs >= expr->type->size * 8) return expr;
+
+      if (expr->nd_type == ND_LSHIFT) {
+        return fold_integer(expr, lhs << rhs);
+      }
+      if (sign) {
+        return fold_integer(expr, slhs >> srhs);
+      }
+      // the value is zero-extended, so the higher bits are cleared
+      // explicitly in case that >> is an arithmetic shift.
+      unsigned long long mask = rhs == 0 ? ~0ULL : (1ULL << (64 - rhs)) - 1;
+      return fold_integer(expr, (lhs >> rhs) & mask);
+    }
+    case ND_LT: return fold_integer(expr, sign ? slhs < srhs : lhs < rhs);
+    case ND_LTE: return fold_integer(expr, sign ? slhs <= srhs : lhs <= rhs);
+    case ND_EQ: return fold_integer(expr, lhs == rhs);
+    case ND_NEQ: return fold_integer(expr, lhs != rhs);
+    case ND_AND: return fold_integer(expr, lhs & rhs);
+    case ND_XOR: return fold_integer(expr, lhs ^ rhs);
+    case ND_OR: return fold_integer(expr, lhs | rhs);
+    default: return expr;
+  }
+}
+
+// the right operand is not evaluated if the left operand decides the result.
+static Expr *fold_logical(Expr *expr) {
+  if (!check_const(expr->lhs)) return expr;
+
+  bool lhs = expr->lhs->int_value != 0;
+  if (expr->nd_type == ND_LAND && !lhs) return fold_integer(expr, 0);
+  if (expr->nd_type == ND_LOR && lhs) return fold_integer(expr, 1);
+
+  if (!check_const(expr->rhs)) return expr;
+  return fold_integer(expr, expr->rhs->int_value != 0);
+}
+
+// only the selected operand is evaluated.
+static Expr *fold_condition(Expr *expr) {
+  if (!check_const(expr->cond)) return expr;
+  return expr->cond->int_value != 0 ? expr->lhs : expr->rhs;
+}
+
+Expr *fold_expr(Expr *expr) {
+  if (!expr) return NULL;
+
+  expr->expr = fold_expr(expr->expr);
+  expr->lhs = fold_expr(expr->lhs);
+  expr->rhs = fold_expr(expr->rhs);
+  expr->cond = fold_expr(expr->cond);
+  expr->macro_ap = fold_expr(expr->macro_ap);
+  if (expr->args) {
+    for (int i = 0; i < expr->args->length; i++) {
+      expr->args->buffer[i] = fold_expr(expr->args->buffer[i]);
+    }
+  }
+
+  switch (expr->nd_type) {
+    case ND_CAST: return fold_cast(expr);
+    case ND_UMINUS:
+    case ND_NOT:
+    case ND_LNOT: return fold_unary(expr);
+    case ND_MUL:
+    case ND_DIV:
+    case ND_MOD:
+    case ND_ADD:
+    case ND_SUB:
+    case ND_LSHIFT:
+    case ND_RSHIFT:
+    case ND_LT:
+    case ND_LTE:
+    case ND_EQ:
+    case ND_NEQ:
+    case ND_AND:
+    case ND_XOR:
+    case ND_OR: return fold_binary(expr);
+    case ND_LAND:
+    case ND_LOR: return fold_logical(expr);
+    case ND_CONDITION: return fold_condition(expr);
+    default: return expr;
+  }
+}
+
+static void fold_init(Initializer *init) {
+  if (init->list) {
+    for (int i = 0; i < init->list->length; i++) {
+      fold_init(init->list->buffer[i]);
+    }
+  } else {
+    init->expr = fold_expr(init->expr);
+  }
+}
+
+static void fold_decl(Decl *decl) {
+  for (int i = 0; i < decl->symbols->length; i++) {
+    Symbol *symbol = decl->symbols->buffer[i];
+    if (symbol->init) {
+      fold_init(symbol->init);
+    }
+  }
+}
+
+static void fold_stmt(Stmt *stmt) {
+  if (!stmt) return;
+
+  switch (stmt->nd_type) {
+    case ND_LABEL: fold_stmt(stmt->label_stmt); break;
+    case ND_CASE: fold_stmt(stmt->case_stmt); break;
+    case ND_DEFAULT: fold_stmt(stmt->default_stmt); break;
+    case ND_COMP: {
+      for (int i = 0; i < stmt->block_items->length; i++) {
+        Node *item = stmt->block_items->buffer[i];
+        if (item->nd_type == ND_DECL) {
+          fold_decl((Decl *) item);
+        } else {
+          fold_stmt((Stmt *) item);
+        }
+      }
+      break;
+    }
+    case ND_EXPR: stmt->expr = fold_expr(stmt->expr); break;
+    case ND_IF: {
+      stmt->if_cond = fold_expr(stmt->if_cond);
+      fold_stmt(stmt->then_body);
+      fold_stmt(stmt->else_body);
+      break;
+    }
+    case ND_SWITCH: {
+      stmt->switch_cond = fold_expr(stmt->switch_cond);
+      fold_stmt(stmt->switch_body);
+      break;
+    }
+    case ND_WHILE: {
+      stmt->while_cond = fold_expr(stmt->while_cond);
+      fold_stmt(stmt->while_body);
+      break;
+    }
+    case ND_DO: {
+      stmt->do_cond = fold_expr(stmt->do_cond);
+      fold_stmt(stmt->do_body);
+      break;
+    }
+    case ND_FOR: {
+      if (stmt->for_init) {
+        if (stmt->for_init->nd_type == ND_DECL) {
+          fold_decl((Decl *) stmt->for_init);
+        } else {
+          stmt->for_init = (Node *) fold_expr((Expr *) stmt->for_init);
+        }
+      }
+      stmt->for_cond = fold_expr(stmt->for_cond);
+      stmt->for_after = fold_expr(stmt->for_after);
+      fold_stmt(stmt->for_body);
+      break;
+    }
+    case ND_RETURN: stmt->ret_expr = fold_expr(stmt->ret_expr); break;
+    default: break;
+  }
+}
+
+void fold(TransUnit *trans_unit) {
+  for (int i = 0; i < trans_unit->decls->length; i++) {
+    Node *decl = trans_unit->decls->buffer[i];
+    if (decl->nd_type == ND_DECL) {
+      fold_decl((Decl *) decl);
+    } else if (decl->nd_type == ND_FUNC) {
+      fold_stmt(((Func *) decl)->body);
+    }
+  }
+}
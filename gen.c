@@ -1,50 +1,5 @@
 #include "cc.h"
 
-typedef enum {
-  REG_BYTE,
-  REG_WORD,
-  REG_LONG,
-  REG_QUAD,
-} RegSize;
-
-typedef enum {
-  REG_AX,
-  REG_CX,
-  REG_DX,
-  REG_BX,
-  REG_SP,
-  REG_BP,
-  REG_SI,
-  REG_DI,
-  REG_R8,
-  REG_R9,
-  REG_R10,
-  REG_R11,
-  REG_R12,
-  REG_R13,
-  REG_R14,
-  REG_R15,
-} RegCode;
-
-static char *reg[16][4] = {
-  { "al", "ax", "eax", "rax" },
-  { "cl", "cx", "ecx", "rcx" },
-  { "dl", "dx", "edx", "rdx" },
-  { "bl", "bx", "ebx", "rbx" },
-  { "spl", "sp", "esp", "rsp" },
-  { "bpl", "bp", "ebp", "rbp" },
-  { "sil", "si", "esi", "rsi" },
-  { "dil", "di", "edi", "rdi" },
-  { "r8b", "r8w", "r8d", "r8" },
-  { "r9b", "r9w", "r9d", "r9" },
-  { "r10b", "r10w", "r10d", "r10" },
-  { "r11b", "r11w", "r11d", "r11" },
-  { "r12b", "r12w", "r12d", "r12" },
-  { "r13b", "r13w", "r13d", "r13" },
-  { "r14b", "r14w", "r14d", "r14" },
-  { "r15b", "r15w", "r15d", "r15" },
-};
-
 // rdi, rsi, rdx, rcx, r8, r9
 // currently initializer with enum constant is not supported.
 static RegCode arg_reg[6] = { 7, 6, 2, 1, 8, 9 };
@@ -55,32 +10,187 @@ static int gp_offset;
 static int overflow_arg_area;
 static int stack_depth;
 
+// frame pointer omission
+// The leaf functions, which neither call functions nor push values, do not
+// set up the frame. The frame is kept in the 128-byte red zone below %rsp,
+// and the slots at disp(%rbp) are addressed as (disp - 8)(%rsp) instead,
+// since %rsp points to the return address just above the saved %rbp.
+
+#define RED_ZONE 128
+static bool omit_enabled;
+static bool frame_omitted; // the frame is addressed relative to %rsp
+static bool frame_pushed;  // the stack is touched by push or call
+
+static EmitOp *gen_frame(int disp) {
+  if (frame_omitted) return emit_mem(REG_SP, disp - 8);
+  return emit_mem(REG_BP, disp);
+}
+
+static EmitOp *gen_frame_sib(RegCode index, Scale scale, int disp) {
+  if (frame_omitted) return emit_mem_sib(REG_SP, index, scale, disp - 8);
+  return emit_mem_sib(REG_BP, index, scale, disp);
+}
+
+// register promotion
+// The local variables whose addresses are not taken are held in
+// the callee-saved registers instead of the stack slots (-O1).
+// The registers are saved below the local variables in the prologue,
+// and restored in the epilogue.
+
+// rbx, r12, r13, r14, r15
+#define PROMOTE_SIZE 5
+static RegCode promote_reg[PROMOTE_SIZE] = { 3, 12, 13, 14, 15 };
+static bool promote_enabled;
+static int promoted; // the number of promoted variables in the function
+
+// dead code elimination
+// The code which can not be reached, after a jump or a call to a noreturn
+// function until the next label, is not generated, and neither are the
+// stores to the local variables which are never read (-O1).
+
+static bool dce_enabled;
+static bool reachable; // the current position can be reached
+
 // generation of expression
 
 static void gen_expr(Expr *expr);
 
+// expression temporaries
+// Each expression leaves its value on a virtual value stack. The slots of
+// the value stack are held in the registers of the pool, and spilled to the
+// machine stack only when the pool is exhausted or the values must survive
+// a function call or a branch. The operations read the operands from the
+// registers of the slots, and write the result to one of them, so that
+// the values are not staged through %rax.
+//
+// The spilled slots always form the bottom of the value stack, so that they
+// can be popped from the machine stack in order. Therefore the bottom slot
+// in the registers is spilled first.
+//
+// %rax, %rcx and %rdx are not in the pool since they are used as scratch
+// registers for operations, and %rdx and %rcx are also destroyed by
+// mul, div and shift instructions.
+
+// r10, r11, r8, r9, rsi, rdi
+#define POOL_SIZE 6
+static RegCode pool_reg[POOL_SIZE] = { 10, 11, 8, 9, 6, 7 };
+static bool pool_used[POOL_SIZE];
+
+static Vector *slots; // Vector<int>, index of pool_reg, or -1 if spilled
+static int spilled;   // the number of spilled slots
+
+static void gen_spill(void) {
+  int reg = (int) (intptr_t) slots->buffer[spilled];
+  emit_inst1(ST_PUSH, INST_QUAD, emit_reg(pool_reg[reg], REG_QUAD));
+  stack_depth += 8;
+  frame_pushed = true;
+  pool_used[reg] = false;
+  slots->buffer[spilled++] = (void *) (intptr_t) -1;
+}
+
+// spill all slots to the machine stack
+static void gen_spill_all(void) {
+  while (spilled < slots->length) {
+    gen_spill();
+  }
+}
+
+static int gen_alloc_slot(void) {
+  while (true) {
+    for (int i = 0; i < POOL_SIZE; i++) {
+      if (!pool_used[i]) {
+        pool_used[i] = true;
+        vector_pushi(slots, i);
+        return i;
+      }
+    }
+    gen_spill();
+  }
+}
+
+// returns the register of the top slot, or -1 if it is spilled.
+// the slot is removed from the value stack.
+static int gen_free_slot(void) {
+  int reg = vector_popi(slots);
+  if (reg < 0) {
+    spilled--;
+    stack_depth -= 8;
+    return -1;
+  }
+  pool_used[reg] = false;
+  return pool_reg[reg];
+}
+
+// a value in a free register of the pool becomes the new slot as it is.
+static void gen_push(RegCode reg) {
+  for (int i = 0; i < POOL_SIZE; i++) {
+    if (pool_reg[i] == reg && !pool_used[i]) {
+      pool_used[i] = true;
+      vector_pushi(slots, i);
+      return;
+    }
+  }
+  int slot = gen_alloc_slot();
+  emit_inst2(ST_MOV, INST_QUAD, emit_reg(reg, REG_QUAD), emit_reg(pool_reg[slot], REG_QUAD));
+}
+
+static void gen_pop(RegCode reg) {
+  int slot = gen_free_slot();
+  if (slot < 0) {
+    emit_inst1(ST_POP, INST_QUAD, emit_reg(reg, REG_QUAD));
+  } else if (slot != reg) {
+    emit_inst2(ST_MOV, INST_QUAD, emit_reg(slot, REG_QUAD), emit_reg(reg, REG_QUAD));
+  }
+}
+
+// The register of a slot is written when the slot is pushed, and is read
+// exactly once, by the operation which pops the slot. The operation may
+// write its result to the popped register, but it must not read the
+// register again after the result is pushed, since the result is another
+// slot. A value which is used twice is pushed again from where it is held.
+
+// returns the register of a new slot on the top of the value stack,
+// to which the value is written directly.
+static RegCode gen_push_reg(void) {
+  return pool_reg[gen_alloc_slot()];
+}
+
+// removes the top slot, and returns the register holding the value,
+// so that the value is read from the pool without a copy.
+// the value spilled to the machine stack is popped to reg.
+static RegCode gen_pop_reg(RegCode reg) {
+  int slot = gen_free_slot();
+  if (slot < 0) {
+    emit_inst1(ST_POP, INST_QUAD, emit_reg(reg, REG_QUAD));
+    return reg;
+  }
+  return slot;
+}
+
+static void gen_pop_discard(void) {
+  if (gen_free_slot() < 0) {
+    emit_inst2(ST_ADD, INST_QUAD, emit_imm(8), emit_reg(REG_SP, REG_QUAD));
+  }
+}
+
 #define GEN_PUSH(reg) \
   do { \
-    stack_depth += 8; \
-    printf("  pushq %%%s\n", reg); \
+    gen_push(reg); \
   } while (0)
 
 #define GEN_POP(reg) \
   do { \
-    stack_depth -= 8; \
-    printf("  popq %%%s\n", reg); \
+    gen_pop(reg); \
   } while (0)
 
 #define GEN_PUSH_GARBAGE() \
   do { \
-    stack_depth += 8; \
-    printf("  subq $8, %%rsp\n"); \
+    gen_alloc_slot(); \
   } while (0)
 
 #define GEN_POP_DISCARD() \
   do { \
-    stack_depth -= 8; \
-    printf("  addq $8, %%rsp\n"); \
+    gen_pop_discard(); \
   } while (0)
 
 #define GEN_EVAL(expr) \
@@ -91,12 +201,16 @@ static void gen_expr(Expr *expr);
 
 #define GEN_LABEL(label) \
   do { \
-    printf(".L%d:\n", label); \
+    emit_label(label); \
+    reachable = true; \
   } while (0)
 
 #define GEN_JUMP(inst, label) \
   do { \
-    printf("  %s .L%d\n", inst, label); \
+    if (reachable) { \
+      emit_inst1(inst, NO_SUFFIX, emit_local(label)); \
+      reachable = (inst) != ST_JMP || !dce_enabled; \
+    } \
   } while (0)
 
 #define GEN_OP(expr, reg) \
@@ -113,21 +227,55 @@ static void gen_expr(Expr *expr);
     GEN_POP(reg_lhs); \
   } while (0)
 
+// evaluate the expression, and returns the register holding the value.
+static RegCode gen_operand(Expr *expr, RegCode reg) {
+  gen_expr(expr);
+  return gen_pop_reg(reg);
+}
+
+// an integer constant is used as an immediate operand.
+// the immediate operand of a 64-bit operation is sign-extended from 32 bits.
+static bool check_imm32(unsigned long long value) {
+  return value + 0x80000000 <= 0xffffffff;
+}
+
+static bool check_imm(Expr *expr) {
+  if (expr->nd_type != ND_INTEGER) return false;
+  return expr->type->size < 8 || check_imm32(expr->int_value);
+}
+
+// evaluate the operands of binary operation.
+// the register holding the left operand is stored to *reg, which also
+// receives the result. the right operand is returned as an immediate operand,
+// or the register holding it.
+static EmitOp *gen_operands(Expr *lhs, Expr *rhs, RegCode *reg) {
+  RegSize size = lhs->type->size == 8 ? REG_QUAD : REG_LONG;
+  if (check_imm(rhs)) {
+    *reg = gen_operand(lhs, REG_AX);
+    return emit_imm(size == REG_QUAD ? rhs->int_value : rhs->int_value & 0xffffffff);
+  }
+  gen_expr(lhs);
+  gen_expr(rhs);
+  RegCode rhs_reg = gen_pop_reg(REG_CX);
+  *reg = gen_pop_reg(REG_AX);
+  return emit_reg(rhs_reg, size);
+}
+
 static void gen_lvalue(Expr *expr) {
   switch (expr->nd_type) {
     case ND_IDENTIFIER: {
+      RegCode reg = gen_push_reg();
       switch (expr->symbol->link) {
         case LN_EXTERNAL:
         case LN_INTERNAL: {
-          printf("  leaq %s(%%rip), %%rax\n", expr->symbol->identifier);
+          emit_inst2(ST_LEA, INST_QUAD, emit_rip(expr->symbol->identifier), emit_reg(reg, REG_QUAD));
           break;
         }
         case LN_NONE: {
-          printf("  leaq %d(%%rbp), %%rax\n", -expr->symbol->offset);
+          emit_inst2(ST_LEA, INST_QUAD, gen_frame(-expr->symbol->offset), emit_reg(reg, REG_QUAD));
           break;
         }
       }
-      GEN_PUSH("rax");
       break;
     }
     case ND_INDIRECT: {
@@ -136,9 +284,9 @@ static void gen_lvalue(Expr *expr) {
     }
     case ND_DOT: {
       gen_lvalue(expr->expr);
-      GEN_POP("rax");
-      printf("  leaq %d(%%rax), %%rax\n", expr->offset);
-      GEN_PUSH("rax");
+      RegCode reg = gen_pop_reg(REG_AX);
+      emit_inst2(ST_LEA, INST_QUAD, emit_mem(reg, expr->offset), emit_reg(reg, REG_QUAD));
+      GEN_PUSH(reg);
       break;
     }
     default: assert(false);
@@ -146,38 +294,42 @@ static void gen_lvalue(Expr *expr) {
 }
 
 static void gen_load(Type *type) {
-  GEN_POP("rax");
+  RegCode reg = gen_pop_reg(REG_AX);
   switch (type->ty_type) {
     case TY_BOOL:
     case TY_CHAR:
     case TY_UCHAR: {
-      printf("  movb (%%rax), %%al\n");
+      emit_inst2(ST_MOV, INST_BYTE, emit_mem(reg, 0), emit_reg(reg, REG_BYTE));
       break;
     }
     case TY_SHORT:
     case TY_USHORT: {
-      printf("  movw (%%rax), %%ax\n");
+      emit_inst2(ST_MOV, INST_WORD, emit_mem(reg, 0), emit_reg(reg, REG_WORD));
       break;
     }
     case TY_INT:
     case TY_UINT: {
-      printf("  movl (%%rax), %%eax\n");
+      emit_inst2(ST_MOV, INST_LONG, emit_mem(reg, 0), emit_reg(reg, REG_LONG));
       break;
     }
     case TY_LONG:
     case TY_ULONG: {
-      printf("  movq (%%rax), %%rax\n");
+      emit_inst2(ST_MOV, INST_QUAD, emit_mem(reg, 0), emit_reg(reg, REG_QUAD));
       break;
     }
     case TY_POINTER: {
       if (type == type->original) {
-        printf("  movq (%%rax), %%rax\n");
+        emit_inst2(ST_MOV, INST_QUAD, emit_mem(reg, 0), emit_reg(reg, REG_QUAD));
       }
       break;
     }
+    case TY_STRUCT: {
+      // the value of struct is represented by its address.
+      break;
+    }
     default: assert(false);
   }
-  GEN_PUSH("rax");
+  GEN_PUSH(reg);
 }
 
 static void gen_store_by_addr(RegCode value, RegCode addr, Type *type) {
@@ -185,23 +337,23 @@ static void gen_store_by_addr(RegCode value, RegCode addr, Type *type) {
     case TY_BOOL:
     case TY_CHAR:
     case TY_UCHAR: {
-      printf("  movb %%%s, (%%%s)\n", reg[value][REG_BYTE], reg[addr][REG_QUAD]);
+      emit_inst2(ST_MOV, INST_BYTE, emit_reg(value, REG_BYTE), emit_mem(addr, 0));
       break;
     }
     case TY_SHORT:
     case TY_USHORT: {
-      printf("  movw %%%s, (%%%s)\n", reg[value][REG_WORD], reg[addr][REG_QUAD]);
+      emit_inst2(ST_MOV, INST_WORD, emit_reg(value, REG_WORD), emit_mem(addr, 0));
       break;
     }
     case TY_INT:
     case TY_UINT: {
-      printf("  movl %%%s, (%%%s)\n", reg[value][REG_LONG], reg[addr][REG_QUAD]);
+      emit_inst2(ST_MOV, INST_LONG, emit_reg(value, REG_LONG), emit_mem(addr, 0));
       break;
     }
     case TY_LONG:
     case TY_ULONG:
     case TY_POINTER: {
-      printf("  movq %%%s, (%%%s)\n", reg[value][REG_QUAD], reg[addr][REG_QUAD]);
+      emit_inst2(ST_MOV, INST_QUAD, emit_reg(value, REG_QUAD), emit_mem(addr, 0));
       break;
     }
     default: assert(false);
@@ -213,70 +365,172 @@ static void gen_store_by_offset(RegCode value, int offset, Type *type) {
     case TY_BOOL:
     case TY_CHAR:
     case TY_UCHAR: {
-      printf("  movb %%%s, %d(%%rbp)\n", reg[value][REG_BYTE], offset);
+      emit_inst2(ST_MOV, INST_BYTE, emit_reg(value, REG_BYTE), gen_frame(offset));
+      break;
+    }
+    case TY_SHORT:
+    case TY_USHORT: {
+      emit_inst2(ST_MOV, INST_WORD, emit_reg(value, REG_WORD), gen_frame(offset));
+      break;
+    }
+    case TY_INT:
+    case TY_UINT: {
+      emit_inst2(ST_MOV, INST_LONG, emit_reg(value, REG_LONG), gen_frame(offset));
+      break;
+    }
+    case TY_LONG:
+    case TY_ULONG:
+    case TY_POINTER: {
+      emit_inst2(ST_MOV, INST_QUAD, emit_reg(value, REG_QUAD), gen_frame(offset));
+      break;
+    }
+    default: assert(false);
+  }
+}
+
+// the value is zero-extended, so that the whole register can be read.
+static void gen_store_by_reg(RegCode value, RegCode reg, Type *type) {
+  switch (type->ty_type) {
+    case TY_BOOL:
+    case TY_CHAR:
+    case TY_UCHAR: {
+      emit_inst2(ST_MOVZB, INST_LONG, emit_reg(value, REG_BYTE), emit_reg(reg, REG_LONG));
       break;
     }
     case TY_SHORT:
     case TY_USHORT: {
-      printf("  movw %%%s, %d(%%rbp)\n", reg[value][REG_WORD], offset);
+      emit_inst2(ST_MOVZW, INST_LONG, emit_reg(value, REG_WORD), emit_reg(reg, REG_LONG));
       break;
     }
     case TY_INT:
     case TY_UINT: {
-      printf("  movl %%%s, %d(%%rbp)\n", reg[value][REG_LONG], offset);
+      emit_inst2(ST_MOV, INST_LONG, emit_reg(value, REG_LONG), emit_reg(reg, REG_LONG));
       break;
     }
     case TY_LONG:
     case TY_ULONG:
     case TY_POINTER: {
-      printf("  movq %%%s, %d(%%rbp)\n", reg[value][REG_QUAD], offset);
+      emit_inst2(ST_MOV, INST_QUAD, emit_reg(value, REG_QUAD), emit_reg(reg, REG_QUAD));
       break;
     }
     default: assert(false);
   }
 }
 
+// block operations
+// The aggregates are zeroed and copied by unrolled 8-byte moves if they
+// are small, or by rep stosq and rep movsq otherwise.
+
+#define BLOCK_UNROLL 64 // the maximum size of unrolled moves
+
+// the memory operand in the block, where REG_BP stands for the frame.
+static EmitOp *gen_block_mem(RegCode base, int disp) {
+  if (base == REG_BP) return gen_frame(disp);
+  return emit_mem(base, disp);
+}
+
+// zero the size bytes at disp(%base), where size is a multiple of 8.
+// %rax and %rcx are destroyed, and so is %rdi if the block is large.
+static void gen_zero(RegCode base, int disp, int size) {
+  emit_inst2(ST_XOR, INST_LONG, emit_reg(REG_AX, REG_LONG), emit_reg(REG_AX, REG_LONG));
+  if (size <= BLOCK_UNROLL) {
+    for (int i = 0; i < size; i += 8) {
+      emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_AX, REG_QUAD), gen_block_mem(base, disp + i));
+    }
+    return;
+  }
+  emit_inst2(ST_LEA, INST_QUAD, gen_block_mem(base, disp), emit_reg(REG_DI, REG_QUAD));
+  emit_inst2(ST_MOV, INST_LONG, emit_imm(size / 8), emit_reg(REG_CX, REG_LONG));
+  emit_inst0(ST_REP_STOS, INST_QUAD);
+}
+
+// copy the size bytes from (%src) to (%dest).
+// %rax is destroyed, and so are %rcx, %rsi and %rdi if the block is large,
+// in which case src and dest should be %rsi and %rdi.
+static void gen_copy(RegCode dest, RegCode src, int size) {
+  int done = 0;
+  if (size > BLOCK_UNROLL) {
+    emit_inst2(ST_MOV, INST_LONG, emit_imm(size / 8), emit_reg(REG_CX, REG_LONG));
+    emit_inst0(ST_REP_MOVS, INST_QUAD);
+    done = size / 8 * 8;
+  }
+
+  // %rsi and %rdi point to the end of the copied part after rep movsq.
+  for (int i = done; i < size;) {
+    int width = size - i >= 8 ? 8 : size - i >= 4 ? 4 : size - i >= 2 ? 2 : 1;
+    InstSuffix suffix = width == 8 ? INST_QUAD : width == 4 ? INST_LONG : width == 2 ? INST_WORD : INST_BYTE;
+    RegSize regtype = width == 8 ? REG_QUAD : width == 4 ? REG_LONG : width == 2 ? REG_WORD : REG_BYTE;
+    emit_inst2(ST_MOV, suffix, emit_mem(src, i - done), emit_reg(REG_AX, regtype));
+    emit_inst2(ST_MOV, suffix, emit_reg(REG_AX, regtype), emit_mem(dest, i - done));
+    i += width;
+  }
+}
+
+// copy the struct value from the address at the top of the value stack
+// to the address below it, and leave the destination address.
+static void gen_copy_struct(int size) {
+  if (size <= BLOCK_UNROLL) {
+    GEN_POP(REG_DX);
+    GEN_POP(REG_CX);
+    gen_copy(REG_CX, REG_DX, size);
+    GEN_PUSH(REG_CX);
+    return;
+  }
+
+  // %rsi and %rdi are freed from the value stack.
+  // the destination is kept in %rdx, since a temporary in the pool
+  // is assumed to be read only once by the peephole optimizer.
+  gen_spill_all();
+  GEN_POP(REG_SI);
+  GEN_POP(REG_DX);
+  emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_reg(REG_DI, REG_QUAD));
+  gen_copy(REG_DI, REG_SI, size);
+  GEN_PUSH(REG_DX);
+}
+
 static void gen_va_start(Expr *expr) {
   gen_lvalue(expr->macro_ap);
-  GEN_POP("rax");
+  GEN_POP(REG_AX);
 
-  printf("  movl $%d, (%%rax)\n", gp_offset);
-  printf("  movl $48, 4(%%rax)\n");
-  printf("  leaq %d(%%rbp), %%rcx\n", overflow_arg_area + 16);
-  printf("  movq %%rcx, 8(%%rax)\n");
-  printf("  leaq -176(%%rbp), %%rcx\n");
-  printf("  movq %%rcx, 16(%%rax)\n");
+  emit_inst2(ST_MOV, INST_LONG, emit_imm(gp_offset), emit_mem(REG_AX, 0));
+  emit_inst2(ST_MOV, INST_LONG, emit_imm(48), emit_mem(REG_AX, 4));
+  emit_inst2(ST_LEA, INST_QUAD, gen_frame(overflow_arg_area + 16), emit_reg(REG_CX, REG_QUAD));
+  emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_CX, REG_QUAD), emit_mem(REG_AX, 8));
+  emit_inst2(ST_LEA, INST_QUAD, gen_frame(-176), emit_reg(REG_CX, REG_QUAD));
+  emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_CX, REG_QUAD), emit_mem(REG_AX, 16));
 
   GEN_PUSH_GARBAGE();
 }
 
 static void gen_va_arg(Expr *expr) {
   gen_lvalue(expr->macro_ap);
-  GEN_POP("rax");
+  GEN_POP(REG_AX);
 
   int label_overflow = label_no++;
   int label_load = label_no++;
 
-  printf("  movl (%%rax), %%ecx\n");
-  printf("  cmpl $48, %%ecx\n");
-  GEN_JUMP("je", label_overflow);
+  emit_inst2(ST_MOV, INST_LONG, emit_mem(REG_AX, 0), emit_reg(REG_CX, REG_LONG));
+  emit_inst2(ST_CMP, INST_LONG, emit_imm(48), emit_reg(REG_CX, REG_LONG));
+  GEN_JUMP(ST_JE, label_overflow);
 
-  printf("  movl %%ecx, %%edx\n");
-  printf("  addl $8, %%edx\n");
-  printf("  movl %%edx, (%%rax)\n");
-  printf("  movq 16(%%rax), %%rdx\n");
-  printf("  addq %%rdx, %%rcx\n");
-  GEN_JUMP("jmp", label_load);
+  emit_inst2(ST_MOV, INST_LONG, emit_reg(REG_CX, REG_LONG), emit_reg(REG_DX, REG_LONG));
+  emit_inst2(ST_ADD, INST_LONG, emit_imm(8), emit_reg(REG_DX, REG_LONG));
+  emit_inst2(ST_MOV, INST_LONG, emit_reg(REG_DX, REG_LONG), emit_mem(REG_AX, 0));
+  emit_inst2(ST_MOV, INST_QUAD, emit_mem(REG_AX, 16), emit_reg(REG_DX, REG_QUAD));
+  emit_inst2(ST_ADD, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_reg(REG_CX, REG_QUAD));
+  emit_inst2(ST_MOV, INST_QUAD, emit_mem(REG_CX, 0), emit_reg(REG_AX, REG_QUAD));
+  GEN_JUMP(ST_JMP, label_load);
 
   GEN_LABEL(label_overflow);
-  printf("  movq 8(%%rax), %%rcx\n");
-  printf("  movq %%rcx, %%rdx\n");
-  printf("  addq $8, %%rdx\n");
-  printf("  movq %%rdx, 8(%%rax)\n");
+  emit_inst2(ST_MOV, INST_QUAD, emit_mem(REG_AX, 8), emit_reg(REG_CX, REG_QUAD));
+  emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_CX, REG_QUAD), emit_reg(REG_DX, REG_QUAD));
+  emit_inst2(ST_ADD, INST_QUAD, emit_imm(8), emit_reg(REG_DX, REG_QUAD));
+  emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_mem(REG_AX, 8));
+  emit_inst2(ST_MOV, INST_QUAD, emit_mem(REG_CX, 0), emit_reg(REG_AX, REG_QUAD));
 
+  // the argument is loaded on both paths, so that only %rax is live at the label.
   GEN_LABEL(label_load);
-  printf("  movq (%%rcx), %%rax\n");
-  GEN_PUSH("rax");
+  GEN_PUSH(REG_AX);
 }
 
 static void gen_va_end(Expr *expr) {
@@ -284,30 +538,95 @@ static void gen_va_end(Expr *expr) {
 }
 
 static void gen_identifier(Expr *expr) {
+  if (expr->symbol->promoted) {
+    GEN_PUSH(expr->symbol->reg);
+    return;
+  }
   gen_lvalue(expr);
   gen_load(expr->type);
 }
 
 static void gen_integer(Expr *expr) {
+  RegCode reg = gen_push_reg();
   switch (expr->type->ty_type) {
+    case TY_BOOL:
+    case TY_CHAR:
+    case TY_UCHAR:
+    case TY_SHORT:
+    case TY_USHORT:
     case TY_INT:
     case TY_UINT: {
-      printf("  movl $%llu, %%eax\n", expr->int_value);
+      emit_inst2(ST_MOV, INST_LONG, emit_imm(expr->int_value & 0xffffffff), emit_reg(reg, REG_LONG));
       break;
     }
     case TY_LONG:
     case TY_ULONG: {
-      printf("  movq $%llu, %%rax\n", expr->int_value);
+      emit_inst2(ST_MOV, INST_QUAD, emit_imm(expr->int_value), emit_reg(reg, REG_QUAD));
       break;
     }
     default: assert(false);
   }
-  GEN_PUSH("rax");
 }
 
 static void gen_string(Expr *expr) {
-  printf("  leaq .S%d(%%rip), %%rax\n", expr->string_label);
-  GEN_PUSH("rax");
+  RegCode reg = gen_push_reg();
+  emit_inst2(ST_LEA, INST_QUAD, emit_rip_string(expr->string_label), emit_reg(reg, REG_QUAD));
+}
+
+// move the registers at once, as a parallel move.
+// a cycle of the moves is broken through %rax.
+static void gen_parallel_move(int *src, int *dest, int moves) {
+  while (moves > 0) {
+    // find a move whose destination is not the source of the others.
+    int k = -1;
+    for (int i = 0; i < moves && k < 0; i++) {
+      bool blocked = false;
+      for (int j = 0; j < moves; j++) {
+        if (j != i && src[j] == dest[i]) blocked = true;
+      }
+      if (!blocked) k = i;
+    }
+
+    // all moves are blocked by a cycle, which is broken through %rax.
+    if (k < 0) {
+      emit_inst2(ST_MOV, INST_QUAD, emit_reg(src[0], REG_QUAD), emit_reg(REG_AX, REG_QUAD));
+      src[0] = REG_AX;
+      continue;
+    }
+
+    if (src[k] != dest[k]) {
+      emit_inst2(ST_MOV, INST_QUAD, emit_reg(src[k], REG_QUAD), emit_reg(dest[k], REG_QUAD));
+    }
+    moves--;
+    src[k] = src[moves];
+    dest[k] = dest[moves];
+  }
+}
+
+// move the top n slots of the value stack to the argument registers.
+// the top slot is the first argument.
+static void gen_args(int n) {
+  // the slots in the pool are moved at once, as a parallel move
+  // since the argument registers may be used by other slots.
+  int src[6], dest[6];
+  int moves = 0;
+  for (int i = 0; i < n; i++) {
+    int slot = (int) (intptr_t) slots->buffer[slots->length - 1 - i];
+    if (slot >= 0) {
+      src[moves] = pool_reg[slot];
+      dest[moves] = arg_reg[i];
+      moves++;
+    }
+  }
+  gen_parallel_move(src, dest, moves);
+
+  // the spilled slots are below the slots in the pool,
+  // and they are popped after the parallel move.
+  for (int i = 0; i < n; i++) {
+    if (gen_free_slot() < 0) {
+      emit_inst1(ST_POP, INST_QUAD, emit_reg(arg_reg[i], REG_QUAD));
+    }
+  }
 }
 
 static void gen_call(Expr *expr) {
@@ -333,12 +652,17 @@ static void gen_call(Expr *expr) {
   //   --- <= %rsp (16-byte aligned)
   // [lower address]
 
+  // all registers of the pool are destroyed by the callee,
+  // so the values on the value stack are saved on the machine stack.
+  gen_spill_all();
+  frame_pushed = true;
+
   // 16-byte alignment
   int stack_args = expr->args->length > 6 ? expr->args->length - 6 : 0;
   int stack_top = stack_depth + stack_args * 8;
   int padding = stack_top % 16 ? 16 - stack_top % 16 : 0;
   if (padding > 0) {
-    printf("  subq $%d, %%rsp\n", padding);
+    emit_inst2(ST_SUB, INST_QUAD, emit_imm(padding), emit_reg(REG_SP, REG_QUAD));
     stack_depth += padding;
   }
 
@@ -347,25 +671,130 @@ static void gen_call(Expr *expr) {
     Expr *arg = expr->args->buffer[i];
     gen_expr(arg);
   }
-  for (int i = 0; i < expr->args->length; i++) {
-    if (i >= 6) break;
-    GEN_POP(reg[arg_reg[i]][REG_QUAD]);
+  if (stack_args > 0) {
+    gen_spill_all();
   }
+  gen_args(expr->args->length - stack_args);
 
   // for function with variable length arguments
   if (!expr->expr->symbol || expr->expr->symbol->type->ellipsis) {
-    printf("  movb $0, %%al\n");
+    emit_inst2(ST_MOV, INST_BYTE, emit_imm(0), emit_reg(REG_AX, REG_BYTE));
   }
 
-  printf("  call %s\n", expr->expr->identifier);
+  emit_inst1(ST_CALL, NO_SUFFIX, emit_sym(expr->expr->identifier));
 
   // restore rsp
   if (padding + stack_args * 8 > 0) {
-    printf("  addq $%d, %%rsp\n", padding + stack_args * 8);
+    emit_inst2(ST_ADD, INST_QUAD, emit_imm(padding + stack_args * 8), emit_reg(REG_SP, REG_QUAD));
     stack_depth -= padding + stack_args * 8;
   }
 
-  GEN_PUSH("rax");
+  GEN_PUSH(REG_AX);
+}
+
+// builtin functions
+// memcpy and memset of a constant size up to BLOCK_UNROLL bytes are
+// expanded to unrolled moves, and the others to rep movsb and rep stosb.
+// strcmp compares the first characters inline, and calls the library
+// function only if they are the same and not null.
+
+static bool gen_check_unroll(Expr *size) {
+  return size->nd_type == ND_INTEGER && size->int_value <= BLOCK_UNROLL;
+}
+
+static void gen_memcpy(Expr *expr) {
+  Expr *size = expr->args->buffer[2];
+  gen_expr(expr->args->buffer[0]);
+  gen_expr(expr->args->buffer[1]);
+  if (gen_check_unroll(size)) {
+    gen_copy_struct(size->int_value);
+    return;
+  }
+  gen_expr(size);
+
+  gen_spill_all();
+  GEN_POP(REG_CX);
+  GEN_POP(REG_SI);
+  GEN_POP(REG_DX);
+  emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_reg(REG_DI, REG_QUAD));
+  emit_inst0(ST_REP_MOVS, INST_BYTE);
+  GEN_PUSH(REG_DX);
+}
+
+static void gen_memset(Expr *expr) {
+  Expr *size = expr->args->buffer[2];
+  gen_expr(expr->args->buffer[0]);
+  gen_expr(expr->args->buffer[1]);
+  if (gen_check_unroll(size)) {
+    // the byte is repeated in %rax.
+    GEN_POP(REG_AX);
+    emit_inst2(ST_MOVZB, INST_LONG, emit_reg(REG_AX, REG_BYTE), emit_reg(REG_AX, REG_LONG));
+    emit_inst2(ST_MOV, INST_QUAD, emit_imm(0x0101010101010101), emit_reg(REG_CX, REG_QUAD));
+    emit_inst2(ST_IMUL, INST_QUAD, emit_reg(REG_CX, REG_QUAD), emit_reg(REG_AX, REG_QUAD));
+    GEN_POP(REG_CX);
+    for (int i = 0; i < size->int_value;) {
+      int width = size->int_value - i >= 8 ? 8 : size->int_value - i >= 4 ? 4 : size->int_value - i >= 2 ? 2 : 1;
+      InstSuffix suffix = width == 8 ? INST_QUAD : width == 4 ? INST_LONG : width == 2 ? INST_WORD : INST_BYTE;
+      RegSize regtype = width == 8 ? REG_QUAD : width == 4 ? REG_LONG : width == 2 ? REG_WORD : REG_BYTE;
+      emit_inst2(ST_MOV, suffix, emit_reg(REG_AX, regtype), emit_mem(REG_CX, i));
+      i += width;
+    }
+    GEN_PUSH(REG_CX);
+    return;
+  }
+  gen_expr(size);
+
+  gen_spill_all();
+  GEN_POP(REG_CX);
+  GEN_POP(REG_AX);
+  GEN_POP(REG_DX);
+  emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_reg(REG_DI, REG_QUAD));
+  emit_inst0(ST_REP_STOS, INST_BYTE);
+  GEN_PUSH(REG_DX);
+}
+
+// the result is the difference of the first characters if they differ.
+// the arguments are kept on the stack across the branches, since the
+// temporaries are not live across jumps, and only %rax is live at the labels.
+static void gen_strcmp(Expr *expr) {
+  gen_spill_all();
+  gen_expr(expr->args->buffer[1]);
+  gen_expr(expr->args->buffer[0]);
+  gen_args(2);
+
+  frame_pushed = true;
+  emit_inst1(ST_PUSH, INST_QUAD, emit_reg(REG_DI, REG_QUAD));
+  emit_inst1(ST_PUSH, INST_QUAD, emit_reg(REG_SI, REG_QUAD));
+
+  int label_differ = label_no++;
+  int label_end = label_no++;
+  emit_inst2(ST_MOVZB, INST_LONG, emit_mem(REG_DI, 0), emit_reg(REG_AX, REG_LONG));
+  emit_inst2(ST_MOVZB, INST_LONG, emit_mem(REG_SI, 0), emit_reg(REG_CX, REG_LONG));
+  emit_inst2(ST_SUB, INST_LONG, emit_reg(REG_CX, REG_LONG), emit_reg(REG_AX, REG_LONG));
+  GEN_JUMP(ST_JNE, label_differ);
+
+  // the result is 0 if the same characters are null.
+  emit_inst1(ST_POP, INST_QUAD, emit_reg(REG_SI, REG_QUAD));
+  emit_inst1(ST_POP, INST_QUAD, emit_reg(REG_DI, REG_QUAD));
+  emit_inst2(ST_CMP, INST_BYTE, emit_imm(0), emit_mem(REG_SI, 0));
+  GEN_JUMP(ST_JE, label_end);
+
+  // 16-byte alignment
+  int padding = stack_depth % 16 ? 16 - stack_depth % 16 : 0;
+  if (padding > 0) {
+    emit_inst2(ST_SUB, INST_QUAD, emit_imm(padding), emit_reg(REG_SP, REG_QUAD));
+  }
+  emit_inst1(ST_CALL, NO_SUFFIX, emit_sym("strcmp"));
+  if (padding > 0) {
+    emit_inst2(ST_ADD, INST_QUAD, emit_imm(padding), emit_reg(REG_SP, REG_QUAD));
+  }
+  GEN_JUMP(ST_JMP, label_end);
+
+  GEN_LABEL(label_differ);
+  emit_inst2(ST_ADD, INST_QUAD, emit_imm(16), emit_reg(REG_SP, REG_QUAD));
+
+  GEN_LABEL(label_end);
+  GEN_PUSH(REG_AX);
 }
 
 static void gen_dot(Expr *expr) {
@@ -383,222 +812,504 @@ static void gen_indirect(Expr *expr) {
 }
 
 static void gen_uminus(Expr *expr) {
-  GEN_OP(expr->expr, "rax");
+  RegCode reg = gen_operand(expr->expr, REG_AX);
   switch (expr->expr->type->ty_type) {
     case TY_INT:
     case TY_UINT: {
-      printf("  negl %%eax\n");
+      emit_inst1(ST_NEG, INST_LONG, emit_reg(reg, REG_LONG));
       break;
     }
     case TY_LONG:
     case TY_ULONG: {
-      printf("  negq %%rax\n");
+      emit_inst1(ST_NEG, INST_QUAD, emit_reg(reg, REG_QUAD));
       break;
     }
     default: assert(false);
   }
-  GEN_PUSH("rax");
+  GEN_PUSH(reg);
 }
 
 static void gen_not(Expr *expr) {
-  GEN_OP(expr->expr, "rax");
+  RegCode reg = gen_operand(expr->expr, REG_AX);
   switch (expr->expr->type->ty_type) {
     case TY_INT:
     case TY_UINT: {
-      printf("  notl %%eax\n");
+      emit_inst1(ST_NOT, INST_LONG, emit_reg(reg, REG_LONG));
       break;
     }
     case TY_LONG:
     case TY_ULONG: {
-      printf("  notq %%rax\n");
+      emit_inst1(ST_NOT, INST_QUAD, emit_reg(reg, REG_QUAD));
       break;
     }
     default: assert(false);
   }
-  GEN_PUSH("rax");
+  GEN_PUSH(reg);
 }
 
 static void gen_lnot(Expr *expr) {
-  GEN_OP(expr->expr, "rax");
-  printf("  cmpq $0, %%rax\n");
-  printf("  sete %%al\n");
-  printf("  movzbl %%al, %%eax\n");
-  GEN_PUSH("rax");
+  RegCode reg = gen_operand(expr->expr, REG_AX);
+  emit_inst2(ST_CMP, INST_QUAD, emit_imm(0), emit_reg(reg, REG_QUAD));
+  emit_inst1(ST_SETE, NO_SUFFIX, emit_reg(reg, REG_BYTE));
+  emit_inst2(ST_MOVZB, INST_LONG, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_LONG));
+  GEN_PUSH(reg);
 }
 
 static void gen_cast(Expr *expr) {
-  GEN_OP(expr->expr, "rax");
-
   Type *to = expr->type;
   Type *from = expr->expr->type;
 
+  // the casts between the same types are inserted by the usual arithmetic
+  // conversion, and the value is left on the value stack as it is.
+  if (to->ty_type == from->ty_type) {
+    gen_expr(expr->expr);
+    return;
+  }
+
+  RegCode reg = gen_operand(expr->expr, REG_AX);
+
   if (to->ty_type == TY_BOOL) {
     if (from->ty_type == TY_CHAR || from->ty_type == TY_UCHAR) {
-      printf("  cmpb $0, %%al\n");
-      printf("  setne %%al\n");
+      emit_inst2(ST_CMP, INST_BYTE, emit_imm(0), emit_reg(reg, REG_BYTE));
+      emit_inst1(ST_SETNE, NO_SUFFIX, emit_reg(reg, REG_BYTE));
     } else if (from->ty_type == TY_SHORT || from->ty_type == TY_USHORT) {
-      printf("  cmpw $0, %%ax\n");
-      printf("  setne %%al\n");
+      emit_inst2(ST_CMP, INST_WORD, emit_imm(0), emit_reg(reg, REG_WORD));
+      emit_inst1(ST_SETNE, NO_SUFFIX, emit_reg(reg, REG_BYTE));
     } else if (from->ty_type == TY_INT || from->ty_type == TY_UINT) {
-      printf("  cmpl $0, %%eax\n");
-      printf("  setne %%al\n");
+      emit_inst2(ST_CMP, INST_LONG, emit_imm(0), emit_reg(reg, REG_LONG));
+      emit_inst1(ST_SETNE, NO_SUFFIX, emit_reg(reg, REG_BYTE));
     }
   } else if (to->ty_type == TY_SHORT || to->ty_type == TY_USHORT) {
     if (from->ty_type == TY_BOOL) {
-      printf("  movzbw %%al, %%ax\n");
+      emit_inst2(ST_MOVZB, INST_WORD, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_WORD));
     } else if (from->ty_type == TY_CHAR) {
-      printf("  movsbw %%al, %%ax\n");
+      emit_inst2(ST_MOVSB, INST_WORD, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_WORD));
     } else if (from->ty_type == TY_UCHAR) {
-      printf("  movzbw %%al, %%ax");
+      emit_inst2(ST_MOVZB, INST_WORD, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_WORD));
     }
   } else if (to->ty_type == TY_INT || to->ty_type == TY_UINT) {
     if (from->ty_type == TY_BOOL) {
-      printf("  movzbl %%al, %%eax\n");
+      emit_inst2(ST_MOVZB, INST_LONG, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_LONG));
     } else if (from->ty_type == TY_CHAR) {
-      printf("  movsbl %%al, %%eax\n");
+      emit_inst2(ST_MOVSB, INST_LONG, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_LONG));
     } else if (from->ty_type == TY_UCHAR) {
-      printf("  movzbl %%al, %%eax\n");
+      emit_inst2(ST_MOVZB, INST_LONG, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_LONG));
     } else if (from->ty_type == TY_SHORT) {
-      printf("  movswl %%ax, %%eax\n");
+      emit_inst2(ST_MOVSW, INST_LONG, emit_reg(reg, REG_WORD), emit_reg(reg, REG_LONG));
     } else if (from->ty_type == TY_USHORT) {
-      printf("  movzwl %%ax, %%eax\n");
+      emit_inst2(ST_MOVZW, INST_LONG, emit_reg(reg, REG_WORD), emit_reg(reg, REG_LONG));
     }
   } else if (to->ty_type == TY_LONG || to->ty_type == TY_ULONG) {
     if (from->ty_type == TY_BOOL) {
-      printf("  movzbl %%al, %%eax\n");
+      emit_inst2(ST_MOVZB, INST_LONG, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_LONG));
     } else if (from->ty_type == TY_CHAR) {
-      printf("  movsbq %%al, %%rax\n");
+      emit_inst2(ST_MOVSB, INST_QUAD, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_QUAD));
     } else if (from->ty_type == TY_UCHAR) {
-      printf("  movzbl %%al, %%eax\n");
+      emit_inst2(ST_MOVZB, INST_LONG, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_LONG));
     } else if (from->ty_type == TY_SHORT) {
-      printf("  movswq %%ax, %%rax\n");
+      emit_inst2(ST_MOVSW, INST_QUAD, emit_reg(reg, REG_WORD), emit_reg(reg, REG_QUAD));
     } else if (from->ty_type == TY_USHORT) {
-      printf("  movzwl %%ax, %%eax\n");
+      emit_inst2(ST_MOVZW, INST_LONG, emit_reg(reg, REG_WORD), emit_reg(reg, REG_LONG));
     } else if (from->ty_type == TY_INT) {
-      printf("  movslq %%eax, %%rax\n");
+      emit_inst2(ST_MOVSL, INST_QUAD, emit_reg(reg, REG_LONG), emit_reg(reg, REG_QUAD));
     }
   }
 
-  GEN_PUSH("rax");
+  GEN_PUSH(reg);
 }
 
-static void gen_mul(Expr *expr) {
-  GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
-  switch (expr->type->ty_type) {
-    case TY_INT: {
-      printf("  imull %%ecx\n");
-      break;
+// strength reduction
+// The multiplication and the division by an integer constant are replaced
+// with shifts, lea and multiplications, which are much faster than div.
+
+// returns k if the value is 2^k, or -1 otherwise.
+int log2_exact(unsigned long long value) {
+  if (value == 0 || (value & (value - 1)) != 0) return -1;
+  int k = 0;
+  while (value != 1) {
+    value = value >> 1;
+    k++;
+  }
+  return k;
+}
+
+// multiply the register by the constant. %rdx is destroyed.
+static void gen_mul_imm(RegCode reg, unsigned long long value, RegSize size) {
+  InstSuffix suffix = size == REG_QUAD ? INST_QUAD : INST_LONG;
+  if (size == REG_LONG) {
+    value = value & 0xffffffff;
+  }
+  int k = log2_exact(value);
+  if (value == 1) return;
+  if (value == 0) {
+    emit_inst2(ST_MOV, suffix, emit_imm(0), emit_reg(reg, size));
+  } else if (k > 0) {
+    emit_inst2(ST_SAL, suffix, emit_imm(k), emit_reg(reg, size));
+  } else if (value == 3 || value == 5 || value == 9) {
+    // x * 3 == x + x * 2
+    Scale scale = value == 3 ? SCALE2 : value == 5 ? SCALE4 : SCALE8;
+    emit_inst2(ST_LEA, suffix, emit_mem_sib(reg, reg, scale, 0), emit_reg(reg, size));
+  } else if (size == REG_LONG || check_imm32(value)) {
+    emit_inst2(ST_IMUL, suffix, emit_imm(value), emit_reg(reg, size));
+  } else {
+    emit_inst2(ST_MOV, suffix, emit_imm(value), emit_reg(REG_DX, size));
+    emit_inst2(ST_IMUL, suffix, emit_reg(REG_DX, size), emit_reg(reg, size));
+  }
+}
+
+// the magic number for the signed division by d (2 <= d < 2^(bits-1)).
+// n / d is the upper half of n * magic (plus n if magic is negative),
+// shifted arithmetically by shift, and then rounded toward zero.
+// (Hacker's Delight, 10-1)
+static void magic_signed(unsigned long long d, int bits, unsigned long long *magic, int *shift) {
+  unsigned long long mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+  unsigned long long two = 1ULL << (bits - 1);
+  unsigned long long anc = two - 1 - two % d;
+  unsigned long long q1 = two / anc;
+  unsigned long long r1 = two - q1 * anc;
+  unsigned long long q2 = two / d;
+  unsigned long long r2 = two - q2 * d;
+  unsigned long long delta;
+  int p = bits - 1;
+  do {
+    p++;
+    q1 = (q1 * 2) & mask;
+    r1 = (r1 * 2) & mask;
+    if (r1 >= anc) {
+      q1 = (q1 + 1) & mask;
+      r1 = r1 - anc;
+    }
+    q2 = (q2 * 2) & mask;
+    r2 = (r2 * 2) & mask;
+    if (r2 >= d) {
+      q2 = (q2 + 1) & mask;
+      r2 = r2 - d;
+    }
+    delta = d - r2;
+  } while (q1 < delta || (q1 == delta && r1 == 0));
+  *magic = (q2 + 1) & mask;
+  *shift = p - bits;
+}
+
+// the magic number for the 64-bit unsigned division by d (d >= 2).
+// n / d is the upper half of n * magic shifted by shift.
+// if the magic number needs 65 bits, add is set and the lost bit is
+// added back by (n - t) / 2 + t. (Hacker's Delight, 10-2)
+static void magic_unsigned(unsigned long long d, unsigned long long *magic, int *shift, bool *add) {
+  unsigned long long two = 1ULL << 63;
+  unsigned long long nc = ~0ULL - (0 - d) % d;
+  unsigned long long q1 = two / nc;
+  unsigned long long r1 = two - q1 * nc;
+  unsigned long long q2 = (two - 1) / d;
+  unsigned long long r2 = (two - 1) - q2 * d;
+  unsigned long long delta;
+  int p = 63;
+  *add = false;
+  do {
+    p++;
+    if (r1 >= nc - r1) {
+      q1 = q1 * 2 + 1;
+      r1 = r1 * 2 - nc;
+    } else {
+      q1 = q1 * 2;
+      r1 = r1 * 2;
     }
-    case TY_UINT: {
-      printf("  mull %%ecx\n");
-      break;
+    if (r2 + 1 >= d - r2) {
+      if (q2 >= two - 1) *add = true;
+      q2 = q2 * 2 + 1;
+      r2 = r2 * 2 + 1 - d;
+    } else {
+      if (q2 >= two) *add = true;
+      q2 = q2 * 2;
+      r2 = r2 * 2 + 1;
+    }
+    delta = d - 1 - r2;
+  } while (p < 128 && (q1 < delta || (q1 == delta && r1 == 0)));
+  *magic = q2 + 1;
+  *shift = p - 64;
+}
+
+// divide %rax by the constant d, which is not a power of two.
+// the quotient is stored to %rax, and the dividend is kept in %rcx.
+static void gen_div_magic(unsigned long long d, bool sign, RegSize size) {
+  unsigned long long magic;
+  int shift;
+  bool add;
+  if (sign && size == REG_LONG) {
+    // the 64-bit product of the sign-extended operands holds the upper half.
+    magic_signed(d, 32, &magic, &shift);
+    add = magic >= 0x80000000;
+    emit_inst2(ST_MOVSL, INST_QUAD, emit_reg(REG_AX, REG_LONG), emit_reg(REG_CX, REG_QUAD));
+    emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_CX, REG_QUAD), emit_reg(REG_AX, REG_QUAD));
+    emit_inst2(ST_IMUL, INST_QUAD, emit_imm(add ? magic | (~0ULL << 32) : magic), emit_reg(REG_AX, REG_QUAD));
+    emit_inst2(ST_SAR, INST_QUAD, emit_imm(32), emit_reg(REG_AX, REG_QUAD));
+    if (add) {
+      emit_inst2(ST_ADD, INST_LONG, emit_reg(REG_CX, REG_LONG), emit_reg(REG_AX, REG_LONG));
+    }
+    if (shift > 0) {
+      emit_inst2(ST_SAR, INST_LONG, emit_imm(shift), emit_reg(REG_AX, REG_LONG));
+    }
+    // add 1 if the quotient is negative.
+    emit_inst2(ST_MOV, INST_LONG, emit_reg(REG_AX, REG_LONG), emit_reg(REG_DX, REG_LONG));
+    emit_inst2(ST_SHR, INST_LONG, emit_imm(31), emit_reg(REG_DX, REG_LONG));
+    emit_inst2(ST_ADD, INST_LONG, emit_reg(REG_DX, REG_LONG), emit_reg(REG_AX, REG_LONG));
+  } else if (sign) {
+    magic_signed(d, 64, &magic, &shift);
+    emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_AX, REG_QUAD), emit_reg(REG_CX, REG_QUAD));
+    emit_inst2(ST_MOV, INST_QUAD, emit_imm(magic), emit_reg(REG_AX, REG_QUAD));
+    emit_inst1(ST_IMUL, INST_QUAD, emit_reg(REG_CX, REG_QUAD));
+    if ((long) magic < 0) {
+      emit_inst2(ST_ADD, INST_QUAD, emit_reg(REG_CX, REG_QUAD), emit_reg(REG_DX, REG_QUAD));
+    }
+    if (shift > 0) {
+      emit_inst2(ST_SAR, INST_QUAD, emit_imm(shift), emit_reg(REG_DX, REG_QUAD));
+    }
+    // add 1 if the quotient is negative.
+    emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_reg(REG_AX, REG_QUAD));
+    emit_inst2(ST_SHR, INST_QUAD, emit_imm(63), emit_reg(REG_AX, REG_QUAD));
+    emit_inst2(ST_ADD, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_reg(REG_AX, REG_QUAD));
+  } else if (size == REG_LONG) {
+    // ceil(2^64 / d) is precise enough for every 32-bit dividend.
+    emit_inst2(ST_MOV, INST_LONG, emit_reg(REG_AX, REG_LONG), emit_reg(REG_CX, REG_LONG));
+    emit_inst2(ST_MOV, INST_QUAD, emit_imm(~0ULL / d + 1), emit_reg(REG_AX, REG_QUAD));
+    emit_inst1(ST_MUL, INST_QUAD, emit_reg(REG_CX, REG_QUAD));
+    emit_inst2(ST_MOV, INST_LONG, emit_reg(REG_DX, REG_LONG), emit_reg(REG_AX, REG_LONG));
+  } else {
+    magic_unsigned(d, &magic, &shift, &add);
+    emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_AX, REG_QUAD), emit_reg(REG_CX, REG_QUAD));
+    emit_inst2(ST_MOV, INST_QUAD, emit_imm(magic), emit_reg(REG_AX, REG_QUAD));
+    emit_inst1(ST_MUL, INST_QUAD, emit_reg(REG_CX, REG_QUAD));
+    if (add) {
+      emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_CX, REG_QUAD), emit_reg(REG_AX, REG_QUAD));
+      emit_inst2(ST_SUB, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_reg(REG_AX, REG_QUAD));
+      emit_inst2(ST_SHR, INST_QUAD, emit_imm(1), emit_reg(REG_AX, REG_QUAD));
+      emit_inst2(ST_ADD, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_reg(REG_AX, REG_QUAD));
+      shift--;
+    } else {
+      emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_reg(REG_AX, REG_QUAD));
     }
-    case TY_LONG: {
-      printf("  imulq %%rcx\n");
-      break;
+    if (shift > 0) {
+      emit_inst2(ST_SHR, INST_QUAD, emit_imm(shift), emit_reg(REG_AX, REG_QUAD));
     }
-    case TY_ULONG: {
-      printf("  mulq %%rcx\n");
-      break;
+  }
+}
+
+// divide %rax by the positive constant d.
+// returns the register which holds the quotient, or the remainder if mod is set.
+static RegCode gen_div_const(unsigned long long d, bool sign, bool mod, RegSize size) {
+  InstSuffix suffix = size == REG_QUAD ? INST_QUAD : INST_LONG;
+  int bits = size == REG_QUAD ? 64 : 32;
+  RegCode result = REG_AX;
+  int k = log2_exact(d);
+  if (d == 1) {
+    if (mod) {
+      emit_inst2(ST_MOV, suffix, emit_imm(0), emit_reg(REG_AX, size));
+    }
+  } else if (k > 0 && !sign) {
+    if (!mod) {
+      emit_inst2(ST_SHR, suffix, emit_imm(k), emit_reg(REG_AX, size));
+    } else if (size == REG_LONG || check_imm32(d - 1)) {
+      emit_inst2(ST_AND, suffix, emit_imm(d - 1), emit_reg(REG_AX, size));
+    } else {
+      emit_inst2(ST_MOV, suffix, emit_imm(d - 1), emit_reg(REG_CX, size));
+      emit_inst2(ST_AND, suffix, emit_reg(REG_CX, size), emit_reg(REG_AX, size));
+    }
+  } else if (k > 0) {
+    // add d - 1 to a negative dividend to round toward zero.
+    emit_inst2(ST_MOV, suffix, emit_reg(REG_AX, size), emit_reg(REG_CX, size));
+    if (k > 1) {
+      emit_inst2(ST_SAR, suffix, emit_imm(bits - 1), emit_reg(REG_CX, size));
+    }
+    emit_inst2(ST_SHR, suffix, emit_imm(bits - k), emit_reg(REG_CX, size));
+    emit_inst2(ST_ADD, suffix, emit_reg(REG_AX, size), emit_reg(REG_CX, size));
+    if (!mod) {
+      emit_inst2(ST_SAR, suffix, emit_imm(k), emit_reg(REG_CX, size));
+      result = REG_CX;
+    } else {
+      unsigned long long mask = size == REG_QUAD ? 0 - d : (0 - d) & 0xffffffff;
+      if (size == REG_LONG || check_imm32(mask)) {
+        emit_inst2(ST_AND, suffix, emit_imm(mask), emit_reg(REG_CX, size));
+      } else {
+        emit_inst2(ST_MOV, suffix, emit_imm(mask), emit_reg(REG_DX, size));
+        emit_inst2(ST_AND, suffix, emit_reg(REG_DX, size), emit_reg(REG_CX, size));
+      }
+      emit_inst2(ST_SUB, suffix, emit_reg(REG_CX, size), emit_reg(REG_AX, size));
     }
-    default: assert(false);
+  } else {
+    gen_div_magic(d, sign, size);
+    if (mod) {
+      // n % d == n - n / d * d
+      gen_mul_imm(REG_AX, d, size);
+      emit_inst2(ST_SUB, suffix, emit_reg(REG_AX, size), emit_reg(REG_CX, size));
+      result = REG_CX;
+    }
+  }
+  return result;
+}
+
+// division and modulo by a positive constant.
+// returns false if the divisor is not a constant.
+static bool gen_div_imm(Expr *expr) {
+  if (expr->rhs->nd_type != ND_INTEGER) return false;
+
+  TypeType ty_type = expr->type->ty_type;
+  bool sign = ty_type == TY_INT || ty_type == TY_LONG;
+  bool mod = expr->nd_type == ND_MOD;
+  RegSize size = expr->type->size == 8 ? REG_QUAD : REG_LONG;
+  unsigned long long d = expr->rhs->int_value;
+  if (d == 0 || (sign && (long) d < 0)) return false;
+
+  GEN_OP(expr->lhs, REG_AX);
+  GEN_PUSH(gen_div_const(d, sign, mod, size));
+  return true;
+}
+
+static void gen_mul(Expr *expr) {
+  Expr *lhs = expr->lhs, *rhs = expr->rhs;
+  if (lhs->nd_type == ND_INTEGER) {
+    lhs = expr->rhs;
+    rhs = expr->lhs;
+  }
+  if (rhs->nd_type == ND_INTEGER) {
+    RegCode reg = gen_operand(lhs, REG_AX);
+    gen_mul_imm(reg, rhs->int_value, expr->type->size == 8 ? REG_QUAD : REG_LONG);
+    GEN_PUSH(reg);
+    return;
+  }
+
+  // the lower half of the product is the same for signed and unsigned
+  // operands, so that the two-operand imul is used for both.
+  RegCode reg;
+  EmitOp *op = gen_operands(expr->lhs, expr->rhs, &reg);
+  if (expr->type->size == 8) {
+    emit_inst2(ST_IMUL, INST_QUAD, op, emit_reg(reg, REG_QUAD));
+  } else {
+    emit_inst2(ST_IMUL, INST_LONG, op, emit_reg(reg, REG_LONG));
   }
-  GEN_PUSH("rax");
+  GEN_PUSH(reg);
 }
 
 static void gen_div(Expr *expr) {
-  GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
+  if (gen_div_imm(expr)) return;
+
+  GEN_OP2(expr->lhs, expr->rhs, REG_AX, REG_CX);
   switch (expr->type->ty_type) {
     case TY_INT: {
       // cltd: sign extension (eax -> edx:eax)
       // idivl: signed devide edx:eax by 32-bit register.
-      printf("  cltd\n");
-      printf("  idivl %%ecx\n");
+      emit_inst0(ST_CLTD, NO_SUFFIX);
+      emit_inst1(ST_IDIV, INST_LONG, emit_reg(REG_CX, REG_LONG));
       break;
     }
     case TY_UINT: {
       // divl: unsigned devide edx:eax by 32-bit register.
-      printf("  movl $0, %%edx\n");
-      printf("  divl %%ecx\n");
+      emit_inst2(ST_MOV, INST_LONG, emit_imm(0), emit_reg(REG_DX, REG_LONG));
+      emit_inst1(ST_DIV, INST_LONG, emit_reg(REG_CX, REG_LONG));
       break;
     }
     case TY_LONG: {
       // cqto: sign extension (rax -> rdx:rax)
       // idivq: signed devide rdx:rax by 64-bit register.
-      printf("  cqto\n");
-      printf("  idivq %%rcx\n");
+      emit_inst0(ST_CQTO, NO_SUFFIX);
+      emit_inst1(ST_IDIV, INST_QUAD, emit_reg(REG_CX, REG_QUAD));
       break;
     }
     case TY_ULONG: {
       // divq: unsigned devide rdx:rax by 64-bit register.
-      printf("  movq $0, %%rdx\n");
-      printf("  divq %%rcx\n");
+      emit_inst2(ST_MOV, INST_QUAD, emit_imm(0), emit_reg(REG_DX, REG_QUAD));
+      emit_inst1(ST_DIV, INST_QUAD, emit_reg(REG_CX, REG_QUAD));
       break;
     }
     default: assert(false);
   }
-  GEN_PUSH("rax");
+  GEN_PUSH(REG_AX);
 }
 
 static void gen_mod(Expr *expr) {
-  GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
+  if (gen_div_imm(expr)) return;
+
+  GEN_OP2(expr->lhs, expr->rhs, REG_AX, REG_CX);
   switch (expr->type->ty_type) {
     case TY_INT: {
       // cltd: sign extension (eax -> edx:eax)
       // idivl: signed devide edx:eax by 32-bit register.
-      printf("  cltd\n");
-      printf("  idivl %%ecx\n");
+      emit_inst0(ST_CLTD, NO_SUFFIX);
+      emit_inst1(ST_IDIV, INST_LONG, emit_reg(REG_CX, REG_LONG));
       break;
     }
     case TY_UINT: {
       // divl: unsigned devide edx:eax by 32-bit register.
-      printf("  movl $0, %%edx\n");
-      printf("  divl %%ecx\n");
+      emit_inst2(ST_MOV, INST_LONG, emit_imm(0), emit_reg(REG_DX, REG_LONG));
+      emit_inst1(ST_DIV, INST_LONG, emit_reg(REG_CX, REG_LONG));
       break;
     }
     case TY_LONG: {
       // cqto: sign extension (rax -> rdx:rax)
       // idivq: signed devide rdx:rax by 64-bit register.
-      printf("  cqto\n");
-      printf("  idivq %%rcx\n");
+      emit_inst0(ST_CQTO, NO_SUFFIX);
+      emit_inst1(ST_IDIV, INST_QUAD, emit_reg(REG_CX, REG_QUAD));
       break;
     }
     case TY_ULONG: {
       // divq: unsigned devide rdx:rax by 64-bit register.
-      printf("  movq $0, %%rdx\n");
-      printf("  divq %%rcx\n");
+      emit_inst2(ST_MOV, INST_QUAD, emit_imm(0), emit_reg(REG_DX, REG_QUAD));
+      emit_inst1(ST_DIV, INST_QUAD, emit_reg(REG_CX, REG_QUAD));
       break;
     }
     default: assert(false);
   }
-  GEN_PUSH("rdx");
+  GEN_PUSH(REG_DX);
 }
 
 static void gen_add(Expr *expr) {
   switch (expr->type->ty_type) {
     case TY_INT:
     case TY_UINT: {
-      GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
-      printf("  addl %%ecx, %%eax\n");
-      GEN_PUSH("rax");
+      RegCode reg;
+      EmitOp *rhs = gen_operands(expr->lhs, expr->rhs, &reg);
+      emit_inst2(ST_ADD, INST_LONG, rhs, emit_reg(reg, REG_LONG));
+      GEN_PUSH(reg);
       break;
     }
     case TY_LONG:
     case TY_ULONG: {
-      GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
-      printf("  addq %%rcx, %%rax\n");
-      GEN_PUSH("rax");
+      RegCode reg;
+      EmitOp *rhs = gen_operands(expr->lhs, expr->rhs, &reg);
+      emit_inst2(ST_ADD, INST_QUAD, rhs, emit_reg(reg, REG_QUAD));
+      GEN_PUSH(reg);
       break;
     }
     case TY_POINTER: {
       int size = expr->lhs->type->pointer_to->size;
+      if (expr->rhs->nd_type == ND_INTEGER && check_imm32(expr->rhs->int_value * size)) {
+        if (expr->rhs->int_value == 0) {
+          gen_expr(expr->lhs);
+          break;
+        }
+        RegCode reg = gen_operand(expr->lhs, REG_AX);
+        emit_inst2(ST_ADD, INST_QUAD, emit_imm(expr->rhs->int_value * size), emit_reg(reg, REG_QUAD));
+        GEN_PUSH(reg);
+        break;
+      }
+      if (size == 1 || size == 2 || size == 4 || size == 8) {
+        // the index is scaled by the addressing mode.
+        // the address is computed to %rax, which is not used in the address,
+        // so that the peephole optimizer can fold it into the memory operand
+        // of the following load.
+        gen_expr(expr->lhs);
+        gen_expr(expr->rhs);
+        RegCode index = gen_pop_reg(REG_CX);
+        RegCode base = gen_pop_reg(REG_DX);
+        emit_inst2(ST_LEA, INST_QUAD, emit_mem_sib(base, index, log2_exact(size), 0), emit_reg(REG_AX, REG_QUAD));
+        GEN_PUSH(REG_AX);
+        break;
+      }
       gen_expr(expr->lhs);
-      GEN_OP(expr->rhs, "rax");
-      printf("  movq $%d, %%rcx\n", size);
-      printf("  mulq %%rcx\n");
-      GEN_POP("rcx");
-      printf("  addq %%rax, %%rcx\n");
-      GEN_PUSH("rcx");
+      RegCode index = gen_operand(expr->rhs, REG_AX);
+      gen_mul_imm(index, size, REG_QUAD);
+      RegCode reg = gen_pop_reg(REG_CX);
+      emit_inst2(ST_ADD, INST_QUAD, emit_reg(index, REG_QUAD), emit_reg(reg, REG_QUAD));
+      GEN_PUSH(reg);
       break;
     }
     default: assert(false);
@@ -609,293 +1320,399 @@ static void gen_sub(Expr *expr) {
   switch (expr->type->ty_type) {
     case TY_INT:
     case TY_UINT: {
-      GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
-      printf("  subl %%ecx, %%eax\n");
-      GEN_PUSH("rax");
+      RegCode reg;
+      EmitOp *rhs = gen_operands(expr->lhs, expr->rhs, &reg);
+      emit_inst2(ST_SUB, INST_LONG, rhs, emit_reg(reg, REG_LONG));
+      GEN_PUSH(reg);
       break;
     }
     case TY_LONG:
     case TY_ULONG: {
-      GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
-      printf("  subq %%rcx, %%rax\n");
-      GEN_PUSH("rax");
+      RegCode reg;
+      EmitOp *rhs = gen_operands(expr->lhs, expr->rhs, &reg);
+      emit_inst2(ST_SUB, INST_QUAD, rhs, emit_reg(reg, REG_QUAD));
+      GEN_PUSH(reg);
       break;
     }
     case TY_POINTER: {
       int size = expr->lhs->type->pointer_to->size;
+      if (expr->rhs->nd_type == ND_INTEGER && check_imm32(expr->rhs->int_value * size)) {
+        if (expr->rhs->int_value == 0) {
+          gen_expr(expr->lhs);
+          break;
+        }
+        RegCode reg = gen_operand(expr->lhs, REG_AX);
+        emit_inst2(ST_SUB, INST_QUAD, emit_imm(expr->rhs->int_value * size), emit_reg(reg, REG_QUAD));
+        GEN_PUSH(reg);
+        break;
+      }
       gen_expr(expr->lhs);
-      GEN_OP(expr->rhs, "rax");
-      printf("  movq $%d, %%rcx\n", size);
-      printf("  mulq %%rcx\n");
-      GEN_POP("rcx");
-      printf("  subq %%rax, %%rcx\n");
-      GEN_PUSH("rcx");
+      RegCode index = gen_operand(expr->rhs, REG_AX);
+      gen_mul_imm(index, size, REG_QUAD);
+      RegCode reg = gen_pop_reg(REG_CX);
+      emit_inst2(ST_SUB, INST_QUAD, emit_reg(index, REG_QUAD), emit_reg(reg, REG_QUAD));
+      GEN_PUSH(reg);
       break;
     }
     default: assert(false);
   }
 }
 
-static void gen_lshift(Expr *expr) {
-  GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
-  switch (expr->type->ty_type) {
-    case TY_INT:
-    case TY_UINT: {
-      printf("  sall %%cl, %%eax\n");
-      break;
-    }
-    case TY_LONG:
-    case TY_ULONG: {
-      printf("  salq %%cl, %%rax\n");
-      break;
-    }
-    default: assert(false);
+static void gen_shift(Expr *expr, StmtType type) {
+  RegSize size = expr->type->size == 8 ? REG_QUAD : REG_LONG;
+  InstSuffix suffix = size == REG_QUAD ? INST_QUAD : INST_LONG;
+  RegCode reg;
+  if (expr->rhs->nd_type == ND_INTEGER && expr->rhs->int_value < expr->type->size * 8) {
+    reg = gen_operand(expr->lhs, REG_AX);
+    emit_inst2(type, suffix, emit_imm(expr->rhs->int_value), emit_reg(reg, size));
+  } else {
+    // the shift count is given in %cl.
+    gen_expr(expr->lhs);
+    GEN_OP(expr->rhs, REG_CX);
+    reg = gen_pop_reg(REG_AX);
+    emit_inst2(type, suffix, emit_reg(REG_CX, REG_BYTE), emit_reg(reg, size));
   }
-  GEN_PUSH("rax");
+  GEN_PUSH(reg);
+}
+
+static void gen_lshift(Expr *expr) {
+  gen_shift(expr, ST_SAL);
 }
 
+// the right shift of an unsigned value is a logical shift.
 static void gen_rshift(Expr *expr) {
-  GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
-  switch (expr->type->ty_type) {
-    case TY_INT:
-    case TY_UINT: {
-      printf("  sarl %%cl, %%eax\n");
-      break;
-    }
-    case TY_LONG:
-    case TY_ULONG: {
-      printf("  sarq %%cl, %%rax\n");
-      break;
-    }
-    default: assert(false);
-  }
-  GEN_PUSH("rax");
+  TypeType ty_type = expr->type->ty_type;
+  gen_shift(expr, ty_type == TY_UINT || ty_type == TY_ULONG ? ST_SHR : ST_SAR);
 }
 
 static void gen_lt(Expr *expr) {
-  GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
+  RegCode reg;
+  EmitOp *rhs = gen_operands(expr->lhs, expr->rhs, &reg);
   switch (expr->lhs->type->ty_type) {
     case TY_INT: {
-      printf("  cmpl %%ecx, %%eax\n");
-      printf("  setl %%al\n");
+      emit_inst2(ST_CMP, INST_LONG, rhs, emit_reg(reg, REG_LONG));
+      emit_inst1(ST_SETL, NO_SUFFIX, emit_reg(reg, REG_BYTE));
       break;
     }
     case TY_UINT: {
-      printf("  cmpl %%ecx, %%eax\n");
-      printf("  setb %%al\n");
+      emit_inst2(ST_CMP, INST_LONG, rhs, emit_reg(reg, REG_LONG));
+      emit_inst1(ST_SETB, NO_SUFFIX, emit_reg(reg, REG_BYTE));
       break;
     }
     case TY_LONG: {
-      printf("  cmpq %%rcx, %%rax\n");
-      printf("  setl %%al\n");
+      emit_inst2(ST_CMP, INST_QUAD, rhs, emit_reg(reg, REG_QUAD));
+      emit_inst1(ST_SETL, NO_SUFFIX, emit_reg(reg, REG_BYTE));
       break;
     }
     case TY_ULONG:
     case TY_POINTER: {
-      printf("  cmpq %%rcx, %%rax\n");
-      printf("  setb %%al\n");
+      emit_inst2(ST_CMP, INST_QUAD, rhs, emit_reg(reg, REG_QUAD));
+      emit_inst1(ST_SETB, NO_SUFFIX, emit_reg(reg, REG_BYTE));
       break;
     }
     default: assert(false);
   }
-  printf("  movzbl %%al, %%eax\n");
-  GEN_PUSH("rax");
+  emit_inst2(ST_MOVZB, INST_LONG, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_LONG));
+  GEN_PUSH(reg);
 }
 
 static void gen_lte(Expr *expr) {
-  GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
+  RegCode reg;
+  EmitOp *rhs = gen_operands(expr->lhs, expr->rhs, &reg);
   switch (expr->lhs->type->ty_type) {
     case TY_INT: {
-      printf("  cmpl %%ecx, %%eax\n");
-      printf("  setle %%al\n");
+      emit_inst2(ST_CMP, INST_LONG, rhs, emit_reg(reg, REG_LONG));
+      emit_inst1(ST_SETLE, NO_SUFFIX, emit_reg(reg, REG_BYTE));
       break;
     }
     case TY_UINT: {
-      printf("  cmpl %%ecx, %%eax\n");
-      printf("  setbe %%al\n");
+      emit_inst2(ST_CMP, INST_LONG, rhs, emit_reg(reg, REG_LONG));
+      emit_inst1(ST_SETBE, NO_SUFFIX, emit_reg(reg, REG_BYTE));
       break;
     }
     case TY_LONG: {
-      printf("  cmpq %%rcx, %%rax\n");
-      printf("  setle %%al\n");
+      emit_inst2(ST_CMP, INST_QUAD, rhs, emit_reg(reg, REG_QUAD));
+      emit_inst1(ST_SETLE, NO_SUFFIX, emit_reg(reg, REG_BYTE));
       break;
     }
     case TY_ULONG:
     case TY_POINTER: {
-      printf("  cmpq %%rcx, %%rax\n");
-      printf("  setbe %%al\n");
+      emit_inst2(ST_CMP, INST_QUAD, rhs, emit_reg(reg, REG_QUAD));
+      emit_inst1(ST_SETBE, NO_SUFFIX, emit_reg(reg, REG_BYTE));
       break;
     }
     default: assert(false);
   }
-  printf("  movzbl %%al, %%eax\n");
-  GEN_PUSH("rax");
+  emit_inst2(ST_MOVZB, INST_LONG, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_LONG));
+  GEN_PUSH(reg);
 }
 
 static void gen_eq(Expr *expr) {
-  GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
+  RegCode reg;
+  EmitOp *rhs = gen_operands(expr->lhs, expr->rhs, &reg);
   switch (expr->lhs->type->ty_type) {
     case TY_INT:
     case TY_UINT: {
-      printf("  cmpl %%ecx, %%eax\n");
+      emit_inst2(ST_CMP, INST_LONG, rhs, emit_reg(reg, REG_LONG));
       break;
     }
     case TY_LONG:
     case TY_ULONG:
     case TY_POINTER: {
-      printf("  cmpq %%rcx, %%rax\n");
+      emit_inst2(ST_CMP, INST_QUAD, rhs, emit_reg(reg, REG_QUAD));
       break;
     }
     default: assert(false);
   }
-  printf("  sete %%al\n");
-  printf("  movzbl %%al, %%eax\n");
-  GEN_PUSH("rax");
+  emit_inst1(ST_SETE, NO_SUFFIX, emit_reg(reg, REG_BYTE));
+  emit_inst2(ST_MOVZB, INST_LONG, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_LONG));
+  GEN_PUSH(reg);
 }
 
 static void gen_neq(Expr *expr) {
-  GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
+  RegCode reg;
+  EmitOp *rhs = gen_operands(expr->lhs, expr->rhs, &reg);
   switch (expr->lhs->type->ty_type) {
     case TY_INT:
     case TY_UINT: {
-      printf("  cmpl %%ecx, %%eax\n");
+      emit_inst2(ST_CMP, INST_LONG, rhs, emit_reg(reg, REG_LONG));
       break;
     }
     case TY_LONG:
     case TY_ULONG:
     case TY_POINTER: {
-      printf("  cmpq %%rcx, %%rax\n");
+      emit_inst2(ST_CMP, INST_QUAD, rhs, emit_reg(reg, REG_QUAD));
       break;
     }
     default: assert(false);
   }
-  printf("  setne %%al\n");
-  printf("  movzbl %%al, %%eax\n");
-  GEN_PUSH("rax");
+  emit_inst1(ST_SETNE, NO_SUFFIX, emit_reg(reg, REG_BYTE));
+  emit_inst2(ST_MOVZB, INST_LONG, emit_reg(reg, REG_BYTE), emit_reg(reg, REG_LONG));
+  GEN_PUSH(reg);
 }
 
 static void gen_and(Expr *expr) {
-  GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
+  RegCode reg;
+  EmitOp *rhs = gen_operands(expr->lhs, expr->rhs, &reg);
   switch (expr->type->ty_type) {
     case TY_INT:
     case TY_UINT: {
-      printf("  andl %%ecx, %%eax\n");
+      emit_inst2(ST_AND, INST_LONG, rhs, emit_reg(reg, REG_LONG));
       break;
     }
     case TY_LONG:
     case TY_ULONG: {
-      printf("  andq %%rcx, %%rax\n");
+      emit_inst2(ST_AND, INST_QUAD, rhs, emit_reg(reg, REG_QUAD));
       break;
     }
     default: assert(false);
   }
-  GEN_PUSH("rax");
+  GEN_PUSH(reg);
 }
 
 static void gen_xor(Expr *expr) {
-  GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
+  RegCode reg;
+  EmitOp *rhs = gen_operands(expr->lhs, expr->rhs, &reg);
   switch (expr->type->ty_type) {
     case TY_INT:
     case TY_UINT: {
-      printf("  xorl %%ecx, %%eax\n");
+      emit_inst2(ST_XOR, INST_LONG, rhs, emit_reg(reg, REG_LONG));
       break;
     }
     case TY_LONG:
     case TY_ULONG: {
-      printf("  xorq %%rcx, %%rax\n");
+      emit_inst2(ST_XOR, INST_QUAD, rhs, emit_reg(reg, REG_QUAD));
       break;
     }
     default: assert(false);
   }
-  GEN_PUSH("rax");
+  GEN_PUSH(reg);
 }
 
 static void gen_or(Expr *expr) {
-  GEN_OP2(expr->lhs, expr->rhs, "rax", "rcx");
+  RegCode reg;
+  EmitOp *rhs = gen_operands(expr->lhs, expr->rhs, &reg);
   switch (expr->type->ty_type) {
     case TY_INT:
     case TY_UINT: {
-      printf("  orl %%ecx, %%eax\n");
+      emit_inst2(ST_OR, INST_LONG, rhs, emit_reg(reg, REG_LONG));
       break;
     }
     case TY_LONG:
     case TY_ULONG: {
-      printf("  orq %%rcx, %%rax\n");
+      emit_inst2(ST_OR, INST_QUAD, rhs, emit_reg(reg, REG_QUAD));
       break;
     }
     default: assert(false);
   }
-  GEN_PUSH("rax");
+  GEN_PUSH(reg);
+}
+
+// conditional branch
+// The conditions of the control statements and the logical operators are
+// compiled into the jumps on the flags, instead of materializing 0 or 1
+// and comparing it with 0.
+// The value stack is not changed by the branch, so that it is in the same
+// state on every path.
+
+// compare the operands, and returns the jump taken when the relation holds.
+static StmtType gen_compare(Expr *expr) {
+  RegCode reg;
+  EmitOp *rhs = gen_operands(expr->lhs, expr->rhs, &reg);
+  if (expr->lhs->type->size == 8) {
+    emit_inst2(ST_CMP, INST_QUAD, rhs, emit_reg(reg, REG_QUAD));
+  } else {
+    emit_inst2(ST_CMP, INST_LONG, rhs, emit_reg(reg, REG_LONG));
+  }
+
+  TypeType ty_type = expr->lhs->type->ty_type;
+  bool sign = ty_type == TY_INT || ty_type == TY_LONG;
+  switch (expr->nd_type) {
+    case ND_LT: return sign ? ST_JL : ST_JB;
+    case ND_LTE: return sign ? ST_JLE : ST_JBE;
+    case ND_EQ: return ST_JE;
+    case ND_NEQ: return ST_JNE;
+    default: assert(false);
+  }
+}
+
+// jump to the label if the truth value of the condition is equal to truth.
+static void gen_cond_jump(Expr *cond, bool truth, int label) {
+  switch (cond->nd_type) {
+    case ND_LT:
+    case ND_LTE:
+    case ND_EQ:
+    case ND_NEQ: {
+      StmtType jump = gen_compare(cond);
+      GEN_JUMP(truth ? jump : emit_negate_jcc(jump), label);
+      break;
+    }
+    case ND_LNOT: {
+      gen_cond_jump(cond->expr, !truth, label);
+      break;
+    }
+    case ND_LAND:
+    case ND_LOR: {
+      // && jumps when either operand is false, and || jumps when either
+      // operand is true. otherwise the right operand is skipped when
+      // the left operand decides the result.
+      bool shortcut = cond->nd_type == ND_LOR;
+      if (truth == shortcut) {
+        gen_cond_jump(cond->lhs, truth, label);
+        gen_cond_jump(cond->rhs, truth, label);
+      } else {
+        int label_skip = label_no++;
+        gen_cond_jump(cond->lhs, !truth, label_skip);
+        gen_cond_jump(cond->rhs, truth, label);
+        GEN_LABEL(label_skip);
+      }
+      break;
+    }
+    case ND_INTEGER: {
+      if ((cond->int_value != 0) == truth) {
+        GEN_JUMP(ST_JMP, label);
+      }
+      break;
+    }
+    default: {
+      RegCode reg = gen_operand(cond, REG_AX);
+      emit_inst2(ST_TEST, INST_QUAD, emit_reg(reg, REG_QUAD), emit_reg(reg, REG_QUAD));
+      GEN_JUMP(truth ? ST_JNE : ST_JE, label);
+      break;
+    }
+  }
 }
 
 static void gen_land(Expr *expr) {
+  // the slots in the pool are spilled before branching,
+  // so that the value stack is in the same state on every path.
+  gen_spill_all();
+
   int label_false = label_no++;
   int label_end = label_no++;
 
-  GEN_OP(expr->lhs, "rax");
-  printf("  cmpq $0, %%rax\n");
-  GEN_JUMP("je", label_false);
+  gen_cond_jump(expr, false, label_false);
 
-  GEN_OP(expr->rhs, "rax");
-  printf("  cmpq $0, %%rax\n");
-  GEN_JUMP("je", label_false);
-
-  printf("  movl $1, %%eax\n");
-  GEN_JUMP("jmp", label_end);
+  emit_inst2(ST_MOV, INST_LONG, emit_imm(1), emit_reg(REG_AX, REG_LONG));
+  GEN_JUMP(ST_JMP, label_end);
 
   GEN_LABEL(label_false);
-  printf("  movl $0, %%eax\n");
+  emit_inst2(ST_MOV, INST_LONG, emit_imm(0), emit_reg(REG_AX, REG_LONG));
 
   GEN_LABEL(label_end);
-  GEN_PUSH("rax");
+  GEN_PUSH(REG_AX);
 }
 
 static void gen_lor(Expr *expr) {
+  gen_spill_all();
+
   int label_true = label_no++;
   int label_end = label_no++;
 
-  GEN_OP(expr->lhs, "rax");
-  printf("  cmpq $0, %%rax\n");
-  GEN_JUMP("jne", label_true);
+  gen_cond_jump(expr, true, label_true);
 
-  GEN_OP(expr->rhs, "rax");
-  printf("  cmpq $0, %%rax\n");
-  GEN_JUMP("jne", label_true);
-
-  printf("  movl $0, %%eax\n");
-  GEN_JUMP("jmp", label_end);
+  emit_inst2(ST_MOV, INST_LONG, emit_imm(0), emit_reg(REG_AX, REG_LONG));
+  GEN_JUMP(ST_JMP, label_end);
 
   GEN_LABEL(label_true);
-  printf("  movl $1, %%eax\n");
+  emit_inst2(ST_MOV, INST_LONG, emit_imm(1), emit_reg(REG_AX, REG_LONG));
 
   GEN_LABEL(label_end);
-  GEN_PUSH("rax");
+  GEN_PUSH(REG_AX);
 }
 
 static void gen_condition(Expr *expr) {
+  gen_spill_all();
+
   int label_false = label_no++;
   int label_end = label_no++;
 
-  GEN_OP(expr->cond, "rax");
-  printf("  cmpq $0, %%rax\n");
-  GEN_JUMP("je", label_false);
+  gen_cond_jump(expr->cond, false, label_false);
 
-  GEN_OP(expr->lhs, "rax");
-  GEN_JUMP("jmp", label_end);
+  GEN_OP(expr->lhs, REG_AX);
+  GEN_JUMP(ST_JMP, label_end);
 
   GEN_LABEL(label_false);
-  GEN_OP(expr->rhs, "rax");
+  GEN_OP(expr->rhs, REG_AX);
 
   GEN_LABEL(label_end);
-  GEN_PUSH("rax");
+  GEN_PUSH(REG_AX);
+}
+
+// the local variable is never read, so that it is not stored.
+static bool check_dead(Symbol *symbol) {
+  if (!dce_enabled || symbol->link != LN_NONE || symbol->escape || symbol->uses != symbol->stores) return false;
+  TypeType ty_type = symbol->type->ty_type;
+  return (TY_BOOL <= ty_type && ty_type <= TY_ULONG) || ty_type == TY_POINTER;
 }
 
 static void gen_assign(Expr *expr) {
+  if (expr->type->ty_type == TY_STRUCT) {
+    gen_lvalue(expr->lhs);
+    gen_expr(expr->rhs);
+    gen_copy_struct(expr->type->size);
+    return;
+  }
+
+  if (expr->lhs->nd_type == ND_IDENTIFIER && check_dead(expr->lhs->symbol)) {
+    gen_expr(expr->rhs);
+    return;
+  }
+
+  if (expr->lhs->nd_type == ND_IDENTIFIER && expr->lhs->symbol->promoted) {
+    // the value is pushed from the variable, since a temporary in the pool
+    // is read only once.
+    RegCode value = gen_operand(expr->rhs, REG_AX);
+    gen_store_by_reg(value, expr->lhs->symbol->reg, expr->lhs->type);
+    GEN_PUSH(expr->lhs->symbol->reg);
+    return;
+  }
+
   gen_lvalue(expr->lhs);
-  GEN_OP(expr->rhs, "rax");
-  GEN_POP("rcx");
-  gen_store_by_addr(REG_AX, REG_CX, expr->lhs->type);
-  GEN_PUSH("rax");
+  RegCode value = gen_operand(expr->rhs, REG_AX);
+  RegCode addr = gen_pop_reg(REG_CX);
+  gen_store_by_addr(value, addr, expr->lhs->type);
+  GEN_PUSH(value);
 }
 
 static void gen_comma(Expr *expr) {
@@ -908,6 +1725,9 @@ static void gen_expr(Expr *expr) {
     case ND_VA_START: gen_va_start(expr); break;
     case ND_VA_ARG: gen_va_arg(expr); break;
     case ND_VA_END: gen_va_end(expr); break;
+    case ND_MEMCPY: gen_memcpy(expr); break;
+    case ND_MEMSET: gen_memset(expr); break;
+    case ND_STRCMP: gen_strcmp(expr); break;
     case ND_IDENTIFIER: gen_identifier(expr); break;
     case ND_INTEGER: gen_integer(expr); break;
     case ND_STRING: gen_string(expr); break;
@@ -942,16 +1762,39 @@ static void gen_expr(Expr *expr) {
   }
 }
 
-static void gen_init_local(Initializer *init, int offset) {
+// the initializer list gives all elements of the array.
+static bool check_init_complete(Initializer *init) {
+  if (!init->list) return true;
+  if (init->list->length * init->type->array_of->size != init->type->size) return false;
+  for (int i = 0; i < init->list->length; i++) {
+    if (!check_init_complete(init->list->buffer[i])) return false;
+  }
+  return true;
+}
+
+// the initializer is zero, which is already stored by the zero-filling.
+static bool check_init_zero(Initializer *init) {
+  Expr *expr = init->expr->nd_type == ND_CAST ? init->expr->expr : init->expr;
+  return expr->nd_type == ND_INTEGER && expr->int_value == 0;
+}
+
+// the zero elements are skipped if the object is zero-filled.
+static void gen_init_local(Initializer *init, int offset, bool zeroed) {
   if (init->list) {
     int size = init->type->array_of->size;
     for (int i = 0; i < init->list->length; i++) {
       Initializer *item = init->list->buffer[i];
-      gen_init_local(item, offset + size * i);
-    }
-  } else if (init->expr) {
-    GEN_OP(init->expr, "rax");
-    gen_store_by_offset(REG_AX, offset, init->expr->type);
+      gen_init_local(item, offset + size * i, zeroed);
+    }
+  } else if (init->expr && init->expr->type->ty_type == TY_STRUCT) {
+    emit_inst2(ST_LEA, INST_QUAD, gen_frame(offset), emit_reg(REG_AX, REG_QUAD));
+    GEN_PUSH(REG_AX);
+    gen_expr(init->expr);
+    gen_copy_struct(init->type->size);
+    GEN_POP_DISCARD();
+  } else if (init->expr && !(zeroed && check_init_zero(init))) {
+    RegCode value = gen_operand(init->expr, REG_AX);
+    gen_store_by_offset(value, offset, init->expr->type);
   }
 }
 
@@ -959,8 +1802,20 @@ static void gen_decl_local(Decl *decl) {
   for (int i = 0; i < decl->symbols->length; i++) {
     Symbol *symbol = decl->symbols->buffer[i];
     if (!symbol->definition) continue;
-    if (symbol->init) {
-      gen_init_local(symbol->init, -symbol->offset);
+    if (symbol->init && check_dead(symbol)) {
+      GEN_EVAL(symbol->init->expr);
+    } else if (symbol->init && symbol->promoted) {
+      RegCode value = gen_operand(symbol->init->expr, REG_AX);
+      gen_store_by_reg(value, symbol->reg, symbol->type);
+    } else if (symbol->init) {
+      // the elements which are missing in the initializer list are
+      // zero-filled at once before the elements are stored.
+      bool zeroed = !check_init_complete(symbol->init);
+      if (zeroed) {
+        gen_spill_all();
+        gen_zero(REG_BP, -symbol->offset, (symbol->type->size + 7) / 8 * 8);
+      }
+      gen_init_local(symbol->init, -symbol->offset, zeroed);
     }
   }
 }
@@ -984,9 +1839,33 @@ static void gen_default(Stmt *stmt) {
   gen_stmt(stmt->default_stmt);
 }
 
+// the statement has a label, which may be reached by a jump.
+static bool check_label(Stmt *stmt) {
+  if (!stmt) return false;
+  switch (stmt->nd_type) {
+    case ND_LABEL:
+    case ND_CASE:
+    case ND_DEFAULT: return true;
+    case ND_COMP: {
+      for (int i = 0; i < stmt->block_items->length; i++) {
+        Node *item = stmt->block_items->buffer[i];
+        if (item->nd_type != ND_DECL && check_label((Stmt *) item)) return true;
+      }
+      return false;
+    }
+    case ND_IF: return check_label(stmt->then_body) || check_label(stmt->else_body);
+    case ND_SWITCH: return check_label(stmt->switch_body);
+    case ND_WHILE: return check_label(stmt->while_body);
+    case ND_DO: return check_label(stmt->do_body);
+    case ND_FOR: return check_label(stmt->for_body);
+    default: return false;
+  }
+}
+
 static void gen_comp_stmt(Stmt *stmt) {
   for (int i = 0; i < stmt->block_items->length; i++) {
     Node *item = stmt->block_items->buffer[i];
+    if (!reachable && (item->nd_type == ND_DECL || !check_label((Stmt *) item))) continue;
     if (item->nd_type == ND_DECL) {
       gen_decl_local((Decl *) item);
     } else {
@@ -999,18 +1878,22 @@ static void gen_expr_stmt(Stmt *stmt) {
   if (stmt->expr) {
     GEN_EVAL(stmt->expr);
   }
+
+  // the call to a noreturn function does not return.
+  Expr *expr = stmt->expr;
+  if (dce_enabled && expr && expr->nd_type == ND_CALL && expr->expr->symbol && expr->expr->symbol->no_return) {
+    reachable = false;
+  }
 }
 
 static void gen_if(Stmt *stmt) {
   int label_else = label_no++;
   int label_end = label_no++;
 
-  GEN_OP(stmt->if_cond, "rax");
-  printf("  cmpq $0, %%rax\n");
-  GEN_JUMP("je", label_else);
+  gen_cond_jump(stmt->if_cond, false, label_else);
 
   gen_stmt(stmt->then_body);
-  GEN_JUMP("jmp", label_end);
+  GEN_JUMP(ST_JMP, label_end);
 
   GEN_LABEL(label_else);
 
@@ -1021,21 +1904,204 @@ static void gen_if(Stmt *stmt) {
   GEN_LABEL(label_end);
 }
 
+// switch statement
+// The case values are sorted, and the runs of dense values are clustered.
+// A cluster is dispatched through a jump table in .rodata,
+// and the clusters are searched by a balanced tree of comparisons.
+
+#define TABLE_MIN_CASES 4 // the minimum number of cases of a jump table
+#define TABLE_DENSITY 3   // the maximum number of entries per case
+
+typedef struct {
+  int label;
+  Vector *targets; // Vector<int>, the label of each entry
+} JumpTable;
+
+static Vector *jump_tables; // Vector<JumpTable*>, written after the function
+
+// the state of the switch statement being dispatched
+static Vector *switch_cases;    // Vector<Stmt*>, sorted by the value
+static Vector *switch_clusters; // Vector<int>, the first case of each cluster
+static bool switch_sign;
+static RegSize switch_size;
+static int switch_default;
+
+// the case value converted to the type of the condition.
+// the sign bit is flipped for a signed condition,
+// so that the values are ordered as unsigned integers.
+static unsigned long long switch_key(Stmt *case_stmt) {
+  unsigned long long value = case_stmt->case_const->int_value;
+  if (switch_size == REG_LONG) {
+    value = switch_sign ? (long) (int) value : value & 0xffffffff;
+  }
+  return switch_sign ? value ^ (1ULL << 63) : value;
+}
+
+static unsigned long long switch_value(unsigned long long key) {
+  unsigned long long value = switch_sign ? key ^ (1ULL << 63) : key;
+  return switch_size == REG_LONG ? value & 0xffffffff : value;
+}
+
+static int switch_cluster_begin(int cluster) {
+  return (int) (intptr_t) switch_clusters->buffer[cluster];
+}
+
+static int switch_cluster_end(int cluster) {
+  if (cluster + 1 < switch_clusters->length) {
+    return switch_cluster_begin(cluster + 1);
+  }
+  return switch_cases->length;
+}
+
+static void gen_switch_sort(void) {
+  for (int i = 1; i < switch_cases->length; i++) {
+    Stmt *case_stmt = switch_cases->buffer[i];
+    unsigned long long key = switch_key(case_stmt);
+    int j = i;
+    while (j > 0 && switch_key(switch_cases->buffer[j - 1]) > key) {
+      switch_cases->buffer[j] = switch_cases->buffer[j - 1];
+      j--;
+    }
+    switch_cases->buffer[j] = case_stmt;
+  }
+}
+
+// the longest dense run from each case is taken greedily.
+static void gen_switch_cluster(void) {
+  switch_clusters = vector_new();
+  int n = switch_cases->length;
+  int i = 0;
+  while (i < n) {
+    vector_push(switch_clusters, (void *) (intptr_t) i);
+    unsigned long long low = switch_key(switch_cases->buffer[i]);
+    int next = i + 1;
+    for (int j = n - 1; j >= i + TABLE_MIN_CASES - 1; j--) {
+      unsigned long long range = switch_key(switch_cases->buffer[j]) - low;
+      if (range < (unsigned long long) (j - i + 1) * TABLE_DENSITY) {
+        next = j + 1;
+        break;
+      }
+    }
+    i = next;
+  }
+}
+
+// cmp $value, %rax
+static void gen_switch_cmp(unsigned long long key) {
+  unsigned long long value = switch_value(key);
+  if (switch_size == REG_QUAD && !check_imm32(value)) {
+    emit_inst2(ST_MOV, INST_QUAD, emit_imm(value), emit_reg(REG_CX, REG_QUAD));
+    emit_inst2(ST_CMP, INST_QUAD, emit_reg(REG_CX, REG_QUAD), emit_reg(REG_AX, REG_QUAD));
+  } else {
+    InstSuffix suffix = switch_size == REG_QUAD ? INST_QUAD : INST_LONG;
+    emit_inst2(ST_CMP, suffix, emit_imm(value), emit_reg(REG_AX, switch_size));
+  }
+}
+
+// the value minus the lowest one is the index of the table,
+// and the values out of the table are excluded by one unsigned comparison.
+static void gen_switch_table(int begin, int end) {
+  InstSuffix suffix = switch_size == REG_QUAD ? INST_QUAD : INST_LONG;
+  unsigned long long low = switch_key(switch_cases->buffer[begin]);
+  unsigned long long high = switch_key(switch_cases->buffer[end - 1]);
+  unsigned long long value = switch_value(low);
+
+  emit_inst2(ST_MOV, suffix, emit_reg(REG_AX, switch_size), emit_reg(REG_CX, switch_size));
+  if (value != 0 && (switch_size == REG_LONG || check_imm32(value))) {
+    emit_inst2(ST_SUB, suffix, emit_imm(value), emit_reg(REG_CX, switch_size));
+  } else if (value != 0) {
+    emit_inst2(ST_MOV, INST_QUAD, emit_imm(value), emit_reg(REG_DX, REG_QUAD));
+    emit_inst2(ST_SUB, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_reg(REG_CX, REG_QUAD));
+  }
+  emit_inst2(ST_CMP, suffix, emit_imm(high - low), emit_reg(REG_CX, switch_size));
+  GEN_JUMP(ST_JA, switch_default);
+
+  JumpTable *table = arena_alloc(ARENA_GEN, sizeof(JumpTable));
+  table->label = label_no++;
+  table->targets = vector_new();
+  int i = begin;
+  // iterate over the offsets, since the key would wrap around after the
+  // maximum value of the type.
+  for (unsigned long long offset = 0; offset <= high - low; offset++) {
+    unsigned long long key = low + offset;
+    Stmt *case_stmt = switch_cases->buffer[i];
+    if (switch_key(case_stmt) == key) {
+      vector_push(table->targets, (void *) (intptr_t) case_stmt->label_no);
+      while (i < end && switch_key(switch_cases->buffer[i]) == key) i++;
+    } else {
+      vector_push(table->targets, (void *) (intptr_t) switch_default);
+    }
+  }
+  vector_push(jump_tables, table);
+
+  emit_inst2(ST_LEA, INST_QUAD, emit_rip_local(table->label), emit_reg(REG_DX, REG_QUAD));
+  emit_inst1(ST_JMP, NO_SUFFIX, emit_mem_sib(REG_DX, REG_CX, SCALE8, 0));
+}
+
+// dispatch the clusters [lo, hi).
+static void gen_switch_tree(int lo, int hi) {
+  if (hi - lo == 1 && switch_cluster_end(lo) - switch_cluster_begin(lo) > 1) {
+    gen_switch_table(switch_cluster_begin(lo), switch_cluster_end(lo));
+    return;
+  }
+
+  // a few single cases are compared one by one.
+  if (hi - lo <= 3 && switch_cluster_end(hi - 1) - switch_cluster_begin(lo) == hi - lo) {
+    for (int i = switch_cluster_begin(lo); i < switch_cluster_end(hi - 1); i++) {
+      Stmt *case_stmt = switch_cases->buffer[i];
+      gen_switch_cmp(switch_key(case_stmt));
+      GEN_JUMP(ST_JE, case_stmt->label_no);
+    }
+    GEN_JUMP(ST_JMP, switch_default);
+    return;
+  }
+
+  int mid = (lo + hi) / 2;
+  int label = label_no++;
+  gen_switch_cmp(switch_key(switch_cases->buffer[switch_cluster_begin(mid)]));
+  GEN_JUMP(switch_sign ? ST_JGE : ST_JAE, label);
+  gen_switch_tree(lo, mid);
+  GEN_LABEL(label);
+  gen_switch_tree(mid, hi);
+}
+
+// dispatch the value in %rax to the labels of the cases.
+static void gen_switch_dispatch(Vector *cases, bool sign, RegSize size, int label_default) {
+  switch_sign = sign;
+  switch_size = size;
+  switch_default = label_default;
+  switch_cases = vector_new();
+  vector_merge(switch_cases, cases);
+  gen_switch_sort();
+  gen_switch_cluster();
+
+  if (switch_cases->length > 0) {
+    gen_switch_tree(0, switch_clusters->length);
+  } else {
+    GEN_JUMP(ST_JMP, switch_default);
+  }
+}
+
 static void gen_switch(Stmt *stmt) {
   stmt->label_break = label_no++;
 
-  GEN_OP(stmt->switch_cond, "rax");
+  int label_default = stmt->label_break;
+  Vector *cases = vector_new();
   for (int i = 0; i < stmt->switch_cases->length; i++) {
     Stmt *case_stmt = stmt->switch_cases->buffer[i];
     case_stmt->label_no = label_no++;
     if (case_stmt->nd_type == ND_CASE) {
-      printf("  cmpq $%llu, %%rax\n", case_stmt->case_const->int_value);
-      GEN_JUMP("je", case_stmt->label_no);
+      vector_push(cases, case_stmt);
     } else if (case_stmt->nd_type == ND_DEFAULT) {
-      GEN_JUMP("jmp", case_stmt->label_no);
+      label_default = case_stmt->label_no;
     }
   }
 
+  Type *type = stmt->switch_cond->type;
+  bool sign = type->ty_type == TY_INT || type->ty_type == TY_LONG;
+  GEN_OP(stmt->switch_cond, REG_AX);
+  gen_switch_dispatch(cases, sign, type->size == 8 ? REG_QUAD : REG_LONG, label_default);
+
   gen_stmt(stmt->switch_body);
 
   GEN_LABEL(stmt->label_break);
@@ -1047,13 +2113,11 @@ static void gen_while(Stmt *stmt) {
 
   GEN_LABEL(stmt->label_continue);
 
-  GEN_OP(stmt->while_cond, "rax");
-  printf("  cmpq $0, %%rax\n");
-  GEN_JUMP("je", stmt->label_break);
+  gen_cond_jump(stmt->while_cond, false, stmt->label_break);
 
   gen_stmt(stmt->while_body);
 
-  GEN_JUMP("jmp", stmt->label_continue);
+  GEN_JUMP(ST_JMP, stmt->label_continue);
 
   GEN_LABEL(stmt->label_break);
 }
@@ -1069,9 +2133,7 @@ static void gen_do(Stmt *stmt) {
 
   GEN_LABEL(stmt->label_continue);
 
-  GEN_OP(stmt->do_cond, "rax");
-  printf("  cmpq $0, %%rax\n");
-  GEN_JUMP("jne", label_begin);
+  gen_cond_jump(stmt->do_cond, true, label_begin);
 
   GEN_LABEL(stmt->label_break);
 }
@@ -1092,9 +2154,7 @@ static void gen_for(Stmt *stmt) {
   GEN_LABEL(label_begin);
 
   if (stmt->for_cond) {
-    GEN_OP(stmt->for_cond, "rax");
-    printf("  cmpq $0, %%rax\n");
-    GEN_JUMP("je", stmt->label_break);
+    gen_cond_jump(stmt->for_cond, false, stmt->label_break);
   }
 
   gen_stmt(stmt->for_body);
@@ -1104,28 +2164,28 @@ static void gen_for(Stmt *stmt) {
   if (stmt->for_after) {
     GEN_EVAL(stmt->for_after);
   }
-  GEN_JUMP("jmp", label_begin);
+  GEN_JUMP(ST_JMP, label_begin);
 
   GEN_LABEL(stmt->label_break);
 }
 
 static void gen_goto(Stmt *stmt) {
-  GEN_JUMP("jmp", stmt->goto_target->label_no);
+  GEN_JUMP(ST_JMP, stmt->goto_target->label_no);
 }
 
 static void gen_continue(Stmt *stmt) {
-  GEN_JUMP("jmp", stmt->continue_target->label_continue);
+  GEN_JUMP(ST_JMP, stmt->continue_target->label_continue);
 }
 
 static void gen_break(Stmt *stmt) {
-  GEN_JUMP("jmp", stmt->break_target->label_break);
+  GEN_JUMP(ST_JMP, stmt->break_target->label_break);
 }
 
 static void gen_return(Stmt *stmt) {
   if (stmt->ret_expr) {
-    GEN_OP(stmt->ret_expr, "rax");
+    GEN_OP(stmt->ret_expr, REG_AX);
   }
-  GEN_JUMP("jmp", stmt->ret_func->label_return);
+  GEN_JUMP(ST_JMP, stmt->ret_func->label_return);
 }
 
 static void gen_stmt(Stmt *stmt) {
@@ -1162,14 +2222,15 @@ static void gen_init_global(Initializer *init) {
     }
 
     if (padding > 0) {
-      printf("  .zero %d\n", padding);
+      emit_zero(padding);
     }
   } else if (init->expr) {
-    Expr *expr = init->expr->expr; // ignore casting
+    // ignore casting to pointer type
+    Expr *expr = init->expr->nd_type == ND_CAST ? init->expr->expr : init->expr;
     if (expr->nd_type == ND_INTEGER) {
-      printf("  .long %llu\n", expr->int_value);
+      emit_long(expr->int_value & 0xffffffff);
     } else if (expr->nd_type == ND_STRING) {
-      printf("  .quad .S%d\n", expr->string_label);
+      emit_quad_string(expr->string_label);
     }
   }
 }
@@ -1179,20 +2240,73 @@ static void gen_decl_global(Decl *decl) {
     Symbol *symbol = decl->symbols->buffer[i];
     if (!symbol->definition) continue;
 
-    printf("  .data\n");
+    emit_data();
     if (symbol->link == LN_EXTERNAL) {
-      printf("  .global %s\n", symbol->identifier);
+      emit_global(symbol->identifier);
     }
-    printf("%s:\n", symbol->identifier);
+    emit_symbol(symbol->identifier);
 
     if (symbol->init) {
       gen_init_global(symbol->init);
     } else {
-      printf("  .zero %d\n", symbol->type->size);
+      emit_zero(symbol->type->size);
+    }
+  }
+}
+
+// the jump tables of the function are written to .rodata.
+static void gen_jump_tables(void) {
+  if (jump_tables->length == 0) return;
+  emit_rodata();
+  for (int i = 0; i < jump_tables->length; i++) {
+    JumpTable *table = jump_tables->buffer[i];
+    emit_label(table->label);
+    for (int j = 0; j < table->targets->length; j++) {
+      emit_quad_label((int) (intptr_t) table->targets->buffer[j]);
     }
   }
 }
 
+static bool check_promotable(Symbol *symbol) {
+  if (symbol->escape || symbol->promoted || symbol->uses == symbol->stores) return false;
+  TypeType ty_type = symbol->type->ty_type;
+  return (TY_BOOL <= ty_type && ty_type <= TY_ULONG) || ty_type == TY_POINTER;
+}
+
+// the most frequently used variables are promoted.
+static void gen_promote(Func *func) {
+  promoted = 0;
+  if (!promote_enabled) return;
+
+  while (promoted < PROMOTE_SIZE) {
+    Symbol *best = NULL;
+    for (int i = 0; i < func->locals->length; i++) {
+      Symbol *symbol = func->locals->buffer[i];
+      if (check_promotable(symbol) && (!best || symbol->uses > best->uses)) {
+        best = symbol;
+      }
+    }
+    if (!best) break;
+
+    best->promoted = true;
+    best->reg = promote_reg[promoted++];
+  }
+}
+
+// the body is generated without output to see whether the stack is touched.
+// the labels are numbered again when the body is generated for real.
+static bool gen_check_leaf(Func *func) {
+  int label_begin = label_no;
+  frame_pushed = false;
+  reachable = true;
+  emit_set_discard(true);
+  gen_stmt(func->body);
+  emit_set_discard(false);
+  label_no = label_begin;
+  jump_tables = vector_new();
+  return !frame_pushed;
+}
+
 static void gen_func(Func *func) {
   Symbol *symbol = func->symbol;
   Type *type = symbol->type;
@@ -1206,6 +2320,13 @@ static void gen_func(Func *func) {
   }
   stack_depth = 8;
 
+  slots = vector_new();
+  spilled = 0;
+  jump_tables = vector_new();
+  for (int i = 0; i < POOL_SIZE; i++) {
+    pool_used[i] = false;
+  }
+
   // assign labels
   func->label_return = label_no++;
   for (int i = 0; i < func->label_stmts->length; i++) {
@@ -1213,23 +2334,35 @@ static void gen_func(Func *func) {
     label_stmt->label_no = label_no++;
   }
 
-  printf("  .text\n");
+  emit_text();
   if (symbol->link == LN_EXTERNAL) {
-    printf("  .global %s\n", symbol->identifier);
+    emit_global(symbol->identifier);
   }
-  printf("%s:\n", symbol->identifier);
+  emit_symbol(symbol->identifier);
 
-  GEN_PUSH("rbp");
-  printf("  movq %%rsp, %%rbp\n");
+  gen_promote(func);
+  int stack_size = func->stack_size + promoted * 8;
+  frame_omitted = false;
+  if (omit_enabled && !type->ellipsis && stack_size + 8 <= RED_ZONE) {
+    frame_omitted = gen_check_leaf(func);
+  }
 
-  if (func->stack_size > 0) {
-    printf("  subq $%d, %%rsp\n", func->stack_size);
-    stack_depth += func->stack_size;
+  if (!frame_omitted) {
+    emit_inst1(ST_PUSH, INST_QUAD, emit_reg(REG_BP, REG_QUAD));
+    stack_depth += 8;
+    emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_SP, REG_QUAD), emit_reg(REG_BP, REG_QUAD));
+    if (stack_size > 0) {
+      emit_inst2(ST_SUB, INST_QUAD, emit_imm(stack_size), emit_reg(REG_SP, REG_QUAD));
+      stack_depth += stack_size;
+    }
+  }
+  for (int i = 0; i < promoted; i++) {
+    emit_inst2(ST_MOV, INST_QUAD, emit_reg(promote_reg[i], REG_QUAD), gen_frame(-func->stack_size - (i + 1) * 8));
   }
 
   if (type->ellipsis) {
     for (int i = type->params->length; i < 6; i++) {
-      printf("  movq %%%s, %d(%%rbp)\n", reg[arg_reg[i]][REG_QUAD], -176 + i * 8);
+      emit_inst2(ST_MOV, INST_QUAD, emit_reg(arg_reg[i], REG_QUAD), gen_frame(-176 + i * 8));
     }
   }
 
@@ -1248,50 +2381,996 @@ static void gen_func(Func *func) {
   //   local variables of the current frame
   //   ---- <= %rsp
   // [lower address]
+  //
+  // If the frame is omitted, %rsp points to the return address, and
+  // the local variables are in the red zone.
 
   for (int i = 0; i < type->params->length; i++) {
     Symbol *param = type->params->buffer[i];
-    if (i < 6) {
+    if (param->promoted && i < 6) {
+      gen_store_by_reg(arg_reg[i], param->reg, param->type);
+    } else if (param->promoted) {
+      emit_inst2(ST_MOV, INST_QUAD, gen_frame(16 + (i - 6) * 8), emit_reg(REG_AX, REG_QUAD));
+      gen_store_by_reg(REG_AX, param->reg, param->type);
+    } else if (i < 6) {
       gen_store_by_offset(arg_reg[i], -param->offset, param->type);
     } else {
-      printf("  movq %d(%%rbp), %%rax\n", 16 + (i - 6) * 8);
+      emit_inst2(ST_MOV, INST_QUAD, gen_frame(16 + (i - 6) * 8), emit_reg(REG_AX, REG_QUAD));
       gen_store_by_offset(REG_AX, -param->offset, param->type);
     }
   }
 
+  reachable = true;
   gen_stmt(func->body);
 
   GEN_LABEL(func->label_return);
-  printf("  leave\n");
-  printf("  ret\n");
+  for (int i = 0; i < promoted; i++) {
+    emit_inst2(ST_MOV, INST_QUAD, gen_frame(-func->stack_size - (i + 1) * 8), emit_reg(promote_reg[i], REG_QUAD));
+  }
+  if (!frame_omitted) {
+    emit_inst0(ST_LEAVE, NO_SUFFIX);
+  }
+  emit_inst0(ST_RET, NO_SUFFIX);
+
+  gen_jump_tables();
+}
+
+// generation from the IR (-O2)
+// The functions which are lowered to the IR are compiled from the
+// instruction list instead of the syntax tree. The vregs are held in
+// the allocated registers or the spill slots, and %rax, %rcx and %rdx are
+// used as scratch registers since they are not allocated.
+
+static IrFunc *ir_fn;
+static int ir_label_return;
+
+static bool ir_in_reg(int vreg) {
+  return ir_fn->regs[vreg] >= 0;
+}
+
+static RegSize ir_size(int size) {
+  return size == 8 ? REG_QUAD : REG_LONG;
+}
+
+static InstSuffix ir_suffix(int size) {
+  return size == 8 ? INST_QUAD : INST_LONG;
+}
+
+static StmtType ir_setcc(StmtType cc) {
+  switch (cc) {
+    case ST_JE: return ST_SETE;
+    case ST_JNE: return ST_SETNE;
+    case ST_JB: return ST_SETB;
+    case ST_JBE: return ST_SETBE;
+    case ST_JL: return ST_SETL;
+    case ST_JLE: return ST_SETLE;
+    case ST_JG: return ST_SETG;
+    case ST_JGE: return ST_SETGE;
+    default: assert(false);
+  }
+}
+
+// the constant value of the vreg, or false if it is not a constant.
+static bool ir_const(int vreg, unsigned long long *value) {
+  IrInst *inst = ir_fn->remat[vreg];
+  if (!inst || inst->op != IR_CONST) return false;
+  *value = inst->imm;
+  return true;
+}
+
+static bool ir_imm(int vreg, int size) {
+  unsigned long long value;
+  return ir_const(vreg, &value) && (size < 8 || check_imm32(value));
+}
+
+// compute the constant or the address to the register.
+static void gen_ir_remat(IrInst *inst, RegCode reg) {
+  switch (inst->op) {
+    case IR_CONST: {
+      if (inst->size < 8 || check_imm32(inst->imm)) {
+        emit_inst2(ST_MOV, INST_LONG, emit_imm(inst->imm & 0xffffffff), emit_reg(reg, REG_LONG));
+        if (inst->size == 8 && inst->imm >= 0x80000000) {
+          emit_inst2(ST_MOVSL, INST_QUAD, emit_reg(reg, REG_LONG), emit_reg(reg, REG_QUAD));
+        }
+      } else {
+        emit_inst2(ST_MOV, INST_QUAD, emit_imm(inst->imm), emit_reg(reg, REG_QUAD));
+      }
+      break;
+    }
+    case IR_LOCAL: {
+      emit_inst2(ST_LEA, INST_QUAD, gen_frame(-inst->symbol->offset), emit_reg(reg, REG_QUAD));
+      break;
+    }
+    case IR_GLOBAL: {
+      emit_inst2(ST_LEA, INST_QUAD, emit_rip(inst->symbol->identifier), emit_reg(reg, REG_QUAD));
+      break;
+    }
+    case IR_STRING: {
+      emit_inst2(ST_LEA, INST_QUAD, emit_rip_string(inst->imm), emit_reg(reg, REG_QUAD));
+      break;
+    }
+    default: assert(false);
+  }
+}
+
+// move the vreg to the register.
+static void gen_ir_move(int vreg, RegCode reg) {
+  if (ir_fn->remat[vreg]) {
+    gen_ir_remat(ir_fn->remat[vreg], reg);
+  } else if (!ir_in_reg(vreg)) {
+    emit_inst2(ST_MOV, INST_QUAD, gen_frame(ir_fn->slots[vreg]), emit_reg(reg, REG_QUAD));
+  } else if (ir_fn->regs[vreg] != reg) {
+    emit_inst2(ST_MOV, INST_QUAD, emit_reg(ir_fn->regs[vreg], REG_QUAD), emit_reg(reg, REG_QUAD));
+  }
+}
+
+// the register which holds the vreg.
+// the vreg is moved to the scratch register if it is not in a register.
+static RegCode gen_ir_reg(int vreg, RegCode scratch) {
+  if (ir_in_reg(vreg)) return ir_fn->regs[vreg];
+  gen_ir_move(vreg, scratch);
+  return scratch;
+}
+
+// the source operand of the vreg, which is an immediate, a register or
+// a spill slot. the other values are computed to the scratch register.
+static EmitOp *gen_ir_src(int vreg, int size, RegCode scratch) {
+  unsigned long long value;
+  if (ir_imm(vreg, size) && ir_const(vreg, &value)) {
+    return emit_imm(size < 8 ? value & 0xffffffff : value);
+  }
+  if (ir_in_reg(vreg)) {
+    return emit_reg(ir_fn->regs[vreg], ir_size(size));
+  }
+  if (!ir_fn->remat[vreg]) {
+    return gen_frame(ir_fn->slots[vreg]);
+  }
+  gen_ir_move(vreg, scratch);
+  return emit_reg(scratch, ir_size(size));
+}
+
+// store the result in the register to the vreg.
+static void gen_ir_def(int vreg, RegCode reg) {
+  if (ir_in_reg(vreg)) {
+    if (ir_fn->regs[vreg] != reg) {
+      emit_inst2(ST_MOV, INST_QUAD, emit_reg(reg, REG_QUAD), emit_reg(ir_fn->regs[vreg], REG_QUAD));
+    }
+  } else {
+    emit_inst2(ST_MOV, INST_QUAD, emit_reg(reg, REG_QUAD), gen_frame(ir_fn->slots[vreg]));
+  }
+}
+
+// the register in which the result is computed.
+// the register of the destination is used unless the other operand is in it.
+static RegCode gen_ir_work(IrInst *inst, int other) {
+  if (!ir_in_reg(inst->dest)) return REG_AX;
+  RegCode reg = ir_fn->regs[inst->dest];
+  if (other >= 0 && other != inst->ops[0] && ir_in_reg(other) && ir_fn->regs[other] == reg) {
+    return REG_AX;
+  }
+  return reg;
+}
+
+// the memory operand of the load or the store.
+static EmitOp *gen_ir_address(IrInst *inst) {
+  IrInst *base = ir_fn->remat[inst->ops[0]];
+  int index = inst->ops[1];
+  if (base && base->op == IR_LOCAL) {
+    int disp = inst->disp - base->symbol->offset;
+    if (index < 0) return gen_frame(disp);
+    return gen_frame_sib(gen_ir_reg(index, REG_CX), inst->scale, disp);
+  }
+  if (base && index < 0 && inst->disp == 0 && base->op == IR_GLOBAL) {
+    return emit_rip(base->symbol->identifier);
+  }
+  if (base && index < 0 && inst->disp == 0 && base->op == IR_STRING) {
+    return emit_rip_string(base->imm);
+  }
+
+  RegCode base_reg = gen_ir_reg(inst->ops[0], REG_DX);
+  if (index < 0) return emit_mem(base_reg, inst->disp);
+  RegCode index_reg = gen_ir_reg(index, REG_CX);
+  return emit_mem_sib(base_reg, index_reg, inst->scale, inst->disp);
+}
+
+static void gen_ir_load(IrInst *inst) {
+  RegCode reg = ir_in_reg(inst->dest) ? ir_fn->regs[inst->dest] : REG_AX;
+  EmitOp *address = gen_ir_address(inst);
+  switch (inst->size) {
+    case 1: emit_inst2(ST_MOVZB, INST_LONG, address, emit_reg(reg, REG_LONG)); break;
+    case 2: emit_inst2(ST_MOVZW, INST_LONG, address, emit_reg(reg, REG_LONG)); break;
+    case 4: emit_inst2(ST_MOV, INST_LONG, address, emit_reg(reg, REG_LONG)); break;
+    case 8: emit_inst2(ST_MOV, INST_QUAD, address, emit_reg(reg, REG_QUAD)); break;
+    default: assert(false);
+  }
+  gen_ir_def(inst->dest, reg);
+}
+
+static void gen_ir_store(IrInst *inst) {
+  InstSuffix suffix;
+  RegSize size;
+  switch (inst->size) {
+    case 1: suffix = INST_BYTE; size = REG_BYTE; break;
+    case 2: suffix = INST_WORD; size = REG_WORD; break;
+    case 4: suffix = INST_LONG; size = REG_LONG; break;
+    case 8: suffix = INST_QUAD; size = REG_QUAD; break;
+    default: assert(false);
+  }
+
+  unsigned long long value;
+  if (ir_imm(inst->ops[2], inst->size) && ir_const(inst->ops[2], &value)) {
+    if (inst->size < 8) {
+      value = value & ((1ULL << (inst->size * 8)) - 1);
+    }
+    EmitOp *address = gen_ir_address(inst);
+    emit_inst2(ST_MOV, suffix, emit_imm(value), address);
+    return;
+  }
+
+  RegCode reg = gen_ir_reg(inst->ops[2], REG_AX);
+  EmitOp *address = gen_ir_address(inst);
+  emit_inst2(ST_MOV, suffix, emit_reg(reg, size), address);
+}
+
+// %rdi, which may hold a vreg, is saved in %rdx during rep stosq.
+static void gen_ir_zero(IrInst *inst) {
+  IrInst *base = ir_fn->remat[inst->ops[0]];
+  bool large = inst->imm > BLOCK_UNROLL;
+  if (large) {
+    emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_DI, REG_QUAD), emit_reg(REG_DX, REG_QUAD));
+  }
+  if (base && base->op == IR_LOCAL) {
+    gen_zero(REG_BP, inst->disp - base->symbol->offset, inst->imm);
+  } else {
+    gen_zero(gen_ir_reg(inst->ops[0], REG_CX), inst->disp, inst->imm);
+  }
+  if (large) {
+    emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_reg(REG_DI, REG_QUAD));
+  }
+}
+
+// the operand of the byte or word operation is zero-extended to %rax or %rcx.
+static EmitOp *gen_ir_narrow(int vreg, int size, RegCode scratch) {
+  RegCode reg = gen_ir_reg(vreg, scratch);
+  StmtType type = size == 1 ? ST_MOVZB : ST_MOVZW;
+  emit_inst2(type, INST_LONG, emit_reg(reg, size == 1 ? REG_BYTE : REG_WORD), emit_reg(scratch, REG_LONG));
+  return emit_reg(scratch, REG_LONG);
+}
+
+// the condition with the operands swapped
+static StmtType ir_swap_cc(StmtType cc) {
+  switch (cc) {
+    case ST_JB: return ST_JA;
+    case ST_JBE: return ST_JAE;
+    case ST_JL: return ST_JG;
+    case ST_JLE: return ST_JGE;
+    default: return cc;
+  }
+}
+
+// cmp ops[1], ops[0]
+// the operands are swapped if the lhs is a constant, and the condition
+// to be tested is returned. the unsigned conditions are swapped only for
+// the jump since setcc does not support them.
+static StmtType gen_ir_compare(IrInst *inst, bool jump) {
+  if (inst->size < 4) {
+    gen_ir_narrow(inst->ops[0], inst->size, REG_AX);
+    EmitOp *rhs = gen_ir_narrow(inst->ops[1], inst->size, REG_CX);
+    emit_inst2(ST_CMP, INST_LONG, rhs, emit_reg(REG_AX, REG_LONG));
+    return inst->cc;
+  }
+
+  int lhs = inst->ops[0];
+  int rhs = inst->ops[1];
+  StmtType cc = inst->cc;
+  bool sign = cc != ST_JB && cc != ST_JBE;
+  if (ir_imm(lhs, inst->size) && !ir_imm(rhs, inst->size) && (jump || sign)) {
+    lhs = inst->ops[1];
+    rhs = inst->ops[0];
+    cc = ir_swap_cc(cc);
+  }
+  RegCode reg = gen_ir_reg(lhs, REG_AX);
+  RegSize size = ir_size(inst->size);
+  unsigned long long value;
+  if (ir_const(rhs, &value) && value == 0) {
+    emit_inst2(ST_TEST, ir_suffix(inst->size), emit_reg(reg, size), emit_reg(reg, size));
+  } else {
+    emit_inst2(ST_CMP, ir_suffix(inst->size), gen_ir_src(rhs, inst->size, REG_CX), emit_reg(reg, size));
+  }
+  return cc;
+}
+
+static void gen_ir_cmp(IrInst *inst) {
+  StmtType cc = gen_ir_compare(inst, false);
+  emit_inst1(ir_setcc(cc), NO_SUFFIX, emit_reg(REG_AX, REG_BYTE));
+  RegCode reg = ir_in_reg(inst->dest) ? ir_fn->regs[inst->dest] : REG_AX;
+  emit_inst2(ST_MOVZB, INST_LONG, emit_reg(REG_AX, REG_BYTE), emit_reg(reg, REG_LONG));
+  gen_ir_def(inst->dest, reg);
+}
+
+// two-address operation
+static void gen_ir_binary(IrInst *inst, StmtType type, bool commutative) {
+  int lhs = inst->ops[0];
+  int rhs = inst->ops[1];
+  if (commutative && (ir_imm(lhs, inst->size) || (ir_in_reg(inst->dest) && ir_in_reg(rhs) && ir_fn->regs[rhs] == ir_fn->regs[inst->dest]))) {
+    lhs = inst->ops[1];
+    rhs = inst->ops[0];
+  }
+
+  RegCode reg = ir_in_reg(inst->dest) ? ir_fn->regs[inst->dest] : REG_AX;
+  if (rhs != lhs && ir_in_reg(rhs) && ir_fn->regs[rhs] == reg) {
+    reg = REG_AX;
+  }
+  gen_ir_move(lhs, reg);
+  emit_inst2(type, ir_suffix(inst->size), gen_ir_src(rhs, inst->size, REG_CX), emit_reg(reg, ir_size(inst->size)));
+  gen_ir_def(inst->dest, reg);
+}
+
+static void gen_ir_unary(IrInst *inst, StmtType type) {
+  RegCode reg = gen_ir_work(inst, -1);
+  gen_ir_move(inst->ops[0], reg);
+  emit_inst1(type, ir_suffix(inst->size), emit_reg(reg, ir_size(inst->size)));
+  gen_ir_def(inst->dest, reg);
+}
+
+static void gen_ir_mul(IrInst *inst) {
+  unsigned long long value;
+  int lhs = inst->ops[0];
+  int rhs = inst->ops[1];
+  if (ir_const(lhs, &value)) {
+    lhs = inst->ops[1];
+    rhs = inst->ops[0];
+  }
+  if (ir_const(rhs, &value)) {
+    gen_ir_move(lhs, REG_AX);
+    gen_mul_imm(REG_AX, value, ir_size(inst->size));
+    gen_ir_def(inst->dest, REG_AX);
+    return;
+  }
+  gen_ir_binary(inst, ST_IMUL, true);
+}
+
+static void gen_ir_div(IrInst *inst) {
+  RegSize size = ir_size(inst->size);
+  InstSuffix suffix = ir_suffix(inst->size);
+  bool mod = inst->op == IR_MOD;
+
+  // division by a positive constant
+  unsigned long long d;
+  if (ir_const(inst->ops[1], &d)) {
+    unsigned long long sign_bit = inst->size == 8 ? 1ULL << 63 : 1ULL << 31;
+    if (d != 0 && !(inst->sign && (d & sign_bit))) {
+      gen_ir_move(inst->ops[0], REG_AX);
+      gen_ir_def(inst->dest, gen_div_const(d, inst->sign, mod, size));
+      return;
+    }
+  }
+
+  RegCode divisor = gen_ir_reg(inst->ops[1], REG_CX);
+  gen_ir_move(inst->ops[0], REG_AX);
+  if (inst->sign) {
+    emit_inst0(size == REG_QUAD ? ST_CQTO : ST_CLTD, NO_SUFFIX);
+    emit_inst1(ST_IDIV, suffix, emit_reg(divisor, size));
+  } else {
+    emit_inst2(ST_MOV, INST_LONG, emit_imm(0), emit_reg(REG_DX, REG_LONG));
+    emit_inst1(ST_DIV, suffix, emit_reg(divisor, size));
+  }
+  gen_ir_def(inst->dest, mod ? REG_DX : REG_AX);
+}
+
+static void gen_ir_shift(IrInst *inst, StmtType type) {
+  unsigned long long count;
+  if (ir_const(inst->ops[1], &count)) {
+    RegCode reg = gen_ir_work(inst, -1);
+    gen_ir_move(inst->ops[0], reg);
+    emit_inst2(type, ir_suffix(inst->size), emit_imm(count & 63), emit_reg(reg, ir_size(inst->size)));
+    gen_ir_def(inst->dest, reg);
+    return;
+  }
+
+  // the count is moved to %cl before the operand is moved to the register.
+  gen_ir_move(inst->ops[1], REG_CX);
+  RegCode reg = ir_in_reg(inst->dest) ? ir_fn->regs[inst->dest] : REG_AX;
+  gen_ir_move(inst->ops[0], reg);
+  emit_inst2(type, ir_suffix(inst->size), emit_reg(REG_CX, REG_BYTE), emit_reg(reg, ir_size(inst->size)));
+  gen_ir_def(inst->dest, reg);
+}
+
+static void gen_ir_ext(IrInst *inst) {
+  RegCode reg = gen_ir_work(inst, -1);
+  RegCode src = gen_ir_reg(inst->ops[0], REG_AX);
+  RegSize to = ir_size(inst->size);
+  InstSuffix suffix = ir_suffix(inst->size);
+  switch (inst->imm) {
+    case 1: {
+      if (inst->sign) {
+        emit_inst2(ST_MOVSB, suffix, emit_reg(src, REG_BYTE), emit_reg(reg, to));
+      } else {
+        emit_inst2(ST_MOVZB, INST_LONG, emit_reg(src, REG_BYTE), emit_reg(reg, REG_LONG));
+      }
+      break;
+    }
+    case 2: {
+      if (inst->sign) {
+        emit_inst2(ST_MOVSW, suffix, emit_reg(src, REG_WORD), emit_reg(reg, to));
+      } else {
+        emit_inst2(ST_MOVZW, INST_LONG, emit_reg(src, REG_WORD), emit_reg(reg, REG_LONG));
+      }
+      break;
+    }
+    case 4: {
+      if (inst->sign) {
+        emit_inst2(ST_MOVSL, INST_QUAD, emit_reg(src, REG_LONG), emit_reg(reg, REG_QUAD));
+      } else {
+        emit_inst2(ST_MOV, INST_LONG, emit_reg(src, REG_LONG), emit_reg(reg, REG_LONG));
+      }
+      break;
+    }
+    default: assert(false);
+  }
+  gen_ir_def(inst->dest, reg);
+}
+
+static void gen_ir_copy(IrInst *inst) {
+  if (ir_in_reg(inst->dest)) {
+    gen_ir_move(inst->ops[0], ir_fn->regs[inst->dest]);
+  } else {
+    gen_ir_def(inst->dest, gen_ir_reg(inst->ops[0], REG_AX));
+  }
+}
+
+static void gen_ir_call(IrInst *inst) {
+  int n = inst->args->length;
+  int stack_args = n > 6 ? n - 6 : 0;
+
+  // the frame is 16-byte aligned, so only the arguments on the stack
+  // need the padding.
+  int padding = stack_args % 2 ? 8 : 0;
+  if (padding > 0) {
+    emit_inst2(ST_SUB, INST_QUAD, emit_imm(padding), emit_reg(REG_SP, REG_QUAD));
+  }
+  for (int i = n - 1; i >= 6; i--) {
+    int arg = (int) (intptr_t) inst->args->buffer[i];
+    emit_inst1(ST_PUSH, INST_QUAD, emit_reg(gen_ir_reg(arg, REG_AX), REG_QUAD));
+  }
+
+  // the arguments in registers are moved at once,
+  // and then the others are loaded.
+  int src[6], dest[6];
+  int moves = 0;
+  for (int i = 0; i < n && i < 6; i++) {
+    int arg = (int) (intptr_t) inst->args->buffer[i];
+    if (ir_in_reg(arg)) {
+      src[moves] = ir_fn->regs[arg];
+      dest[moves] = arg_reg[i];
+      moves++;
+    }
+  }
+  gen_parallel_move(src, dest, moves);
+  for (int i = 0; i < n && i < 6; i++) {
+    int arg = (int) (intptr_t) inst->args->buffer[i];
+    if (!ir_in_reg(arg)) {
+      gen_ir_move(arg, arg_reg[i]);
+    }
+  }
+
+  if (inst->variadic) {
+    emit_inst2(ST_MOV, INST_BYTE, emit_imm(0), emit_reg(REG_AX, REG_BYTE));
+  }
+  emit_inst1(ST_CALL, NO_SUFFIX, emit_sym(inst->symbol->identifier));
+  if (padding + stack_args * 8 > 0) {
+    emit_inst2(ST_ADD, INST_QUAD, emit_imm(padding + stack_args * 8), emit_reg(REG_SP, REG_QUAD));
+  }
+
+  if (inst->dest >= 0) {
+    gen_ir_def(inst->dest, REG_AX);
+  }
+}
+
+// vector loop
+// The index is held in %rax and the end in %rdx, and the elements are
+// processed by SSE2 with %xmm0 to %xmm3. x is broadcast to %xmm1, and
+// the partial sums are accumulated in %xmm2.
+
+static EmitOp *gen_xmm(int n) {
+  return emit_reg(n, REG_XMM);
+}
+
+// the memory operand of the element at %rax.
+static EmitOp *gen_ir_element(int vreg, Scale scale) {
+  IrInst *base = ir_fn->remat[vreg];
+  if (base && base->op == IR_LOCAL) {
+    return gen_frame_sib(REG_AX, scale, -base->symbol->offset);
+  }
+  return emit_mem_sib(gen_ir_reg(vreg, REG_CX), REG_AX, scale, 0);
+}
+
+// x is broadcast to each element of %xmm1.
+static void gen_ir_splat(int vreg, int size) {
+  gen_ir_move(vreg, REG_CX);
+  if (size == 1) {
+    emit_inst2(ST_MOVZB, INST_LONG, emit_reg(REG_CX, REG_BYTE), emit_reg(REG_CX, REG_LONG));
+    emit_inst2(ST_IMUL, INST_LONG, emit_imm(0x01010101), emit_reg(REG_CX, REG_LONG));
+  }
+  emit_inst2(ST_MOVD, NO_SUFFIX, emit_reg(REG_CX, REG_LONG), gen_xmm(1));
+  emit_inst3(ST_PSHUFD, NO_SUFFIX, emit_imm(0), gen_xmm(1), gen_xmm(1));
+}
+
+// jump to the label if the destination is 1 to 15 bytes after the source,
+// where the elements are overwritten before they are read.
+static void gen_ir_overlap(int dest, int src, int label) {
+  gen_ir_move(src, REG_DX);
+  gen_ir_move(dest, REG_CX);
+  emit_inst2(ST_SUB, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_reg(REG_CX, REG_QUAD));
+  emit_inst2(ST_SUB, INST_QUAD, emit_imm(1), emit_reg(REG_CX, REG_QUAD));
+  emit_inst2(ST_CMP, INST_QUAD, emit_imm(15), emit_reg(REG_CX, REG_QUAD));
+  GEN_JUMP(ST_JB, label);
+}
+
+static void gen_ir_vector(IrInst *inst) {
+  int size = inst->size;
+  Scale scale = size == 1 ? SCALE1 : SCALE4;
+  StmtType padd = size == 1 ? ST_PADDB : ST_PADDD;
+  int arg[6];
+  for (int i = 0; i < inst->args->length; i++) {
+    arg[i] = (int) (intptr_t) inst->args->buffer[i];
+  }
+  int dest = arg[2];
+
+  switch (inst->imm) {
+    case VEC_FILL:
+    case VEC_FIND: gen_ir_splat(arg[3], size); break;
+    case VEC_ADD_SCALAR: gen_ir_splat(arg[4], size); break;
+    case VEC_SUM: emit_inst2(ST_PXOR, NO_SUFFIX, gen_xmm(2), gen_xmm(2)); break;
+  }
+
+  int label_loop = label_no++;
+  int label_end = label_no++;
+  gen_ir_move(arg[0], REG_AX);
+  if (inst->imm == VEC_COPY || inst->imm == VEC_ADD || inst->imm == VEC_ADD_SCALAR) {
+    gen_ir_overlap(dest, arg[3], label_end);
+  }
+  if (inst->imm == VEC_ADD) {
+    gen_ir_overlap(dest, arg[4], label_end);
+  }
+  gen_ir_move(arg[1], REG_DX);
+
+  GEN_LABEL(label_loop);
+  switch (inst->imm) {
+    case VEC_FILL: {
+      emit_inst2(ST_MOVDQU, NO_SUFFIX, gen_xmm(1), gen_ir_element(dest, scale));
+      break;
+    }
+    case VEC_COPY: {
+      emit_inst2(ST_MOVDQU, NO_SUFFIX, gen_ir_element(arg[3], scale), gen_xmm(0));
+      emit_inst2(ST_MOVDQU, NO_SUFFIX, gen_xmm(0), gen_ir_element(dest, scale));
+      break;
+    }
+    case VEC_ADD: {
+      emit_inst2(ST_MOVDQU, NO_SUFFIX, gen_ir_element(arg[3], scale), gen_xmm(0));
+      emit_inst2(ST_MOVDQU, NO_SUFFIX, gen_ir_element(arg[4], scale), gen_xmm(3));
+      emit_inst2(padd, NO_SUFFIX, gen_xmm(3), gen_xmm(0));
+      emit_inst2(ST_MOVDQU, NO_SUFFIX, gen_xmm(0), gen_ir_element(dest, scale));
+      break;
+    }
+    case VEC_ADD_SCALAR: {
+      emit_inst2(ST_MOVDQU, NO_SUFFIX, gen_ir_element(arg[3], scale), gen_xmm(0));
+      emit_inst2(padd, NO_SUFFIX, gen_xmm(1), gen_xmm(0));
+      emit_inst2(ST_MOVDQU, NO_SUFFIX, gen_xmm(0), gen_ir_element(dest, scale));
+      break;
+    }
+    case VEC_SUM: {
+      emit_inst2(ST_MOVDQU, NO_SUFFIX, gen_ir_element(dest, scale), gen_xmm(0));
+      emit_inst2(ST_PADDD, NO_SUFFIX, gen_xmm(0), gen_xmm(2));
+      break;
+    }
+    case VEC_FIND: {
+      emit_inst2(ST_MOVDQU, NO_SUFFIX, gen_ir_element(dest, scale), gen_xmm(0));
+      emit_inst2(ST_PCMPEQB, NO_SUFFIX, gen_xmm(1), gen_xmm(0));
+      emit_inst2(ST_PMOVMSKB, NO_SUFFIX, gen_xmm(0), emit_reg(REG_CX, REG_LONG));
+      emit_inst2(ST_TEST, INST_LONG, emit_reg(REG_CX, REG_LONG), emit_reg(REG_CX, REG_LONG));
+      GEN_JUMP(ST_JNE, label_end);
+      break;
+    }
+    default: assert(false);
+  }
+  emit_inst2(ST_ADD, INST_QUAD, emit_imm(16 / size), emit_reg(REG_AX, REG_QUAD));
+  emit_inst2(ST_CMP, INST_QUAD, emit_reg(REG_DX, REG_QUAD), emit_reg(REG_AX, REG_QUAD));
+  GEN_JUMP(ST_JL, label_loop);
+  GEN_LABEL(label_end);
+
+  // the four partial sums are added up.
+  if (inst->imm == VEC_SUM) {
+    emit_inst3(ST_PSHUFD, NO_SUFFIX, emit_imm(0x4e), gen_xmm(2), gen_xmm(0));
+    emit_inst2(ST_PADDD, NO_SUFFIX, gen_xmm(0), gen_xmm(2));
+    emit_inst3(ST_PSHUFD, NO_SUFFIX, emit_imm(0xb1), gen_xmm(2), gen_xmm(0));
+    emit_inst2(ST_PADDD, NO_SUFFIX, gen_xmm(0), gen_xmm(2));
+    emit_inst2(ST_MOVD, NO_SUFFIX, gen_xmm(2), emit_reg(REG_AX, REG_LONG));
+  }
+  gen_ir_def(inst->dest, REG_AX);
+}
+
+static void gen_ir_jump(IrBlock *target, IrBlock *next) {
+  if (target != next) {
+    GEN_JUMP(ST_JMP, target->label);
+  }
+}
+
+// jump to succs[0] if the condition cc holds, or succs[1].
+static void gen_ir_cond_jump(StmtType cc, IrBlock *block, IrBlock *next) {
+  IrBlock *then_block = block->succs->buffer[0];
+  IrBlock *else_block = block->succs->buffer[1];
+  if (then_block == next) {
+    GEN_JUMP(emit_negate_jcc(cc), else_block->label);
+  } else {
+    GEN_JUMP(cc, then_block->label);
+    gen_ir_jump(else_block, next);
+  }
+}
+
+static void gen_ir_branch(IrInst *inst, IrBlock *block, IrBlock *next) {
+  IrInst *cond = ir_fn->remat[inst->ops[0]];
+  if (cond && cond->fused) {
+    StmtType cc = gen_ir_compare(cond, true);
+    gen_ir_cond_jump(cc, block, next);
+    return;
+  }
+
+  if (inst->size < 4) {
+    EmitOp *reg = gen_ir_narrow(inst->ops[0], inst->size, REG_AX);
+    emit_inst2(ST_TEST, INST_LONG, reg, emit_reg(REG_AX, REG_LONG));
+  } else if (ir_in_reg(inst->ops[0]) || ir_fn->remat[inst->ops[0]]) {
+    RegCode reg = gen_ir_reg(inst->ops[0], REG_AX);
+    RegSize size = ir_size(inst->size);
+    emit_inst2(ST_TEST, ir_suffix(inst->size), emit_reg(reg, size), emit_reg(reg, size));
+  } else {
+    emit_inst2(ST_CMP, ir_suffix(inst->size), emit_imm(0), gen_frame(ir_fn->slots[inst->ops[0]]));
+  }
+  gen_ir_cond_jump(ST_JNE, block, next);
+}
+
+static void gen_ir_switch(IrInst *inst, IrBlock *block) {
+  for (int i = 0; i < inst->cases->length; i++) {
+    Stmt *case_stmt = inst->cases->buffer[i];
+    IrBlock *succ = block->succs->buffer[i];
+    case_stmt->label_no = succ->label;
+  }
+  IrBlock *default_block = vector_last(block->succs);
+
+  gen_ir_move(inst->ops[0], REG_AX);
+  gen_switch_dispatch(inst->cases, inst->sign, ir_size(inst->size), default_block->label);
+}
+
+static void gen_ir_inst(IrInst *inst, IrBlock *block, IrBlock *next) {
+  switch (inst->op) {
+    case IR_CONST:
+    case IR_LOCAL:
+    case IR_GLOBAL:
+    case IR_STRING:
+    case IR_PARAM:
+      break;
+    case IR_COPY: gen_ir_copy(inst); break;
+    case IR_LOAD: gen_ir_load(inst); break;
+    case IR_STORE: gen_ir_store(inst); break;
+    case IR_ZERO: gen_ir_zero(inst); break;
+    case IR_NEG: gen_ir_unary(inst, ST_NEG); break;
+    case IR_NOT: gen_ir_unary(inst, ST_NOT); break;
+    case IR_EXT: gen_ir_ext(inst); break;
+    case IR_ADD: gen_ir_binary(inst, ST_ADD, true); break;
+    case IR_SUB: gen_ir_binary(inst, ST_SUB, false); break;
+    case IR_MUL: gen_ir_mul(inst); break;
+    case IR_DIV:
+    case IR_MOD: gen_ir_div(inst); break;
+    case IR_AND: gen_ir_binary(inst, ST_AND, true); break;
+    case IR_OR: gen_ir_binary(inst, ST_OR, true); break;
+    case IR_XOR: gen_ir_binary(inst, ST_XOR, true); break;
+    case IR_SHL: gen_ir_shift(inst, ST_SAL); break;
+    case IR_SHR: gen_ir_shift(inst, ST_SHR); break;
+    case IR_SAR: gen_ir_shift(inst, ST_SAR); break;
+    case IR_CMP: {
+      if (!inst->fused) {
+        gen_ir_cmp(inst);
+      }
+      break;
+    }
+    case IR_CALL: gen_ir_call(inst); break;
+    case IR_VECTOR: gen_ir_vector(inst); break;
+    case IR_JMP: gen_ir_jump(block->succs->buffer[0], next); break;
+    case IR_BR: gen_ir_branch(inst, block, next); break;
+    case IR_SWITCH: gen_ir_switch(inst, block); break;
+    case IR_RET: {
+      if (inst->ops[0] >= 0) {
+        gen_ir_move(inst->ops[0], REG_AX);
+      }
+      if (next) {
+        GEN_JUMP(ST_JMP, ir_label_return);
+      }
+      break;
+    }
+    case IR_UNREACHABLE: break;
+    default: assert(false);
+  }
+}
+
+// the parameters are moved to their registers at once.
+static void gen_ir_params(IrBlock *entry) {
+  int src[6], dest[6];
+  int moves = 0;
+  for (int i = 0; i < entry->insts->length; i++) {
+    IrInst *inst = entry->insts->buffer[i];
+    if (inst->op != IR_PARAM) break;
+    if (inst->imm < 6 && !ir_in_reg(inst->dest)) {
+      emit_inst2(ST_MOV, INST_QUAD, emit_reg(arg_reg[inst->imm], REG_QUAD), gen_frame(ir_fn->slots[inst->dest]));
+    } else if (inst->imm < 6) {
+      src[moves] = arg_reg[inst->imm];
+      dest[moves] = ir_fn->regs[inst->dest];
+      moves++;
+    }
+  }
+  gen_parallel_move(src, dest, moves);
+
+  for (int i = 0; i < entry->insts->length; i++) {
+    IrInst *inst = entry->insts->buffer[i];
+    if (inst->op != IR_PARAM) break;
+    if (inst->imm >= 6) {
+      RegCode reg = ir_in_reg(inst->dest) ? ir_fn->regs[inst->dest] : REG_AX;
+      emit_inst2(ST_MOV, INST_QUAD, gen_frame(16 + (inst->imm - 6) * 8), emit_reg(reg, REG_QUAD));
+      gen_ir_def(inst->dest, reg);
+    }
+  }
+}
+
+// the stack is touched only by the calls in the code from the IR.
+static bool gen_ir_leaf(IrFunc *fn) {
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->op == IR_CALL) return false;
+    }
+  }
+  return true;
+}
+
+static void gen_ir_func(Func *func, IrFunc *fn) {
+  Symbol *symbol = func->symbol;
+  ir_fn = fn;
+  ir_label_return = label_no++;
+  jump_tables = vector_new();
+  reachable = true;
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    block->label = label_no++;
+  }
+
+  emit_text();
+  if (symbol->link == LN_EXTERNAL) {
+    emit_global(symbol->identifier);
+  }
+  emit_symbol(symbol->identifier);
+
+  // the callee-saved registers are saved below the local variables,
+  // and the spill slots are below them.
+  int saved = 0;
+  for (int i = 0; i < PROMOTE_SIZE; i++) {
+    if (fn->saved & (1 << promote_reg[i])) saved++;
+  }
+  int frame = func->stack_size + (saved + fn->spills) * 8;
+  frame_omitted = omit_enabled && frame + 8 <= RED_ZONE && gen_ir_leaf(fn);
+  frame = (frame + 15) / 16 * 16;
+
+  if (!frame_omitted) {
+    emit_inst1(ST_PUSH, INST_QUAD, emit_reg(REG_BP, REG_QUAD));
+    emit_inst2(ST_MOV, INST_QUAD, emit_reg(REG_SP, REG_QUAD), emit_reg(REG_BP, REG_QUAD));
+    if (frame > 0) {
+      emit_inst2(ST_SUB, INST_QUAD, emit_imm(frame), emit_reg(REG_SP, REG_QUAD));
+    }
+  }
+  int k = 0;
+  for (int i = 0; i < PROMOTE_SIZE; i++) {
+    if (fn->saved & (1 << promote_reg[i])) {
+      emit_inst2(ST_MOV, INST_QUAD, emit_reg(promote_reg[i], REG_QUAD), gen_frame(-func->stack_size - (++k) * 8));
+    }
+  }
+
+  gen_ir_params(fn->blocks->buffer[0]);
+
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    IrBlock *next = i + 1 < fn->blocks->length ? fn->blocks->buffer[i + 1] : NULL;
+    if (i > 0) {
+      GEN_LABEL(block->label);
+    }
+    for (int j = 0; j < block->insts->length; j++) {
+      gen_ir_inst(block->insts->buffer[j], block, next);
+    }
+  }
+
+  GEN_LABEL(ir_label_return);
+  k = 0;
+  for (int i = 0; i < PROMOTE_SIZE; i++) {
+    if (fn->saved & (1 << promote_reg[i])) {
+      emit_inst2(ST_MOV, INST_QUAD, gen_frame(-func->stack_size - (++k) * 8), emit_reg(promote_reg[i], REG_QUAD));
+    }
+  }
+  if (!frame_omitted) {
+    emit_inst0(ST_LEAVE, NO_SUFFIX);
+  }
+  emit_inst0(ST_RET, NO_SUFFIX);
+
+  gen_jump_tables();
 }
 
 static void gen_string_literal(String *string, int label) {
-  printf(".S%d:\n", label);
-  printf("  .ascii \"");
-  for (int i = 0; i < string->length; i++) {
-    char c = string->buffer[i];
-    switch (c) {
-      case '\\': printf("\\\\"); break;
-      case '"': printf("\\\""); break;
-      case '\a': printf("\\a"); break;
-      case '\b': printf("\\b"); break;
-      case '\f': printf("\\f"); break;
-      case '\n': printf("\\n"); break;
-      case '\r': printf("\\r"); break;
-      case '\t': printf("\\t"); break;
-      case '\v': printf("\\v"); break;
-      default: printf(isprint(c) ? "%c" : "\\%o", c);
-    }
-  }
-  printf("\"\n");
-}
-
-static void gen_trans_unit(TransUnit *trans_unit) {
+  emit_string_label(label);
+  emit_ascii(string);
+}
+
+// the IR of the functions in the translation unit (NULL if not supported).
+// with -O2, the functions are optimized, and then the small ones are inlined
+// into the callers, which are optimized again.
+static Vector *gen_ir_build(TransUnit *trans_unit, Options *options) {
+  Vector *fns = vector_new();
+  for (int i = 0; i < trans_unit->decls->length; i++) {
+    Node *decl = trans_unit->decls->buffer[i];
+    if (decl->nd_type != ND_FUNC) continue;
+
+    IrFunc *fn = ir_build((Func *) decl, options->opt_level >= 2, options->vectorize_report);
+    if (fn && options->opt_level >= 2) {
+      ir_optimize(fn);
+    }
+    vector_push(fns, fn);
+  }
+
+  if (options->opt_level >= 2) {
+    for (int i = 0; i < fns->length; i++) {
+      IrFunc *fn = fns->buffer[i];
+      if (fn && ir_inline(fn, fns, options->inline_report)) {
+        ir_optimize(fn);
+      }
+    }
+  }
+  return fns;
+}
+
+// the functions are lowered to the IR with -O2, and the others are compiled
+// from the syntax tree. the peephole optimizer is not applied to the code
+// from the IR since the registers are allocated across the statements.
+static void gen_func_opt(Func *func, IrFunc *fn) {
+  if (!fn) {
+    gen_func(func);
+    return;
+  }
+  ir_lower(fn, func->stack_size);
+
+  emit_set_optimize(false);
+  gen_ir_func(func, fn);
+  emit_set_optimize(true);
+}
+
+// unused functions and string literals
+// The static functions which are not referenced from the external functions,
+// directly or indirectly, are removed from the translation unit, and so are
+// the string literals which are not used by the remaining code (-O1).
+// The references of a function compiled through the IR are taken from
+// the IR, so that a static function whose calls are all inlined is removed.
+
+static void gen_prune_ref(Map *funcs, bool *live, Vector *work, Symbol *symbol) {
+  int index = map_lookupi(funcs, symbol->identifier) - 1;
+  if (index >= 0 && !live[index]) {
+    live[index] = true;
+    vector_pushi(work, index);
+  }
+}
+
+static void gen_prune_init(Initializer *init, bool *used) {
+  if (init->list) {
+    for (int i = 0; i < init->list->length; i++) {
+      gen_prune_init(init->list->buffer[i], used);
+    }
+  } else if (init->expr) {
+    Expr *expr = init->expr->nd_type == ND_CAST ? init->expr->expr : init->expr;
+    if (expr->nd_type == ND_STRING) {
+      used[expr->string_label] = true;
+    }
+  }
+}
+
+// returns the IR of the remaining functions if fns is not NULL.
+static Vector *gen_prune(TransUnit *trans_unit, Vector *fns) {
+  Vector *decls = trans_unit->decls;
+  Vector *literals = trans_unit->literals;
+  Vector *funcs = vector_new();
+  Map *indexes = map_new();
+  for (int i = 0; i < decls->length; i++) {
+    Node *decl = decls->buffer[i];
+    if (decl->nd_type != ND_FUNC) continue;
+    Func *func = (Func *) decl;
+    vector_push(funcs, func);
+    map_puti(indexes, func->symbol->identifier, funcs->length);
+  }
+
+  bool *live = arena_alloc(ARENA_GEN, sizeof(bool) * (funcs->length + 1));
+  bool *used = arena_alloc(ARENA_GEN, sizeof(bool) * (literals->length + 1));
+  Vector *work = vector_new();
+  for (int i = 0; i < funcs->length; i++) {
+    Func *func = funcs->buffer[i];
+    if (func->symbol->link == LN_EXTERNAL) {
+      live[i] = true;
+      vector_pushi(work, i);
+    }
+  }
+  for (int i = 0; i < decls->length; i++) {
+    Decl *decl = decls->buffer[i];
+    if (decl->nd_type != ND_DECL) continue;
+    for (int j = 0; j < decl->symbols->length; j++) {
+      Symbol *symbol = decl->symbols->buffer[j];
+      if (symbol->init) {
+        gen_prune_init(symbol->init, used);
+      }
+    }
+  }
+
+  while (work->length > 0) {
+    int index = vector_popi(work);
+    Func *func = funcs->buffer[index];
+    IrFunc *fn = fns ? fns->buffer[index] : NULL;
+    if (!fn) {
+      for (int i = 0; i < func->refs->length; i++) {
+        gen_prune_ref(indexes, live, work, func->refs->buffer[i]);
+      }
+      for (int i = 0; i < func->strings->length; i++) {
+        used[(int) (intptr_t) func->strings->buffer[i]] = true;
+      }
+      continue;
+    }
+    for (int i = 0; i < fn->blocks->length; i++) {
+      IrBlock *block = fn->blocks->buffer[i];
+      for (int j = 0; j < block->insts->length; j++) {
+        IrInst *inst = block->insts->buffer[j];
+        if (inst->op == IR_CALL || inst->op == IR_GLOBAL) {
+          gen_prune_ref(indexes, live, work, inst->symbol);
+        } else if (inst->op == IR_STRING) {
+          used[inst->imm] = true;
+        }
+      }
+    }
+  }
+
+  Vector *remaining = vector_new();
+  Vector *remaining_fns = fns ? vector_new() : NULL;
+  int index = 0;
+  for (int i = 0; i < decls->length; i++) {
+    Node *decl = decls->buffer[i];
+    if (decl->nd_type == ND_FUNC && !live[index++]) continue;
+    vector_push(remaining, decl);
+    if (decl->nd_type == ND_FUNC && fns) {
+      vector_push(remaining_fns, fns->buffer[index - 1]);
+    }
+  }
+  trans_unit->decls = remaining;
+
+  for (int i = 0; i < literals->length; i++) {
+    if (!used[i]) {
+      literals->buffer[i] = NULL;
+    }
+  }
+  return remaining_fns;
+}
+
+static void gen_trans_unit(TransUnit *trans_unit, Options *options) {
+  Vector *fns = options->opt_level >= 2 ? gen_ir_build(trans_unit, options) : NULL;
+  int funcs = 0;
+  if (dce_enabled) {
+    fns = gen_prune(trans_unit, fns);
+  }
+
   if (trans_unit->literals->length > 0) {
-    printf("  .section .rodata\n");
+    emit_rodata();
     for (int i = 0; i < trans_unit->literals->length; i++) {
-      gen_string_literal(trans_unit->literals->buffer[i], i);
+      if (trans_unit->literals->buffer[i]) {
+        gen_string_literal(trans_unit->literals->buffer[i], i);
+      }
     }
   }
 
@@ -1299,13 +3378,61 @@ static void gen_trans_unit(TransUnit *trans_unit) {
     Node *decl = trans_unit->decls->buffer[i];
     if (decl->nd_type == ND_DECL) {
       gen_decl_global((Decl *) decl);
+    } else if (decl->nd_type == ND_FUNC && fns) {
+      gen_func_opt((Func *) decl, fns->buffer[funcs++]);
     } else if (decl->nd_type == ND_FUNC) {
       gen_func((Func *) decl);
     }
   }
 }
 
-void gen(TransUnit *trans_unit) {
+// the IR of the functions is written to output (stdout if it is NULL).
+static void gen_ir_dump(TransUnit *trans_unit, char *output, Options *options) {
+  FILE *fp = output ? fopen(output, "w") : stdout;
+  if (!fp) {
+    perror(output);
+    exit(1);
+  }
+
+  Vector *fns = gen_ir_build(trans_unit, options);
+  int funcs = 0;
+  for (int i = 0; i < trans_unit->decls->length; i++) {
+    Node *decl = trans_unit->decls->buffer[i];
+    if (decl->nd_type != ND_FUNC) continue;
+
+    Func *func = (Func *) decl;
+    IrFunc *fn = fns->buffer[funcs++];
+    if (!fn) {
+      fprintf(fp, "func %s\n  ; not supported\n\n", func->symbol->identifier);
+      continue;
+    }
+    ir_dump(fn, fp);
+  }
+
+  if (output) {
+    fclose(fp);
+  }
+}
+
+// if options->object is true, an object file is generated by the integrated assembler.
+// otherwise assembly is written to output (stdout if it is NULL).
+// the peephole optimizer and the register promotion are enabled with -O1 or higher,
+// and the functions are compiled through the IR with -O2.
+// if options->emit_ir is true, the IR is written instead of assembly.
+// if options->inline_report is true, the decisions of the inliner are written to stderr.
+// if options->vectorize_report is true, the decisions of the vectorizer are written to stderr.
+// the frame of the leaf functions is omitted with -O1 or higher if options->omit_frame_pointer is true.
+void gen(TransUnit *trans_unit, char *output, Options *options) {
   label_no = 0;
-  gen_trans_unit(trans_unit);
+  if (options->emit_ir) {
+    gen_ir_dump(trans_unit, output, options);
+    return;
+  }
+
+  promote_enabled = options->opt_level >= 1;
+  dce_enabled = options->opt_level >= 1;
+  omit_enabled = options->opt_level >= 1 && options->omit_frame_pointer;
+  emit_open(output, options->object, options->opt_level >= 1);
+  gen_trans_unit(trans_unit, options);
+  emit_close();
 }
@@ -0,0 +1,25 @@
+#include "sk2cc.h"
+#include "map.h"
+#include "ident.h"
+
+static Map *idents; // Map<Ident*>
+
+// returns the canonical Ident of the spelling.
+// the given string is kept as the canonical name if it is seen for the first time,
+// so it should not be modified after interned.
+Ident *intern(char *name) {
+  if (!idents) {
+    idents = map_new();
+  }
+
+  unsigned int hash = map_hash(name);
+  Ident *ident = map_lookup_hash(idents, name, hash);
+  if (!ident) {
+    ident = calloc(1, sizeof(Ident));
+    ident->name = name;
+    ident->hash = hash;
+    map_put_hash(idents, name, hash, ident);
+  }
+
+  return ident;
+}
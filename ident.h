@@ -0,0 +1,13 @@
+// interned identifiers
+// each distinct spelling is represented by exactly one Ident,
+// so identifiers can be compared by ident->name pointers.
+typedef struct ident {
+  char *name;
+  unsigned int hash;
+
+  // bindings attached by the lexer and the preprocessor
+  int keyword; // token type if the identifier is a keyword
+  void *macro; // current macro definition
+} Ident;
+
+extern Ident *intern(char *name);
@@ -0,0 +1,3638 @@
+#include "cc.h"
+
+// intermediate representation (-O2)
+// See ir.h for the overview.
+
+static IrFunc *ir_fn;
+static IrBlock *ir_current; // the block being built, or NULL after a jump
+static bool ir_unsupported;
+static bool ir_vectorize;
+static Vector *ir_vec_loops; // Vector<VecLoop*>, the loops for the report
+
+static void list_remove(Vector *vector, int index) {
+  for (int i = index; i < vector->length - 1; i++) {
+    vector->buffer[i] = vector->buffer[i + 1];
+  }
+  vector_pop(vector);
+}
+
+static int list_find(Vector *vector, void *value) {
+  for (int i = 0; i < vector->length; i++) {
+    if (vector->buffer[i] == value) return i;
+  }
+  return -1;
+}
+
+static int list_geti(Vector *vector, int index) {
+  return (int) (intptr_t) vector->buffer[index];
+}
+
+static void list_seti(Vector *vector, int index, int value) {
+  vector->buffer[index] = (void *) (intptr_t) value;
+}
+
+static bool check_imm32(unsigned long long value) {
+  return value + 0x80000000 <= 0xffffffff;
+}
+
+// the value truncated to the size.
+static unsigned long long ir_trunc(unsigned long long value, int size) {
+  if (size == 8) return value;
+  return value & ((1ULL << (size * 8)) - 1);
+}
+
+// the value sign-extended from the size.
+static long ir_sext(unsigned long long value, int size) {
+  if (size == 8) return value;
+  int bits = 64 - size * 8;
+  return (long) (value << bits) >> bits;
+}
+
+// blocks and instructions
+
+static IrBlock *block_new(void) {
+  IrBlock *block = arena_alloc(ARENA_GEN, sizeof(IrBlock));
+  block->id = ir_fn->blocks->length;
+  block->insts = vector_new();
+  block->preds = vector_new();
+  block->succs = vector_new();
+  vector_push(ir_fn->blocks, block);
+  return block;
+}
+
+static IrInst *inst_new(IrOp op, int size) {
+  IrInst *inst = arena_alloc(ARENA_GEN, sizeof(IrInst));
+  inst->op = op;
+  inst->size = size;
+  inst->dest = -1;
+  inst->ops[0] = -1;
+  inst->ops[1] = -1;
+  inst->ops[2] = -1;
+  return inst;
+}
+
+static int vreg_new(IrFunc *fn) {
+  return fn->vregs++;
+}
+
+static IrInst *block_last(IrBlock *block) {
+  if (block->insts->length == 0) return NULL;
+  return vector_last(block->insts);
+}
+
+static bool check_terminator(IrInst *inst) {
+  return inst && IR_JMP <= inst->op && inst->op <= IR_UNREACHABLE;
+}
+
+static void edge_add(IrBlock *from, IrBlock *to) {
+  vector_push(from->succs, to);
+  vector_push(to->preds, from);
+}
+
+// remove the index-th predecessor of the block with the arguments of phi.
+static void pred_remove(IrBlock *block, int index) {
+  list_remove(block->preds, index);
+  for (int i = 0; i < block->insts->length; i++) {
+    IrInst *inst = block->insts->buffer[i];
+    if (inst->op != IR_PHI) break;
+    list_remove(inst->args, index);
+  }
+}
+
+static bool check_phis(IrBlock *block) {
+  IrInst *first = block->insts->length > 0 ? block->insts->buffer[0] : NULL;
+  return first && first->op == IR_PHI;
+}
+
+// construction
+// The syntax tree is lowered in the order of the source code. The local
+// variables are accessed by loads and stores, and the temporaries of the
+// logical and conditional operators are the fresh local variables,
+// which are always turned into vregs by mem2reg.
+
+static IrInst *build_inst(IrInst *inst) {
+  if (!ir_current) {
+    ir_current = block_new(); // unreachable
+  }
+  vector_push(ir_current->insts, inst);
+  return inst;
+}
+
+static int build_value(IrInst *inst) {
+  inst->dest = vreg_new(ir_fn);
+  build_inst(inst);
+  return inst->dest;
+}
+
+static int build_const(unsigned long long value, int size) {
+  IrInst *inst = inst_new(IR_CONST, size);
+  inst->imm = ir_trunc(value, size);
+  return build_value(inst);
+}
+
+static int build_unary(IrOp op, int size, int operand) {
+  IrInst *inst = inst_new(op, size);
+  inst->ops[0] = operand;
+  return build_value(inst);
+}
+
+static int build_binary(IrOp op, int size, int lhs, int rhs) {
+  IrInst *inst = inst_new(op, size);
+  inst->ops[0] = lhs;
+  inst->ops[1] = rhs;
+  return build_value(inst);
+}
+
+static int build_ext(int value, int from, bool sign, int size) {
+  IrInst *inst = inst_new(IR_EXT, size);
+  inst->ops[0] = value;
+  inst->imm = from;
+  inst->sign = sign;
+  return build_value(inst);
+}
+
+static int build_cmp(StmtType cc, int size, int lhs, int rhs) {
+  IrInst *inst = inst_new(IR_CMP, size);
+  inst->ops[0] = lhs;
+  inst->ops[1] = rhs;
+  inst->cc = cc;
+  inst = build_inst(inst);
+  inst->dest = vreg_new(ir_fn);
+  return inst->dest;
+}
+
+static void build_terminator(IrInst *inst) {
+  build_inst(inst);
+  ir_current = NULL;
+}
+
+static void build_jump(IrBlock *target) {
+  if (!ir_current) return; // unreachable
+  IrBlock *block = ir_current;
+  build_terminator(inst_new(IR_JMP, 0));
+  edge_add(block, target);
+}
+
+static void build_branch(int cond, int size, IrBlock *then_block, IrBlock *else_block) {
+  IrInst *inst = inst_new(IR_BR, size);
+  inst->ops[0] = cond;
+  build_inst(inst);
+  IrBlock *block = ir_current;
+  ir_current = NULL;
+  edge_add(block, then_block);
+  edge_add(block, else_block);
+}
+
+// the code falls through to the block.
+static void build_label(IrBlock *block) {
+  build_jump(block);
+  ir_current = block;
+}
+
+static bool check_signed(Type *type) {
+  TypeType ty_type = type->ty_type;
+  return ty_type == TY_CHAR || ty_type == TY_SHORT || ty_type == TY_INT || ty_type == TY_LONG;
+}
+
+// the scalar types which are held in a vreg.
+static bool check_scalar(Type *type) {
+  TypeType ty_type = type->ty_type;
+  if (TY_BOOL <= ty_type && ty_type <= TY_ULONG) return true;
+  return ty_type == TY_POINTER && type == type->original;
+}
+
+static Symbol *build_temp(Type *type) {
+  Symbol *symbol = arena_alloc(ARENA_GEN, sizeof(Symbol));
+  symbol->sy_type = SY_VARIABLE;
+  symbol->identifier = "tmp";
+  symbol->type = type;
+  symbol->link = LN_NONE;
+  return symbol;
+}
+
+static int build_address(Symbol *symbol) {
+  IrInst *inst = inst_new(symbol->link == LN_NONE ? IR_LOCAL : IR_GLOBAL, 8);
+  inst->symbol = symbol;
+  return build_value(inst);
+}
+
+// the value of the object at the address.
+// an array is converted to its address, and a struct can not be loaded.
+static int build_load(int base, int disp, Type *type) {
+  if (type->ty_type == TY_STRUCT || type->ty_type == TY_VOID) {
+    ir_unsupported = true;
+    return build_const(0, 8);
+  }
+  if (!check_scalar(type)) {
+    if (disp == 0) return base;
+    return build_binary(IR_ADD, 8, base, build_const(disp, 8));
+  }
+
+  IrInst *inst = inst_new(IR_LOAD, type->size);
+  inst->ops[0] = base;
+  inst->disp = disp;
+  return build_value(inst);
+}
+
+static void build_store(int base, int disp, int value, Type *type) {
+  if (!check_scalar(type)) {
+    ir_unsupported = true;
+    return;
+  }
+
+  IrInst *inst = inst_new(IR_STORE, type->size);
+  inst->ops[0] = base;
+  inst->ops[2] = value;
+  inst->disp = disp;
+  build_inst(inst);
+}
+
+static int build_expr(Expr *expr);
+static void build_cond(Expr *cond, IrBlock *then_block, IrBlock *else_block);
+
+// the address of the lvalue is base + disp.
+static int build_lvalue(Expr *expr, int *disp) {
+  switch (expr->nd_type) {
+    case ND_IDENTIFIER: {
+      return build_address(expr->symbol);
+    }
+    case ND_INDIRECT: {
+      return build_expr(expr->expr);
+    }
+    case ND_DOT: {
+      int base = build_lvalue(expr->expr, disp);
+      *disp = *disp + expr->offset;
+      return base;
+    }
+    default: {
+      ir_unsupported = true;
+      return build_const(0, 8);
+    }
+  }
+}
+
+static int build_identifier(Expr *expr) {
+  int disp = 0;
+  int base = build_lvalue(expr, &disp);
+  return build_load(base, disp, expr->type);
+}
+
+static int build_call(Expr *expr) {
+  Symbol *symbol = expr->expr->symbol;
+  if (!symbol) {
+    symbol = build_temp(expr->type);
+    symbol->identifier = expr->expr->identifier;
+  }
+
+  // the arguments are evaluated from the last one as -O0 does.
+  int n = expr->args->length;
+  Vector *args = vector_new();
+  for (int i = 0; i < n; i++) {
+    vector_pushi(args, -1);
+  }
+  for (int i = n - 1; i >= 0; i--) {
+    list_seti(args, i, build_expr(expr->args->buffer[i]));
+  }
+
+  IrInst *inst = inst_new(IR_CALL, expr->type->size);
+  inst->symbol = symbol;
+  inst->args = args;
+  inst->variadic = !expr->expr->symbol || expr->expr->symbol->type->ellipsis;
+  if (expr->type->ty_type == TY_STRUCT) {
+    ir_unsupported = true;
+  }
+  int value = -1;
+  if (expr->type->ty_type == TY_VOID) {
+    build_inst(inst);
+  } else {
+    value = build_value(inst);
+  }
+
+  // the code after the call is unreachable.
+  if (expr->expr->symbol && expr->expr->symbol->no_return) {
+    build_terminator(inst_new(IR_UNREACHABLE, 0));
+  }
+  return value;
+}
+
+static int build_cast(Expr *expr) {
+  Type *to = expr->type;
+  Type *from = expr->expr->type;
+  int value = build_expr(expr->expr);
+  if (to->ty_type == from->ty_type || to->ty_type == TY_VOID) return value;
+
+  if (to->ty_type == TY_BOOL) {
+    return build_cmp(ST_JNE, from->size, value, build_const(0, from->size));
+  }
+  if (to->size > from->size) {
+    return build_ext(value, from->size, check_signed(from), to->size);
+  }
+  return value;
+}
+
+// pointer +/- integer
+static int build_pointer(IrOp op, Expr *expr) {
+  int size = expr->lhs->type->pointer_to->size;
+  int lhs = build_expr(expr->lhs);
+  if (expr->rhs->nd_type == ND_INTEGER) {
+    return build_binary(op, 8, lhs, build_const(expr->rhs->int_value * size, 8));
+  }
+
+  int index = build_expr(expr->rhs);
+  if (expr->rhs->type->size < 8) {
+    index = build_ext(index, expr->rhs->type->size, check_signed(expr->rhs->type), 8);
+  }
+  int k = log2_exact(size);
+  if (k > 0) {
+    index = build_binary(IR_SHL, 8, index, build_const(k, 8));
+  } else if (k < 0) {
+    index = build_binary(IR_MUL, 8, index, build_const(size, 8));
+  }
+  return build_binary(op, 8, lhs, index);
+}
+
+static int build_arith(IrOp op, Expr *expr) {
+  if (expr->type->ty_type == TY_POINTER) {
+    return build_pointer(op, expr);
+  }
+
+  int lhs = build_expr(expr->lhs);
+  int rhs = build_expr(expr->rhs);
+  IrInst *inst = inst_new(op, expr->type->size);
+  inst->ops[0] = lhs;
+  inst->ops[1] = rhs;
+  inst->sign = check_signed(expr->type);
+  return build_value(inst);
+}
+
+static StmtType build_cc(Expr *expr) {
+  bool sign = check_signed(expr->lhs->type);
+  switch (expr->nd_type) {
+    case ND_LT: return sign ? ST_JL : ST_JB;
+    case ND_LTE: return sign ? ST_JLE : ST_JBE;
+    case ND_EQ: return ST_JE;
+    case ND_NEQ: return ST_JNE;
+    default: assert(false);
+  }
+}
+
+static int build_compare(Expr *expr) {
+  int lhs = build_expr(expr->lhs);
+  int rhs = build_expr(expr->rhs);
+  return build_cmp(build_cc(expr), expr->lhs->type->size, lhs, rhs);
+}
+
+// the value of the logical operators and the conditional operator
+// is merged through a temporary variable.
+static int build_logical(Expr *expr) {
+  Symbol *temp = build_temp(expr->type);
+  IrBlock *then_block = block_new();
+  IrBlock *else_block = block_new();
+  IrBlock *end_block = block_new();
+
+  Expr *cond = expr->nd_type == ND_CONDITION ? expr->cond : expr;
+  build_cond(cond, then_block, else_block);
+
+  ir_current = then_block;
+  int then_value = expr->nd_type == ND_CONDITION ? build_expr(expr->lhs) : build_const(1, 4);
+  build_store(build_address(temp), 0, then_value, temp->type);
+  build_jump(end_block);
+
+  ir_current = else_block;
+  int else_value = expr->nd_type == ND_CONDITION ? build_expr(expr->rhs) : build_const(0, 4);
+  build_store(build_address(temp), 0, else_value, temp->type);
+  build_jump(end_block);
+
+  ir_current = end_block;
+  return build_load(build_address(temp), 0, temp->type);
+}
+
+static int build_assign(Expr *expr) {
+  int disp = 0;
+  int base = build_lvalue(expr->lhs, &disp);
+  int value = build_expr(expr->rhs);
+  build_store(base, disp, value, expr->lhs->type);
+  return value;
+}
+
+// builtin functions
+// memcpy and memset of a constant size up to 64 bytes are expanded to
+// loads and stores, and the others are called. strcmp compares the first
+// characters inline, and calls the library function only if they are the
+// same and not null.
+
+#define BUILTIN_UNROLL 64
+
+static int build_libcall(char *identifier, Vector *args, Type *type) {
+  Symbol *symbol = build_temp(type);
+  symbol->identifier = identifier;
+
+  IrInst *inst = inst_new(IR_CALL, type->size);
+  inst->symbol = symbol;
+  inst->args = args;
+  return build_value(inst);
+}
+
+// the arguments are evaluated from the last one as calls.
+static Vector *build_builtin_args(Expr *expr) {
+  int n = expr->args->length;
+  Vector *args = vector_new();
+  for (int i = 0; i < n; i++) {
+    vector_pushi(args, -1);
+  }
+  for (int i = n - 1; i >= 0; i--) {
+    list_seti(args, i, build_expr(expr->args->buffer[i]));
+  }
+  return args;
+}
+
+// the value is stored to the size bytes at dest by the widest stores,
+// or the bytes at src are copied if value is -1.
+static void build_block(int dest, int src, int value, int size) {
+  for (int i = 0; i < size;) {
+    int width = size - i >= 8 ? 8 : size - i >= 4 ? 4 : size - i >= 2 ? 2 : 1;
+    int part = value;
+    if (value < 0) {
+      IrInst *load = inst_new(IR_LOAD, width);
+      load->ops[0] = src;
+      load->disp = i;
+      part = build_value(load);
+    }
+    IrInst *store = inst_new(IR_STORE, width);
+    store->ops[0] = dest;
+    store->ops[2] = part;
+    store->disp = i;
+    build_inst(store);
+    i += width;
+  }
+}
+
+static bool check_unroll(Expr *size) {
+  return size->nd_type == ND_INTEGER && size->int_value <= BUILTIN_UNROLL;
+}
+
+static int build_memcpy(Expr *expr) {
+  Vector *args = build_builtin_args(expr);
+  Expr *size = expr->args->buffer[2];
+  if (!check_unroll(size)) {
+    return build_libcall("memcpy", args, expr->type);
+  }
+  int dest = list_geti(args, 0);
+  build_block(dest, list_geti(args, 1), -1, size->int_value);
+  return dest;
+}
+
+// the byte is repeated in the 64-bit value.
+static int build_memset(Expr *expr) {
+  Vector *args = build_builtin_args(expr);
+  Expr *size = expr->args->buffer[2];
+  if (!check_unroll(size)) {
+    return build_libcall("memset", args, expr->type);
+  }
+  int byte = build_ext(list_geti(args, 1), 1, false, 8);
+  int value = build_binary(IR_MUL, 8, byte, build_const(0x0101010101010101, 8));
+  int dest = list_geti(args, 0);
+  build_block(dest, -1, value, size->int_value);
+  return dest;
+}
+
+static int build_strcmp(Expr *expr) {
+  Vector *args = build_builtin_args(expr);
+  Symbol *temp = build_temp(expr->type);
+  IrBlock *check_block = block_new();
+  IrBlock *call_block = block_new();
+  IrBlock *end_block = block_new();
+
+  IrInst *lhs = inst_new(IR_LOAD, 1);
+  lhs->ops[0] = list_geti(args, 0);
+  IrInst *rhs = inst_new(IR_LOAD, 1);
+  rhs->ops[0] = list_geti(args, 1);
+  int first = build_ext(build_value(rhs), 1, false, 4);
+  int diff = build_binary(IR_SUB, 4, build_ext(build_value(lhs), 1, false, 4), first);
+  build_store(build_address(temp), 0, diff, temp->type);
+  build_branch(diff, 4, end_block, check_block);
+
+  ir_current = check_block;
+  build_branch(first, 4, call_block, end_block);
+
+  ir_current = call_block;
+  int value = build_libcall("strcmp", args, expr->type);
+  build_store(build_address(temp), 0, value, temp->type);
+  build_jump(end_block);
+
+  ir_current = end_block;
+  return build_load(build_address(temp), 0, temp->type);
+}
+
+static int build_expr(Expr *expr) {
+  switch (expr->nd_type) {
+    case ND_IDENTIFIER: return build_identifier(expr);
+    case ND_INTEGER: return build_const(expr->int_value, expr->type->size);
+    case ND_STRING: {
+      IrInst *inst = inst_new(IR_STRING, 8);
+      inst->imm = expr->string_label;
+      return build_value(inst);
+    }
+    case ND_CALL: return build_call(expr);
+    case ND_MEMCPY: return build_memcpy(expr);
+    case ND_MEMSET: return build_memset(expr);
+    case ND_STRCMP: return build_strcmp(expr);
+    case ND_DOT:
+    case ND_INDIRECT: {
+      int disp = 0;
+      int base = build_lvalue(expr, &disp);
+      return build_load(base, disp, expr->type);
+    }
+    case ND_ADDRESS: {
+      int disp = 0;
+      int base = build_lvalue(expr->expr, &disp);
+      if (disp == 0) return base;
+      return build_binary(IR_ADD, 8, base, build_const(disp, 8));
+    }
+    case ND_UMINUS: return build_unary(IR_NEG, expr->type->size, build_expr(expr->expr));
+    case ND_NOT: return build_unary(IR_NOT, expr->type->size, build_expr(expr->expr));
+    case ND_LNOT: {
+      int size = expr->expr->type->size;
+      return build_cmp(ST_JE, size, build_expr(expr->expr), build_const(0, size));
+    }
+    case ND_CAST: return build_cast(expr);
+    case ND_MUL: return build_arith(IR_MUL, expr);
+    case ND_DIV: return build_arith(IR_DIV, expr);
+    case ND_MOD: return build_arith(IR_MOD, expr);
+    case ND_ADD: return build_arith(IR_ADD, expr);
+    case ND_SUB: return build_arith(IR_SUB, expr);
+    case ND_LSHIFT: return build_arith(IR_SHL, expr);
+    case ND_RSHIFT: return build_arith(check_signed(expr->type) ? IR_SAR : IR_SHR, expr);
+    case ND_LT:
+    case ND_LTE:
+    case ND_EQ:
+    case ND_NEQ: return build_compare(expr);
+    case ND_AND: return build_arith(IR_AND, expr);
+    case ND_XOR: return build_arith(IR_XOR, expr);
+    case ND_OR: return build_arith(IR_OR, expr);
+    case ND_LAND:
+    case ND_LOR:
+    case ND_CONDITION: return build_logical(expr);
+    case ND_ASSIGN: return build_assign(expr);
+    case ND_COMMA: {
+      build_expr(expr->lhs);
+      return build_expr(expr->rhs);
+    }
+    default: {
+      // va_start, va_arg and va_end are left to -O0.
+      ir_unsupported = true;
+      return build_const(0, 8);
+    }
+  }
+}
+
+// jump to then_block if the condition is true, or else_block.
+static void build_cond(Expr *cond, IrBlock *then_block, IrBlock *else_block) {
+  switch (cond->nd_type) {
+    case ND_LT:
+    case ND_LTE:
+    case ND_EQ:
+    case ND_NEQ: {
+      build_branch(build_compare(cond), 4, then_block, else_block);
+      break;
+    }
+    case ND_LNOT: {
+      build_cond(cond->expr, else_block, then_block);
+      break;
+    }
+    case ND_LAND: {
+      IrBlock *rhs_block = block_new();
+      build_cond(cond->lhs, rhs_block, else_block);
+      ir_current = rhs_block;
+      build_cond(cond->rhs, then_block, else_block);
+      break;
+    }
+    case ND_LOR: {
+      IrBlock *rhs_block = block_new();
+      build_cond(cond->lhs, then_block, rhs_block);
+      ir_current = rhs_block;
+      build_cond(cond->rhs, then_block, else_block);
+      break;
+    }
+    case ND_INTEGER: {
+      build_jump(cond->int_value != 0 ? then_block : else_block);
+      break;
+    }
+    default: {
+      build_branch(build_expr(cond), cond->type->size, then_block, else_block);
+      break;
+    }
+  }
+}
+
+// the initializer list gives all elements of the array.
+static bool check_init_complete(Initializer *init) {
+  if (!init->list) return true;
+  if (init->list->length * init->type->array_of->size != init->type->size) return false;
+  for (int i = 0; i < init->list->length; i++) {
+    if (!check_init_complete(init->list->buffer[i])) return false;
+  }
+  return true;
+}
+
+// the zero elements are skipped if the variable is zero-filled.
+static void build_init(Symbol *symbol, Initializer *init, int offset, bool zeroed) {
+  if (init->list) {
+    int size = init->type->array_of->size;
+    for (int i = 0; i < init->list->length; i++) {
+      build_init(symbol, init->list->buffer[i], offset + size * i, zeroed);
+    }
+  } else if (init->expr) {
+    Expr *expr = init->expr->nd_type == ND_CAST ? init->expr->expr : init->expr;
+    if (zeroed && expr->nd_type == ND_INTEGER && expr->int_value == 0) return;
+    int value = build_expr(init->expr);
+    build_store(build_address(symbol), offset, value, init->expr->type);
+  }
+}
+
+static void build_decl(Decl *decl) {
+  for (int i = 0; i < decl->symbols->length; i++) {
+    Symbol *symbol = decl->symbols->buffer[i];
+    if (!symbol->definition || !symbol->init) continue;
+
+    // the elements which are missing in the initializer list are
+    // zero-filled at once, which is rounded up to 8 bytes in the frame.
+    bool zeroed = !check_init_complete(symbol->init);
+    if (zeroed) {
+      IrInst *inst = inst_new(IR_ZERO, 8);
+      inst->ops[0] = build_address(symbol);
+      inst->imm = (symbol->type->size + 7) / 8 * 8;
+      build_inst(inst);
+    }
+    build_init(symbol, symbol->init, 0, zeroed);
+  }
+}
+
+// the blocks of the statements are identified by the index in the function,
+// which is stored to the labels of the statement.
+static IrBlock *stmt_block(int id) {
+  return ir_fn->blocks->buffer[id];
+}
+
+static void build_stmt(Stmt *stmt);
+
+static void build_switch(Stmt *stmt) {
+  IrBlock *break_block = block_new();
+  stmt->label_break = break_block->id;
+
+  IrInst *inst = inst_new(IR_SWITCH, stmt->switch_cond->type->size);
+  inst->ops[0] = build_expr(stmt->switch_cond);
+  inst->sign = check_signed(stmt->switch_cond->type);
+  inst->cases = vector_new();
+  build_inst(inst);
+  IrBlock *block = ir_current;
+  ir_current = NULL;
+
+  IrBlock *default_block = break_block;
+  for (int i = 0; i < stmt->switch_cases->length; i++) {
+    Stmt *case_stmt = stmt->switch_cases->buffer[i];
+    IrBlock *case_block = block_new();
+    case_stmt->label_no = case_block->id;
+    if (case_stmt->nd_type == ND_CASE) {
+      vector_push(inst->cases, case_stmt);
+      edge_add(block, case_block);
+    } else {
+      default_block = case_block;
+    }
+  }
+  edge_add(block, default_block);
+
+  build_stmt(stmt->switch_body);
+  build_label(break_block);
+}
+
+// vectorization
+// The innermost counted loops of the following forms are vectorized with
+// SSE2, where the elements are 32-bit or 8-bit integers, i is a local
+// variable, and n and x are loop-invariant.
+//
+//   for (...; i < n; i++) a[i] = x;              fill
+//   for (...; i < n; i++) a[i] = b[i];           copy
+//   for (...; i < n; i++) a[i] = b[i] + c[i];    add (b[i] + x as well)
+//   for (...; i < n; i++) s += a[i];             sum (32-bit)
+//   for (...; i < n; i++) if (a[i] == x) break;  find (8-bit)
+//
+// The vector loop (IR_VECTOR) is placed before the loop, which is left as
+// the scalar epilogue for the rest of the elements. The invariant values
+// are the constants and the local variables whose addresses are not taken,
+// which are never changed by the stores to the elements.
+
+typedef struct {
+  char *reason; // why it is not vectorized, or NULL
+
+  IrVector kind;
+  int size;      // the size of the elements
+  Symbol *index; // i
+  Expr *bound;   // n
+  Expr *dest;    // a
+  Expr *lhs;     // b
+  Expr *rhs;     // c
+  Expr *value;   // x
+  Symbol *sum;   // s
+} VecLoop;
+
+static char *vec_names[] = { "fill", "copy", "add", "add", "sum", "find" };
+
+static bool vec_integer(Type *type) {
+  return TY_CHAR <= type->ty_type && type->ty_type <= TY_ULONG;
+}
+
+static bool vec_local(Symbol *symbol) {
+  return symbol->link == LN_NONE && !symbol->escape && check_scalar(symbol->type);
+}
+
+// the expression without the casts which keep the bits.
+static Expr *vec_same(Expr *expr) {
+  while (expr->nd_type == ND_CAST && vec_integer(expr->type) && vec_integer(expr->expr->type)) {
+    if (expr->type->size != expr->expr->type->size) break;
+    expr = expr->expr;
+  }
+  return expr;
+}
+
+// the expression without the casts which keep the low bytes of the size.
+static Expr *vec_low(Expr *expr, int size) {
+  while (expr->nd_type == ND_CAST && vec_integer(expr->type) && vec_integer(expr->expr->type)) {
+    if (expr->type->size < size || expr->expr->type->size < size) break;
+    expr = expr->expr;
+  }
+  return expr;
+}
+
+static bool vec_invariant(Expr *expr, VecLoop *loop) {
+  switch (expr->nd_type) {
+    case ND_INTEGER: return true;
+    case ND_IDENTIFIER: {
+      Symbol *symbol = expr->symbol;
+      if (symbol == loop->index || symbol == loop->sum) return false;
+      return vec_local(symbol) && vec_integer(symbol->type);
+    }
+    case ND_CAST: return vec_integer(expr->type) && vec_invariant(expr->expr, loop);
+    default: return false;
+  }
+}
+
+// the base address of the element a[i] of the size, or NULL.
+// a is an array or a local pointer whose address is not taken.
+static Expr *vec_element(Expr *expr, VecLoop *loop, int size) {
+  if (expr->nd_type != ND_INDIRECT || !vec_integer(expr->type) || expr->type->size != size) return NULL;
+  Expr *add = expr->expr;
+  if (add->nd_type != ND_ADD || add->type->ty_type != TY_POINTER) return NULL;
+
+  Expr *index = vec_same(add->rhs);
+  if (index->nd_type != ND_IDENTIFIER || index->symbol != loop->index) return NULL;
+
+  Expr *base = add->lhs;
+  if (base->nd_type != ND_IDENTIFIER) return NULL;
+  if (base->symbol->type->ty_type == TY_ARRAY) return base;
+  if (base->symbol->type->ty_type == TY_POINTER && vec_local(base->symbol)) return base;
+  return NULL;
+}
+
+// i + 1 (ND_ADD) or i - 1 (ND_SUB)
+static bool vec_unit(Expr *expr, NodeType nd_type, Symbol *index) {
+  expr = vec_same(expr);
+  if (expr->nd_type != nd_type) return false;
+  Expr *lhs = vec_same(expr->lhs);
+  Expr *rhs = vec_same(expr->rhs);
+  if (nd_type == ND_ADD && lhs->nd_type == ND_INTEGER) {
+    Expr *tmp = lhs;
+    lhs = rhs;
+    rhs = tmp;
+  }
+  if (lhs->nd_type != ND_IDENTIFIER || lhs->symbol != index) return false;
+  return rhs->nd_type == ND_INTEGER && rhs->int_value == 1;
+}
+
+// i++, ++i or i += 1, which are lowered to (i = i + 1, i - 1) or i = i + 1.
+// any other comma expression may write the symbols read by the loop.
+static bool vec_step(Expr *expr, Symbol *index) {
+  if (expr->nd_type == ND_COMMA) {
+    if (!vec_unit(expr->rhs, ND_SUB, index)) return false;
+    expr = expr->lhs;
+  }
+  if (expr->nd_type != ND_ASSIGN || expr->lhs->nd_type != ND_IDENTIFIER || expr->lhs->symbol != index) return false;
+  return vec_unit(expr->rhs, ND_ADD, index);
+}
+
+static bool vec_nested(Stmt *stmt) {
+  switch (stmt->nd_type) {
+    case ND_WHILE:
+    case ND_DO:
+    case ND_FOR:
+      return true;
+    case ND_COMP: {
+      for (int i = 0; i < stmt->block_items->length; i++) {
+        Node *item = stmt->block_items->buffer[i];
+        if (item->nd_type != ND_DECL && vec_nested((Stmt *) item)) return true;
+      }
+      return false;
+    }
+    case ND_IF: return vec_nested(stmt->then_body) || (stmt->else_body && vec_nested(stmt->else_body));
+    case ND_SWITCH: return vec_nested(stmt->switch_body);
+    case ND_LABEL: return vec_nested(stmt->label_stmt);
+    case ND_CASE: return vec_nested(stmt->case_stmt);
+    case ND_DEFAULT: return vec_nested(stmt->default_stmt);
+    default: return false;
+  }
+}
+
+// the statement in the blocks which have only one statement.
+static Stmt *vec_single(Stmt *stmt) {
+  while (stmt->nd_type == ND_COMP && stmt->block_items->length == 1) {
+    Node *item = stmt->block_items->buffer[0];
+    if (item->nd_type == ND_DECL) break;
+    stmt = (Stmt *) item;
+  }
+  return stmt;
+}
+
+// s += a[i]
+static char *vec_check_sum(Expr *assign, VecLoop *loop) {
+  Symbol *sum = assign->lhs->symbol;
+  if (!vec_local(sum) || !vec_integer(sum->type) || sum->type->size != 4 || sum == loop->index) {
+    return "accumulator is not a 32-bit local variable";
+  }
+  loop->kind = VEC_SUM;
+  loop->size = 4;
+  loop->sum = sum;
+
+  Expr *add = vec_low(assign->rhs, 4);
+  if (add->nd_type != ND_ADD) return "unsupported operation";
+  Expr *lhs = vec_low(add->lhs, 4);
+  Expr *rhs = vec_low(add->rhs, 4);
+  if (rhs->nd_type == ND_IDENTIFIER) {
+    Expr *tmp = lhs;
+    lhs = rhs;
+    rhs = tmp;
+  }
+  if (lhs->nd_type != ND_IDENTIFIER || lhs->symbol != sum) return "unsupported operation";
+
+  loop->dest = vec_element(rhs, loop, 4);
+  if (!loop->dest) return "operand is not an element of a 32-bit array";
+  return NULL;
+}
+
+// a[i] = x, a[i] = b[i], a[i] = b[i] + c[i] and a[i] = b[i] + x
+static char *vec_check_store(Expr *assign, VecLoop *loop) {
+  int size = assign->lhs->type->size;
+  if (!vec_integer(assign->lhs->type) || (size != 1 && size != 4)) {
+    return "elements are not 8-bit or 32-bit";
+  }
+  loop->size = size;
+  loop->dest = vec_element(assign->lhs, loop, size);
+  if (!loop->dest) return "destination is not an element of an array";
+
+  Expr *value = vec_low(assign->rhs, size);
+  if (vec_invariant(value, loop)) {
+    loop->kind = VEC_FILL;
+    loop->value = value;
+    return NULL;
+  }
+  loop->lhs = vec_element(value, loop, size);
+  if (loop->lhs) {
+    loop->kind = VEC_COPY;
+    return NULL;
+  }
+
+  if (value->nd_type != ND_ADD || !vec_integer(value->type)) return "unsupported operation";
+  Expr *lhs = vec_low(value->lhs, size);
+  Expr *rhs = vec_low(value->rhs, size);
+  if (!vec_element(lhs, loop, size)) {
+    Expr *tmp = lhs;
+    lhs = rhs;
+    rhs = tmp;
+  }
+  loop->lhs = vec_element(lhs, loop, size);
+  if (!loop->lhs) return "operand is not an element of the same size";
+  loop->rhs = vec_element(rhs, loop, size);
+  if (loop->rhs) {
+    loop->kind = VEC_ADD;
+    return NULL;
+  }
+  if (vec_invariant(rhs, loop)) {
+    loop->kind = VEC_ADD_SCALAR;
+    loop->value = rhs;
+    return NULL;
+  }
+  return "operand is not an element of the same size";
+}
+
+// if (a[i] == x) break;
+// x should be in the range of the elements, since they are compared as int.
+static char *vec_check_find(Stmt *stmt, VecLoop *loop) {
+  Expr *cond = stmt->if_cond;
+  if (stmt->else_body || vec_single(stmt->then_body)->nd_type != ND_BREAK || cond->nd_type != ND_EQ) {
+    return "unsupported statement";
+  }
+  loop->kind = VEC_FIND;
+  loop->size = 1;
+
+  Expr *elem = vec_same(cond->lhs);
+  Expr *value = vec_same(cond->rhs);
+  if (value->nd_type == ND_CAST && vec_element(value->expr, loop, 1)) {
+    Expr *tmp = elem;
+    elem = value;
+    value = tmp;
+  }
+  if (elem->nd_type != ND_CAST || elem->type->ty_type != TY_INT) return "unsupported condition";
+  loop->dest = vec_element(elem->expr, loop, 1);
+  if (!loop->dest) return "operand is not an element of an 8-bit array";
+
+  Type *type = elem->expr->type;
+  if (value->nd_type == ND_INTEGER) {
+    long x = ir_sext(value->int_value, value->type->size);
+    bool sign = check_signed(type);
+    if (x < (sign ? -128 : 0) || x > (sign ? 127 : 255)) return "value is out of the range of the elements";
+  } else if (value->nd_type != ND_CAST || value->expr->type->ty_type != type->ty_type || !vec_invariant(value, loop)) {
+    return "value is not an invariant of the element type";
+  }
+  loop->value = value;
+  return NULL;
+}
+
+// returns NULL if the loop is vectorized, or the reason why it is not.
+static char *vec_check(Stmt *stmt, VecLoop *loop) {
+  if (vec_nested(stmt->for_body)) return "not innermost";
+
+  Expr *cond = stmt->for_cond;
+  Expr *index = cond && cond->nd_type == ND_LT ? vec_same(cond->lhs) : NULL;
+  if (!index || index->nd_type != ND_IDENTIFIER) return "not a counted loop";
+  Symbol *symbol = index->symbol;
+  TypeType ty_type = symbol->type->ty_type;
+  if (!vec_local(symbol) || (ty_type != TY_INT && ty_type != TY_LONG)) {
+    return "induction variable is not a local int or long";
+  }
+  if (cond->lhs->type->size != symbol->type->size || !check_signed(cond->lhs->type)) {
+    return "not a counted loop";
+  }
+  loop->index = symbol;
+  if (!stmt->for_after || !vec_step(stmt->for_after, symbol)) return "not a unit stride";
+  if (!vec_invariant(cond->rhs, loop)) return "bound is not invariant";
+  loop->bound = cond->rhs;
+
+  Stmt *body = vec_single(stmt->for_body);
+  if (body->nd_type == ND_EXPR && body->expr && body->expr->nd_type == ND_ASSIGN) {
+    if (body->expr->lhs->nd_type == ND_IDENTIFIER) {
+      return vec_check_sum(body->expr, loop);
+    }
+    return vec_check_store(body->expr, loop);
+  }
+  if (body->nd_type == ND_IF) {
+    return vec_check_find(body, loop);
+  }
+  return "unsupported statement";
+}
+
+// i = i + (n - i) / lanes * lanes is the start of the epilogue,
+// and the vector loop is skipped if n - i < lanes.
+static void build_vector(Stmt *stmt) {
+  VecLoop *loop = arena_alloc(ARENA_GEN, sizeof(VecLoop));
+  loop->reason = vec_check(stmt, loop);
+  vector_push(ir_vec_loops, loop);
+  if (loop->reason) return;
+
+  int lanes = 16 / loop->size;
+  Type *type = loop->index->type;
+  int from = build_load(build_address(loop->index), 0, type);
+  int bound = build_expr(loop->bound);
+  if (type->size < 8) {
+    from = build_ext(from, type->size, true, 8);
+    bound = build_ext(bound, type->size, true, 8);
+  }
+  int count = build_binary(IR_SUB, 8, bound, from);
+
+  IrBlock *vector_block = block_new();
+  IrBlock *scalar_block = block_new();
+  build_branch(build_cmp(ST_JLE, 8, build_const(lanes, 8), count), 4, vector_block, scalar_block);
+
+  ir_current = vector_block;
+  int to = build_binary(IR_ADD, 8, from, build_binary(IR_AND, 8, count, build_const(-lanes, 8)));
+  IrInst *inst = inst_new(IR_VECTOR, loop->size);
+  inst->imm = loop->kind;
+  inst->args = vector_new();
+  vector_pushi(inst->args, from);
+  vector_pushi(inst->args, to);
+  vector_pushi(inst->args, build_expr(loop->dest));
+  if (loop->lhs) vector_pushi(inst->args, build_expr(loop->lhs));
+  if (loop->rhs) vector_pushi(inst->args, build_expr(loop->rhs));
+  if (loop->value) vector_pushi(inst->args, build_expr(loop->value));
+  int result = build_value(inst);
+
+  if (loop->kind == VEC_SUM) {
+    int sum = build_load(build_address(loop->sum), 0, loop->sum->type);
+    build_store(build_address(loop->sum), 0, build_binary(IR_ADD, 4, sum, result), loop->sum->type);
+    result = to;
+  }
+  build_store(build_address(loop->index), 0, result, type);
+  build_jump(scalar_block);
+  ir_current = scalar_block;
+}
+
+static void build_stmt(Stmt *stmt) {
+  switch (stmt->nd_type) {
+    case ND_LABEL: {
+      build_label(stmt_block(stmt->label_no));
+      build_stmt(stmt->label_stmt);
+      break;
+    }
+    case ND_CASE: {
+      build_label(stmt_block(stmt->label_no));
+      build_stmt(stmt->case_stmt);
+      break;
+    }
+    case ND_DEFAULT: {
+      build_label(stmt_block(stmt->label_no));
+      build_stmt(stmt->default_stmt);
+      break;
+    }
+    case ND_COMP: {
+      for (int i = 0; i < stmt->block_items->length; i++) {
+        Node *item = stmt->block_items->buffer[i];
+        if (item->nd_type == ND_DECL) {
+          build_decl((Decl *) item);
+        } else {
+          build_stmt((Stmt *) item);
+        }
+      }
+      break;
+    }
+    case ND_EXPR: {
+      if (stmt->expr) {
+        build_expr(stmt->expr);
+      }
+      break;
+    }
+    case ND_IF: {
+      IrBlock *then_block = block_new();
+      IrBlock *else_block = block_new();
+      IrBlock *end_block = stmt->else_body ? block_new() : else_block;
+      build_cond(stmt->if_cond, then_block, else_block);
+      ir_current = then_block;
+      build_stmt(stmt->then_body);
+      build_jump(end_block);
+      if (stmt->else_body) {
+        ir_current = else_block;
+        build_stmt(stmt->else_body);
+        build_jump(end_block);
+      }
+      ir_current = end_block;
+      break;
+    }
+    case ND_SWITCH: {
+      build_switch(stmt);
+      break;
+    }
+    case ND_WHILE: {
+      IrBlock *cond_block = block_new();
+      IrBlock *body_block = block_new();
+      IrBlock *break_block = block_new();
+      stmt->label_continue = cond_block->id;
+      stmt->label_break = break_block->id;
+      build_label(cond_block);
+      build_cond(stmt->while_cond, body_block, break_block);
+      ir_current = body_block;
+      build_stmt(stmt->while_body);
+      build_jump(cond_block);
+      ir_current = break_block;
+      break;
+    }
+    case ND_DO: {
+      IrBlock *body_block = block_new();
+      IrBlock *cond_block = block_new();
+      IrBlock *break_block = block_new();
+      stmt->label_continue = cond_block->id;
+      stmt->label_break = break_block->id;
+      build_label(body_block);
+      build_stmt(stmt->do_body);
+      build_label(cond_block);
+      build_cond(stmt->do_cond, body_block, break_block);
+      ir_current = break_block;
+      break;
+    }
+    case ND_FOR: {
+      if (stmt->for_init && stmt->for_init->nd_type == ND_DECL) {
+        build_decl((Decl *) stmt->for_init);
+      } else if (stmt->for_init) {
+        build_expr((Expr *) stmt->for_init);
+      }
+      if (ir_vectorize) {
+        build_vector(stmt);
+      }
+      IrBlock *cond_block = block_new();
+      IrBlock *body_block = block_new();
+      IrBlock *continue_block = block_new();
+      IrBlock *break_block = block_new();
+      stmt->label_continue = continue_block->id;
+      stmt->label_break = break_block->id;
+      build_label(cond_block);
+      if (stmt->for_cond) {
+        build_cond(stmt->for_cond, body_block, break_block);
+      } else {
+        build_jump(body_block);
+      }
+      ir_current = body_block;
+      build_stmt(stmt->for_body);
+      build_label(continue_block);
+      if (stmt->for_after) {
+        build_expr(stmt->for_after);
+      }
+      build_jump(cond_block);
+      ir_current = break_block;
+      break;
+    }
+    case ND_GOTO: {
+      build_jump(stmt_block(stmt->goto_target->label_no));
+      break;
+    }
+    case ND_CONTINUE: {
+      build_jump(stmt_block(stmt->continue_target->label_continue));
+      break;
+    }
+    case ND_BREAK: {
+      build_jump(stmt_block(stmt->break_target->label_break));
+      break;
+    }
+    case ND_RETURN: {
+      IrInst *inst = inst_new(IR_RET, 0);
+      if (stmt->ret_expr) {
+        inst->ops[0] = build_expr(stmt->ret_expr);
+        inst->size = stmt->ret_expr->type->size;
+      }
+      build_terminator(inst);
+      break;
+    }
+    default: assert(false);
+  }
+}
+
+// control flow graph
+
+// the reverse postorder of the reachable blocks.
+// the successors are visited from the last one, so that the first one
+// tends to follow the block, which is used as the layout.
+static Vector *cfg_order(IrFunc *fn) {
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    block->rpo = -1;
+  }
+
+  Vector *post = vector_new();
+  Vector *stack = vector_new();
+  Vector *next = vector_new();
+  IrBlock *entry = fn->blocks->buffer[0];
+  entry->rpo = 0;
+  vector_push(stack, entry);
+  vector_pushi(next, 0);
+  while (stack->length > 0) {
+    IrBlock *block = vector_last(stack);
+    int i = vector_lasti(next);
+    if (i < block->succs->length) {
+      list_seti(next, next->length - 1, i + 1);
+      IrBlock *succ = block->succs->buffer[block->succs->length - 1 - i];
+      if (succ->rpo < 0) {
+        succ->rpo = 0;
+        vector_push(stack, succ);
+        vector_pushi(next, 0);
+      }
+    } else {
+      vector_pop(stack);
+      vector_popi(next);
+      vector_push(post, block);
+    }
+  }
+
+  Vector *order = vector_new();
+  for (int i = post->length - 1; i >= 0; i--) {
+    IrBlock *block = post->buffer[i];
+    block->rpo = order->length;
+    vector_push(order, block);
+  }
+  return order;
+}
+
+// remove the blocks which are not reachable from the entry.
+static bool cfg_remove_unreachable(IrFunc *fn) {
+  cfg_order(fn);
+
+  Vector *blocks = vector_new();
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    if (block->rpo >= 0) {
+      block->id = blocks->length;
+      vector_push(blocks, block);
+      continue;
+    }
+    for (int j = 0; j < block->succs->length; j++) {
+      IrBlock *succ = block->succs->buffer[j];
+      int index = list_find(succ->preds, block);
+      if (index >= 0) {
+        pred_remove(succ, index);
+      }
+    }
+  }
+
+  bool changed = blocks->length != fn->blocks->length;
+  fn->blocks = blocks;
+  return changed;
+}
+
+// dominator tree
+// (Cooper, Harvey and Kennedy, A Simple, Fast Dominance Algorithm)
+
+static IrBlock *dom_intersect(IrBlock *a, IrBlock *b) {
+  while (a != b) {
+    while (a->rpo > b->rpo) a = a->idom;
+    while (b->rpo > a->rpo) b = b->idom;
+  }
+  return a;
+}
+
+static Vector *dom_compute(IrFunc *fn) {
+  Vector *order = cfg_order(fn);
+  for (int i = 0; i < order->length; i++) {
+    IrBlock *block = order->buffer[i];
+    block->idom = NULL;
+    block->children = vector_new();
+    block->frontier = vector_new();
+  }
+
+  IrBlock *entry = order->buffer[0];
+  entry->idom = entry;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 1; i < order->length; i++) {
+      IrBlock *block = order->buffer[i];
+      IrBlock *idom = NULL;
+      for (int j = 0; j < block->preds->length; j++) {
+        IrBlock *pred = block->preds->buffer[j];
+        if (!pred->idom) continue;
+        idom = idom ? dom_intersect(pred, idom) : pred;
+      }
+      if (block->idom != idom) {
+        block->idom = idom;
+        changed = true;
+      }
+    }
+  }
+
+  for (int i = 1; i < order->length; i++) {
+    IrBlock *block = order->buffer[i];
+    vector_push(block->idom->children, block);
+  }
+
+  // dominance frontier
+  for (int i = 0; i < order->length; i++) {
+    IrBlock *block = order->buffer[i];
+    if (block->preds->length < 2) continue;
+    for (int j = 0; j < block->preds->length; j++) {
+      IrBlock *runner = block->preds->buffer[j];
+      while (runner != block->idom) {
+        if (list_find(runner->frontier, block) < 0) {
+          vector_push(runner->frontier, block);
+        }
+        runner = runner->idom;
+      }
+    }
+  }
+
+  entry->idom = NULL;
+  return order;
+}
+
+// the definition of each vreg in SSA form
+static IrInst **ssa_defs(IrFunc *fn) {
+  IrInst **defs = arena_alloc(ARENA_GEN, sizeof(IrInst *) * (fn->vregs + 1));
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->dest >= 0) {
+        defs[inst->dest] = inst;
+      }
+    }
+  }
+  return defs;
+}
+
+// the number of uses of each vreg
+static int *ssa_uses(IrFunc *fn) {
+  int *uses = arena_alloc(ARENA_GEN, sizeof(int) * (fn->vregs + 1));
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      for (int k = 0; k < 3; k++) {
+        if (inst->ops[k] >= 0) uses[inst->ops[k]]++;
+      }
+      if (inst->args) {
+        for (int k = 0; k < inst->args->length; k++) {
+          int arg = list_geti(inst->args, k);
+          if (arg >= 0) uses[arg]++;
+        }
+      }
+    }
+  }
+  return uses;
+}
+
+// replace the operands by the map.
+static void ssa_replace(IrFunc *fn, int *map) {
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      for (int k = 0; k < 3; k++) {
+        if (inst->ops[k] >= 0) inst->ops[k] = map[inst->ops[k]];
+      }
+      if (inst->args) {
+        for (int k = 0; k < inst->args->length; k++) {
+          int arg = list_geti(inst->args, k);
+          if (arg >= 0) list_seti(inst->args, k, map[arg]);
+        }
+      }
+    }
+  }
+}
+
+// the map which replaces each vreg by itself
+static int *ssa_identity(IrFunc *fn) {
+  int *map = arena_alloc(ARENA_GEN, sizeof(int) * (fn->vregs + 1));
+  for (int i = 0; i < fn->vregs; i++) {
+    map[i] = i;
+  }
+  return map;
+}
+
+static int ssa_find(int *map, int vreg) {
+  int root = vreg;
+  while (map[root] != root) root = map[root];
+  while (map[vreg] != root) {
+    int next = map[vreg];
+    map[vreg] = root;
+    vreg = next;
+  }
+  return root;
+}
+
+// remove the instructions which are replaced with nop.
+static void remove_nops(IrFunc *fn) {
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    int n = 0;
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->op != IR_NOP) {
+        block->insts->buffer[n++] = inst;
+      }
+    }
+    while (block->insts->length > n) {
+      vector_pop(block->insts);
+    }
+  }
+}
+
+// mem2reg
+// The scalar local variables which are accessed only by loads and stores
+// are turned into vregs. The phi functions are placed on the iterated
+// dominance frontier of the stores, and the loads are replaced with the
+// reaching definitions while walking the dominator tree.
+// (Cytron et al., Efficiently Computing Static Single Assignment Form)
+
+static Vector *m2r_vars;   // Vector<Symbol*>, the promoted variables
+static int *m2r_var;       // the variable of the address of each vreg, or -1
+static Vector **m2r_stack; // the reaching definitions of each variable
+static int *m2r_undef;     // the undefined value of each variable
+static Vector *m2r_consts; // Vector<IrInst*>, the undefined values
+
+static int m2r_index(Symbol *symbol) {
+  for (int i = 0; i < m2r_vars->length; i++) {
+    if (m2r_vars->buffer[i] == symbol) return i;
+  }
+  return -1;
+}
+
+// the variable accessed by the load or the store, or -1.
+static int m2r_access(IrInst *inst) {
+  if (inst->op != IR_LOAD && inst->op != IR_STORE) return -1;
+  return m2r_var[inst->ops[0]];
+}
+
+static int m2r_current(int var) {
+  Vector *stack = m2r_stack[var];
+  if (stack->length > 0) return vector_lasti(stack);
+
+  if (m2r_undef[var] < 0) {
+    Symbol *symbol = m2r_vars->buffer[var];
+    IrInst *inst = inst_new(IR_CONST, symbol->type->size);
+    inst->dest = vreg_new(ir_fn);
+    vector_push(m2r_consts, inst);
+    m2r_undef[var] = inst->dest;
+  }
+  return m2r_undef[var];
+}
+
+static void m2r_rename(IrBlock *block) {
+  Vector *pushed = vector_new();
+
+  for (int i = 0; i < block->insts->length; i++) {
+    IrInst *inst = block->insts->buffer[i];
+    if (inst->op == IR_PHI && inst->symbol) {
+      int var = m2r_index(inst->symbol);
+      vector_pushi(m2r_stack[var], inst->dest);
+      vector_pushi(pushed, var);
+      continue;
+    }
+
+    int var = m2r_access(inst);
+    if (var < 0) continue;
+    if (inst->op == IR_LOAD) {
+      inst->op = IR_COPY;
+      inst->ops[0] = m2r_current(var);
+    } else {
+      vector_pushi(m2r_stack[var], inst->ops[2]);
+      vector_pushi(pushed, var);
+      inst->op = IR_NOP;
+    }
+  }
+
+  for (int i = 0; i < block->succs->length; i++) {
+    IrBlock *succ = block->succs->buffer[i];
+    for (int j = 0; j < succ->preds->length; j++) {
+      if (succ->preds->buffer[j] != block) continue;
+      for (int k = 0; k < succ->insts->length; k++) {
+        IrInst *phi = succ->insts->buffer[k];
+        if (phi->op != IR_PHI) break;
+        if (!phi->symbol) continue;
+        list_seti(phi->args, j, m2r_current(m2r_index(phi->symbol)));
+      }
+    }
+  }
+
+  for (int i = 0; i < block->children->length; i++) {
+    m2r_rename(block->children->buffer[i]);
+  }
+
+  for (int i = 0; i < pushed->length; i++) {
+    vector_popi(m2r_stack[list_geti(pushed, i)]);
+  }
+}
+
+static void mem2reg(IrFunc *fn) {
+  dom_compute(fn);
+
+  // collect the local variables
+  m2r_vars = vector_new();
+  m2r_var = arena_alloc(ARENA_GEN, sizeof(int) * (fn->vregs + 1));
+  for (int i = 0; i < fn->vregs; i++) {
+    m2r_var[i] = -1;
+  }
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->op != IR_LOCAL || !check_scalar(inst->symbol->type)) continue;
+      int var = m2r_index(inst->symbol);
+      if (var < 0) {
+        var = m2r_vars->length;
+        vector_push(m2r_vars, inst->symbol);
+      }
+      m2r_var[inst->dest] = var;
+    }
+  }
+
+  // a variable is not promoted if its address is used otherwise.
+  int n = m2r_vars->length;
+  bool *promotable = arena_alloc(ARENA_GEN, sizeof(bool) * (n + 1));
+  for (int i = 0; i < n; i++) {
+    promotable[i] = true;
+  }
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      for (int k = 0; k < 3; k++) {
+        if (inst->ops[k] < 0 || m2r_var[inst->ops[k]] < 0) continue;
+        int var = m2r_var[inst->ops[k]];
+        Symbol *symbol = m2r_vars->buffer[var];
+        bool access = (inst->op == IR_LOAD || inst->op == IR_STORE) && k == 0;
+        if (!access || inst->ops[1] >= 0 || inst->disp != 0 || inst->size != symbol->type->size) {
+          promotable[var] = false;
+        }
+      }
+      if (inst->args) {
+        for (int k = 0; k < inst->args->length; k++) {
+          int arg = list_geti(inst->args, k);
+          if (m2r_var[arg] >= 0) promotable[m2r_var[arg]] = false;
+        }
+      }
+    }
+  }
+  for (int i = 0; i < fn->vregs; i++) {
+    if (m2r_var[i] >= 0 && !promotable[m2r_var[i]]) {
+      m2r_var[i] = -1;
+    }
+  }
+
+  // place phi functions
+  m2r_stack = arena_alloc(ARENA_GEN, sizeof(Vector *) * (n + 1));
+  m2r_undef = arena_alloc(ARENA_GEN, sizeof(int) * (n + 1));
+  m2r_consts = vector_new();
+  for (int var = 0; var < n; var++) {
+    m2r_stack[var] = vector_new();
+    m2r_undef[var] = -1;
+    if (!promotable[var]) continue;
+
+    Symbol *symbol = m2r_vars->buffer[var];
+    Vector *work = vector_new();
+    for (int i = 0; i < fn->blocks->length; i++) {
+      IrBlock *block = fn->blocks->buffer[i];
+      for (int j = 0; j < block->insts->length; j++) {
+        IrInst *inst = block->insts->buffer[j];
+        if (inst->op == IR_STORE && m2r_access(inst) == var) {
+          vector_push(work, block);
+          break;
+        }
+      }
+    }
+
+    Vector *placed = vector_new();
+    while (work->length > 0) {
+      IrBlock *block = vector_pop(work);
+      for (int i = 0; i < block->frontier->length; i++) {
+        IrBlock *join = block->frontier->buffer[i];
+        if (list_find(placed, join) >= 0) continue;
+        vector_push(placed, join);
+        vector_push(work, join);
+
+        IrInst *phi = inst_new(IR_PHI, symbol->type->size);
+        phi->dest = vreg_new(fn);
+        phi->symbol = symbol;
+        phi->args = vector_new();
+        for (int j = 0; j < join->preds->length; j++) {
+          vector_pushi(phi->args, -1);
+        }
+        vector_push(join->insts, NULL);
+        for (int j = join->insts->length - 1; j > 0; j--) {
+          join->insts->buffer[j] = join->insts->buffer[j - 1];
+        }
+        join->insts->buffer[0] = phi;
+      }
+    }
+  }
+
+  m2r_rename(fn->blocks->buffer[0]);
+
+  // the undefined values are defined after the parameters.
+  IrBlock *entry = fn->blocks->buffer[0];
+  int params = 0;
+  while (params < entry->insts->length && ((IrInst *) entry->insts->buffer[params])->op == IR_PARAM) {
+    params++;
+  }
+  Vector *insts = vector_new();
+  for (int i = 0; i < entry->insts->length; i++) {
+    if (i == params) vector_merge(insts, m2r_consts);
+    vector_push(insts, entry->insts->buffer[i]);
+  }
+  entry->insts = insts;
+
+  remove_nops(fn);
+}
+
+// prints the for loops of the function in the order of the source,
+// since the locations are released before the code generation.
+static void vec_report(Func *func) {
+  for (int i = 0; i < ir_vec_loops->length; i++) {
+    VecLoop *loop = ir_vec_loops->buffer[i];
+    char *name = func->symbol->identifier;
+    if (loop->reason) {
+      fprintf(stderr, "%s: loop %d: not vectorized (%s)\n", name, i + 1, loop->reason);
+    } else {
+      fprintf(stderr, "%s: loop %d: vectorized (%s, %d x %d-bit)\n", name, i + 1, vec_names[loop->kind], 16 / loop->size, loop->size * 8);
+    }
+  }
+}
+
+IrFunc *ir_build(Func *func, bool vectorize, bool report) {
+  Type *type = func->symbol->type;
+  if (type->ellipsis || type->returning->ty_type == TY_STRUCT) return NULL;
+
+  IrFunc *fn = arena_alloc(ARENA_GEN, sizeof(IrFunc));
+  fn->func = func;
+  fn->blocks = vector_new();
+  ir_fn = fn;
+  ir_unsupported = false;
+  ir_vectorize = vectorize;
+  ir_vec_loops = vector_new();
+
+  ir_current = block_new();
+  for (int i = 0; i < func->label_stmts->length; i++) {
+    Stmt *label_stmt = func->label_stmts->buffer[i];
+    label_stmt->label_no = block_new()->id;
+  }
+
+  // the parameters are stored to the local variables.
+  Vector *params = vector_new();
+  for (int i = 0; i < type->params->length; i++) {
+    IrInst *inst = inst_new(IR_PARAM, 8);
+    inst->imm = i;
+    vector_pushi(params, build_value(inst));
+  }
+  for (int i = 0; i < type->params->length; i++) {
+    Symbol *param = type->params->buffer[i];
+    build_store(build_address(param), 0, list_geti(params, i), param->type);
+  }
+
+  build_stmt(func->body);
+
+  // main returns 0 if it reaches the end.
+  if (ir_current) {
+    IrInst *inst = inst_new(IR_RET, 0);
+    if (strcmp(func->symbol->identifier, "main") == 0) {
+      inst->ops[0] = build_const(0, 4);
+      inst->size = 4;
+    }
+    build_terminator(inst);
+  }
+
+  if (ir_unsupported) {
+    for (int i = 0; i < ir_vec_loops->length; i++) {
+      VecLoop *loop = ir_vec_loops->buffer[i];
+      loop->reason = "function is not compiled with the IR";
+    }
+  }
+  if (report) {
+    vec_report(func);
+  }
+  if (ir_unsupported) return NULL;
+
+  cfg_remove_unreachable(fn);
+  mem2reg(fn);
+  return fn;
+}
+
+// dead code elimination
+// The instructions which have side effects are live, and so are the
+// definitions of the operands of the live instructions.
+
+static bool check_effect(IrInst *inst) {
+  return inst->op == IR_STORE || inst->op == IR_ZERO || inst->op == IR_CALL || inst->op == IR_VECTOR || check_terminator(inst);
+}
+
+static bool pass_dce(IrFunc *fn) {
+  IrInst **defs = ssa_defs(fn);
+  bool *live = arena_alloc(ARENA_GEN, sizeof(bool) * (fn->vregs + 1));
+  Vector *work = vector_new();
+
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (check_effect(inst)) {
+        vector_push(work, inst);
+      }
+    }
+  }
+
+  while (work->length > 0) {
+    IrInst *inst = vector_pop(work);
+    for (int k = 0; k < 3; k++) {
+      int vreg = inst->ops[k];
+      if (vreg >= 0 && !live[vreg]) {
+        live[vreg] = true;
+        vector_push(work, defs[vreg]);
+      }
+    }
+    if (inst->args) {
+      for (int k = 0; k < inst->args->length; k++) {
+        int vreg = list_geti(inst->args, k);
+        if (vreg >= 0 && !live[vreg]) {
+          live[vreg] = true;
+          vector_push(work, defs[vreg]);
+        }
+      }
+    }
+  }
+
+  bool changed = false;
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (!check_effect(inst) && !live[inst->dest]) {
+        inst->op = IR_NOP;
+        changed = true;
+      }
+    }
+  }
+  remove_nops(fn);
+  return changed;
+}
+
+// dead store elimination
+// The stores to a local variable are removed if its address, or an address
+// computed from it, is used only as the base address of the stores, since
+// the memory is never read.
+
+// the local variable whose address is computed by the instruction, or NULL.
+static Symbol *dse_address(IrInst *inst, Symbol **locals) {
+  switch (inst->op) {
+    case IR_LOCAL: return inst->symbol;
+    case IR_COPY: return locals[inst->ops[0]];
+    case IR_ADD: {
+      Symbol *lhs = locals[inst->ops[0]];
+      Symbol *rhs = locals[inst->ops[1]];
+      if (lhs && rhs) return NULL;
+      return lhs ? lhs : rhs;
+    }
+    case IR_SUB: return locals[inst->ops[1]] ? NULL : locals[inst->ops[0]];
+    default: return NULL;
+  }
+}
+
+static bool pass_dse(IrFunc *fn) {
+  Symbol **locals = arena_alloc(ARENA_GEN, sizeof(Symbol *) * (fn->vregs + 1));
+  bool grown = true;
+  while (grown) {
+    grown = false;
+    for (int i = 0; i < fn->blocks->length; i++) {
+      IrBlock *block = fn->blocks->buffer[i];
+      for (int j = 0; j < block->insts->length; j++) {
+        IrInst *inst = block->insts->buffer[j];
+        if (inst->dest < 0 || locals[inst->dest]) continue;
+        Symbol *symbol = dse_address(inst, locals);
+        if (symbol) {
+          locals[inst->dest] = symbol;
+          grown = true;
+        }
+      }
+    }
+  }
+
+  // the local variables whose addresses are used otherwise
+  Vector *read = vector_new();
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      for (int k = 0; k < 3; k++) {
+        int vreg = inst->ops[k];
+        if (vreg < 0 || !locals[vreg]) continue;
+        if ((inst->op == IR_STORE || inst->op == IR_ZERO) && k == 0) continue;
+        if (inst->dest >= 0 && locals[inst->dest] == locals[vreg]) continue;
+        vector_push(read, locals[vreg]);
+      }
+      if (inst->args) {
+        for (int k = 0; k < inst->args->length; k++) {
+          int vreg = list_geti(inst->args, k);
+          if (vreg >= 0 && locals[vreg]) {
+            vector_push(read, locals[vreg]);
+          }
+        }
+      }
+    }
+  }
+
+  bool changed = false;
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if ((inst->op != IR_STORE && inst->op != IR_ZERO) || !locals[inst->ops[0]]) continue;
+      if (list_find(read, locals[inst->ops[0]]) >= 0) continue;
+      inst->op = IR_NOP;
+      changed = true;
+    }
+  }
+  remove_nops(fn);
+  return changed;
+}
+
+// copy propagation
+// The uses of a copy are replaced with its source. A phi function whose
+// arguments are the same value except for itself is a copy too.
+
+static bool pass_copy_prop(IrFunc *fn) {
+  int *map = ssa_identity(fn);
+  bool changed = false;
+
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->op == IR_COPY) {
+        map[inst->dest] = inst->ops[0];
+        inst->op = IR_NOP;
+        changed = true;
+      } else if (inst->op == IR_PHI) {
+        int value = -1;
+        bool same = true;
+        for (int k = 0; k < inst->args->length; k++) {
+          int arg = list_geti(inst->args, k);
+          if (arg == inst->dest || arg == value) continue;
+          if (value >= 0) same = false;
+          value = arg;
+        }
+        if (same && value >= 0) {
+          map[inst->dest] = value;
+          inst->op = IR_NOP;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < fn->vregs; i++) {
+    ssa_find(map, i);
+  }
+  ssa_replace(fn, map);
+  remove_nops(fn);
+  return changed;
+}
+
+// global value numbering
+// The pure instructions are numbered by the hash of the operation and the
+// operands, and an instruction which computes the same value as another
+// one in a dominating block is removed. The table is scoped by the walk
+// of the dominator tree.
+
+static Vector **gvn_table;
+static int gvn_mask;
+static int *gvn_map;
+static IrInst **gvn_defs;
+static bool gvn_changed;
+
+static bool check_pure(IrInst *inst) {
+  switch (inst->op) {
+    case IR_CONST:
+    case IR_LOCAL:
+    case IR_GLOBAL:
+    case IR_STRING:
+    case IR_NEG:
+    case IR_NOT:
+    case IR_EXT:
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+    case IR_MOD:
+    case IR_AND:
+    case IR_OR:
+    case IR_XOR:
+    case IR_SHL:
+    case IR_SHR:
+    case IR_SAR:
+    case IR_CMP:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool check_commutative(IrInst *inst) {
+  switch (inst->op) {
+    case IR_ADD:
+    case IR_MUL:
+    case IR_AND:
+    case IR_OR:
+    case IR_XOR:
+      return true;
+    case IR_CMP:
+      return inst->cc == ST_JE || inst->cc == ST_JNE;
+    default:
+      return false;
+  }
+}
+
+static int gvn_hash(IrInst *inst) {
+  unsigned long long hash = inst->op;
+  hash = hash * 31 + inst->size;
+  hash = hash * 31 + inst->imm;
+  hash = hash * 31 + (unsigned long long) (intptr_t) inst->symbol;
+  hash = hash * 31 + inst->sign;
+  hash = hash * 31 + inst->cc;
+  hash = hash * 31 + inst->ops[0];
+  hash = hash * 31 + inst->ops[1];
+  return (int) ((hash ^ (hash >> 32)) & gvn_mask);
+}
+
+static bool gvn_equal(IrInst *a, IrInst *b) {
+  return a->op == b->op && a->size == b->size && a->imm == b->imm && a->symbol == b->symbol &&
+    a->sign == b->sign && a->cc == b->cc && a->ops[0] == b->ops[0] && a->ops[1] == b->ops[1];
+}
+
+static bool gvn_const(int vreg, unsigned long long *value) {
+  IrInst *def = gvn_defs[vreg];
+  if (!def || def->op != IR_CONST) return false;
+  *value = def->imm;
+  return true;
+}
+
+static bool gvn_compare(StmtType cc, unsigned long long lhs, unsigned long long rhs, int size) {
+  switch (cc) {
+    case ST_JE: return ir_trunc(lhs, size) == ir_trunc(rhs, size);
+    case ST_JNE: return ir_trunc(lhs, size) != ir_trunc(rhs, size);
+    case ST_JB: return ir_trunc(lhs, size) < ir_trunc(rhs, size);
+    case ST_JBE: return ir_trunc(lhs, size) <= ir_trunc(rhs, size);
+    case ST_JL: return ir_sext(lhs, size) < ir_sext(rhs, size);
+    case ST_JLE: return ir_sext(lhs, size) <= ir_sext(rhs, size);
+    default: assert(false);
+  }
+}
+
+// constant folding
+// the instruction whose operands are constants is replaced with a constant.
+static bool gvn_fold(IrInst *inst) {
+  unsigned long long lhs, rhs;
+  unsigned long long value;
+  int bits = inst->size * 8;
+
+  // x == x, x != x, x < x and x <= x
+  if (inst->op == IR_CMP && inst->ops[0] == inst->ops[1]) {
+    value = inst->cc == ST_JE || inst->cc == ST_JBE || inst->cc == ST_JLE;
+    inst->op = IR_CONST;
+    inst->size = 4;
+    inst->imm = value;
+    inst->ops[0] = -1;
+    inst->ops[1] = -1;
+    return true;
+  }
+
+  if (inst->ops[0] < 0 || !gvn_const(inst->ops[0], &lhs)) return false;
+  if (inst->ops[1] >= 0 && !gvn_const(inst->ops[1], &rhs)) return false;
+
+  switch (inst->op) {
+    case IR_NEG: value = 0 - lhs; break;
+    case IR_NOT: value = ~lhs; break;
+    case IR_EXT: value = inst->sign ? ir_sext(lhs, inst->imm) : ir_trunc(lhs, inst->imm); break;
+    case IR_ADD: value = lhs + rhs; break;
+    case IR_SUB: value = lhs - rhs; break;
+    case IR_MUL: value = lhs * rhs; break;
+    case IR_DIV:
+    case IR_MOD: {
+      if (ir_trunc(rhs, inst->size) == 0) return false;
+      if (inst->sign) {
+        long a = ir_sext(lhs, inst->size);
+        long b = ir_sext(rhs, inst->size);
+        if (b == -1) return false; // may overflow
+        value = inst->op == IR_DIV ? a / b : a % b;
+      } else {
+        unsigned long long a = ir_trunc(lhs, inst->size);
+        unsigned long long b = ir_trunc(rhs, inst->size);
+        value = inst->op == IR_DIV ? a / b : a % b;
+      }
+      break;
+    }
+    case IR_AND: value = lhs & rhs; break;
+    case IR_OR: value = lhs | rhs; break;
+    case IR_XOR: value = lhs ^ rhs; break;
+    case IR_SHL: value = lhs << (rhs & (bits - 1)); break;
+    case IR_SHR: value = ir_trunc(lhs, inst->size) >> (rhs & (bits - 1)); break;
+    case IR_SAR: value = ir_sext(lhs, inst->size) >> (rhs & (bits - 1)); break;
+    case IR_CMP: {
+      value = gvn_compare(inst->cc, lhs, rhs, inst->size);
+      inst->size = 4;
+      break;
+    }
+    default: return false;
+  }
+
+  inst->op = IR_CONST;
+  inst->imm = ir_trunc(value, inst->size);
+  inst->ops[0] = -1;
+  inst->ops[1] = -1;
+  inst->sign = false;
+  inst->cc = 0;
+  return true;
+}
+
+// x + 0, x - 0, x | 0, x ^ 0, x << 0, x >> 0 and x * 1 are x itself.
+// returns the operand, or -1.
+static int gvn_identity(IrInst *inst) {
+  unsigned long long value;
+  int lhs = inst->ops[0];
+  int rhs = inst->ops[1];
+  if (lhs < 0 || rhs < 0) return -1;
+  if (check_commutative(inst) && gvn_const(lhs, &value)) {
+    lhs = inst->ops[1];
+    rhs = inst->ops[0];
+  }
+  if (!gvn_const(rhs, &value)) return -1;
+  value = ir_trunc(value, inst->size);
+
+  switch (inst->op) {
+    case IR_ADD:
+    case IR_SUB:
+    case IR_OR:
+    case IR_XOR:
+    case IR_SHL:
+    case IR_SHR:
+    case IR_SAR:
+      return value == 0 ? lhs : -1;
+    case IR_MUL:
+      return value == 1 ? lhs : -1;
+    default:
+      return -1;
+  }
+}
+
+static void gvn_walk(IrBlock *block) {
+  Vector *pushed = vector_new(); // Vector<int>, the buckets
+
+  for (int i = 0; i < block->insts->length; i++) {
+    IrInst *inst = block->insts->buffer[i];
+    for (int k = 0; k < 3; k++) {
+      if (inst->ops[k] >= 0) inst->ops[k] = gvn_map[inst->ops[k]];
+    }
+    if (inst->args && inst->op != IR_PHI) {
+      for (int k = 0; k < inst->args->length; k++) {
+        list_seti(inst->args, k, gvn_map[list_geti(inst->args, k)]);
+      }
+    }
+    if (!check_pure(inst)) continue;
+    if (gvn_fold(inst)) {
+      gvn_changed = true;
+    }
+    int operand = gvn_identity(inst);
+    if (operand >= 0) {
+      gvn_map[inst->dest] = operand;
+      inst->op = IR_NOP;
+      gvn_changed = true;
+      continue;
+    }
+
+    // the operands are ordered by the number, but a constant is the last.
+    unsigned long long value;
+    bool lhs_const = inst->ops[0] >= 0 && gvn_const(inst->ops[0], &value);
+    bool rhs_const = inst->ops[1] >= 0 && gvn_const(inst->ops[1], &value);
+    bool swap = lhs_const != rhs_const ? lhs_const : inst->ops[0] > inst->ops[1];
+    if (check_commutative(inst) && swap) {
+      int tmp = inst->ops[0];
+      inst->ops[0] = inst->ops[1];
+      inst->ops[1] = tmp;
+    }
+
+    int hash = gvn_hash(inst);
+    if (!gvn_table[hash]) {
+      gvn_table[hash] = vector_new();
+    }
+    Vector *bucket = gvn_table[hash];
+    IrInst *found = NULL;
+    for (int j = 0; j < bucket->length && !found; j++) {
+      IrInst *other = bucket->buffer[j];
+      if (gvn_equal(inst, other)) found = other;
+    }
+    if (found) {
+      gvn_map[inst->dest] = found->dest;
+      inst->op = IR_NOP;
+      gvn_changed = true;
+    } else {
+      vector_push(bucket, inst);
+      vector_pushi(pushed, hash);
+    }
+  }
+
+  for (int i = 0; i < block->children->length; i++) {
+    gvn_walk(block->children->buffer[i]);
+  }
+
+  for (int i = pushed->length - 1; i >= 0; i--) {
+    vector_pop(gvn_table[list_geti(pushed, i)]);
+  }
+}
+
+static bool pass_gvn(IrFunc *fn) {
+  dom_compute(fn);
+
+  int insts = 0;
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    insts += block->insts->length;
+  }
+  int size = 64;
+  while (size < insts * 2) size = size * 2;
+  gvn_table = arena_alloc(ARENA_GEN, sizeof(Vector *) * size);
+  gvn_mask = size - 1;
+  gvn_map = ssa_identity(fn);
+  gvn_defs = ssa_defs(fn);
+  gvn_changed = false;
+
+  gvn_walk(fn->blocks->buffer[0]);
+
+  // the arguments of phi functions may be in the blocks not dominated.
+  ssa_replace(fn, gvn_map);
+  remove_nops(fn);
+  return gvn_changed;
+}
+
+// CFG simplification
+// The constant branches are folded, the unreachable blocks are removed,
+// a block is merged into its only predecessor, and the jumps to an empty
+// block are redirected to its successor.
+
+static bool cfg_fold_branches(IrFunc *fn, IrInst **defs) {
+  bool changed = false;
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    IrInst *inst = block_last(block);
+    if (inst->op != IR_BR) continue;
+
+    IrInst *cond = defs[inst->ops[0]];
+    int taken = -1;
+    if (block->succs->buffer[0] == block->succs->buffer[1]) {
+      taken = 0;
+    } else if (cond->op == IR_CONST) {
+      taken = ir_trunc(cond->imm, inst->size) != 0 ? 0 : 1;
+    }
+    if (taken < 0) continue;
+
+    IrBlock *removed = block->succs->buffer[1 - taken];
+    pred_remove(removed, list_find(removed->preds, block));
+    list_remove(block->succs, 1 - taken);
+    inst->op = IR_JMP;
+    inst->ops[0] = -1;
+    changed = true;
+  }
+  return changed;
+}
+
+// merge the block into the only predecessor which jumps to it.
+static bool cfg_merge(IrFunc *fn) {
+  bool changed = false;
+  for (int i = 1; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    if (block->preds->length != 1) continue;
+    IrBlock *pred = block->preds->buffer[0];
+    if (pred == block || pred->succs->length != 1) continue;
+
+    vector_pop(pred->insts);
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->op == IR_PHI) {
+        inst->op = IR_COPY;
+        inst->ops[0] = list_geti(inst->args, 0);
+        inst->args = NULL;
+      }
+      vector_push(pred->insts, inst);
+    }
+    pred->succs = block->succs;
+    for (int j = 0; j < block->succs->length; j++) {
+      IrBlock *succ = block->succs->buffer[j];
+      for (int k = 0; k < succ->preds->length; k++) {
+        if (succ->preds->buffer[k] == block) succ->preds->buffer[k] = pred;
+      }
+    }
+    block->preds = vector_new();
+    block->succs = vector_new();
+    block->insts = vector_new();
+    vector_push(block->insts, inst_new(IR_JMP, 0));
+    changed = true;
+  }
+  return changed;
+}
+
+// redirect the jumps to an empty block to its successor.
+static bool cfg_forward(IrFunc *fn) {
+  bool changed = false;
+  for (int i = 1; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    if (block->insts->length != 1 || block->succs->length != 1) continue;
+    IrBlock *succ = block->succs->buffer[0];
+    if (succ == block || check_phis(succ)) continue;
+
+    while (block->preds->length > 0) {
+      IrBlock *pred = vector_pop(block->preds);
+      for (int j = 0; j < pred->succs->length; j++) {
+        if (pred->succs->buffer[j] == block) {
+          pred->succs->buffer[j] = succ;
+          vector_push(succ->preds, pred);
+          break;
+        }
+      }
+    }
+    changed = true;
+  }
+  return changed;
+}
+
+static bool pass_simplify_cfg(IrFunc *fn) {
+  bool changed = false;
+  while (true) {
+    bool folded = cfg_fold_branches(fn, ssa_defs(fn));
+    bool removed = cfg_remove_unreachable(fn);
+    bool merged = cfg_merge(fn);
+    bool forwarded = cfg_forward(fn);
+    if (merged || forwarded) {
+      cfg_remove_unreachable(fn);
+    }
+    if (!folded && !removed && !merged && !forwarded) break;
+    changed = true;
+  }
+  return changed;
+}
+
+// loop optimization
+// A natural loop is formed by a back edge to a block (the header) which
+// dominates the source (the latch). The loops which have one latch and one
+// entry edge from the outside are optimized. The loop-invariant instructions
+// are hoisted to the preheader, a block on the entry edge, and the addresses
+// computed from an induction variable scaled by a constant are replaced with
+// pointers which are incremented by the scaled step (strength reduction).
+
+static bool check_remat(IrInst *inst);
+
+static IrBlock *loop_header;
+static IrBlock *loop_latch;
+static IrBlock *loop_entry; // the predecessor outside the loop
+static bool *loop_body;     // the blocks in the loop by the id
+static int loop_blocks;     // the number of blocks when the loop is found
+static IrInst **loop_defs;
+static IrBlock **loop_def_blocks; // the block of the definition of each vreg
+static int loop_vregs;            // the number of vregs when the loop is found
+
+// a dominates b.
+static bool dom_check(IrBlock *a, IrBlock *b) {
+  while (b && b != a) b = b->idom;
+  return b == a;
+}
+
+static bool loop_contains(IrBlock *block) {
+  return block->id < loop_blocks && loop_body[block->id];
+}
+
+// the definition of the vreg, or NULL if it is made by the optimization.
+static IrInst *loop_def(int vreg) {
+  if (vreg >= loop_vregs) return NULL;
+  return loop_defs[vreg];
+}
+
+static bool loop_invariant(int vreg) {
+  if (vreg >= loop_vregs) return false;
+  return !loop_contains(loop_def_blocks[vreg]);
+}
+
+static bool loop_const(int vreg, unsigned long long *value) {
+  IrInst *def = loop_def(vreg);
+  if (!def || def->op != IR_CONST) return false;
+  *value = def->imm;
+  return true;
+}
+
+// returns true if the header has one latch and one entry.
+// the blocks which reach the latch without passing through the header
+// form the body of the loop.
+static bool loop_find(IrFunc *fn, IrBlock *header) {
+  if (header->rpo < 0 || header->preds->length != 2) return false;
+  IrBlock *first = header->preds->buffer[0];
+  IrBlock *second = header->preds->buffer[1];
+  if (dom_check(header, first) == dom_check(header, second)) return false;
+
+  loop_header = header;
+  loop_latch = dom_check(header, first) ? first : second;
+  loop_entry = dom_check(header, first) ? second : first;
+
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    block->id = i;
+  }
+  loop_blocks = fn->blocks->length;
+  loop_body = arena_alloc(ARENA_GEN, sizeof(bool) * loop_blocks);
+  loop_body[header->id] = true;
+  Vector *stack = vector_new();
+  if (!loop_body[loop_latch->id]) {
+    loop_body[loop_latch->id] = true;
+    vector_push(stack, loop_latch);
+  }
+  while (stack->length > 0) {
+    IrBlock *block = vector_pop(stack);
+    for (int i = 0; i < block->preds->length; i++) {
+      IrBlock *pred = block->preds->buffer[i];
+      if (!loop_body[pred->id]) {
+        loop_body[pred->id] = true;
+        vector_push(stack, pred);
+      }
+    }
+  }
+
+  loop_vregs = fn->vregs;
+  loop_defs = ssa_defs(fn);
+  loop_def_blocks = arena_alloc(ARENA_GEN, sizeof(IrBlock *) * (fn->vregs + 1));
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->dest >= 0) {
+        loop_def_blocks[inst->dest] = block;
+      }
+    }
+  }
+  return true;
+}
+
+// the block on the entry edge, which is made if the entry has other successors.
+static IrBlock *loop_preheader(void) {
+  if (loop_entry->succs->length == 1) return loop_entry;
+
+  IrBlock *block = block_new();
+  vector_push(block->insts, inst_new(IR_JMP, 0));
+  loop_entry->succs->buffer[list_find(loop_entry->succs, loop_header)] = block;
+  loop_header->preds->buffer[list_find(loop_header->preds, loop_entry)] = block;
+  vector_push(block->preds, loop_entry);
+  vector_push(block->succs, loop_header);
+  loop_entry = block;
+  return block;
+}
+
+// insert the instruction before the terminator of the block, or before
+// the comparison for the branch so that they can be fused.
+static void loop_insert(IrBlock *block, IrInst *inst) {
+  int pos = block->insts->length - 1;
+  IrInst *terminator = block->insts->buffer[pos];
+  IrInst *cmp = pos > 0 ? block->insts->buffer[pos - 1] : NULL;
+  if (terminator->op == IR_BR && cmp && cmp->op == IR_CMP && cmp->dest == terminator->ops[0]) {
+    pos--;
+  }
+
+  vector_push(block->insts, NULL);
+  for (int i = block->insts->length - 1; i > pos; i--) {
+    block->insts->buffer[i] = block->insts->buffer[i - 1];
+  }
+  block->insts->buffer[pos] = inst;
+}
+
+// loop-invariant code motion
+// An instruction is invariant if its operands are defined outside the loop
+// or by invariant instructions. The division is not hoisted since it may
+// trap, and a load is hoisted only from the header, which is executed
+// whenever the loop is entered, if nothing is stored in the loop.
+
+static bool licm_check(IrInst *inst, IrBlock *block, bool memory, bool *hoisted) {
+  if (inst->dest < 0 || hoisted[inst->dest]) return false;
+  if (inst->op == IR_LOAD) {
+    if (memory || block != loop_header) return false;
+  } else if (!check_pure(inst) || inst->op == IR_DIV || inst->op == IR_MOD) {
+    return false;
+  }
+
+  for (int k = 0; k < 3; k++) {
+    int vreg = inst->ops[k];
+    if (vreg >= 0 && !loop_invariant(vreg) && !hoisted[vreg]) return false;
+  }
+  return true;
+}
+
+static bool licm_loop(IrFunc *fn) {
+  bool memory = false;
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    if (!loop_contains(block)) continue;
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->op == IR_STORE || inst->op == IR_ZERO || inst->op == IR_CALL || inst->op == IR_VECTOR) memory = true;
+    }
+  }
+
+  // the invariant instructions in the order of the dependencies.
+  // the constants and the addresses are hoisted only with the others.
+  bool *hoisted = arena_alloc(ARENA_GEN, sizeof(bool) * (fn->vregs + 1));
+  Vector *insts = vector_new();
+  bool useful = false;
+  bool grown = true;
+  while (grown) {
+    grown = false;
+    for (int i = 0; i < fn->blocks->length; i++) {
+      IrBlock *block = fn->blocks->buffer[i];
+      if (!loop_contains(block)) continue;
+      for (int j = 0; j < block->insts->length; j++) {
+        IrInst *inst = block->insts->buffer[j];
+        if (!licm_check(inst, block, memory, hoisted)) continue;
+        hoisted[inst->dest] = true;
+        vector_push(insts, inst);
+        if (!check_remat(inst)) useful = true;
+        grown = true;
+      }
+    }
+  }
+  if (!useful) return false;
+
+  IrBlock *preheader = loop_preheader();
+  for (int i = 0; i < insts->length; i++) {
+    IrInst *inst = insts->buffer[i];
+    IrInst *copy = inst_new(IR_NOP, 0);
+    memcpy(copy, inst, sizeof(IrInst));
+    loop_insert(preheader, copy);
+    inst->op = IR_NOP;
+  }
+  remove_nops(fn);
+  return true;
+}
+
+static bool pass_licm(IrFunc *fn) {
+  dom_compute(fn);
+
+  bool changed = false;
+  int blocks = fn->blocks->length;
+  for (int i = 0; i < blocks; i++) {
+    if (loop_find(fn, fn->blocks->buffer[i]) && licm_loop(fn)) {
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+// strength reduction
+// A basic induction variable is a phi function in the header which is
+// incremented by a constant step in each iteration. An address computed as
+// base + iv * scale, where the base is invariant and iv is extended to 8 bytes
+// if it is a signed int, becomes a new phi function p = base + init * scale
+// which is incremented by step * scale in the latch. The overflow of the
+// signed int is undefined, so that the extension commutes with the step.
+
+// the step of the basic induction variable, or 0.
+static long sr_step(IrInst *phi, int latch_index) {
+  int next = list_geti(phi->args, latch_index);
+  IrInst *inst = loop_def(next);
+  if (!inst || inst->size != phi->size || (phi->size != 4 && phi->size != 8)) return 0;
+
+  unsigned long long value;
+  if (inst->op == IR_ADD && inst->ops[0] == phi->dest && loop_const(inst->ops[1], &value)) {
+    return ir_sext(value, phi->size);
+  }
+  if (inst->op == IR_ADD && inst->ops[1] == phi->dest && loop_const(inst->ops[0], &value)) {
+    return ir_sext(value, phi->size);
+  }
+  if (inst->op == IR_SUB && inst->ops[0] == phi->dest && loop_const(inst->ops[1], &value)) {
+    return -ir_sext(value, phi->size);
+  }
+  return 0;
+}
+
+// the vreg is the induction variable as 8 bytes.
+static bool sr_index(int vreg, IrInst *iv) {
+  if (vreg == iv->dest) return iv->size == 8;
+  IrInst *ext = loop_def(vreg);
+  return ext && ext->op == IR_EXT && ext->sign && ext->imm == 4 && ext->size == 8 &&
+    iv->size == 4 && ext->ops[0] == iv->dest;
+}
+
+// the vreg is the induction variable multiplied by the scale.
+static bool sr_scaled(int vreg, IrInst *iv, long *scale) {
+  if (sr_index(vreg, iv)) {
+    *scale = 1;
+    return true;
+  }
+
+  IrInst *inst = loop_def(vreg);
+  if (!inst || inst->size != 8) return false;
+  unsigned long long value;
+  if (inst->op == IR_SHL && sr_index(inst->ops[0], iv) && loop_const(inst->ops[1], &value) && value < 32) {
+    *scale = 1;
+    for (int i = 0; i < value; i++) *scale = *scale * 2;
+    return true;
+  }
+  if (inst->op == IR_MUL && sr_index(inst->ops[0], iv) && loop_const(inst->ops[1], &value)) {
+    *scale = value;
+    return true;
+  }
+  if (inst->op == IR_MUL && sr_index(inst->ops[1], iv) && loop_const(inst->ops[0], &value)) {
+    *scale = value;
+    return true;
+  }
+  return false;
+}
+
+// the invariant base of the address, which is not a constant.
+// an address in the loop is computed again in the preheader.
+static bool sr_base(int vreg) {
+  IrInst *def = loop_def(vreg);
+  if (!def || def->op == IR_CONST) return false;
+  return loop_invariant(vreg) || check_remat(def);
+}
+
+static int sr_emit(IrFunc *fn, IrBlock *block, IrInst *inst) {
+  inst->dest = vreg_new(fn);
+  loop_insert(block, inst);
+  return inst->dest;
+}
+
+static int sr_const(IrFunc *fn, IrBlock *block, unsigned long long value) {
+  IrInst *inst = inst_new(IR_CONST, 8);
+  inst->imm = value;
+  return sr_emit(fn, block, inst);
+}
+
+// replace the address with a new induction variable.
+static void sr_reduce(IrFunc *fn, IrInst *addr, IrInst *iv, int base, long scale, long step) {
+  int entry_index = list_find(loop_header->preds, loop_entry);
+  IrBlock *preheader = loop_preheader();
+
+  // p = base + init * scale in the preheader
+  if (!loop_invariant(base)) {
+    IrInst *copy = inst_new(IR_NOP, 0);
+    memcpy(copy, loop_def(base), sizeof(IrInst));
+    base = sr_emit(fn, preheader, copy);
+  }
+  int index = list_geti(iv->args, entry_index);
+  unsigned long long value;
+  if (loop_const(index, &value)) {
+    index = ir_sext(value, iv->size) * scale == 0 ? -1 : sr_const(fn, preheader, ir_sext(value, iv->size) * scale);
+  } else {
+    if (iv->size == 4) {
+      IrInst *ext = inst_new(IR_EXT, 8);
+      ext->ops[0] = index;
+      ext->imm = 4;
+      ext->sign = true;
+      index = sr_emit(fn, preheader, ext);
+    }
+    if (scale != 1) {
+      int shift = log2_exact(scale);
+      IrInst *mul = inst_new(shift >= 0 ? IR_SHL : IR_MUL, 8);
+      mul->ops[0] = index;
+      mul->ops[1] = sr_const(fn, preheader, shift >= 0 ? shift : scale);
+      index = sr_emit(fn, preheader, mul);
+    }
+  }
+  int init = base;
+  if (index >= 0) {
+    IrInst *add = inst_new(IR_ADD, 8);
+    add->ops[0] = base;
+    add->ops[1] = index;
+    init = sr_emit(fn, preheader, add);
+  }
+
+  // p += step * scale in the latch
+  IrInst *phi = inst_new(IR_PHI, 8);
+  phi->dest = vreg_new(fn);
+  phi->args = vector_new();
+  IrInst *next = inst_new(IR_ADD, 8);
+  next->ops[0] = phi->dest;
+  next->ops[1] = sr_const(fn, loop_latch, step * scale);
+  sr_emit(fn, loop_latch, next);
+  for (int i = 0; i < loop_header->preds->length; i++) {
+    vector_pushi(phi->args, i == entry_index ? init : next->dest);
+  }
+  vector_push(loop_header->insts, NULL);
+  for (int i = loop_header->insts->length - 1; i > 0; i--) {
+    loop_header->insts->buffer[i] = loop_header->insts->buffer[i - 1];
+  }
+  loop_header->insts->buffer[0] = phi;
+
+  addr->op = IR_COPY;
+  addr->ops[0] = phi->dest;
+  addr->ops[1] = -1;
+}
+
+static bool sr_loop(IrFunc *fn) {
+  int latch_index = list_find(loop_header->preds, loop_latch);
+  Vector *ivs = vector_new();
+  Vector *steps = vector_new();
+  bool *nexts = arena_alloc(ARENA_GEN, sizeof(bool) * (fn->vregs + 1));
+  for (int i = 0; i < loop_header->insts->length; i++) {
+    IrInst *inst = loop_header->insts->buffer[i];
+    if (inst->op != IR_PHI) break;
+    nexts[list_geti(inst->args, latch_index)] = true;
+    long step = sr_step(inst, latch_index);
+    if (step != 0) {
+      vector_push(ivs, inst);
+      vector_push(steps, (void *) (intptr_t) step);
+    }
+  }
+  if (ivs->length == 0) return false;
+
+  bool changed = false;
+  for (int i = 0; i < loop_blocks; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    if (!loop_body[i]) continue;
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->op != IR_ADD || inst->size != 8 || inst->dest >= loop_vregs || nexts[inst->dest]) continue;
+
+      for (int k = 0; k < ivs->length; k++) {
+        IrInst *iv = ivs->buffer[k];
+        long step = (long) (intptr_t) steps->buffer[k];
+        long scale;
+        if (sr_base(inst->ops[0]) && sr_scaled(inst->ops[1], iv, &scale)) {
+          sr_reduce(fn, inst, iv, inst->ops[0], scale, step);
+        } else if (sr_base(inst->ops[1]) && sr_scaled(inst->ops[0], iv, &scale)) {
+          sr_reduce(fn, inst, iv, inst->ops[1], scale, step);
+        } else {
+          continue;
+        }
+        changed = true;
+        break;
+      }
+    }
+  }
+  return changed;
+}
+
+static bool pass_strength(IrFunc *fn) {
+  dom_compute(fn);
+
+  bool changed = false;
+  int blocks = fn->blocks->length;
+  for (int i = 0; i < blocks; i++) {
+    if (loop_find(fn, fn->blocks->buffer[i]) && sr_loop(fn)) {
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+// pass manager
+// The passes are applied in order until none of them changes the function.
+// (simplify-cfg, copy-prop, gvn, dce, dse, licm, strength reduction)
+
+#define PASSES 7
+#define PASS_ROUNDS 8
+
+static bool pass_run(IrFunc *fn, int pass) {
+  switch (pass) {
+    case 0: return pass_simplify_cfg(fn);
+    case 1: return pass_copy_prop(fn);
+    case 2: return pass_gvn(fn);
+    case 3: return pass_dce(fn);
+    case 4: return pass_dse(fn);
+    case 5: return pass_licm(fn);
+    case 6: return pass_strength(fn);
+    default: assert(false);
+  }
+}
+
+void ir_optimize(IrFunc *fn) {
+  ir_fn = fn;
+  for (int round = 0; round < PASS_ROUNDS; round++) {
+    bool changed = false;
+    for (int pass = 0; pass < PASSES; pass++) {
+      if (pass_run(fn, pass)) {
+        changed = true;
+      }
+    }
+    if (!changed) break;
+  }
+}
+
+// inlining
+// A call to a small function defined in the translation unit is replaced
+// with a copy of the optimized body of the callee. The parameters become
+// copies of the arguments, and the returns jump to the rest of the caller,
+// where a phi function merges the returned values. The local variables of
+// the callee which are left in memory are placed below those of the caller.
+// A function is not inlined into itself, and the calls in the inlined body
+// are not inlined again, so that the recursion is never expanded.
+
+#define INLINE_COST 16    // the cost of a function which is inlined
+#define INLINE_BONUS 8    // the extra cost allowed for a leaf or static function
+#define INLINE_LIMIT 1000 // the size of a function which is not grown any more
+
+static int inline_size(IrFunc *fn) {
+  int size = 0;
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    size += block->insts->length;
+  }
+  return size;
+}
+
+// the instructions except the parameters and the return
+// are counted as the cost of the function.
+static int inline_cost(IrFunc *fn, bool *leaf) {
+  int cost = 0;
+  *leaf = true;
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->op == IR_CALL) *leaf = false;
+      if (inst->op != IR_PARAM && inst->op != IR_RET) cost++;
+    }
+  }
+  return cost;
+}
+
+static IrFunc *inline_lookup(Vector *fns, Symbol *symbol) {
+  for (int i = 0; i < fns->length; i++) {
+    IrFunc *fn = fns->buffer[i];
+    if (fn && strcmp(fn->func->symbol->identifier, symbol->identifier) == 0) return fn;
+  }
+  return NULL;
+}
+
+// returns NULL if the call is inlined, or the reason why it is not.
+static char *inline_check(IrFunc *fn, IrInst *call, IrFunc *callee, int *cost) {
+  *cost = -1;
+  if (!callee) return "not defined";
+  if (call->variadic) return "not declared";
+  if (callee == fn) return "recursive";
+  if (call->args->length != callee->func->symbol->type->params->length) return "argument mismatch";
+
+  IrBlock *entry = callee->blocks->buffer[0];
+  if (entry->preds->length > 0) return "not supported";
+
+  bool leaf;
+  *cost = inline_cost(callee, &leaf);
+  int limit = INLINE_COST;
+  if (leaf) limit += INLINE_BONUS;
+  if (callee->func->symbol->link == LN_INTERNAL) limit += INLINE_BONUS;
+  if (*cost > limit) return "too large";
+  if (inline_size(fn) + *cost > INLINE_LIMIT) return "caller too large";
+  return NULL;
+}
+
+// the copy of the local variable with the offset in the frame of the caller.
+static Symbol *inline_local(Vector *locals, Vector *copies, Symbol *symbol, int shift) {
+  int index = list_find(locals, symbol);
+  if (index >= 0) return copies->buffer[index];
+
+  Symbol *copy = arena_alloc(ARENA_GEN, sizeof(Symbol));
+  memcpy(copy, symbol, sizeof(Symbol));
+  copy->offset = symbol->offset + shift;
+  vector_push(locals, symbol);
+  vector_push(copies, copy);
+  return copy;
+}
+
+// replace the index-th instruction of the block, which calls the callee.
+static void inline_call(IrFunc *fn, IrBlock *block, int index, IrFunc *callee) {
+  IrInst *call = block->insts->buffer[index];
+
+  // the instructions after the call are moved to a new block.
+  IrBlock *after = block_new();
+  for (int i = index + 1; i < block->insts->length; i++) {
+    vector_push(after->insts, block->insts->buffer[i]);
+  }
+  block->insts->length = index;
+  for (int i = 0; i < block->succs->length; i++) {
+    IrBlock *succ = block->succs->buffer[i];
+    succ->preds->buffer[list_find(succ->preds, block)] = after;
+    vector_push(after->succs, succ);
+  }
+  block->succs = vector_new();
+
+  // the local variables of the callee in memory are placed below the caller's.
+  bool memory = false;
+  for (int i = 0; i < callee->blocks->length; i++) {
+    IrBlock *callee_block = callee->blocks->buffer[i];
+    for (int j = 0; j < callee_block->insts->length; j++) {
+      IrInst *inst = callee_block->insts->buffer[j];
+      if (inst->op == IR_LOCAL) memory = true;
+    }
+  }
+  int shift = (fn->func->stack_size + 15) / 16 * 16;
+  if (memory) {
+    fn->func->stack_size = shift + callee->func->stack_size;
+  }
+  Vector *locals = vector_new();
+  Vector *copies = vector_new();
+
+  Vector *blocks = vector_new();
+  for (int i = 0; i < callee->blocks->length; i++) {
+    vector_push(blocks, block_new());
+  }
+  int base = fn->vregs;
+  fn->vregs += callee->vregs;
+
+  Vector *rets = vector_new(); // Vector<int>, the returned values
+  for (int i = 0; i < callee->blocks->length; i++) {
+    IrBlock *callee_block = callee->blocks->buffer[i];
+    IrBlock *copy = blocks->buffer[i];
+    for (int j = 0; j < callee_block->preds->length; j++) {
+      IrBlock *pred = callee_block->preds->buffer[j];
+      vector_push(copy->preds, blocks->buffer[list_find(callee->blocks, pred)]);
+    }
+    for (int j = 0; j < callee_block->succs->length; j++) {
+      IrBlock *succ = callee_block->succs->buffer[j];
+      vector_push(copy->succs, blocks->buffer[list_find(callee->blocks, succ)]);
+    }
+
+    for (int j = 0; j < callee_block->insts->length; j++) {
+      IrInst *inst = inst_new(IR_NOP, 0);
+      memcpy(inst, callee_block->insts->buffer[j], sizeof(IrInst));
+      if (inst->dest >= 0) inst->dest = base + inst->dest;
+      for (int k = 0; k < 3; k++) {
+        if (inst->ops[k] >= 0) inst->ops[k] = base + inst->ops[k];
+      }
+      if (inst->args) {
+        Vector *args = vector_new();
+        for (int k = 0; k < inst->args->length; k++) {
+          vector_pushi(args, base + list_geti(inst->args, k));
+        }
+        inst->args = args;
+      }
+
+      if (inst->op == IR_PARAM) {
+        inst->op = IR_COPY;
+        inst->ops[0] = list_geti(call->args, inst->imm);
+      } else if (inst->op == IR_LOCAL) {
+        inst->symbol = inline_local(locals, copies, inst->symbol, shift);
+      } else if (inst->op == IR_RET) {
+        // the returned value is undefined if the callee returns nothing.
+        if (call->dest >= 0 && inst->ops[0] < 0) {
+          IrInst *undef = inst_new(IR_CONST, call->size);
+          undef->dest = vreg_new(fn);
+          vector_push(copy->insts, undef);
+          vector_pushi(rets, undef->dest);
+        } else if (call->dest >= 0) {
+          vector_pushi(rets, inst->ops[0]);
+        }
+        inst = inst_new(IR_JMP, 0);
+        edge_add(copy, after);
+      }
+      vector_push(copy->insts, inst);
+    }
+  }
+
+  // the call is replaced with the jump to the body.
+  IrInst *jump = inst_new(IR_JMP, 0);
+  vector_push(block->insts, jump);
+  edge_add(block, blocks->buffer[0]);
+
+  // the returned value
+  if (call->dest >= 0) {
+    IrInst *inst;
+    if (rets->length == 0) {
+      inst = inst_new(IR_CONST, call->size);
+    } else if (rets->length == 1) {
+      inst = inst_new(IR_COPY, call->size);
+      inst->ops[0] = list_geti(rets, 0);
+    } else {
+      inst = inst_new(IR_PHI, call->size);
+      inst->args = rets;
+    }
+    inst->dest = call->dest;
+
+    Vector *insts = vector_new();
+    vector_push(insts, inst);
+    vector_merge(insts, after->insts);
+    after->insts = insts;
+  }
+}
+
+// returns true if some of the calls are inlined.
+bool ir_inline(IrFunc *fn, Vector *fns, bool report) {
+  ir_fn = fn;
+
+  // the calls in the original blocks are inlined, but not in the copies.
+  Vector *calls = vector_new();
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->op == IR_CALL) vector_push(calls, inst);
+    }
+  }
+
+  bool inlined = false;
+  for (int i = 0; i < calls->length; i++) {
+    IrInst *call = calls->buffer[i];
+    IrFunc *callee = inline_lookup(fns, call->symbol);
+    int cost;
+    char *reason = inline_check(fn, call, callee, &cost);
+    if (report) {
+      fprintf(stderr, "%s: %s: ", fn->func->symbol->identifier, call->symbol->identifier);
+      if (!reason) {
+        fprintf(stderr, "inlined (cost %d)\n", cost);
+      } else if (cost >= 0) {
+        fprintf(stderr, "not inlined (%s, cost %d)\n", reason, cost);
+      } else {
+        fprintf(stderr, "not inlined (%s)\n", reason);
+      }
+    }
+    if (reason) continue;
+
+    for (int j = 0; j < fn->blocks->length; j++) {
+      IrBlock *block = fn->blocks->buffer[j];
+      int index = list_find(block->insts, call);
+      if (index >= 0) {
+        inline_call(fn, block, index, callee);
+        break;
+      }
+    }
+    inlined = true;
+  }
+  if (!inlined) return false;
+
+  cfg_remove_unreachable(fn);
+  return true;
+}
+
+// lowering
+// The loads and stores take the address computations as the addressing
+// modes, the phi functions are replaced with copies in the predecessors,
+// and the vregs are allocated to registers by linear scan.
+
+// base + index << scale + disp
+static void lower_address(IrFunc *fn, IrInst **defs, int *uses) {
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if ((inst->op != IR_LOAD && inst->op != IR_STORE) || inst->ops[1] >= 0) continue;
+
+      IrInst *add = defs[inst->ops[0]];
+      if (add->op != IR_ADD || uses[add->dest] != 1) continue;
+      int base = add->ops[0];
+      int index = add->ops[1];
+      if (defs[base]->op == IR_CONST) {
+        base = add->ops[1];
+        index = add->ops[0];
+      }
+
+      IrInst *offset = defs[index];
+      if (offset->op == IR_CONST && check_imm32(offset->imm + inst->disp)) {
+        inst->ops[0] = base;
+        inst->disp = inst->disp + offset->imm;
+        add->op = IR_NOP;
+        continue;
+      }
+
+      IrInst *shift = defs[index];
+      if (shift->op == IR_SHL && uses[index] == 1 && defs[shift->ops[1]]->op == IR_CONST && defs[shift->ops[1]]->imm <= 3) {
+        inst->scale = defs[shift->ops[1]]->imm;
+        index = shift->ops[0];
+        shift->op = IR_NOP;
+      }
+      inst->ops[0] = base;
+      inst->ops[1] = index;
+      add->op = IR_NOP;
+    }
+  }
+  remove_nops(fn);
+}
+
+// the copies on an edge are inserted to a new block
+// if the predecessor has other successors.
+// the new block is placed after the predecessor.
+static void lower_split_edges(IrFunc *fn) {
+  Vector *blocks = vector_new();
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    block->id = blocks->length;
+    vector_push(blocks, block);
+    if (block->succs->length < 2) continue;
+
+    for (int j = 0; j < block->succs->length; j++) {
+      IrBlock *succ = block->succs->buffer[j];
+      if (!check_phis(succ)) continue;
+
+      IrBlock *edge = arena_alloc(ARENA_GEN, sizeof(IrBlock));
+      edge->id = blocks->length;
+      edge->insts = vector_new();
+      edge->preds = vector_new();
+      edge->succs = vector_new();
+      vector_push(edge->insts, inst_new(IR_JMP, 0));
+      vector_push(edge->preds, block);
+      vector_push(edge->succs, succ);
+      vector_push(blocks, edge);
+      block->succs->buffer[j] = edge;
+      succ->preds->buffer[list_find(succ->preds, block)] = edge;
+    }
+  }
+  fn->blocks = blocks;
+}
+
+// the parallel copies are sequentialized. a cycle is broken by a new vreg.
+static void lower_copies(IrFunc *fn, IrBlock *block, Vector *dests, Vector *srcs) {
+  IrInst *terminator = vector_pop(block->insts);
+  while (dests->length > 0) {
+    int found = -1;
+    for (int i = 0; i < dests->length && found < 0; i++) {
+      int dest = list_geti(dests, i);
+      bool blocked = false;
+      for (int j = 0; j < srcs->length; j++) {
+        if (j != i && list_geti(srcs, j) == dest) blocked = true;
+      }
+      if (!blocked) found = i;
+    }
+
+    if (found < 0) {
+      int dest = list_geti(dests, 0);
+      IrInst *save = inst_new(IR_COPY, 8);
+      save->dest = vreg_new(fn);
+      save->ops[0] = dest;
+      vector_push(block->insts, save);
+      for (int i = 0; i < srcs->length; i++) {
+        if (list_geti(srcs, i) == dest) list_seti(srcs, i, save->dest);
+      }
+      continue;
+    }
+
+    IrInst *copy = inst_new(IR_COPY, 8);
+    copy->dest = list_geti(dests, found);
+    copy->ops[0] = list_geti(srcs, found);
+    if (copy->dest != copy->ops[0]) {
+      vector_push(block->insts, copy);
+    }
+    list_remove(dests, found);
+    list_remove(srcs, found);
+  }
+  vector_push(block->insts, terminator);
+}
+
+static void lower_phis(IrFunc *fn) {
+  lower_split_edges(fn);
+
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    if (!check_phis(block)) continue;
+
+    for (int j = 0; j < block->preds->length; j++) {
+      Vector *dests = vector_new();
+      Vector *srcs = vector_new();
+      for (int k = 0; k < block->insts->length; k++) {
+        IrInst *phi = block->insts->buffer[k];
+        if (phi->op != IR_PHI) break;
+        vector_pushi(dests, phi->dest);
+        vector_pushi(srcs, list_geti(phi->args, j));
+      }
+      lower_copies(fn, block->preds->buffer[j], dests, srcs);
+    }
+
+    for (int k = 0; k < block->insts->length; k++) {
+      IrInst *phi = block->insts->buffer[k];
+      if (phi->op != IR_PHI) break;
+      phi->op = IR_NOP;
+    }
+  }
+  remove_nops(fn);
+}
+
+// a comparison is fused into the branch which follows it.
+static void lower_fuse(IrFunc *fn, int *uses) {
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    int n = block->insts->length;
+    if (n < 2) continue;
+    IrInst *branch = block->insts->buffer[n - 1];
+    IrInst *cmp = block->insts->buffer[n - 2];
+    if (branch->op == IR_BR && cmp->op == IR_CMP && cmp->dest == branch->ops[0] && uses[cmp->dest] == 1) {
+      cmp->fused = true;
+    }
+  }
+}
+
+// a constant or an address is computed where it is used,
+// instead of being held in a register.
+static bool check_remat(IrInst *inst) {
+  switch (inst->op) {
+    case IR_CONST:
+    case IR_LOCAL:
+    case IR_GLOBAL:
+    case IR_STRING:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// register allocation
+// The live range of a vreg is approximated by one interval, and the
+// intervals are allocated by linear scan. Each instruction i reads its
+// operands at 2i and writes its result at 2i + 1, so that the result can
+// be held in the register of an operand which dies there.
+// The vregs which live across a call are held in the callee-saved
+// registers, and the others prefer the caller-saved registers.
+// (Poletto and Sarkar, Linear Scan Register Allocation)
+
+// r10, r11, r8, r9, rsi, rdi
+#define CALLER_SIZE 6
+static RegCode caller_regs[CALLER_SIZE] = { 10, 11, 8, 9, 6, 7 };
+
+// rbx, r12, r13, r14, r15
+#define CALLEE_SIZE 5
+static RegCode callee_regs[CALLEE_SIZE] = { 3, 12, 13, 14, 15 };
+
+#define BIT(n) (1ULL << ((n) % 64))
+
+static void live_add(unsigned long long *set, int vreg) {
+  set[vreg / 64] = set[vreg / 64] | BIT(vreg);
+}
+
+static bool live_check(unsigned long long *set, int vreg) {
+  return (set[vreg / 64] & BIT(vreg)) != 0;
+}
+
+// liveness analysis on the blocks in the layout order
+static void lower_liveness(IrFunc *fn) {
+  int words = fn->vregs / 64 + 1;
+  int n = fn->blocks->length;
+  unsigned long long **gens = arena_alloc(ARENA_GEN, sizeof(unsigned long long *) * n);
+  unsigned long long **kills = arena_alloc(ARENA_GEN, sizeof(unsigned long long *) * n);
+
+  for (int i = 0; i < n; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    block->live_in = arena_alloc(ARENA_GEN, sizeof(unsigned long long) * words);
+    block->live_out = arena_alloc(ARENA_GEN, sizeof(unsigned long long) * words);
+    gens[i] = arena_alloc(ARENA_GEN, sizeof(unsigned long long) * words);
+    kills[i] = arena_alloc(ARENA_GEN, sizeof(unsigned long long) * words);
+
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      for (int k = 0; k < 3; k++) {
+        int vreg = inst->ops[k];
+        if (vreg >= 0 && !fn->remat[vreg] && !live_check(kills[i], vreg)) live_add(gens[i], vreg);
+      }
+      if (inst->args) {
+        for (int k = 0; k < inst->args->length; k++) {
+          int vreg = list_geti(inst->args, k);
+          if (!fn->remat[vreg] && !live_check(kills[i], vreg)) live_add(gens[i], vreg);
+        }
+      }
+      if (inst->dest >= 0) {
+        live_add(kills[i], inst->dest);
+      }
+    }
+  }
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = n - 1; i >= 0; i--) {
+      IrBlock *block = fn->blocks->buffer[i];
+      for (int w = 0; w < words; w++) {
+        unsigned long long out = 0;
+        for (int j = 0; j < block->succs->length; j++) {
+          IrBlock *succ = block->succs->buffer[j];
+          out = out | succ->live_in[w];
+        }
+        unsigned long long in = gens[i][w] | (out & ~kills[i][w]);
+        if (out != block->live_out[w] || in != block->live_in[w]) {
+          block->live_out[w] = out;
+          block->live_in[w] = in;
+          changed = true;
+        }
+      }
+    }
+  }
+}
+
+// copy coalescing
+// The source and the destination of a copy are merged into one vreg if
+// they do not interfere, so that the copy is removed. Two vregs interfere
+// if one of them is live after a definition of the other, except that the
+// source of a copy may be live after the copy.
+// (Chaitin, Register Allocation and Spilling via Graph Coloring)
+
+static Vector **co_defs;   // Vector<IrInst*>, the definitions of each vreg
+static Vector **co_blocks; // Vector<IrBlock*>, the blocks of the definitions
+
+static bool co_use(IrInst *inst, int vreg) {
+  for (int k = 0; k < 3; k++) {
+    if (inst->ops[k] == vreg) return true;
+  }
+  if (inst->args) {
+    for (int k = 0; k < inst->args->length; k++) {
+      if (list_geti(inst->args, k) == vreg) return true;
+    }
+  }
+  return false;
+}
+
+// returns true if the vreg is live after the instruction.
+static bool co_live_after(IrBlock *block, IrInst *def, int vreg) {
+  for (int i = list_find(block->insts, def) + 1; i < block->insts->length; i++) {
+    IrInst *inst = block->insts->buffer[i];
+    if (co_use(inst, vreg)) return true;
+    if (inst->dest == vreg) return false;
+  }
+  return live_check(block->live_out, vreg);
+}
+
+// returns true if a definition of a member of a interferes with b.
+static bool co_interfere(Vector *a, Vector *b) {
+  for (int i = 0; i < a->length; i++) {
+    int vreg = list_geti(a, i);
+    for (int j = 0; j < co_defs[vreg]->length; j++) {
+      IrInst *def = co_defs[vreg]->buffer[j];
+      IrBlock *block = co_blocks[vreg]->buffer[j];
+      for (int k = 0; k < b->length; k++) {
+        int other = list_geti(b, k);
+        if (def->op == IR_COPY && def->ops[0] == other) continue;
+        if (co_live_after(block, def, other)) return true;
+      }
+    }
+  }
+  return false;
+}
+
+static void lower_coalesce(IrFunc *fn) {
+  lower_liveness(fn);
+
+  int n = fn->vregs;
+  co_defs = arena_alloc(ARENA_GEN, sizeof(Vector *) * (n + 1));
+  co_blocks = arena_alloc(ARENA_GEN, sizeof(Vector *) * (n + 1));
+  for (int i = 0; i < n; i++) {
+    co_defs[i] = vector_new();
+    co_blocks[i] = vector_new();
+  }
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->dest >= 0) {
+        vector_push(co_defs[inst->dest], inst);
+        vector_push(co_blocks[inst->dest], block);
+      }
+    }
+  }
+
+  // the representative of each vreg, and the vregs merged into it
+  int *rep = arena_alloc(ARENA_GEN, sizeof(int) * (n + 1));
+  Vector **members = arena_alloc(ARENA_GEN, sizeof(Vector *) * (n + 1));
+  for (int i = 0; i < n; i++) {
+    rep[i] = i;
+    members[i] = vector_new();
+    vector_pushi(members[i], i);
+  }
+
+  bool merged = false;
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->op != IR_COPY || fn->remat[inst->ops[0]]) continue;
+      int dest = rep[inst->dest];
+      int src = rep[inst->ops[0]];
+      if (dest == src) continue;
+      if (co_interfere(members[dest], members[src]) || co_interfere(members[src], members[dest])) continue;
+
+      for (int k = 0; k < members[src]->length; k++) {
+        rep[list_geti(members[src], k)] = dest;
+      }
+      vector_merge(members[dest], members[src]);
+      merged = true;
+    }
+  }
+  if (!merged) return;
+
+  // rename the vregs, and remove the copies to themselves
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    Vector *insts = vector_new();
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (inst->dest >= 0) inst->dest = rep[inst->dest];
+      for (int k = 0; k < 3; k++) {
+        if (inst->ops[k] >= 0) inst->ops[k] = rep[inst->ops[k]];
+      }
+      if (inst->args) {
+        for (int k = 0; k < inst->args->length; k++) {
+          list_seti(inst->args, k, rep[list_geti(inst->args, k)]);
+        }
+      }
+      if (inst->op == IR_COPY && inst->dest == inst->ops[0]) continue;
+      vector_push(insts, inst);
+    }
+    block->insts = insts;
+  }
+}
+
+// the jumps to a block which has only a jump are redirected to its successor.
+static void lower_forward(IrFunc *fn) {
+  Vector *blocks = vector_new();
+  vector_push(blocks, fn->blocks->buffer[0]);
+  for (int i = 1; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    IrInst *inst = block->insts->buffer[0];
+    IrBlock *succ = block->succs->length > 0 ? block->succs->buffer[0] : NULL;
+    if (block->insts->length != 1 || inst->op != IR_JMP || succ == block) {
+      vector_push(blocks, block);
+      continue;
+    }
+
+    list_remove(succ->preds, list_find(succ->preds, block));
+    for (int j = 0; j < block->preds->length; j++) {
+      IrBlock *pred = block->preds->buffer[j];
+      for (int k = 0; k < pred->succs->length; k++) {
+        if (pred->succs->buffer[k] == block) pred->succs->buffer[k] = succ;
+      }
+      if (list_find(succ->preds, pred) < 0) vector_push(succ->preds, pred);
+    }
+  }
+  fn->blocks = blocks;
+}
+
+static int *ra_start;
+static int *ra_end;
+
+static void ra_extend(int vreg, int pos) {
+  if (ra_start[vreg] < 0 || pos < ra_start[vreg]) ra_start[vreg] = pos;
+  if (pos > ra_end[vreg]) ra_end[vreg] = pos;
+}
+
+static void lower_regalloc(IrFunc *fn, int stack_size) {
+  lower_liveness(fn);
+
+  int n = fn->vregs;
+  ra_start = arena_alloc(ARENA_GEN, sizeof(int) * (n + 1));
+  ra_end = arena_alloc(ARENA_GEN, sizeof(int) * (n + 1));
+  for (int i = 0; i < n; i++) {
+    ra_start[i] = -1;
+    ra_end[i] = -1;
+  }
+
+  // intervals
+  int pos = 0;
+  Vector *calls = vector_new(); // Vector<int>, the positions of calls
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    block->begin = pos;
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      for (int k = 0; k < 3; k++) {
+        if (inst->ops[k] >= 0) ra_extend(inst->ops[k], pos * 2);
+      }
+      if (inst->args) {
+        for (int k = 0; k < inst->args->length; k++) {
+          ra_extend(list_geti(inst->args, k), pos * 2);
+        }
+      }
+      if (inst->dest >= 0) {
+        ra_extend(inst->dest, pos * 2 + 1);
+      }
+      if (inst->op == IR_CALL) {
+        vector_pushi(calls, pos * 2 + 1);
+      }
+      pos++;
+    }
+    block->end = pos - 1;
+
+    for (int vreg = 0; vreg < n; vreg++) {
+      if (live_check(block->live_in, vreg)) ra_extend(vreg, block->begin * 2);
+      if (live_check(block->live_out, vreg)) ra_extend(vreg, block->end * 2 + 1);
+    }
+  }
+
+  // the number of calls before each position
+  int positions = pos * 2 + 2;
+  int *calls_before = arena_alloc(ARENA_GEN, sizeof(int) * (positions + 1));
+  for (int i = 0; i < calls->length; i++) {
+    calls_before[list_geti(calls, i) + 1]++;
+  }
+  for (int i = 1; i <= positions; i++) {
+    calls_before[i] = calls_before[i] + calls_before[i - 1];
+  }
+
+  // sort the intervals by the start position
+  int *first = arena_alloc(ARENA_GEN, sizeof(int) * (positions + 1));
+  int *next = arena_alloc(ARENA_GEN, sizeof(int) * (n + 1));
+  for (int i = 0; i < positions; i++) {
+    first[i] = -1;
+  }
+  for (int vreg = n - 1; vreg >= 0; vreg--) {
+    if (ra_start[vreg] < 0 || fn->remat[vreg]) continue;
+    next[vreg] = first[ra_start[vreg]];
+    first[ra_start[vreg]] = vreg;
+  }
+
+  fn->regs = arena_alloc(ARENA_GEN, sizeof(int) * (n + 1));
+  fn->slots = arena_alloc(ARENA_GEN, sizeof(int) * (n + 1));
+  for (int i = 0; i < n; i++) {
+    fn->regs[i] = -1;
+  }
+  fn->spills = 0;
+  fn->saved = 0;
+
+  Vector *active = vector_new(); // Vector<int>, the vregs in registers
+  Vector *spilled = vector_new();
+  for (int p = 0; p < positions; p++) {
+    for (int vreg = first[p]; vreg >= 0; vreg = next[vreg]) {
+      // expire the intervals which end before this one
+      for (int i = active->length - 1; i >= 0; i--) {
+        if (ra_end[list_geti(active, i)] < p) list_remove(active, i);
+      }
+
+      bool cross = calls_before[ra_end[vreg]] - calls_before[p + 1] > 0;
+      int used = 0;
+      for (int i = 0; i < active->length; i++) {
+        used = used | (1 << fn->regs[list_geti(active, i)]);
+      }
+
+      int reg = -1;
+      for (int i = 0; i < CALLER_SIZE && reg < 0 && !cross; i++) {
+        if (!(used & (1 << caller_regs[i]))) reg = caller_regs[i];
+      }
+      for (int i = 0; i < CALLEE_SIZE && reg < 0; i++) {
+        if (!(used & (1 << callee_regs[i]))) reg = callee_regs[i];
+      }
+
+      // spill the interval which ends last
+      if (reg < 0) {
+        int victim = -1;
+        for (int i = 0; i < active->length; i++) {
+          int other = list_geti(active, i);
+          bool callee = fn->regs[other] == REG_BX || fn->regs[other] >= REG_R12;
+          if ((callee || !cross) && (victim < 0 || ra_end[other] > ra_end[victim])) victim = other;
+        }
+        if (victim >= 0 && ra_end[victim] > ra_end[vreg]) {
+          reg = fn->regs[victim];
+          fn->regs[victim] = -1;
+          list_remove(active, list_find(active, (void *) (intptr_t) victim));
+          vector_pushi(spilled, victim);
+        } else {
+          vector_pushi(spilled, vreg);
+          continue;
+        }
+      }
+
+      fn->regs[vreg] = reg;
+      vector_pushi(active, vreg);
+      if (reg == REG_BX || reg >= REG_R12) {
+        fn->saved = fn->saved | (1 << reg);
+      }
+    }
+  }
+
+  // the callee-saved registers are saved below the local variables,
+  // and the spilled vregs are stored below them.
+  int saved = 0;
+  for (int i = 0; i < CALLEE_SIZE; i++) {
+    if (fn->saved & (1 << callee_regs[i])) saved++;
+  }
+  for (int i = 0; i < spilled->length; i++) {
+    int vreg = list_geti(spilled, i);
+    fn->slots[vreg] = -stack_size - (saved + fn->spills + 1) * 8;
+    fn->spills++;
+  }
+}
+
+void ir_lower(IrFunc *fn, int stack_size) {
+  ir_fn = fn;
+  fn->blocks = cfg_order(fn);
+  lower_address(fn, ssa_defs(fn), ssa_uses(fn));
+  lower_phis(fn);
+
+  IrInst **defs = ssa_defs(fn);
+  fn->remat = arena_alloc(ARENA_GEN, sizeof(IrInst *) * (fn->vregs + 1));
+  for (int i = 0; i < fn->vregs; i++) {
+    if (defs[i] && check_remat(defs[i])) fn->remat[i] = defs[i];
+  }
+  int *uses = ssa_uses(fn);
+  lower_fuse(fn, uses);
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    for (int j = 0; j < block->insts->length; j++) {
+      IrInst *inst = block->insts->buffer[j];
+      if (check_remat(inst) || inst->fused) {
+        fn->remat[inst->dest] = inst;
+      }
+    }
+  }
+
+  lower_coalesce(fn);
+  lower_forward(fn);
+  lower_regalloc(fn, stack_size);
+}
+
+// dump (--emit-ir)
+
+static char *ir_names[] = {
+  "nop", "const", "param", "local", "global", "string", "copy", "phi",
+  "load", "store", "zero", "neg", "not", "ext", "add", "sub", "mul", "div", "mod",
+  "and", "or", "xor", "shl", "shr", "sar", "cmp", "call", "vector",
+  "jmp", "br", "switch", "ret", "unreachable",
+};
+
+static char *cc_name(StmtType cc) {
+  switch (cc) {
+    case ST_JE: return "eq";
+    case ST_JNE: return "ne";
+    case ST_JL: return "lt";
+    case ST_JLE: return "le";
+    case ST_JB: return "ult";
+    case ST_JBE: return "ule";
+    default: return "?";
+  }
+}
+
+static void dump_address(IrInst *inst, FILE *fp) {
+  fprintf(fp, " [v%d", inst->ops[0]);
+  if (inst->ops[1] >= 0) {
+    fprintf(fp, " + v%d * %d", inst->ops[1], 1 << inst->scale);
+  }
+  if (inst->disp != 0) {
+    fprintf(fp, " + %d", inst->disp);
+  }
+  fprintf(fp, "]");
+}
+
+static void dump_inst(IrInst *inst, IrBlock *block, FILE *fp) {
+  fprintf(fp, "  ");
+  if (inst->dest >= 0) {
+    fprintf(fp, "v%d = ", inst->dest);
+  }
+
+  bool sign = inst->op == IR_EXT || inst->op == IR_DIV || inst->op == IR_MOD;
+  if (sign) {
+    fprintf(fp, "%c", inst->sign ? 's' : 'u');
+  }
+  fprintf(fp, "%s", ir_names[inst->op]);
+  if (inst->size > 0) {
+    fprintf(fp, ".%d", inst->size);
+  }
+
+  switch (inst->op) {
+    case IR_CONST: fprintf(fp, " %llu", inst->imm); break;
+    case IR_PARAM: fprintf(fp, " %llu", inst->imm); break;
+    case IR_LOCAL:
+    case IR_GLOBAL: fprintf(fp, " %s", inst->symbol->identifier ? inst->symbol->identifier : "tmp"); break;
+    case IR_STRING: fprintf(fp, " .S%llu", inst->imm); break;
+    case IR_PHI: {
+      for (int i = 0; i < inst->args->length; i++) {
+        IrBlock *pred = block->preds->buffer[i];
+        fprintf(fp, "%s [v%d, .B%d]", i == 0 ? "" : ",", list_geti(inst->args, i), pred->id);
+      }
+      break;
+    }
+    case IR_LOAD: dump_address(inst, fp); break;
+    case IR_ZERO: {
+      dump_address(inst, fp);
+      fprintf(fp, ", %llu", inst->imm);
+      break;
+    }
+    case IR_STORE: {
+      dump_address(inst, fp);
+      fprintf(fp, ", v%d", inst->ops[2]);
+      break;
+    }
+    case IR_EXT: fprintf(fp, " v%d, %llu", inst->ops[0], inst->imm); break;
+    case IR_CMP: fprintf(fp, " %s v%d, v%d", cc_name(inst->cc), inst->ops[0], inst->ops[1]); break;
+    case IR_CALL: {
+      fprintf(fp, " %s(", inst->symbol->identifier);
+      for (int i = 0; i < inst->args->length; i++) {
+        fprintf(fp, "%sv%d", i == 0 ? "" : ", ", list_geti(inst->args, i));
+      }
+      fprintf(fp, ")");
+      break;
+    }
+    case IR_VECTOR: {
+      fprintf(fp, " %s(", vec_names[inst->imm]);
+      for (int i = 0; i < inst->args->length; i++) {
+        fprintf(fp, "%sv%d", i == 0 ? "" : ", ", list_geti(inst->args, i));
+      }
+      fprintf(fp, ")");
+      break;
+    }
+    case IR_JMP: {
+      IrBlock *succ = block->succs->buffer[0];
+      fprintf(fp, " .B%d", succ->id);
+      break;
+    }
+    case IR_BR: {
+      IrBlock *then_block = block->succs->buffer[0];
+      IrBlock *else_block = block->succs->buffer[1];
+      fprintf(fp, " v%d, .B%d, .B%d", inst->ops[0], then_block->id, else_block->id);
+      break;
+    }
+    case IR_SWITCH: {
+      fprintf(fp, " v%d", inst->ops[0]);
+      for (int i = 0; i < inst->cases->length; i++) {
+        Stmt *case_stmt = inst->cases->buffer[i];
+        IrBlock *succ = block->succs->buffer[i];
+        fprintf(fp, ", [%lld: .B%d]", (long long) case_stmt->case_const->int_value, succ->id);
+      }
+      IrBlock *default_block = vector_last(block->succs);
+      fprintf(fp, ", default .B%d", default_block->id);
+      break;
+    }
+    default: {
+      for (int k = 0; k < 3; k++) {
+        if (inst->ops[k] >= 0) {
+          fprintf(fp, "%s v%d", k == 0 ? "" : ",", inst->ops[k]);
+        }
+      }
+      break;
+    }
+  }
+  fprintf(fp, "\n");
+}
+
+void ir_dump(IrFunc *fn, FILE *fp) {
+  fprintf(fp, "func %s\n", fn->func->symbol->identifier);
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    block->id = i;
+  }
+  for (int i = 0; i < fn->blocks->length; i++) {
+    IrBlock *block = fn->blocks->buffer[i];
+    fprintf(fp, ".B%d:", block->id);
+    if (block->preds->length > 0) {
+      fprintf(fp, " ; preds");
+      for (int j = 0; j < block->preds->length; j++) {
+        IrBlock *pred = block->preds->buffer[j];
+        fprintf(fp, " .B%d", pred->id);
+      }
+    }
+    fprintf(fp, "\n");
+    for (int j = 0; j < block->insts->length; j++) {
+      dump_inst(block->insts->buffer[j], block, fp);
+    }
+  }
+  fprintf(fp, "\n");
+}
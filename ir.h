@@ -0,0 +1,146 @@
+// intermediate representation (-O2)
+// A function is lowered to a control flow graph of basic blocks.
+// Each instruction defines at most one virtual register (vreg), and the
+// local variables are accessed by explicit loads and stores. The scalar
+// local variables whose addresses are not taken are turned into vregs in
+// SSA form by mem2reg, and the passes below are applied to the SSA form.
+// The small functions in the translation unit are inlined into the callers.
+// Before the instruction selection, the phi functions are replaced with
+// copies, and each vreg is assigned a register or a stack slot.
+//
+// Only the low bits of a vreg, as many as the size of the operation
+// which defines it, are meaningful. A narrow value is widened by IR_EXT.
+
+typedef struct ir_inst IrInst;
+typedef struct ir_block IrBlock;
+typedef struct ir_func IrFunc;
+
+typedef enum {
+  IR_NOP,
+
+  // values
+  IR_CONST,  // dest = imm
+  IR_PARAM,  // dest = the imm-th parameter
+  IR_LOCAL,  // dest = the address of the local variable (symbol)
+  IR_GLOBAL, // dest = the address of the global variable (symbol)
+  IR_STRING, // dest = the address of the string literal (imm)
+  IR_COPY,   // dest = ops[0]
+  IR_PHI,    // dest = args[i] if it is reached from the i-th predecessor
+
+  // memory
+  // the address is ops[0] + ops[1] * (1 << scale) + disp (ops[1] is optional)
+  IR_LOAD,  // dest = *address
+  IR_STORE, // *address = ops[2]
+  IR_ZERO,  // the imm bytes at address = 0 (multiple of 8)
+
+  // arithmetic
+  IR_NEG,
+  IR_NOT,
+  IR_EXT, // dest = ops[0] extended from imm bytes (sign)
+  IR_ADD,
+  IR_SUB,
+  IR_MUL,
+  IR_DIV, // (sign)
+  IR_MOD, // (sign)
+  IR_AND,
+  IR_OR,
+  IR_XOR,
+  IR_SHL,
+  IR_SHR,
+  IR_SAR,
+  IR_CMP, // dest = 1 if the jump cc is taken by cmp ops[1], ops[0], or 0
+
+  // call
+  IR_CALL, // dest = symbol(args...)
+
+  // vector loop
+  IR_VECTOR, // the loop over the elements with SSE2 (see IrVector)
+
+  // terminators
+  IR_JMP,    // jump to succs[0]
+  IR_BR,     // jump to succs[0] if ops[0] != 0, or succs[1]
+  IR_SWITCH, // jump to succs[i] if ops[0] == cases[i], or the last of succs
+  IR_RET,    // return ops[0] (optional)
+  IR_UNREACHABLE, // not reached (after a call to a noreturn function)
+} IrOp;
+
+// vector loop
+// The elements a[from] to a[to - 1] are processed 16 bytes at a time,
+// where args are [from, to, operands...] (64-bit), size is the size of the
+// elements (1 or 4), and imm is the kind. to - from is a positive multiple
+// of the number of the elements in a vector. A copy or an add does nothing
+// and results in from if the destination overlaps the sources.
+typedef enum {
+  VEC_FILL,       // a[i] = x (a, x), dest = to
+  VEC_COPY,       // a[i] = b[i] (a, b), dest = to
+  VEC_ADD,        // a[i] = b[i] + c[i] (a, b, c), dest = to
+  VEC_ADD_SCALAR, // a[i] = b[i] + x (a, b, x), dest = to
+  VEC_SUM,        // dest = the sum of a[i] (a)
+  VEC_FIND,       // dest = the start of the first vector which contains x (a, x), or to
+} IrVector;
+
+struct ir_inst {
+  IrOp op;
+  int size;   // the size of the operation in bytes (1, 2, 4 or 8)
+  int dest;   // vreg, or -1
+  int ops[3]; // vregs, or -1
+  Vector *args; // Vector<int>, vregs of phi and call
+
+  unsigned long long imm;
+  Symbol *symbol;
+  bool sign;
+  StmtType cc;
+
+  // memory operand
+  int scale;
+  int disp;
+
+  // call
+  bool variadic; // %al holds the number of vector registers
+
+  // switch
+  Vector *cases; // Vector<Stmt*>
+
+  // instruction selection
+  bool fused; // the comparison is fused into the branch
+};
+
+struct ir_block {
+  int id;
+  int label;
+  Vector *insts; // Vector<IrInst*>, the terminator is the last one
+  Vector *preds; // Vector<IrBlock*>
+  Vector *succs; // Vector<IrBlock*>
+
+  // dominator tree
+  IrBlock *idom;
+  Vector *children; // Vector<IrBlock*>
+  Vector *frontier; // Vector<IrBlock*>
+  int rpo;          // reverse postorder number, or -1 if unreachable
+
+  // liveness (bit sets of vregs)
+  unsigned long long *live_in;
+  unsigned long long *live_out;
+  int begin; // the position of the first instruction
+  int end;   // the position of the last instruction
+};
+
+struct ir_func {
+  Func *func;
+  Vector *blocks; // Vector<IrBlock*>, the entry block is the first one
+  int vregs;      // the number of vregs
+
+  // register allocation
+  IrInst **remat; // the instruction which is computed at each use, or NULL
+  int *regs;  // RegCode of each vreg, or -1 if it is spilled
+  int *slots; // the stack offset of each spilled vreg
+  int spills; // the number of spill slots
+  int saved;  // bit set of the callee-saved registers in use
+};
+
+// ir.c
+extern IrFunc *ir_build(Func *func, bool vectorize, bool report);
+extern void ir_optimize(IrFunc *fn);
+extern bool ir_inline(IrFunc *fn, Vector *fns, bool report);
+extern void ir_lower(IrFunc *fn, int stack_size);
+extern void ir_dump(IrFunc *fn, FILE *fp);
@@ -5,74 +5,17 @@ static char *filename;
 static char *src;
 static int pos;
 
-static char **cur_line;
+static char *line; // head of the current line
 static int lineno;
 static int column;
 
 static String *text;
 static Location *loc;
 
-static Map *keywords;
-
-// read the input source code and replace '\r\n' with '\n'
-static char *read_file(void) {
-  FILE *fp;
-  if (strcmp(filename, "-") == 0) {
-    filename = "stdin";
-    fp = stdin;
-  } else {
-    fp = fopen(filename, "r");
-    if (!fp) {
-      perror(filename);
-      exit(1);
-    }
-  }
-
-  String *file = string_new();
-  char buffer[4096];
-  while (1) {
-    int n = fread(buffer, 1, sizeof(buffer), fp);
-    if (n == 0) break;
-    for (int i = 0; i < n; i++) {
-      string_push(file, buffer[i]);
-    }
-  }
-
-  fclose(fp);
-
-  String *src = string_new();
-  for (int i = 0; i < file->length; i++) {
-    char c = file->buffer[i];
-    if (c == '\r' && i + 1 < file->length && file->buffer[i + 1] == '\n') {
-      c = '\n';
-      i++;
-    }
-    string_push(src, c);
-  }
-
-  return src->buffer;
-}
-
-// prepare lines for error message
-// clone the source code and replace '\n' with '\0' for debugging and error message
-// we can display the line by printf("%s\n", token->line);
-static char **split_lines(char *orig_src) {
-  String *src = string_new();
-  string_write(src, orig_src);
-
-  Vector *lines = vector_new();
-  for (int i = 0; i < src->length; i++) {
-    vector_push(lines, &src->buffer[i]);
-
-    while (src->buffer[i] != '\n') i++;
-    src->buffer[i] = '\0';
-  }
-
-  return (char **) lines->buffer;
-}
+static bool keywords; // whether keywords are registered to the interning table
 
 static Token *create_token(TokenType tk_type) {
-  Token *token = calloc(1, sizeof(Token));
+  Token *token = arena_alloc(ARENA_LEX, sizeof(Token));
   token->tk_type = tk_type;
   token->text = text->buffer;
   token->loc = loc;
@@ -80,17 +23,28 @@ static Token *create_token(TokenType tk_type) {
 }
 
 static void next_line(void) {
-  cur_line++;
+  line = &src[pos];
   lineno++;
   column = 1;
 }
 
-// skip '\' '\n' and concat previous and next lines
+// length of the newline at p ("\n" or "\r\n"), or 0
+static int newline(int p) {
+  if (src[p] == '\n') return 1;
+  if (src[p] == '\r' && src[p + 1] == '\n') return 2;
+  return 0;
+}
+
+// skip '\' '\n' and concat previous and next lines.
+// '\r' of "\r\n" is also skipped, so that the newline is read as '\n'.
 static void skip_backslash_newline(void) {
-  while (src[pos] == '\\' && src[pos + 1] == '\n') {
-    pos += 2;
+  while (src[pos] == '\\' && newline(pos + 1)) {
+    pos += 1 + newline(pos + 1);
     next_line();
   }
+  if (src[pos] == '\r' && src[pos + 1] == '\n') {
+    pos++;
+  }
 }
 
 static char peek_char(void) {
@@ -126,39 +80,35 @@ static bool read_char(char c) {
   return false;
 }
 
-static Map *create_keywords(void) {
-  Map *map = map_new();
-
-  map_puti(map, "sizeof", TK_SIZEOF);
-  map_puti(map, "_Alignof", TK_ALIGNOF);
-  map_puti(map, "typedef", TK_TYPEDEF);
-  map_puti(map, "extern", TK_EXTERN);
-  map_puti(map, "static", TK_STATIC);
-  map_puti(map, "void", TK_VOID);
-  map_puti(map, "char", TK_CHAR);
-  map_puti(map, "short", TK_SHORT);
-  map_puti(map, "int", TK_INT);
-  map_puti(map, "long", TK_LONG);
-  map_puti(map, "signed", TK_SIGNED);
-  map_puti(map, "unsigned", TK_UNSIGNED);
-  map_puti(map, "_Bool", TK_BOOL);
-  map_puti(map, "struct", TK_STRUCT);
-  map_puti(map, "enum", TK_ENUM);
-  map_puti(map, "_Noreturn", TK_NORETURN);
-  map_puti(map, "case", TK_CASE);
-  map_puti(map, "default", TK_DEFAULT);
-  map_puti(map, "if", TK_IF);
-  map_puti(map, "else", TK_ELSE);
-  map_puti(map, "switch", TK_SWITCH);
-  map_puti(map, "while", TK_WHILE);
-  map_puti(map, "do", TK_DO);
-  map_puti(map, "for", TK_FOR);
-  map_puti(map, "goto", TK_GOTO);
-  map_puti(map, "continue", TK_CONTINUE);
-  map_puti(map, "break", TK_BREAK);
-  map_puti(map, "return", TK_RETURN);
-
-  return map;
+static void create_keywords(void) {
+  intern("sizeof")->keyword = TK_SIZEOF;
+  intern("_Alignof")->keyword = TK_ALIGNOF;
+  intern("typedef")->keyword = TK_TYPEDEF;
+  intern("extern")->keyword = TK_EXTERN;
+  intern("static")->keyword = TK_STATIC;
+  intern("void")->keyword = TK_VOID;
+  intern("char")->keyword = TK_CHAR;
+  intern("short")->keyword = TK_SHORT;
+  intern("int")->keyword = TK_INT;
+  intern("long")->keyword = TK_LONG;
+  intern("signed")->keyword = TK_SIGNED;
+  intern("unsigned")->keyword = TK_UNSIGNED;
+  intern("_Bool")->keyword = TK_BOOL;
+  intern("struct")->keyword = TK_STRUCT;
+  intern("enum")->keyword = TK_ENUM;
+  intern("_Noreturn")->keyword = TK_NORETURN;
+  intern("case")->keyword = TK_CASE;
+  intern("default")->keyword = TK_DEFAULT;
+  intern("if")->keyword = TK_IF;
+  intern("else")->keyword = TK_ELSE;
+  intern("switch")->keyword = TK_SWITCH;
+  intern("while")->keyword = TK_WHILE;
+  intern("do")->keyword = TK_DO;
+  intern("for")->keyword = TK_FOR;
+  intern("goto")->keyword = TK_GOTO;
+  intern("continue")->keyword = TK_CONTINUE;
+  intern("break")->keyword = TK_BREAK;
+  intern("return")->keyword = TK_RETURN;
 }
 
 static char get_escape_sequence(void) {
@@ -182,9 +132,9 @@ static Token *next_token(void) {
   skip_backslash_newline();
 
   // store the start position of the next token.
-  loc = calloc(1, sizeof(Location));
+  loc = arena_alloc(ARENA_LEX, sizeof(Location));
   loc->filename = filename;
-  loc->line = *cur_line;
+  loc->line = line;
   loc->lineno = lineno;
   loc->column = column;
 
@@ -232,11 +182,12 @@ static Token *next_token(void) {
       string_push(string, get_char());
     }
 
-    TokenType tk_type = map_lookupi(keywords, string->buffer);
-    if (tk_type) return create_token(tk_type);
+    Ident *ident = intern(string->buffer);
+    if (ident->keyword) return create_token(ident->keyword);
 
     Token *token = create_token(TK_IDENTIFIER);
-    token->identifier = string->buffer;
+    token->identifier = ident->name;
+    token->ident = ident;
     return token;
   }
 
@@ -321,16 +272,20 @@ Vector *tokenize(char *_filename) {
   filename = _filename;
 
   // read the input file
-  src = read_file();
+  src = load_source(filename);
   pos = 0;
+  if (strcmp(filename, "-") == 0) {
+    filename = "stdin";
+  }
 
   // initialization
-  cur_line = split_lines(src);
+  line = src;
   lineno = 1;
   column = 1;
 
   if (!keywords) {
-    keywords = create_keywords();
+    create_keywords();
+    keywords = true;
   }
 
   // tokenize
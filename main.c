@@ -1,14 +1,54 @@
 #include "sk2cc.h"
+#include "string.h"
+#include "arena.h"
+#include "stats.h"
+#include "options.h"
+#include "x86.h"
+#include "emit.h"
 
-extern void compile(char *input, bool cpp);
+extern void compile(char *input, char *output, Options *options);
 extern void assemble(char *input, char *output);
 
+// foo.c -> foo.o
+static char *object_name(char *input) {
+  String *name = string_new();
+  string_write(name, input);
+  if (name->length >= 2 && name->buffer[name->length - 2] == '.') {
+    name->buffer[name->length - 1] = 'o';
+  } else {
+    string_write(name, ".o");
+  }
+  return name->buffer;
+}
+
 int main(int argc, char **argv) {
   char *command = argv[0];
 
+  // options which are accepted in any mode
+  bool mem_report = false;
+  bool time_report = false;
+  bool time_report_json = false;
+  bool rule_report = false;
+  int n = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--mem-report") == 0) {
+      mem_report = true;
+    } else if (strcmp(argv[i], "--time-report") == 0) {
+      time_report = true;
+    } else if (strcmp(argv[i], "--time-report=json") == 0) {
+      time_report = true;
+      time_report_json = true;
+    } else if (strcmp(argv[i], "--peephole-report") == 0) {
+      rule_report = true;
+    } else {
+      argv[n++] = argv[i];
+    }
+  }
+  argc = n;
+
   if (argc >= 2 && strcmp(argv[1], "--as") == 0) {
     if (argc != 4) {
-      fprintf(stderr, "usage: %s --as [input file] [output file]\n", command);
+      fprintf(stderr, "usage: %s [--mem-report] [--time-report[=json]] [--peephole-report] --as [input file] [output file]\n", command);
       exit(1);
     }
 
@@ -17,20 +57,94 @@ int main(int argc, char **argv) {
     assemble(input, output);
   } else if (argc >= 2 && strcmp(argv[1], "--cpp") == 0) {
     if (argc != 3) {
-      fprintf(stderr, "usage: %s --cpp [input file]\n", command);
+      fprintf(stderr, "usage: %s [--mem-report] [--time-report[=json]] [--peephole-report] --cpp [input file]\n", command);
       exit(1);
     }
 
     char *input = argv[2];
-    compile(input, true);
+    Options options;
+    options.cpp = true;
+    options.object = false;
+    options.opt_level = 0;
+    options.emit_ir = false;
+    options.inline_report = false;
+    options.vectorize_report = false;
+    options.omit_frame_pointer = false;
+    compile(input, NULL, &options);
   } else {
-    if (argc != 2) {
-      fprintf(stderr, "usage: %s [input file]\n", command);
+    // -c: generate an object file by the integrated assembler
+    // -S: generate assembly (default)
+    // -O0: no optimization (default)
+    // -O1: peephole optimization
+    // -O2: optimization on the IR
+    // --emit-ir: write the IR instead of assembly
+    // --inline-report: write the decisions of the inliner (-O2) to stderr
+    // --vectorize-report: write the decisions of the vectorizer (-O2) to stderr
+    // -fno-omit-frame-pointer: set up the frame of the leaf functions (-O1 or higher)
+    char *input = NULL;
+    char *output = NULL;
+    bool object = false;
+    int opt_level = 0;
+    bool emit_ir = false;
+    bool inline_report = false;
+    bool vectorize_report = false;
+    bool omit_frame_pointer = true;
+    bool usage = false;
+    for (int i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-c") == 0) {
+        object = true;
+      } else if (strcmp(argv[i], "-S") == 0) {
+        object = false;
+      } else if (strcmp(argv[i], "-O0") == 0) {
+        opt_level = 0;
+      } else if (strcmp(argv[i], "-O1") == 0) {
+        opt_level = 1;
+      } else if (strcmp(argv[i], "-O2") == 0) {
+        opt_level = 2;
+      } else if (strcmp(argv[i], "--emit-ir") == 0) {
+        emit_ir = true;
+      } else if (strcmp(argv[i], "--inline-report") == 0) {
+        inline_report = true;
+      } else if (strcmp(argv[i], "--vectorize-report") == 0) {
+        vectorize_report = true;
+      } else if (strcmp(argv[i], "-fno-omit-frame-pointer") == 0) {
+        omit_frame_pointer = false;
+      } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+        output = argv[++i];
+      } else if ((argv[i][0] != '-' || strcmp(argv[i], "-") == 0) && !input) {
+        input = argv[i];
+      } else {
+        usage = true;
+      }
+    }
+
+    if (!input || usage) {
+      fprintf(stderr, "usage: %s [--mem-report] [--time-report[=json]] [--peephole-report] [-c|-S] [-O0|-O1|-O2] [--emit-ir] [--inline-report] [--vectorize-report] [-fno-omit-frame-pointer] [-o output file] [input file]\n", command);
       exit(1);
     }
 
-    char *input = argv[1];
-    compile(input, false);
+    if (object && !output) {
+      output = object_name(input);
+    }
+    Options options;
+    options.cpp = false;
+    options.object = object;
+    options.opt_level = opt_level;
+    options.emit_ir = emit_ir;
+    options.inline_report = inline_report;
+    options.vectorize_report = vectorize_report;
+    options.omit_frame_pointer = omit_frame_pointer;
+    compile(input, output, &options);
+  }
+
+  if (mem_report) {
+    arena_report();
+  }
+  if (time_report) {
+    stats_report(time_report_json);
+  }
+  if (rule_report) {
+    peephole_report();
   }
 
   return 0;
@@ -1,44 +1,93 @@
 #include "sk2cc.h"
 #include "map.h"
 
+// keys and values are stored in insertion order.
+// slots is an open-addressing table (linear probing) of 2 * capacity entries,
+// each of which holds (index of the entry + 1), or 0 if the slot is empty.
+
+unsigned int map_hash(char *key) {
+  // FNV-1a
+  unsigned int hash = 2166136261u;
+  for (int i = 0; key[i]; i++) {
+    hash = hash ^ (unsigned char) key[i];
+    hash *= 16777619;
+  }
+  return hash;
+}
+
+static int map_slot(Map *map, char *key, unsigned int hash) {
+  int mask = map->capacity * 2 - 1;
+  for (int i = hash & mask;; i = (i + 1) & mask) {
+    int index = map->slots[i] - 1;
+    if (index < 0) return i;
+    if (map->keys[index] == key) return i; // interned keys are compared by pointers
+    if (map->hashes[index] == hash && strcmp(map->keys[index], key) == 0) return i;
+  }
+}
+
+static void map_rehash(Map *map) {
+  int mask = map->capacity * 2 - 1;
+  map->slots = calloc(map->capacity * 2, sizeof(int));
+  for (int index = 0; index < map->count; index++) {
+    int i = map->hashes[index] & mask;
+    while (map->slots[i]) {
+      i = (i + 1) & mask;
+    }
+    map->slots[i] = index + 1;
+  }
+}
+
 Map *map_new(void) {
   Map *map = calloc(1, sizeof(Map));
   map->count = 0;
   map->capacity = 64;
   map->keys = calloc(map->capacity, sizeof(char *));
   map->values = calloc(map->capacity, sizeof(void *));
+  map->hashes = calloc(map->capacity, sizeof(unsigned int));
+  map->slots = calloc(map->capacity * 2, sizeof(int));
   return map;
 }
 
-void map_put(Map *map, char *key, void *value) {
-  for (int i = 0; i < map->count; i++) {
-    if (strcmp(map->keys[i], key) == 0) {
-      map->values[i] = value;
-      return;
-    }
+void map_put_hash(Map *map, char *key, unsigned int hash, void *value) {
+  int slot = map_slot(map, key, hash);
+  if (map->slots[slot]) {
+    map->values[map->slots[slot] - 1] = value;
+    return;
   }
 
   map->keys[map->count] = key;
   map->values[map->count] = value;
+  map->hashes[map->count] = hash;
+  map->slots[slot] = map->count + 1;
   map->count++;
 
   if (map->count == map->capacity) {
     map->capacity *= 2;
     map->keys = realloc(map->keys, sizeof(void *) * map->capacity);
     map->values = realloc(map->values, sizeof(void *) * map->capacity);
+    map->hashes = realloc(map->hashes, sizeof(unsigned int) * map->capacity);
+    free(map->slots);
+    map_rehash(map);
   }
 }
 
-void *map_lookup(Map *map, char *key) {
-  for (int i = 0; i < map->count; i++) {
-    if (strcmp(map->keys[i], key) == 0) {
-      return map->values[i];
-    }
+void *map_lookup_hash(Map *map, char *key, unsigned int hash) {
+  int slot = map_slot(map, key, hash);
+  if (map->slots[slot]) {
+    return map->values[map->slots[slot] - 1];
   }
 
   return NULL;
 }
 
+void map_put(Map *map, char *key, void *value) {
+  map_put_hash(map, key, map_hash(key), value);
+}
+
+void *map_lookup(Map *map, char *key) {
+  return map_lookup_hash(map, key, map_hash(key));
+}
+
 void map_puti(Map *map, char *key, int value) {
   map_put(map, key, (void *) (intptr_t) value);
 }
@@ -2,9 +2,14 @@ typedef struct map {
   int count, capacity;
   char **keys;
   void **values;
+  unsigned int *hashes;
+  int *slots;
 } Map;
 
+extern unsigned int map_hash(char *key);
 extern Map *map_new(void);
+extern void map_put_hash(Map *map, char *key, unsigned int hash, void *value);
+extern void *map_lookup_hash(Map *map, char *key, unsigned int hash);
 extern void map_put(Map *map, char *key, void *value);
 extern void *map_lookup(Map *map, char *key);
 extern void map_puti(Map *map, char *key, int value);
@@ -0,0 +1,10 @@
+// options of the compiler given on the command line
+typedef struct options {
+  bool cpp;                // only preprocess (--cpp)
+  bool object;             // generate an object file (-c)
+  int opt_level;           // -O0, -O1 or -O2
+  bool emit_ir;            // write the IR instead of assembly (--emit-ir)
+  bool inline_report;      // write the decisions of the inliner (--inline-report)
+  bool vectorize_report;   // write the decisions of the vectorizer (--vectorize-report)
+  bool omit_frame_pointer; // omit the frame of the leaf functions (-fno-omit-frame-pointer)
+} Options;
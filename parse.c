@@ -6,6 +6,17 @@ static Vector *literals; // Vector<String*>
 
 static Vector *symbol_scopes; // Vector<Map<SymbolType*>*>
 
+// builtin macros
+static Ident *ident_va_start;
+static Ident *ident_va_arg;
+static Ident *ident_va_end;
+
+// builtin functions
+static Ident *ident_memcpy;
+static Ident *ident_memset;
+static Ident *ident_strlen;
+static Ident *ident_strcmp;
+
 static void put_symbol(char *identifier, Symbol *symbol) {
   if (!identifier) return;
 
@@ -19,12 +30,12 @@ static void put_symbol(char *identifier, Symbol *symbol) {
   map_put(map, identifier, symbol);
 }
 
-static Symbol *lookup_symbol(char *identifier) {
-  if (!identifier) return NULL;
+static Symbol *lookup_symbol(Ident *ident) {
+  if (!ident) return NULL;
 
   for (int i = symbol_scopes->length - 1; i >= 0; i--) {
     Map *map = symbol_scopes->buffer[i];
-    Symbol *symbol = map_lookup(map, identifier);
+    Symbol *symbol = map_lookup_hash(map, ident->name, ident->hash);
     if (symbol) return symbol;
   }
 
@@ -77,7 +88,7 @@ static bool check_storage_class_specifier(void) {
 
 static bool check_typedef_name(void) {
   if (check(TK_IDENTIFIER)) {
-    Symbol *symbol = lookup_symbol(peek()->identifier);
+    Symbol *symbol = lookup_symbol(peek()->ident);
     return symbol && symbol->sy_type == SY_TYPE;
   }
 
@@ -117,14 +128,16 @@ static bool check_declaration_specifier(void) {
 // parse expression
 
 static Expr *expr_new(NodeType nd_type, Token *token) {
-  Expr *expr = calloc(1, sizeof(Expr));
+  Expr *expr = arena_alloc(ARENA_PARSE, sizeof(Expr));
+  stats_count(STAT_NODES, 1);
   expr->nd_type = nd_type;
   expr->token = token;
   return expr;
 }
 
 static Expr *expr_unary(NodeType nd_type, Expr *_expr, Token *token) {
-  Expr *expr = calloc(1, sizeof(Expr));
+  Expr *expr = arena_alloc(ARENA_PARSE, sizeof(Expr));
+  stats_count(STAT_NODES, 1);
   expr->nd_type = nd_type;
   expr->expr = _expr;
   expr->token = token;
@@ -132,7 +145,8 @@ static Expr *expr_unary(NodeType nd_type, Expr *_expr, Token *token) {
 }
 
 static Expr *expr_binary(NodeType nd_type, Expr *lhs, Expr *rhs, Token *token) {
-  Expr *expr = calloc(1, sizeof(Expr));
+  Expr *expr = arena_alloc(ARENA_PARSE, sizeof(Expr));
+  stats_count(STAT_NODES, 1);
   expr->nd_type = nd_type;
   expr->lhs = lhs;
   expr->rhs = rhs;
@@ -145,6 +159,18 @@ static Expr *assignment_expression(void);
 static Expr *expression(void);
 static TypeName *type_name(void);
 
+// the arguments of the builtin function, which takes n arguments.
+static Expr *builtin_function(NodeType nd_type, int n, Token *token) {
+  Expr *expr = expr_new(nd_type, token);
+  expr->args = vector_new();
+  for (int i = 0; i < n; i++) {
+    if (i > 0) expect(',');
+    vector_push(expr->args, assignment_expression());
+  }
+  expect(')');
+  return expr;
+}
+
 // primary-expression :
 //   identifier
 //   integer-constant
@@ -155,7 +181,7 @@ static Expr *primary_expression(void) {
 
   if (!check_typedef_name() && read(TK_IDENTIFIER)) {
     // check builtin macros
-    if (strcmp(token->identifier, "__builtin_va_start") == 0 && read('(')) {
+    if (token->ident == ident_va_start && read('(')) {
       Expr *macro_ap = assignment_expression();
       expect(',');
       char *macro_arg = expect(TK_IDENTIFIER)->identifier;
@@ -166,7 +192,7 @@ static Expr *primary_expression(void) {
       expr->macro_arg = macro_arg;
       return expr;
     }
-    if (strcmp(token->identifier, "__builtin_va_arg") == 0 && read('(')) {
+    if (token->ident == ident_va_arg && read('(')) {
       Expr *macro_ap = assignment_expression();
       expect(',');
       TypeName *macro_type = type_name();
@@ -177,7 +203,7 @@ static Expr *primary_expression(void) {
       expr->macro_type = macro_type;
       return expr;
     }
-    if (strcmp(token->identifier, "__builtin_va_end") == 0 && read('(')) {
+    if (token->ident == ident_va_end && read('(')) {
       Expr *macro_ap = assignment_expression();
       expect(')');
 
@@ -186,7 +212,13 @@ static Expr *primary_expression(void) {
       return expr;
     }
 
-    Symbol *symbol = lookup_symbol(token->identifier);
+    // check builtin functions
+    if (token->ident == ident_memcpy && read('(')) return builtin_function(ND_MEMCPY, 3, token);
+    if (token->ident == ident_memset && read('(')) return builtin_function(ND_MEMSET, 3, token);
+    if (token->ident == ident_strlen && read('(')) return builtin_function(ND_STRLEN, 1, token);
+    if (token->ident == ident_strcmp && read('(')) return builtin_function(ND_STRCMP, 2, token);
+
+    Symbol *symbol = lookup_symbol(token->ident);
     if (symbol && symbol->sy_type == SY_CONST) {
       Expr *expr = expr_new(ND_ENUM_CONST, token);
       expr->identifier = token->identifier;
@@ -637,7 +669,8 @@ static Expr *constant_expression(void) {
 // parse declaration
 
 static Decl *decl_new(Vector *specs, Vector *symbols, Token *token) {
-  Decl *decl = calloc(1, sizeof(Decl));
+  Decl *decl = arena_alloc(ARENA_PARSE, sizeof(Decl));
+  stats_count(STAT_NODES, 1);
   decl->nd_type = ND_DECL;
   decl->specs = specs;
   decl->symbols = symbols;
@@ -646,7 +679,8 @@ static Decl *decl_new(Vector *specs, Vector *symbols, Token *token) {
 }
 
 static Decl *param_new(Vector *specs, Symbol *symbol, Token *token) {
-  Decl *decl = calloc(1, sizeof(Decl));
+  Decl *decl = arena_alloc(ARENA_PARSE, sizeof(Decl));
+  stats_count(STAT_NODES, 1);
   decl->nd_type = ND_DECL;
   decl->specs = specs;
   decl->symbol = symbol;
@@ -655,14 +689,14 @@ static Decl *param_new(Vector *specs, Symbol *symbol, Token *token) {
 }
 
 static Specifier *specifier_new(SpecifierType sp_type, Token *token) {
-  Specifier *spec = calloc(1, sizeof(Specifier));
+  Specifier *spec = arena_alloc(ARENA_PARSE, sizeof(Specifier));
   spec->sp_type = sp_type;
   spec->token = token;
   return spec;
 }
 
 static Declarator *declarator_new(DeclaratorType decl_type, Declarator *_decl, Token *token) {
-  Declarator *decl = calloc(1, sizeof(Declarator));
+  Declarator *decl = arena_alloc(ARENA_PARSE, sizeof(Declarator));
   decl->decl_type = decl_type;
   decl->decl = _decl;
   decl->token = token;
@@ -930,7 +964,7 @@ static Symbol *enumerator(void) {
   Token *token = expect(TK_IDENTIFIER);
   Expr *const_expr = read('=') ? constant_expression() : NULL;
 
-  Symbol *symbol = calloc(1, sizeof(Symbol));
+  Symbol *symbol = arena_alloc(ARENA_PARSE, sizeof(Symbol));
   symbol->sy_type = SY_CONST;
   symbol->identifier = token->identifier;
   symbol->const_expr = const_expr;
@@ -942,7 +976,7 @@ static Symbol *enumerator(void) {
 //   identifier
 static Specifier *typedef_name(void) {
   Token *token = expect(TK_IDENTIFIER);
-  Symbol *symbol = lookup_symbol(token->identifier);
+  Symbol *symbol = lookup_symbol(token->ident);
 
   Specifier *spec = specifier_new(SP_TYPEDEF_NAME, token);
   spec->typedef_name = token->identifier;
@@ -993,7 +1027,7 @@ static Symbol *declarator(bool sp_typedef) {
 static Symbol *direct_declarator(bool sp_typedef) {
   Token *token = expect(TK_IDENTIFIER);
 
-  Symbol *symbol = calloc(1, sizeof(Symbol));
+  Symbol *symbol = arena_alloc(ARENA_PARSE, sizeof(Symbol));
   symbol->sy_type = sp_typedef ? SY_TYPE : SY_VARIABLE;
   symbol->identifier = token->identifier;
   symbol->decl = NULL;
@@ -1071,7 +1105,7 @@ static Symbol *param_direct_declarator(void) {
   Token *token = peek();
   Token *ident = read(TK_IDENTIFIER);
 
-  Symbol *symbol = calloc(1, sizeof(Symbol));
+  Symbol *symbol = arena_alloc(ARENA_PARSE, sizeof(Symbol));
   symbol->sy_type = SY_VARIABLE;
   symbol->identifier = ident ? ident->identifier : NULL;
   symbol->decl = NULL;
@@ -1129,7 +1163,7 @@ static TypeName *type_name(void) {
     decl = abstract_declarator()->decl;
   }
 
-  TypeName *type_name = calloc(1, sizeof(TypeName));
+  TypeName *type_name = arena_alloc(ARENA_PARSE, sizeof(TypeName));
   type_name->specs = specs;
   type_name->decl = decl;
   type_name->token = token;
@@ -1149,7 +1183,7 @@ static Symbol *abstract_declarator(void) {
       return symbol;
     }
 
-    Symbol *symbol = calloc(1, sizeof(Symbol));
+    Symbol *symbol = arena_alloc(ARENA_PARSE, sizeof(Symbol));
     symbol->sy_type = SY_VARIABLE;
     symbol->decl = declarator_new(DECL_POINTER, NULL, token);
     symbol->token = token;
@@ -1164,7 +1198,7 @@ static Symbol *abstract_declarator(void) {
 static Symbol *direct_abstract_declarator(void) {
   Token *token = peek();
 
-  Symbol *symbol = calloc(1, sizeof(Symbol));
+  Symbol *symbol = arena_alloc(ARENA_PARSE, sizeof(Symbol));
   symbol->sy_type = SY_VARIABLE;
   symbol->decl = NULL;
   symbol->token = token;
@@ -1226,13 +1260,13 @@ static Initializer *initializer(void) {
     }
     expect('}');
 
-    Initializer *init = calloc(1, sizeof(Initializer));
+    Initializer *init = arena_alloc(ARENA_PARSE, sizeof(Initializer));
     init->list = list;
     init->token = token;
     return init;
   }
 
-  Initializer *init = calloc(1, sizeof(Initializer));
+  Initializer *init = arena_alloc(ARENA_PARSE, sizeof(Initializer));
   init->expr = assignment_expression();
   init->token = token;
   return init;
@@ -1241,7 +1275,8 @@ static Initializer *initializer(void) {
 // parse statement
 
 static Stmt *stmt_new(NodeType nd_type, Token *token) {
-  Stmt *stmt = calloc(1, sizeof(Stmt));
+  Stmt *stmt = arena_alloc(ARENA_PARSE, sizeof(Stmt));
+  stats_count(STAT_NODES, 1);
   stmt->nd_type = nd_type;
   stmt->token = token;
   return stmt;
@@ -1573,7 +1608,8 @@ static Node *external_declaration(void) {
   Stmt *body = compound_statement();
   vector_pop(symbol_scopes);
 
-  Func *func = calloc(1, sizeof(Func));
+  Func *func = arena_alloc(ARENA_PARSE, sizeof(Func));
+  stats_count(STAT_NODES, 1);
   func->nd_type = ND_FUNC;
   func->specs = specs;
   func->symbol = symbol;
@@ -1591,9 +1627,9 @@ static TransUnit *translation_unit(void) {
   vector_push(symbol_scopes, map_new()); // begin file scope
 
   // __builtin_va_list
-  Symbol *sym_va_list = calloc(1, sizeof(Symbol));
+  Symbol *sym_va_list = arena_alloc(ARENA_PARSE, sizeof(Symbol));
   sym_va_list->sy_type = SY_TYPE;
-  sym_va_list->identifier = "__builtin_va_list";
+  sym_va_list->identifier = intern("__builtin_va_list")->name;
   sym_va_list->token = NULL;
   put_symbol(sym_va_list->identifier, sym_va_list);
 
@@ -1604,7 +1640,7 @@ static TransUnit *translation_unit(void) {
 
   vector_pop(symbol_scopes); // end file scope
 
-  TransUnit *unit = calloc(1, sizeof(TransUnit));
+  TransUnit *unit = arena_alloc(ARENA_PARSE, sizeof(TransUnit));
   unit->literals = literals;
   unit->decls = decls;
   return unit;
@@ -1644,10 +1680,10 @@ static Token *inspect_pp_number(Token *token) {
   if (tolower(pp_number[pos]) == 'u') {
     int_unsigned = true;
     pos++;
-    if (tolower(pp_number[pos] == 'l')) {
+    if (tolower(pp_number[pos]) == 'l') {
       int_long = true;
       pos++;
-      if (tolower(pp_number[pos] == 'l')) {
+      if (tolower(pp_number[pos]) == 'l') {
         pos++;
       }
     }
@@ -1667,7 +1703,7 @@ static Token *inspect_pp_number(Token *token) {
     ERROR(token, "invalid preprocessing number.");
   }
 
-  Token *int_const = calloc(1, sizeof(Token));
+  Token *int_const = arena_alloc(ARENA_PARSE, sizeof(Token));
   int_const->tk_type = TK_INTEGER_CONST;
   int_const->text = token->text;
   int_const->loc = token->loc;
@@ -1679,6 +1715,14 @@ static Token *inspect_pp_number(Token *token) {
 }
 
 TransUnit *parse(Vector *_tokens) {
+  ident_va_start = intern("__builtin_va_start");
+  ident_va_arg = intern("__builtin_va_arg");
+  ident_va_end = intern("__builtin_va_end");
+  ident_memcpy = intern("__builtin_memcpy");
+  ident_memset = intern("__builtin_memset");
+  ident_strlen = intern("__builtin_strlen");
+  ident_strcmp = intern("__builtin_strcmp");
+
   // remove newlines and white-spaces
   // inspect pp-numbers
   Vector *parse_tokens = vector_new();
@@ -0,0 +1,714 @@
+#include "sk2cc.h"
+#include "string.h"
+#include "x86.h"
+#include "emit.h"
+
+// peephole optimizer (-O1)
+// The statements from the code generator are held in a small window
+// in the structured form, and the rules below rewrite the instructions
+// at the tail of the window each time an instruction is added.
+// The window is written out at labels, jumps and directives,
+// so that the rules are applied within a basic block.
+//
+// The rules rely on the following conventions of gen.c:
+//   - the expression temporaries (r8-r11, rsi, rdi) and the scratch registers
+//     (rcx, rdx) are not live across labels and jumps.
+//   - the value in an expression temporary is read only once, when it is
+//     popped from the value stack.
+//   - the flags are not live across labels and jumps.
+//   - memory is not accessed through the stack pointer except push and pop,
+//     or in the leaf functions without the frame, which never push values.
+
+#define WINDOW 32
+
+#define BIT(reg) (1 << (reg))
+
+#define POOL (BIT(REG_R8) | BIT(REG_R9) | BIT(REG_R10) | BIT(REG_R11) | BIT(REG_SI) | BIT(REG_DI))
+#define TEMPS (POOL | BIT(REG_CX) | BIT(REG_DX))
+#define CALL_USES (BIT(REG_AX) | BIT(REG_CX) | BIT(REG_DX) | BIT(REG_SI) | BIT(REG_DI) | BIT(REG_R8) | BIT(REG_R9) | BIT(REG_SP))
+#define CALL_DEFS (BIT(REG_AX) | BIT(REG_CX) | BIT(REG_DX) | BIT(REG_SI) | BIT(REG_DI) | BIT(REG_R8) | BIT(REG_R9) | BIT(REG_R10) | BIT(REG_R11))
+
+// rules
+typedef enum {
+  RULE_PUSH_POP,   // push %x; pop %y -> mov %x, %y
+  RULE_ADDRESS,    // lea M, %x; mov (%x), %y -> mov M, %y
+  RULE_LOAD,       // mov %x, M; mov M, %y -> mov %x, %y
+  RULE_STORE,      // mov M, %x; mov %x, M -> mov M, %x
+  RULE_COPY,       // mov %x, %y; mov %y, %x -> mov %x, %y
+  RULE_DEAD_MOVE,  // mov %x, %y (not used until %y is overwritten)
+  RULE_SETCC_JUMP, // setl %al; movzbl %al, %eax; test %rax, %rax; je L -> setl %al; movzbl %al, %eax; jge L
+} Rule;
+
+#define RULES 7
+
+static char *rule_names[RULES] = { "push-pop", "address", "load", "store", "copy", "dead-move", "setcc-jump" };
+static long hits[RULES];
+
+// registers and memory accessed by an instruction
+// a register is killed if its whole value is overwritten.
+// writing to the lower 8 or 16 bits is regarded as both of use and definition.
+typedef struct {
+  int uses;
+  int defs;
+  int kills;
+  bool load;
+  bool store;
+  bool flags; // the flags are overwritten
+} Effect;
+
+typedef struct {
+  EmitStmt stmt;
+  Effect effect;
+} Entry;
+
+// the window is a ring buffer
+static Entry window[WINDOW];
+static int head;
+static int count;
+
+static Entry *at(int i) {
+  return &window[(head + i) % WINDOW];
+}
+
+// effect analysis
+
+static int op_address(EmitOp *op) {
+  if (op->type != EOP_MEM) return 0;
+  if (op->sib) return BIT(op->base) | BIT(op->index);
+  return BIT(op->base);
+}
+
+// the vector registers are not tracked.
+static void effect_read(Effect *effect, EmitOp *op) {
+  if (op->type == EOP_REG && op->regtype == REG_XMM) return;
+  if (op->type == EOP_REG) {
+    effect->uses = effect->uses | BIT(op->regcode);
+  } else if (op->type == EOP_MEM || op->type == EOP_RIP) {
+    effect->uses = effect->uses | op_address(op);
+    effect->load = true;
+  }
+}
+
+static void effect_write(Effect *effect, EmitOp *op) {
+  if (op->type == EOP_REG && op->regtype == REG_XMM) return;
+  if (op->type == EOP_REG) {
+    effect->defs = effect->defs | BIT(op->regcode);
+    if (op->regtype == REG_LONG || op->regtype == REG_QUAD) {
+      effect->kills = effect->kills | BIT(op->regcode);
+    } else {
+      effect->uses = effect->uses | BIT(op->regcode);
+    }
+  } else if (op->type == EOP_MEM || op->type == EOP_RIP) {
+    effect->uses = effect->uses | op_address(op);
+    effect->store = true;
+  }
+}
+
+static void effect_analyze(EmitStmt *stmt, Effect *effect) {
+  memset(effect, 0, sizeof(Effect));
+
+  switch (stmt->type) {
+    case ST_PUSH: {
+      effect_read(effect, &stmt->ops[0]);
+      effect->uses = effect->uses | BIT(REG_SP);
+      effect->defs = effect->defs | BIT(REG_SP);
+      effect->store = true;
+      break;
+    }
+    case ST_POP: {
+      effect_write(effect, &stmt->ops[0]);
+      effect->uses = effect->uses | BIT(REG_SP);
+      effect->defs = effect->defs | BIT(REG_SP);
+      effect->load = true;
+      break;
+    }
+    case ST_CLTD:
+    case ST_CQTO: {
+      effect->uses = BIT(REG_AX);
+      effect->defs = BIT(REG_DX);
+      effect->kills = BIT(REG_DX);
+      break;
+    }
+    case ST_MOV:
+    case ST_MOVZB:
+    case ST_MOVZW:
+    case ST_MOVSB:
+    case ST_MOVSW:
+    case ST_MOVSL: {
+      effect_read(effect, &stmt->ops[0]);
+      effect_write(effect, &stmt->ops[1]);
+      break;
+    }
+    case ST_LEA: {
+      effect->uses = op_address(&stmt->ops[0]);
+      effect_write(effect, &stmt->ops[1]);
+      break;
+    }
+    case ST_NEG:
+    case ST_NOT: {
+      effect_read(effect, &stmt->ops[0]);
+      effect_write(effect, &stmt->ops[0]);
+      effect->flags = true;
+      break;
+    }
+    case ST_MUL:
+    case ST_IMUL:
+    case ST_DIV:
+    case ST_IDIV: {
+      if (stmt->nops == 1) {
+        effect_read(effect, &stmt->ops[0]);
+        effect->uses = effect->uses | BIT(REG_AX) | BIT(REG_DX);
+        effect->defs = effect->defs | BIT(REG_AX) | BIT(REG_DX);
+        effect->kills = effect->kills | BIT(REG_AX) | BIT(REG_DX);
+        effect->flags = true;
+        break;
+      }
+      effect_read(effect, &stmt->ops[0]);
+      effect_read(effect, &stmt->ops[1]);
+      effect_write(effect, &stmt->ops[1]);
+      effect->flags = true;
+      break;
+    }
+    case ST_ADD:
+    case ST_SUB:
+    case ST_AND:
+    case ST_XOR:
+    case ST_OR:
+    case ST_SAL:
+    case ST_SAR:
+    case ST_SHR: {
+      effect_read(effect, &stmt->ops[0]);
+      effect_read(effect, &stmt->ops[1]);
+      effect_write(effect, &stmt->ops[1]);
+      effect->flags = true;
+      break;
+    }
+    case ST_CMP:
+    case ST_TEST: {
+      effect_read(effect, &stmt->ops[0]);
+      effect_read(effect, &stmt->ops[1]);
+      effect->flags = true;
+      break;
+    }
+    case ST_SETE:
+    case ST_SETNE:
+    case ST_SETB:
+    case ST_SETL:
+    case ST_SETG:
+    case ST_SETBE:
+    case ST_SETLE:
+    case ST_SETGE: {
+      effect_write(effect, &stmt->ops[0]);
+      break;
+    }
+    case ST_CALL: {
+      effect->uses = CALL_USES;
+      effect->defs = CALL_DEFS;
+      effect->kills = CALL_DEFS;
+      effect->load = true;
+      effect->store = true;
+      effect->flags = true;
+      break;
+    }
+    case ST_REP_STOS: {
+      effect->uses = BIT(REG_AX) | BIT(REG_CX) | BIT(REG_DI);
+      effect->defs = BIT(REG_CX) | BIT(REG_DI);
+      effect->kills = BIT(REG_CX) | BIT(REG_DI);
+      effect->store = true;
+      break;
+    }
+    case ST_REP_MOVS: {
+      effect->uses = BIT(REG_CX) | BIT(REG_SI) | BIT(REG_DI);
+      effect->defs = BIT(REG_CX) | BIT(REG_SI) | BIT(REG_DI);
+      effect->kills = BIT(REG_CX) | BIT(REG_SI) | BIT(REG_DI);
+      effect->load = true;
+      effect->store = true;
+      break;
+    }
+    case ST_MOVD:
+    case ST_MOVDQU:
+    case ST_PADDB:
+    case ST_PADDD:
+    case ST_PXOR:
+    case ST_PCMPEQB:
+    case ST_PMOVMSKB: {
+      effect_read(effect, &stmt->ops[0]);
+      effect_write(effect, &stmt->ops[1]);
+      break;
+    }
+    case ST_PSHUFD: {
+      effect_read(effect, &stmt->ops[1]);
+      effect_write(effect, &stmt->ops[2]);
+      break;
+    }
+    case ST_LEAVE: {
+      effect->uses = BIT(REG_BP);
+      effect->defs = BIT(REG_SP) | BIT(REG_BP);
+      effect->kills = BIT(REG_SP) | BIT(REG_BP);
+      effect->load = true;
+      break;
+    }
+    case ST_JMP: {
+      // indirect jump
+      if (stmt->ops[0].type != EOP_SYM) {
+        effect_read(effect, &stmt->ops[0]);
+      }
+      break;
+    }
+    case ST_JE:
+    case ST_JNE:
+    case ST_JB:
+    case ST_JBE:
+    case ST_JA:
+    case ST_JAE:
+    case ST_JL:
+    case ST_JLE:
+    case ST_JG:
+    case ST_JGE:
+    case ST_JS:
+    case ST_JNS:
+    case ST_RET: {
+      break;
+    }
+    default: assert(false);
+  }
+}
+
+// window
+
+static void window_remove(int i) {
+  for (int j = i; j < count - 1; j++) {
+    memcpy(at(j), at(j + 1), sizeof(Entry));
+  }
+  count--;
+}
+
+static void window_update(int i) {
+  effect_analyze(&at(i)->stmt, &at(i)->effect);
+}
+
+static void window_flush(void) {
+  for (int i = 0; i < count; i++) {
+    emit_output(&at(i)->stmt);
+  }
+  head = 0;
+  count = 0;
+}
+
+// the registers written by the instructions in [begin, end)
+static int defs_between(int begin, int end) {
+  int defs = 0;
+  for (int i = begin; i < end; i++) {
+    defs = defs | at(i)->effect.defs;
+  }
+  return defs;
+}
+
+static bool check_reg(EmitOp *op, RegCode regcode) {
+  return op->type == EOP_REG && op->regcode == regcode;
+}
+
+static bool check_imm(EmitOp *op, unsigned long long imm) {
+  return op->type == EOP_IMM && op->imm == imm;
+}
+
+static bool check_memory(EmitOp *op) {
+  return op->type == EOP_MEM || op->type == EOP_RIP;
+}
+
+static bool check_same_memory(EmitOp *op1, EmitOp *op2) {
+  if (op1->type != op2->type) return false;
+
+  if (op1->type == EOP_MEM) {
+    if (op1->base != op2->base || op1->disp != op2->disp || op1->sib != op2->sib) return false;
+    return !op1->sib || (op1->index == op2->index && op1->scale == op2->scale);
+  }
+  if (op1->type == EOP_RIP) {
+    if (op1->ident || op2->ident) {
+      return op1->ident && op2->ident && strcmp(op1->ident, op2->ident) == 0;
+    }
+    return op1->prefix == op2->prefix && op1->label == op2->label;
+  }
+  return false;
+}
+
+// movq %x, %y
+static bool check_copy(EmitStmt *stmt) {
+  return stmt->type == ST_MOV && stmt->suffix == INST_QUAD &&
+    stmt->ops[0].type == EOP_REG && stmt->ops[1].type == EOP_REG;
+}
+
+// the instruction only writes the destination register.
+static bool check_pure(EmitStmt *stmt) {
+  switch (stmt->type) {
+    case ST_MOV:
+    case ST_MOVZB:
+    case ST_MOVZW:
+    case ST_MOVSB:
+    case ST_MOVSW:
+    case ST_MOVSL:
+    case ST_LEA:
+      return stmt->ops[1].type == EOP_REG;
+    default:
+      return false;
+  }
+}
+
+// rules
+
+// push %x; ...; pop %y
+// the pushed value is forwarded if the stack is not touched between them.
+static bool rule_push_pop(void) {
+  EmitStmt *pop = &at(count - 1)->stmt;
+  if (pop->type != ST_POP || pop->ops[0].type != EOP_REG) return false;
+
+  for (int i = count - 2; i >= 0; i--) {
+    EmitStmt *push = &at(i)->stmt;
+    if (push->type == ST_PUSH && push->ops[0].type == EOP_REG) {
+      RegCode src = push->ops[0].regcode;
+      RegCode dest = pop->ops[0].regcode;
+      if (defs_between(i + 1, count - 1) & BIT(src)) return false;
+
+      hits[RULE_PUSH_POP]++;
+      pop->type = ST_MOV;
+      pop->nops = 2;
+      memcpy(&pop->ops[1], &pop->ops[0], sizeof(EmitOp));
+      memcpy(&pop->ops[0], &push->ops[0], sizeof(EmitOp));
+      window_update(count - 1);
+      window_remove(i);
+
+      if (src == dest) {
+        window_remove(count - 1);
+        return true;
+      }
+      return false;
+    }
+
+    Effect *effect = &at(i)->effect;
+    if ((effect->uses | effect->defs) & BIT(REG_SP)) return false;
+  }
+
+  return false;
+}
+
+// find the lea which computes the value of the register at the position
+// through the register copies.
+static int find_address(int end, RegCode regcode) {
+  for (int i = end - 1; i >= 0; i--) {
+    EmitStmt *stmt = &at(i)->stmt;
+    if (!(at(i)->effect.defs & BIT(regcode))) continue;
+
+    if (stmt->type == ST_LEA && stmt->suffix == INST_QUAD) return i;
+    if (check_copy(stmt)) return find_address(i, stmt->ops[0].regcode);
+    return -1;
+  }
+  return -1;
+}
+
+// lea M, %x; ...; op disp(%x)
+// the address computed by lea is folded into the memory operand.
+static void rule_address(void) {
+  EmitStmt *stmt = &at(count - 1)->stmt;
+  for (int i = 0; i < stmt->nops; i++) {
+    EmitOp *op = &stmt->ops[i];
+    if (op->type != EOP_MEM || op->sib || op->base == REG_BP || op->base == REG_SP) continue;
+
+    int lea = find_address(count - 1, op->base);
+    if (lea < 0) continue;
+
+    // the registers of the address should not be changed after lea.
+    EmitOp *addr = &at(lea)->stmt.ops[0];
+    if (addr->type == EOP_RIP && op->disp != 0) continue;
+    if (defs_between(lea, count - 1) & op_address(addr)) continue;
+
+    hits[RULE_ADDRESS]++;
+    int disp = op->disp;
+    memcpy(op, addr, sizeof(EmitOp));
+    op->disp += disp;
+    window_update(count - 1);
+  }
+}
+
+// mov %x, M; ...; mov M, %y -> mov %x, %y
+// mov M, %x; ...; mov M, %y -> mov %x, %y
+// the value in memory is forwarded if no memory is written between them.
+static bool rule_load(void) {
+  EmitStmt *load = &at(count - 1)->stmt;
+  if (load->type != ST_MOV || !check_memory(&load->ops[0]) || load->ops[1].type != EOP_REG) return false;
+
+  EmitOp *mem = &load->ops[0];
+  for (int i = count - 2; i >= 0; i--) {
+    EmitStmt *stmt = &at(i)->stmt;
+    Effect *effect = &at(i)->effect;
+
+    RegCode src;
+    bool stored = false;
+    if (stmt->type == ST_MOV && stmt->suffix == load->suffix && stmt->ops[0].type == EOP_REG &&
+        check_same_memory(&stmt->ops[1], mem)) {
+      src = stmt->ops[0].regcode;
+      stored = true;
+    } else if (stmt->type == ST_MOV && stmt->suffix == load->suffix && stmt->ops[1].type == EOP_REG &&
+        check_same_memory(&stmt->ops[0], mem) && !(op_address(mem) & BIT(stmt->ops[1].regcode))) {
+      src = stmt->ops[1].regcode;
+    } else {
+      if (effect->store) return false;
+      if (effect->defs & op_address(mem)) return false;
+      continue;
+    }
+
+    if (defs_between(i + 1, count - 1) & (BIT(src) | op_address(mem))) return false;
+
+    hits[RULE_LOAD]++;
+    RegCode dest = load->ops[1].regcode;
+
+    // movl zero-extends the loaded value, but the stored value may have
+    // the upper bits.
+    if (src == dest && (load->suffix != INST_LONG || !stored)) {
+      window_remove(count - 1);
+      return true;
+    }
+
+    load->ops[0].type = EOP_REG;
+    load->ops[0].regcode = src;
+    load->ops[0].regtype = load->ops[1].regtype;
+    window_update(count - 1);
+    return false;
+  }
+
+  return false;
+}
+
+// mov M, %x; ...; mov %x, M
+// mov %x, M; ...; mov %x, M
+// the store is removed if the memory already holds the value.
+static bool rule_store(void) {
+  EmitStmt *store = &at(count - 1)->stmt;
+  if (store->type != ST_MOV || store->ops[0].type != EOP_REG || !check_memory(&store->ops[1])) return false;
+
+  RegCode src = store->ops[0].regcode;
+  EmitOp *mem = &store->ops[1];
+  for (int i = count - 2; i >= 0; i--) {
+    EmitStmt *stmt = &at(i)->stmt;
+    Effect *effect = &at(i)->effect;
+
+    bool match = false;
+    if (stmt->type == ST_MOV && stmt->suffix == store->suffix) {
+      if (check_reg(&stmt->ops[0], src) && check_same_memory(&stmt->ops[1], mem)) {
+        match = true;
+      } else if (check_reg(&stmt->ops[1], src) && check_same_memory(&stmt->ops[0], mem) &&
+          !(op_address(mem) & BIT(src))) {
+        match = true;
+      }
+    }
+
+    if (!match) {
+      if (effect->store) return false;
+      if (effect->defs & (BIT(src) | op_address(mem))) return false;
+      continue;
+    }
+
+    if (defs_between(i + 1, count - 1) & (BIT(src) | op_address(mem))) return false;
+
+    hits[RULE_STORE]++;
+    window_remove(count - 1);
+    return true;
+  }
+
+  return false;
+}
+
+// movq %x, %x
+// movq %x, %y; ...; movq %y, %x
+// movq %x, %p; ...; movq %p, %y -> movq %x, %y (%p is an expression temporary)
+static bool rule_copy(void) {
+  EmitStmt *copy = &at(count - 1)->stmt;
+  if (!check_copy(copy)) return false;
+
+  RegCode src = copy->ops[0].regcode;
+  RegCode dest = copy->ops[1].regcode;
+  if (src == dest) {
+    hits[RULE_COPY]++;
+    window_remove(count - 1);
+    return true;
+  }
+
+  for (int i = count - 2; i >= 0; i--) {
+    EmitStmt *stmt = &at(i)->stmt;
+    Effect *effect = &at(i)->effect;
+    if ((POOL & BIT(src)) && (effect->uses & BIT(src))) return false;
+    if (!(effect->defs & (BIT(src) | BIT(dest)))) continue;
+    if (!check_copy(stmt)) return false;
+
+    // the temporary is not read after this copy, so the value is forwarded.
+    RegCode from = stmt->ops[0].regcode;
+    RegCode to = stmt->ops[1].regcode;
+    if ((POOL & BIT(src)) && to == src && !(defs_between(i + 1, count - 1) & BIT(from))) {
+      hits[RULE_COPY]++;
+      window_remove(i);
+      if (from == dest) {
+        window_remove(count - 1);
+        return true;
+      }
+      at(count - 1)->stmt.ops[0].regcode = from;
+      window_update(count - 1);
+      return false;
+    }
+
+    if ((from == src && to == dest) || (from == dest && to == src)) {
+      hits[RULE_COPY]++;
+      window_remove(count - 1);
+      return true;
+    }
+    return false;
+  }
+
+  return false;
+}
+
+static int remove_dead(int end, RegCode regcode);
+
+// remove the instruction at the position.
+// the definitions of the registers used by the instruction may become dead.
+static void remove_inst(int pos) {
+  int uses = at(pos)->effect.uses;
+  window_remove(pos);
+
+  for (int regcode = 0; regcode < 16; regcode++) {
+    if (!(uses & BIT(regcode))) continue;
+
+    for (int i = pos; i < count; i++) {
+      Effect *effect = &at(i)->effect;
+      if (effect->uses & BIT(regcode)) break;
+      if (effect->kills & BIT(regcode)) {
+        if (remove_dead(i, regcode) >= 0) {
+          pos--;
+        }
+        break;
+      }
+    }
+  }
+}
+
+// remove the last definition of the register before the position
+// if it is not used until the position.
+// returns the position of the removed instruction, or -1.
+static int remove_dead(int end, RegCode regcode) {
+  for (int i = end - 1; i >= 0; i--) {
+    Effect *effect = &at(i)->effect;
+    if (effect->uses & BIT(regcode)) return -1;
+    if (effect->defs & BIT(regcode)) {
+      if (!check_pure(&at(i)->stmt) || !(effect->kills & BIT(regcode))) return -1;
+
+      hits[RULE_DEAD_MOVE]++;
+      remove_inst(i);
+      return i;
+    }
+  }
+  return -1;
+}
+
+// the registers overwritten by the last instruction
+static void rule_dead_move(void) {
+  Effect *effect = &at(count - 1)->effect;
+  int kills = effect->kills & ~effect->uses;
+  for (int regcode = 0; regcode < 16; regcode++) {
+    if (kills & BIT(regcode)) {
+      remove_dead(count - 1, regcode);
+    }
+  }
+}
+
+// setcc %al; movzbl %al, %eax; ...; test %rax, %rax; je L
+// the conditional jump uses the flags of setcc directly.
+static void rule_setcc_jump(void) {
+  EmitStmt *jump = &at(count - 1)->stmt;
+  if ((jump->type != ST_JE && jump->type != ST_JNE) || count < 4) return;
+
+  // cmp $0, %rax or test %rax, %rax
+  EmitStmt *cmp = &at(count - 2)->stmt;
+  bool zero_cmp = cmp->type == ST_CMP && check_imm(&cmp->ops[0], 0);
+  bool zero_test = cmp->type == ST_TEST && check_reg(&cmp->ops[0], REG_AX);
+  if ((!zero_cmp && !zero_test) || !check_reg(&cmp->ops[1], REG_AX)) return;
+
+  for (int i = count - 3; i >= 1; i--) {
+    EmitStmt *stmt = &at(i)->stmt;
+    Effect *effect = &at(i)->effect;
+
+    if (stmt->type == ST_MOVZB && check_reg(&stmt->ops[0], REG_AX) && check_reg(&stmt->ops[1], REG_AX)) {
+      EmitStmt *setcc = &at(i - 1)->stmt;
+      if (setcc->type < ST_SETE || ST_SETGE < setcc->type) return;
+
+      // je jumps if the condition of setcc is false.
+      StmtType type = emit_setcc_jcc(setcc->type);
+
+      hits[RULE_SETCC_JUMP]++;
+      jump->type = jump->type == ST_JNE ? type : emit_negate_jcc(type);
+      window_update(count - 1);
+      window_remove(count - 2);
+      return;
+    }
+
+    if (effect->flags || (effect->defs & BIT(REG_AX))) return;
+  }
+}
+
+// the expression temporaries are dead at the end of the basic block.
+static void block_end(void) {
+  bool removed = true;
+  while (removed) {
+    removed = false;
+    for (int regcode = 0; regcode < 16; regcode++) {
+      if ((TEMPS & BIT(regcode)) && remove_dead(count, regcode) >= 0) {
+        removed = true;
+      }
+    }
+  }
+}
+
+static void optimize(void) {
+  if (rule_push_pop()) return;
+  rule_address();
+  rule_dead_move();
+  if (rule_load()) return;
+  if (rule_store()) return;
+  if (rule_copy()) return;
+  rule_setcc_jump();
+}
+
+void peephole(EmitStmt *stmt) {
+  // labels and directives
+  if (stmt->type < ST_PUSH) {
+    block_end();
+    window_flush();
+    emit_output(stmt);
+    return;
+  }
+
+  if (count == WINDOW) {
+    emit_output(&at(0)->stmt);
+    head = (head + 1) % WINDOW;
+    count--;
+  }
+
+  memcpy(&at(count)->stmt, stmt, sizeof(EmitStmt));
+  window_update(count);
+  count++;
+  optimize();
+
+  if (stmt->type == ST_JMP || emit_check_jcc(stmt->type) || stmt->type == ST_RET) {
+    block_end();
+    window_flush();
+  }
+}
+
+void peephole_flush(void) {
+  block_end();
+  window_flush();
+}
+
+void peephole_report(void) {
+  fprintf(stderr, "%-16s %10s\n", "rule", "hits");
+  for (int i = 0; i < RULES; i++) {
+    fprintf(stderr, "%-16s %10ld\n", rule_names[i], hits[i]);
+  }
+}
@@ -10,11 +10,16 @@ typedef struct decl_attribution {
 // --- symbols ---
 
 static int stack_size;
+static Vector *locals; // Vector<Symbol*>
+static Vector *refs;   // Vector<Symbol*>, NULL out of functions
+static Vector *strings; // Vector<int>, NULL out of functions
+static int loop_depth;
 
 static void put_variable(DeclAttribution *attr, Symbol *symbol, bool global) {
   if (symbol->prev && symbol->prev->definition) {
     ERROR(symbol->token, "duplicated declaration: %s.", symbol->identifier);
   }
+  symbol->no_return = (attr && attr->sp_noreturn) || (symbol->prev && symbol->prev->no_return);
 
   if (global) {
     if (attr && attr->sp_extern) {
@@ -45,6 +50,7 @@ static void put_variable(DeclAttribution *attr, Symbol *symbol, bool global) {
     }
 
     symbol->offset = stack_size;
+    vector_push(locals, symbol);
   }
 }
 
@@ -70,7 +76,7 @@ static Type *lookup_tag(char *tag) {
 // --- types ---
 
 static Type *type_new(TypeType ty_type, int size, int align, bool complete) {
-  Type *type = calloc(1, sizeof(Type));
+  Type *type = arena_alloc(ARENA_PARSE, sizeof(Type));
   type->ty_type = ty_type;
   type->size = size;
   type->align = align;
@@ -165,7 +171,7 @@ static Type *type_struct(Type *type, Vector *symbols) {
       size = size / type->align * type->align + type->align;
     }
 
-    Member *member = calloc(1, sizeof(Member));
+    Member *member = arena_alloc(ARENA_PARSE, sizeof(Member));
     member->type = type;
     member->offset = size;
     map_put(members, symbol->identifier, member);
@@ -200,25 +206,25 @@ static Type *type_struct(Type *type, Vector *symbols) {
 static Type *type_va_list(void) {
   Vector *symbols = vector_new();
 
-  Symbol *gp_offset = calloc(1, sizeof(Symbol));
+  Symbol *gp_offset = arena_alloc(ARENA_PARSE, sizeof(Symbol));
   gp_offset->sy_type = SY_VARIABLE;
   gp_offset->identifier = "gp_offset";
   gp_offset->type = type_int();
   vector_push(symbols, gp_offset);
 
-  Symbol *fp_offset = calloc(1, sizeof(Symbol));
+  Symbol *fp_offset = arena_alloc(ARENA_PARSE, sizeof(Symbol));
   fp_offset->sy_type = SY_VARIABLE;
   fp_offset->identifier = "fp_offset";
   fp_offset->type = type_int();
   vector_push(symbols, fp_offset);
 
-  Symbol *overflow_arg_area = calloc(1, sizeof(Symbol));
+  Symbol *overflow_arg_area = arena_alloc(ARENA_PARSE, sizeof(Symbol));
   overflow_arg_area->sy_type = SY_VARIABLE;
   overflow_arg_area->identifier = "overflow_arg_area";
   overflow_arg_area->type = type_pointer(type_void());
   vector_push(symbols, overflow_arg_area);
 
-  Symbol *reg_save_area = calloc(1, sizeof(Symbol));
+  Symbol *reg_save_area = arena_alloc(ARENA_PARSE, sizeof(Symbol));
   reg_save_area->sy_type = SY_VARIABLE;
   reg_save_area->identifier = "reg_save_area";
   reg_save_area->type = type_pointer(type_void());
@@ -262,7 +268,8 @@ static bool check_scalar(Type *type) {
 // --- expressions ---
 
 static Expr *expr_identifier(char *identifier, Symbol *symbol, Token *token) {
-  Expr *expr = calloc(1, sizeof(Expr));
+  Expr *expr = arena_alloc(ARENA_PARSE, sizeof(Expr));
+  stats_count(STAT_NODES, 1);
   expr->nd_type = ND_IDENTIFIER;
   expr->identifier = identifier;
   expr->symbol = symbol;
@@ -271,7 +278,8 @@ static Expr *expr_identifier(char *identifier, Symbol *symbol, Token *token) {
 }
 
 static Expr *expr_integer(unsigned long long int_value, Token *token) {
-  Expr *expr = calloc(1, sizeof(Expr));
+  Expr *expr = arena_alloc(ARENA_PARSE, sizeof(Expr));
+  stats_count(STAT_NODES, 1);
   expr->nd_type = ND_INTEGER;
   expr->int_value = int_value;
   expr->token = token;
@@ -279,7 +287,8 @@ static Expr *expr_integer(unsigned long long int_value, Token *token) {
 }
 
 static Expr *expr_dot(Expr *_expr, char *member, Token *token) {
-  Expr *expr = calloc(1, sizeof(Expr));
+  Expr *expr = arena_alloc(ARENA_PARSE, sizeof(Expr));
+  stats_count(STAT_NODES, 1);
   expr->nd_type = ND_DOT;
   expr->expr = _expr;
   expr->member = member;
@@ -288,7 +297,8 @@ static Expr *expr_dot(Expr *_expr, char *member, Token *token) {
 }
 
 static Expr *expr_cast(TypeName *type_name, Expr *_expr, Token *token) {
-  Expr *expr = calloc(1, sizeof(Expr));
+  Expr *expr = arena_alloc(ARENA_PARSE, sizeof(Expr));
+  stats_count(STAT_NODES, 1);
   expr->nd_type = ND_CAST;
   expr->expr = _expr;
   expr->type_name = type_name;
@@ -297,7 +307,8 @@ static Expr *expr_cast(TypeName *type_name, Expr *_expr, Token *token) {
 }
 
 static Expr *expr_unary(NodeType nd_type, Expr *_expr, Token *token) {
-  Expr *expr = calloc(1, sizeof(Expr));
+  Expr *expr = arena_alloc(ARENA_PARSE, sizeof(Expr));
+  stats_count(STAT_NODES, 1);
   expr->nd_type = nd_type;
   expr->expr = _expr;
   expr->token = token;
@@ -305,7 +316,8 @@ static Expr *expr_unary(NodeType nd_type, Expr *_expr, Token *token) {
 }
 
 static Expr *expr_binary(NodeType nd_type, Expr *lhs, Expr *rhs, Token *token) {
-  Expr *expr = calloc(1, sizeof(Expr));
+  Expr *expr = arena_alloc(ARENA_PARSE, sizeof(Expr));
+  stats_count(STAT_NODES, 1);
   expr->nd_type = nd_type;
   expr->lhs = lhs;
   expr->rhs = rhs;
@@ -367,6 +379,18 @@ static Expr *insert_cast(Type *type, Expr *expr, Token *token) {
   return cast;
 }
 
+// the struct value is copied from the object at its address,
+// so that it should be an lvalue or the result of an assignment.
+static Expr *insert_copy(Type *type, Expr *expr, Token *token) {
+  if (type->ty_type == TY_STRUCT && type == expr->type) {
+    if (check_lvalue(expr) || expr->nd_type == ND_ASSIGN) {
+      return expr;
+    }
+  }
+
+  return insert_cast(type, expr, token);
+}
+
 // integer promotion
 static Type *promote_integer(Expr **expr) {
   TypeType ty_types[] = { TY_BOOL, TY_CHAR, TY_UCHAR, TY_SHORT, TY_USHORT };
@@ -396,17 +420,37 @@ static Type *convert_arithmetic(Expr **lhs, Expr **rhs) {
   return type;
 }
 
+// a local variable is updated without taking its address,
+// so that it can be promoted to a register.
+static bool check_local(Expr *expr) {
+  return expr->nd_type == ND_IDENTIFIER && expr->symbol->link == LN_NONE;
+}
+
 static Expr *comp_assign_post(NodeType nd_type, Expr *lhs, Expr *rhs, Token *token) {
   lhs = sema_expr(lhs);
 
-  Symbol *sym_addr = calloc(1, sizeof(Symbol));
+  // (x = x + 1, (T) (x - 1))
+  // the previous value of _Bool can not be restored by the inverse operation.
+  if (check_local(lhs) && lhs->type->ty_type != TY_BOOL) {
+    Expr *op = expr_binary(nd_type, expr_identifier(lhs->identifier, lhs->symbol, token), rhs, token);
+    Expr *assign = sema_expr(expr_binary(ND_ASSIGN, lhs, op, token));
+
+    NodeType inverse = nd_type == ND_ADD ? ND_SUB : ND_ADD;
+    Expr *prev = expr_binary(inverse, expr_identifier(lhs->identifier, lhs->symbol, token), rhs, token);
+    Expr *cast = insert_cast(lhs->type, sema_expr(prev), token);
+
+    Expr *comma = expr_binary(ND_COMMA, assign, cast, token);
+    return sema_expr(comma);
+  }
+
+  Symbol *sym_addr = arena_alloc(ARENA_PARSE, sizeof(Symbol));
   sym_addr->sy_type = SY_VARIABLE;
   sym_addr->link = LN_NONE;
   sym_addr->type = type_pointer(lhs->type);
   sym_addr->token = token;
   put_variable(NULL, sym_addr, false);
 
-  Symbol *sym_val = calloc(1, sizeof(Symbol));
+  Symbol *sym_val = arena_alloc(ARENA_PARSE, sizeof(Symbol));
   sym_val->sy_type = SY_VARIABLE;
   sym_val->link = LN_NONE;
   sym_val->type = lhs->type;
@@ -417,15 +461,16 @@ static Expr *comp_assign_post(NodeType nd_type, Expr *lhs, Expr *rhs, Token *tok
   Expr *addr = expr_unary(ND_ADDRESS, lhs, token);
   Expr *addr_assign = expr_binary(ND_ASSIGN, addr_ident, addr, token);
 
+  // the variables are read through their own nodes, so that the reads are counted.
   Expr *val_ident = expr_identifier(NULL, sym_val, token);
-  Expr *val = expr_unary(ND_INDIRECT, addr_ident, token);
+  Expr *val = expr_unary(ND_INDIRECT, expr_identifier(NULL, sym_addr, token), token);
   Expr *val_assign = expr_binary(ND_ASSIGN, val_ident, val, token);
 
   Expr *lvalue = expr_unary(ND_INDIRECT, addr_assign, token);
   Expr *op = expr_binary(nd_type, val_assign, rhs, token);
   Expr *assign = expr_binary(ND_ASSIGN, lvalue, op, token);
 
-  Expr *comma = expr_binary(ND_COMMA, assign, val_ident, token);
+  Expr *comma = expr_binary(ND_COMMA, assign, expr_identifier(NULL, sym_val, token), token);
 
   return sema_expr(comma);
 }
@@ -433,7 +478,14 @@ static Expr *comp_assign_post(NodeType nd_type, Expr *lhs, Expr *rhs, Token *tok
 static Expr *comp_assign_pre(NodeType nd_type, Expr *lhs, Expr *rhs, Token *token) {
   lhs = sema_expr(lhs);
 
-  Symbol *sym_addr = calloc(1, sizeof(Symbol));
+  // x = x op rhs
+  if (check_local(lhs)) {
+    Expr *op = expr_binary(nd_type, expr_identifier(lhs->identifier, lhs->symbol, token), rhs, token);
+    Expr *assign = expr_binary(ND_ASSIGN, lhs, op, token);
+    return sema_expr(assign);
+  }
+
+  Symbol *sym_addr = arena_alloc(ARENA_PARSE, sizeof(Symbol));
   sym_addr->sy_type = SY_VARIABLE;
   sym_addr->link = LN_NONE;
   sym_addr->type = type_pointer(lhs->type);
@@ -444,7 +496,7 @@ static Expr *comp_assign_pre(NodeType nd_type, Expr *lhs, Expr *rhs, Token *toke
   Expr *addr = expr_unary(ND_ADDRESS, lhs, token);
   Expr *addr_assign = expr_binary(ND_ASSIGN, addr_ident, addr, token);
 
-  Expr *val = expr_unary(ND_INDIRECT, addr_ident, token);
+  Expr *val = expr_unary(ND_INDIRECT, expr_identifier(NULL, sym_addr, token), token);
 
   Expr *lvalue = expr_unary(ND_INDIRECT, addr_assign, token);
   Expr *op = expr_binary(nd_type, val, rhs, token);
@@ -486,9 +538,85 @@ static Expr *sema_va_end(Expr *expr) {
   return expr;
 }
 
+// the argument of the builtin function is converted to the type of
+// the parameter of the library function.
+static void sema_builtin_arg(Expr *expr, int index, Type *type, char *name) {
+  Expr *arg = sema_expr(expr->args->buffer[index]);
+  if (check_pointer(type) ? !check_pointer(arg->type) : !check_integer(arg->type)) {
+    ERROR(arg->token, "invalid argument of '%s'.", name);
+  }
+  expr->args->buffer[index] = insert_cast(type, arg, expr->token);
+}
+
+static Expr *sema_memcpy(Expr *expr) {
+  sema_builtin_arg(expr, 0, type_pointer(type_void()), "__builtin_memcpy");
+  sema_builtin_arg(expr, 1, type_pointer(type_void()), "__builtin_memcpy");
+  sema_builtin_arg(expr, 2, type_ulong(), "__builtin_memcpy");
+
+  expr->type = type_pointer(type_void());
+
+  return expr;
+}
+
+static Expr *sema_memset(Expr *expr) {
+  sema_builtin_arg(expr, 0, type_pointer(type_void()), "__builtin_memset");
+  sema_builtin_arg(expr, 1, type_int(), "__builtin_memset");
+  sema_builtin_arg(expr, 2, type_ulong(), "__builtin_memset");
+
+  expr->type = type_pointer(type_void());
+
+  return expr;
+}
+
+// the length of a string literal is a constant,
+// and the others are left to the library function.
+static Expr *sema_strlen(Expr *expr) {
+  Expr *arg = expr->args->buffer[0];
+  if (arg->nd_type == ND_STRING) {
+    int length = 0;
+    while (arg->string_literal->buffer[length] != '\0') {
+      length++;
+    }
+    Expr *int_const = expr_integer(length, expr->token);
+    int_const->type = type_ulong();
+    return int_const;
+  }
+
+  sema_builtin_arg(expr, 0, type_pointer(type_char()), "__builtin_strlen");
+
+  Expr *call = expr_unary(ND_CALL, expr_identifier("strlen", NULL, expr->token), expr->token);
+  call->args = expr->args;
+  call->type = type_ulong();
+
+  return call;
+}
+
+static Expr *sema_strcmp(Expr *expr) {
+  sema_builtin_arg(expr, 0, type_pointer(type_char()), "__builtin_strcmp");
+  sema_builtin_arg(expr, 1, type_pointer(type_char()), "__builtin_strcmp");
+
+  expr->type = type_int();
+
+  return expr;
+}
+
+// the uses in loops are weighted by 8 for each level of nesting.
+static int loop_weight(void) {
+  int weight = 1;
+  for (int i = 0; i < loop_depth && i < 4; i++) {
+    weight *= 8;
+  }
+  return weight;
+}
+
 static Expr *sema_identifier(Expr *expr) {
   if (expr->symbol) {
     expr->type = expr->symbol->type;
+
+    expr->symbol->uses += loop_weight();
+    if (refs && expr->symbol->sy_type == SY_VARIABLE && expr->symbol->link != LN_NONE) {
+      vector_push(refs, expr->symbol);
+    }
   } else {
     ERROR(expr->token, "undefined variable: %s.", expr->identifier);
   }
@@ -528,6 +656,9 @@ static Expr *sema_enum_const(Expr *expr) {
 static Expr *sema_string(Expr *expr) {
   int length = expr->string_literal->length;
   expr->type = type_array(type_array_incomplete(type_char()), length);
+  if (strings) {
+    vector_pushi(strings, expr->string_label);
+  }
 
   return expr;
 }
@@ -648,6 +779,11 @@ static Expr *sema_address(Expr *expr) {
     ERROR(expr->token, "operand should be lvalue.");
   }
 
+  // escape analysis
+  if (expr->expr->nd_type == ND_IDENTIFIER) {
+    expr->expr->symbol->escape = true;
+  }
+
   return expr;
 }
 
@@ -923,8 +1059,13 @@ static Expr *sema_assign(Expr *expr) {
   expr->lhs = sema_expr(expr->lhs);
   expr->rhs = sema_expr(expr->rhs);
 
+  // the variable is not read by the assignment.
+  if (expr->lhs->nd_type == ND_IDENTIFIER) {
+    expr->lhs->symbol->stores += loop_weight();
+  }
+
   if (check_lvalue(expr->lhs)) {
-    expr->rhs = insert_cast(expr->lhs->type, expr->rhs, expr->token);
+    expr->rhs = insert_copy(expr->lhs->type, expr->rhs, expr->token);
     expr->type = expr->lhs->type;
   } else {
     ERROR(expr->token, "invalid operands.");
@@ -970,6 +1111,10 @@ static Expr *sema_expr(Expr *expr) {
     case ND_VA_START: expr = sema_va_start(expr); break;
     case ND_VA_ARG: expr = sema_va_arg(expr); break;
     case ND_VA_END: expr = sema_va_end(expr); break;
+    case ND_MEMCPY: expr = sema_memcpy(expr); break;
+    case ND_MEMSET: expr = sema_memset(expr); break;
+    case ND_STRLEN: expr = sema_strlen(expr); break;
+    case ND_STRCMP: expr = sema_strcmp(expr); break;
     case ND_IDENTIFIER: expr = sema_identifier(expr); break;
     case ND_INTEGER: expr = sema_integer(expr); break;
     case ND_ENUM_CONST: expr = sema_enum_const(expr); break;
@@ -1031,7 +1176,7 @@ static Expr *sema_expr(Expr *expr) {
 }
 
 static Expr *sema_const_expr(Expr *expr) {
-  expr = sema_expr(expr);
+  expr = fold_expr(sema_expr(expr));
 
   if (expr->nd_type != ND_INTEGER) {
     ERROR(expr->token, "invalid integer constant expression.");
@@ -1217,7 +1362,7 @@ static DeclAttribution *sema_specs(Vector *specs, Token *token) {
     ERROR(token, "invalid type-specifiers.");
   }
 
-  DeclAttribution *attr = calloc(1, sizeof(DeclAttribution));
+  DeclAttribution *attr = arena_alloc(ARENA_PARSE, sizeof(DeclAttribution));
   attr->type = type;
   attr->sp_extern = sp_extern;
   attr->sp_static = sp_static;
@@ -1319,9 +1464,7 @@ static Type *sema_declarator(Declarator *decl, Type *type) {
   if (decl->decl_type == DECL_ARRAY) {
     Type *array = type_array_incomplete(type);
     if (decl->size) {
-      if (decl->size->nd_type != ND_INTEGER) {
-        ERROR(decl->size->token, "only integer constant is supported for array size.");
-      }
+      decl->size = sema_const_expr(decl->size);
       array = type_array(array, decl->size->int_value);
     }
     return sema_declarator(decl->decl, array);
@@ -1369,13 +1512,17 @@ static void sema_initializer(Initializer *init, Type *type, bool global) {
       sema_initializer(init->list->buffer[i], type->array_of, global);
     }
   } else {
+    init->expr = sema_expr(init->expr);
+    init->expr = insert_copy(type, init->expr, init->token);
+
     if (global) {
-      if (init->expr->nd_type != ND_INTEGER && init->expr->nd_type != ND_STRING) {
+      // the cast to pointer type remains for the string literal and null pointer.
+      init->expr = fold_expr(init->expr);
+      Expr *expr = init->expr->nd_type == ND_CAST ? init->expr->expr : init->expr;
+      if (expr->nd_type != ND_INTEGER && expr->nd_type != ND_STRING) {
         ERROR(init->expr->token, "initializer expression should be integer constant or string literal.");
       }
     }
-    init->expr = sema_expr(init->expr);
-    init->expr = insert_cast(type, init->expr, init->token);
   }
 }
 
@@ -1413,19 +1560,21 @@ static void loop_begin(Stmt *stmt) {
   scope_begin();
   vector_push(continue_targets, stmt);
   vector_push(break_targets, stmt);
+  loop_depth++;
 }
 
 static void loop_end(void) {
   scope_end();
   vector_pop(continue_targets);
   vector_pop(break_targets);
+  loop_depth--;
 }
 
 static void sema_label(Stmt *stmt) {
   for (int i = 0; i < label_stmts->length; i++) {
     Stmt *label_stmt = label_stmts->buffer[i];
     char *label_ident = label_stmt->label_ident;
-    if (strcmp(stmt->label_ident, label_ident) == 0) {
+    if (stmt->label_ident == label_ident) {
       ERROR(stmt->token, "duplicated label declaration: %s.", stmt->label_ident);
     }
   }
@@ -1442,7 +1591,7 @@ static void sema_case(Stmt *stmt) {
     ERROR(stmt->token, "'case' should appear in switch statement.");
   }
 
-  stmt->case_const = sema_expr(stmt->case_const);
+  stmt->case_const = sema_const_expr(stmt->case_const);
 
   sema_stmt(stmt->case_stmt);
 }
@@ -1644,6 +1793,9 @@ static void sema_func(Func *func) {
   }
 
   stack_size = func->symbol->type->ellipsis ? 176 : 0;
+  locals = vector_new();
+  refs = vector_new();
+  strings = vector_new();
 
   // initialize statements
   label_stmts = vector_new();
@@ -1679,7 +1831,7 @@ static void sema_func(Func *func) {
     for (int j = 0; j < label_stmts->length; j++) {
       Stmt *label_stmt = label_stmts->buffer[j];
       char *label_ident = label_stmt->label_ident;
-      if (strcmp(stmt->goto_ident, label_ident) == 0) {
+      if (stmt->goto_ident == label_ident) {
         stmt->goto_target = label_stmt;
       }
     }
@@ -1690,6 +1842,11 @@ static void sema_func(Func *func) {
 
   func->stack_size = stack_size;
   func->label_stmts = label_stmts;
+  func->locals = locals;
+  func->refs = refs;
+  func->strings = strings;
+  refs = NULL;
+  strings = NULL;
 }
 
 static void sema_trans_unit(TransUnit *trans_unit) {
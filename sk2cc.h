@@ -65,10 +65,54 @@ void perror(char *s);
 // stdlib.h
 void *calloc(size_t nmemb, size_t size);
 void *realloc(void *ptr, size_t size);
-void exit(int status);
+void free(void *ptr);
+noreturn void exit(int status);
 
 // string.h
 int strcmp(char *s1, char *s2);
+size_t strlen(char *s);
+void *memcpy(void *dest, void *src, size_t n);
+void *memset(void *s, int c, size_t n);
+
+#define strcmp __builtin_strcmp
+#define strlen __builtin_strlen
+#define memcpy __builtin_memcpy
+#define memset __builtin_memset
+
+// fcntl.h
+#define O_RDONLY 0x0
+#define O_WRONLY 0x1
+#define O_CREAT 0x40
+#define O_TRUNC 0x200
+
+int open(char *pathname, int flags, ...);
+
+// unistd.h
+#define SEEK_SET 0
+#define SEEK_END 2
+
+long write(int fd, void *buf, size_t count);
+long lseek(int fd, long offset, int whence);
+int close(int fd);
+int getpagesize(void);
+
+// sys/mman.h
+#define PROT_READ 0x1
+#define MAP_PRIVATE 0x2
+#define MAP_FAILED ((void *) (intptr_t) -1)
+
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, long offset);
+
+// time.h
+#define CLOCK_MONOTONIC 1
+#define CLOCK_PROCESS_CPUTIME_ID 2
+
+struct timespec {
+  long tv_sec;
+  long tv_nsec;
+};
+
+int clock_gettime(int clock_id, struct timespec *tp);
 
 // ctype.h
 int isprint(int c);
@@ -165,3 +209,6 @@ typedef struct {
   Elf64_Xword r_info;
   Elf64_Sxword r_addend;
 } Elf64_Rela;
+
+// gen.c
+extern int log2_exact(unsigned long long value);
@@ -0,0 +1,59 @@
+#include "sk2cc.h"
+#include "string.h"
+#include "source.h"
+
+static char *read_stream(FILE *fp) {
+  String *src = string_new();
+  char buffer[65536];
+  while (1) {
+    int n = fread(buffer, 1, sizeof(buffer), fp);
+    if (n == 0) break;
+    string_append(src, buffer, n);
+  }
+  return src->buffer;
+}
+
+// the source file is mapped to memory without copying.
+// the rest of the last page is filled with zeros, which terminates the source.
+// if the file size is a multiple of the page size, there is no room for '\0',
+// so the file is read into a buffer instead.
+char *load_source(char *filename) {
+  if (strcmp(filename, "-") == 0) {
+    return read_stream(stdin);
+  }
+
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    perror(filename);
+    exit(1);
+  }
+
+  long size = lseek(fd, 0, SEEK_END);
+  if (size > 0 && size % getpagesize() != 0) {
+    char *src = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (src != MAP_FAILED) {
+      close(fd);
+      return src;
+    }
+  }
+  close(fd);
+
+  FILE *fp = fopen(filename, "r");
+  if (!fp) {
+    perror(filename);
+    exit(1);
+  }
+  char *src = read_stream(fp);
+  fclose(fp);
+
+  return src;
+}
+
+// length of the line without the line terminator, for error messages.
+int line_length(char *line) {
+  int length = 0;
+  while (line[length] != '\n' && line[length] != '\r' && line[length] != '\0') {
+    length++;
+  }
+  return length;
+}
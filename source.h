@@ -0,0 +1,4 @@
+// source file
+// the source is terminated by '\0', and should not be modified.
+extern char *load_source(char *filename);
+extern int line_length(char *line);
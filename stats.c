@@ -0,0 +1,100 @@
+#include "sk2cc.h"
+#include "arena.h"
+#include "stats.h"
+
+#define PHASES 64
+
+// a phase can be nested in another phase.
+// e.g. the integrated assembler runs in the gen phase.
+typedef struct {
+  char *name;
+  int depth;
+
+  long wall; // us
+  long cpu;  // us
+  long allocated;
+  long objects;
+} Phase;
+
+static Phase phases[PHASES];
+static int phase_count;
+
+static int stack[PHASES];
+static int depth;
+
+static long counts[STATS];
+static char *stat_names[STATS] = { "tokens", "nodes", "insts", "relocs", "relaxed" };
+
+static long clock_us(int clock_id) {
+  struct timespec ts;
+  clock_gettime(clock_id, &ts);
+  return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void phase_begin(char *name) {
+  if (phase_count >= PHASES) return;
+
+  Phase *phase = &phases[phase_count];
+  phase->name = name;
+  phase->depth = depth;
+
+  // the start values are kept until the phase ends
+  phase->wall = clock_us(CLOCK_MONOTONIC);
+  phase->cpu = clock_us(CLOCK_PROCESS_CPUTIME_ID);
+  arena_stats(&phase->allocated, &phase->objects);
+
+  stack[depth++] = phase_count++;
+}
+
+void phase_end(void) {
+  if (depth == 0) return;
+
+  Phase *phase = &phases[stack[--depth]];
+  long allocated, objects;
+  arena_stats(&allocated, &objects);
+
+  phase->wall = clock_us(CLOCK_MONOTONIC) - phase->wall;
+  phase->cpu = clock_us(CLOCK_PROCESS_CPUTIME_ID) - phase->cpu;
+  phase->allocated = allocated - phase->allocated;
+  phase->objects = objects - phase->objects;
+}
+
+void stats_count(StatType type, long n) {
+  counts[type] += n;
+}
+
+static void report_text(void) {
+  fprintf(stderr, "%-16s %10s %10s %12s %10s\n", "phase", "wall(us)", "cpu(us)", "allocated", "objects");
+  for (int i = 0; i < phase_count; i++) {
+    Phase *phase = &phases[i];
+    fprintf(stderr, "%*s%-*s %10ld %10ld %12ld %10ld\n",
+        phase->depth * 2, "", 16 - phase->depth * 2, phase->name,
+        phase->wall, phase->cpu, phase->allocated, phase->objects);
+  }
+  for (int i = 0; i < STATS; i++) {
+    fprintf(stderr, "%-16s %10ld\n", stat_names[i], counts[i]);
+  }
+}
+
+static void report_json(void) {
+  fprintf(stderr, "{\"phases\": [");
+  for (int i = 0; i < phase_count; i++) {
+    Phase *phase = &phases[i];
+    fprintf(stderr, "%s{\"name\": \"%s\", \"depth\": %d, \"wall_us\": %ld, \"cpu_us\": %ld, \"allocated\": %ld, \"objects\": %ld}",
+        i > 0 ? ", " : "", phase->name, phase->depth,
+        phase->wall, phase->cpu, phase->allocated, phase->objects);
+  }
+  fprintf(stderr, "], \"counts\": {");
+  for (int i = 0; i < STATS; i++) {
+    fprintf(stderr, "%s\"%s\": %ld", i > 0 ? ", " : "", stat_names[i], counts[i]);
+  }
+  fprintf(stderr, "}}\n");
+}
+
+void stats_report(bool json) {
+  if (json) {
+    report_json();
+  } else {
+    report_text();
+  }
+}
@@ -0,0 +1,15 @@
+// statistics for --time-report
+typedef enum {
+  STAT_TOKENS,  // tokens (after preprocessing)
+  STAT_NODES,   // syntax tree nodes
+  STAT_INSTS,   // instructions
+  STAT_RELOCS,  // relocations
+  STAT_RELAXED, // jumps encoded in the short form
+} StatType;
+
+#define STATS 5
+
+extern void phase_begin(char *name);
+extern void phase_end(void);
+extern void stats_count(StatType type, long n);
+extern void stats_report(bool json);
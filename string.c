@@ -13,19 +13,38 @@ String *string_new(void) {
   return string;
 }
 
-void string_push(String *string, char c) {
-  string->buffer[string->length++] = c;
-
-  if (string->length >= string->capacity) {
-    string->capacity *= 2;
+// make room for size more characters.
+// the buffer always has a room for the terminating '\0'.
+void string_reserve(String *string, int size) {
+  if (string->length + size >= string->capacity) {
+    while (string->length + size >= string->capacity) {
+      string->capacity *= 2;
+    }
     string->buffer = realloc(string->buffer, sizeof(char) * string->capacity);
   }
+}
 
+void string_push(String *string, char c) {
+  string_reserve(string, 1);
+  string->buffer[string->length++] = c;
+  string->buffer[string->length] = '\0';
+}
+
+// append size characters of s.
+void string_append(String *string, char *s, int size) {
+  string_reserve(string, size);
+  memcpy(string->buffer + string->length, s, size);
+  string->length += size;
   string->buffer[string->length] = '\0';
 }
 
 void string_write(String *string, char *s) {
-  for (int i = 0; s[i]; i++) {
-    string_push(string, s[i]);
-  }
+  string_append(string, s, strlen(s));
+}
+
+void string_fill(String *string, char c, int size) {
+  string_reserve(string, size);
+  memset(string->buffer + string->length, c, size);
+  string->length += size;
+  string->buffer[string->length] = '\0';
 }
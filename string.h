@@ -4,5 +4,8 @@ typedef struct string {
 } String;
 
 extern String *string_new(void);
+extern void string_reserve(String *string, int size);
 extern void string_push(String *string, char c);
+extern void string_append(String *string, char *s, int size);
 extern void string_write(String *string, char *s);
+extern void string_fill(String *string, char c, int size);
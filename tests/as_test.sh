@@ -114,6 +114,58 @@ main:
   ret
 EOS
 
+expect 24 << EOS
+  .global main
+main:
+  pushq %rbp
+  movq %rsp, %rbp
+  subq \$64, %rsp
+  movq \$3, %rax
+  leaq -64(%rbp), %rdi
+  movl \$4, %ecx
+  rep stosq
+  leaq -64(%rbp), %rsi
+  leaq -32(%rbp), %rdi
+  movl \$4, %ecx
+  rep movsq
+  movq -32(%rbp), %rax
+  addq -8(%rbp), %rax
+  addq -40(%rbp), %rax
+  addq -64(%rbp), %rax
+  addq -48(%rbp), %rax
+  addq -16(%rbp), %rax
+  addq -56(%rbp), %rax
+  addq -24(%rbp), %rax
+  leave
+  ret
+EOS
+
+expect 46 << EOS
+  .global main
+main:
+  pushq %rbp
+  movq %rsp, %rbp
+  subq \$32, %rsp
+  movl \$5, %ecx
+  movd %ecx, %xmm1
+  pshufd \$0, %xmm1, %xmm1
+  movdqu %xmm1, -32(%rbp)
+  movdqu -32(%rbp), %xmm0
+  paddd %xmm1, %xmm0
+  pshufd \$78, %xmm0, %xmm2
+  paddd %xmm2, %xmm0
+  pshufd \$177, %xmm0, %xmm2
+  paddd %xmm2, %xmm0
+  movd %xmm0, %eax
+  pxor %xmm3, %xmm3
+  pcmpeqb %xmm1, %xmm3
+  pmovmskb %xmm3, %ecx
+  andl \$6, %ecx
+  addl %ecx, %eax
+  leave
+  ret
+EOS
+
 expect 85 << EOS
   .global main
 main:
@@ -389,6 +441,81 @@ main:
   ret
 EOS
 
+expect 3 << EOS
+  .global main
+main:
+  movl \$0, %eax
+  movl \$0, %ecx
+  subl \$1, %ecx
+  cmpl \$0, %ecx
+  jl .L1
+  addl \$8, %eax
+.L1:
+  cmpl \$1, %ecx
+  jb .L2
+  addl \$1, %eax
+.L2:
+  testl %ecx, %ecx
+  jns .L3
+  addl \$2, %eax
+.L3:
+  ret
+EOS
+
+expect 10 << EOS
+  .global main
+main:
+  movl \$0, %eax
+  movl \$0, %ecx
+.L0:
+  addl \$2, %eax
+  addl \$1, %ecx
+  cmpl \$5, %ecx
+  jge .L1
+  jmp .L0
+.L1:
+  ret
+EOS
+
+expect 7 << EOS
+  .global main
+main:
+  movl \$7, %eax
+  cmpl \$7, %eax
+  je .L1
+  .zero 200
+.L1:
+  jmp .L2
+.L3:
+  ret
+  .zero 150
+.L2:
+  jmp .L3
+EOS
+
+expect 30 << EOS
+  .text
+  .global main
+main:
+  movl \$2, %ecx
+  leaq .L9(%rip), %rdx
+  jmp *(%rdx, %rcx, 8)
+.L0:
+  movl \$10, %eax
+  ret
+.L1:
+  movl \$20, %eax
+  ret
+.L2:
+  movl \$30, %eax
+  ret
+  .section .rodata
+.L9:
+  .quad .L0
+  .quad .L1
+  .quad .L2
+EOS
+
 expect 15 << EOS
   .data
 .S0:
@@ -423,6 +550,22 @@ main:
   ret
 EOS
 
+expect 42 << EOS
+  .data
+a:
+  .long 0
+b:
+  .long 0
+  .text
+  .global main
+main:
+  movl \$19, a(%rip)
+  movl \$23, b(%rip)
+  movl a(%rip), %eax
+  addl b(%rip), %eax
+  ret
+EOS
+
 expect 0 << EOS
   .data
   .global a
@@ -476,7 +619,7 @@ main:
 EOS
 
 gcc -o tmp/as_driver \
-  string.c vector.c map.c binary.c \
+  string.c vector.c map.c binary.c arena.c stats.c ident.c source.c \
   as_error.c as_lex.c as_parse.c as_sema.c as_encode.c as_gen.c \
   tests/as_driver.c \
   || exit 1
@@ -536,6 +679,12 @@ test_encoding 'movq $42, %r12' '49 c7 c4 2a 00 00 00'
 test_encoding 'movq $42, %r13' '49 c7 c5 2a 00 00 00'
 test_encoding 'movq $42, %r15' '49 c7 c7 2a 00 00 00'
 
+# movq $imm64, %r64 (movabs)
+test_encoding 'movq $4886718345, %rax' '48 b8 89 67 45 23 01 00 00 00'
+test_encoding 'movq $9223372036854775807, %rdi' '48 bf ff ff ff ff ff ff ff 7f'
+test_encoding 'movq $2147483648, %r8' '49 b8 00 00 00 80 00 00 00 00'
+test_encoding 'movq $18446744073709551615, %rax' '48 c7 c0 ff ff ff ff'
+
 # movq $imm32, (%r64)
 test_encoding 'movq $42, (%rax)' '48 c7 00 2a 00 00 00'
 test_encoding 'movq $42, (%rsp)' '48 c7 04 24 2a 00 00 00' # Scale: 0, Index: 4, Base: 4
@@ -1408,6 +1557,11 @@ test_encoding 'leaq 144(%r12), %r9' '4d 8d 8c 24 90 00 00 00' # Scale: 0, Index:
 test_encoding 'leaq 144(%r13), %r9' '4d 8d 8d 90 00 00 00' # Mod: 1, disp8: 0
 test_encoding 'leaq 144(%r15), %r9' '4d 8d 8f 90 00 00 00'
 
+# lea with scaled index
+test_encoding 'leaq (%rcx,%rax,4), %rdx' '48 8d 14 81'
+test_encoding 'leal (%rax,%rax,2), %eax' '8d 04 40'
+test_encoding 'leal (%r9,%r9,8), %r9d' '47 8d 0c c9'
+
 # leaq id(%rip), %r64
 test_encoding 'leaq id(%rip), %rax' '48 8d 05 00 00 00 00'
 test_encoding 'leaq id(%rip), %rsp' '48 8d 25 00 00 00 00'
@@ -1460,6 +1614,15 @@ test_encoding 'imulq (%rdx)' '48 f7 2a'
 test_encoding 'imull %edx' 'f7 ea'
 test_encoding 'imull (%rdx)' 'f7 2a'
 
+# imulq, imull with two operands
+test_encoding 'imulq $10, %rdx' '48 69 d2 0a 00 00 00'
+test_encoding 'imulq $10, %r9' '4d 69 c9 0a 00 00 00'
+test_encoding 'imull $10, %edx' '69 d2 0a 00 00 00'
+test_encoding 'imulq %rcx, %rdx' '48 0f af d1'
+test_encoding 'imulq (%rcx), %rdx' '48 0f af 11'
+test_encoding 'imull %ecx, %edx' '0f af d1'
+test_encoding 'imull %r9d, %r10d' '45 0f af d1'
+
 # divq
 test_encoding 'divq %rdx' '48 f7 f2'
 test_encoding 'divq (%rdx)' '48 f7 32'
@@ -1504,6 +1667,29 @@ test_encoding 'cmpb %cl, %dl' '38 ca'
 test_encoding 'cmpb %cl, (%rdx)' '38 0a'
 test_encoding 'cmpb (%rdx), %cl' '3a 0a'
 
+# testq
+test_encoding 'testq $42, %rdx' '48 f7 c2 2a 00 00 00'
+test_encoding 'testq $42, (%rdx)' '48 f7 02 2a 00 00 00'
+test_encoding 'testq %rcx, %rdx' '48 85 ca'
+test_encoding 'testq %rcx, (%rdx)' '48 85 0a'
+test_encoding 'testq (%rdx), %rcx' '48 85 0a'
+
+# testl
+test_encoding 'testl $42, %edx' 'f7 c2 2a 00 00 00'
+test_encoding 'testl $42, (%rdx)' 'f7 02 2a 00 00 00'
+test_encoding 'testl %ecx, %edx' '85 ca'
+test_encoding 'testl %ecx, (%rdx)' '85 0a'
+
+# testw
+test_encoding 'testw $42, %dx' '66 f7 c2 2a 00'
+test_encoding 'testw %cx, %dx' '66 85 ca'
+
+# testb
+test_encoding 'testb $42, %dl' 'f6 c2 2a'
+test_encoding 'testb $42, (%rdx)' 'f6 02 2a'
+test_encoding 'testb %cl, %dl' '84 ca'
+test_encoding 'testb %cl, %sil' '40 84 ce'
+
 # sete
 test_encoding 'sete %bl' '0f 94 c3'
 test_encoding 'sete (%rbx)' '0f 94 03'
@@ -1536,6 +1722,34 @@ test_encoding 'setle (%rbx)' '0f 9e 03'
 test_encoding 'setge %bl' '0f 9d c3'
 test_encoding 'setge (%rbx)' '0f 9d 03'
 
+# jcc
+test_encoding 'je .L1' '0f 84 00 00 00 00'
+test_encoding 'jne .L1' '0f 85 00 00 00 00'
+test_encoding 'jb .L1' '0f 82 00 00 00 00'
+test_encoding 'jbe .L1' '0f 86 00 00 00 00'
+test_encoding 'ja .L1' '0f 87 00 00 00 00'
+test_encoding 'jae .L1' '0f 83 00 00 00 00'
+test_encoding 'jl .L1' '0f 8c 00 00 00 00'
+test_encoding 'jle .L1' '0f 8e 00 00 00 00'
+test_encoding 'jg .L1' '0f 8f 00 00 00 00'
+test_encoding 'jge .L1' '0f 8d 00 00 00 00'
+test_encoding 'js .L1' '0f 88 00 00 00 00'
+test_encoding 'jns .L1' '0f 89 00 00 00 00'
+
+# indirect jumps
+test_encoding 'jmp *%rax' 'ff e0'
+test_encoding 'jmp *%r11' '41 ff e3'
+test_encoding 'jmp *(%rdx, %rcx, 8)' 'ff 24 ca'
+test_encoding 'jmp *(%r8, %r9, 8)' '43 ff 24 c8'
+test_encoding 'jmp *8(%rax)' 'ff 60 08'
+
+# short jumps to local labels
+test_encoding $'.L0:\njmp .L0' 'eb fe'
+test_encoding $'jmp .L1\n.L1:' 'eb 00'
+test_encoding $'.L0:\njl .L0' '7c fe'
+test_encoding $'jne .L1\nret\n.L1:' '75 01 c3'
+test_encoding $'.L0:\njmp foo' 'e9 00 00 00 00'
+
 # negq
 test_encoding 'negq %rsi' '48 f7 de'
 test_encoding 'negq (%rsi)' '48 f7 1e'
@@ -1606,6 +1820,18 @@ test_encoding 'sarq %cl, %rdx' '48 d3 fa'
 # sall
 test_encoding 'sarl %cl, %edx' 'd3 fa'
 
+# shift by an immediate
+test_encoding 'salq $3, %rdx' '48 c1 e2 03'
+test_encoding 'sall $3, %edx' 'c1 e2 03'
+test_encoding 'sarq $63, %rdx' '48 c1 fa 3f'
+test_encoding 'sarl $31, %edx' 'c1 fa 1f'
+
+# shrq, shrl
+test_encoding 'shrq %cl, %rdx' '48 d3 ea'
+test_encoding 'shrl %cl, %edx' 'd3 ea'
+test_encoding 'shrq $32, %rdx' '48 c1 ea 20'
+test_encoding 'shrl $5, %r9d' '41 c1 e9 05'
+
 # movzb
 test_encoding 'movzbq %cl, %rdx' '48 0f b6 d1'
 test_encoding 'movzbq (%rcx), %rdx' '48 0f b6 11'
@@ -1613,6 +1839,8 @@ test_encoding 'movzbl %cl, %edx' '0f b6 d1'
 test_encoding 'movzbl (%rcx), %edx' '0f b6 11'
 test_encoding 'movzbw %cl, %dx' '66 0f b6 d1'
 test_encoding 'movzbw (%rcx), %dx' '66 0f b6 11'
+test_encoding 'movzbl %dil, %ebx' '40 0f b6 df'
+test_encoding 'movzbl %sil, %r12d' '44 0f b6 e6'
 
 # movzw
 test_encoding 'movzwq %cx, %rdx' '48 0f b7 d1'
@@ -1625,6 +1853,8 @@ test_encoding 'movsbq %cl, %rdx' '48 0f be d1'
 test_encoding 'movsbq (%rcx), %rdx' '48 0f be 11'
 test_encoding 'movsbl %cl, %edx' '0f be d1'
 test_encoding 'movsbl (%rcx), %edx' '0f be 11'
+test_encoding 'movsbl %dil, %eax' '40 0f be c7'
+test_encoding 'movsbq %spl, %rax' '48 0f be c4'
 test_encoding 'movsbw %cl, %dx' '66 0f be d1'
 test_encoding 'movsbw (%rcx), %dx' '66 0f be 11'
 
@@ -1642,5 +1872,51 @@ test_encoding 'movslq (%rcx), %rdx' '48 63 11'
 test_encoding 'cltd' '99'
 test_encoding 'cqto' '48 99'
 
+# rep stos, rep movs
+test_encoding 'rep stosq' 'f3 48 ab'
+test_encoding 'rep stosl' 'f3 ab'
+test_encoding 'rep stosw' 'f3 66 ab'
+test_encoding 'rep stosb' 'f3 aa'
+test_encoding 'rep movsq' 'f3 48 a5'
+test_encoding 'rep movsl' 'f3 a5'
+test_encoding 'rep movsw' 'f3 66 a5'
+test_encoding 'rep movsb' 'f3 a4'
+
+# movd
+test_encoding 'movd %ecx, %xmm1' '66 0f 6e c9'
+test_encoding 'movd %r9d, %xmm10' '66 45 0f 6e d1'
+test_encoding 'movd %xmm2, %eax' '66 0f 7e d0'
+test_encoding 'movd (%rcx), %xmm0' '66 0f 6e 01'
+
+# movdqu
+test_encoding 'movdqu (%rdx, %rax, 4), %xmm0' 'f3 0f 6f 04 82'
+test_encoding 'movdqu %xmm0, (%r10, %rax, 1)' 'f3 41 0f 7f 04 02'
+test_encoding 'movdqu 16(%rbp), %xmm9' 'f3 44 0f 6f 4d 10'
+test_encoding 'movdqu %xmm1, -32(%rsp, %rax, 4)' 'f3 0f 7f 4c 84 e0'
+test_encoding 'movdqu %xmm3, %xmm12' 'f3 44 0f 6f e3'
+
+# paddb
+test_encoding 'paddb %xmm1, %xmm0' '66 0f fc c1'
+
+# paddd
+test_encoding 'paddd %xmm3, %xmm0' '66 0f fe c3'
+test_encoding 'paddd (%rcx), %xmm8' '66 44 0f fe 01'
+
+# pxor
+test_encoding 'pxor %xmm2, %xmm2' '66 0f ef d2'
+
+# pcmpeqb
+test_encoding 'pcmpeqb %xmm1, %xmm0' '66 0f 74 c1'
+test_encoding 'pcmpeqb %xmm15, %xmm0' '66 41 0f 74 c7'
+
+# pmovmskb
+test_encoding 'pmovmskb %xmm0, %ecx' '66 0f d7 c8'
+test_encoding 'pmovmskb %xmm9, %r11d' '66 45 0f d7 d9'
+
+# pshufd
+test_encoding 'pshufd $0, %xmm1, %xmm1' '66 0f 70 c9 00'
+test_encoding 'pshufd $78, %xmm2, %xmm0' '66 0f 70 c2 4e'
+test_encoding 'pshufd $177, %xmm10, %xmm3' '66 41 0f 70 da b1'
+
 echo "[OK]"
 exit 0
@@ -0,0 +1,55 @@
+#include "../sk2cc.h"
+#include "../binary.h"
+
+int main(void) {
+  Binary *binary = binary_new();
+
+  assert(binary->length == 0);
+  assert(binary->capacity == 256);
+
+  binary_u8(binary, 0x12);
+  binary_u16(binary, 0x3456);
+  binary_u32(binary, 0x789abcde);
+  binary_u64(binary, 0x0123456789abcdefULL);
+  assert(binary->length == 15);
+
+  Byte expected[15] = {
+    0x12,
+    0x56, 0x34,
+    0xde, 0xbc, 0x9a, 0x78,
+    0xef, 0xcd, 0xab, 0x89, 0x67, 0x45, 0x23, 0x01,
+  };
+  for (int i = 0; i < 15; i++) {
+    assert(binary->buffer[i] == expected[i]);
+  }
+
+  binary_append(binary, 3, 0xaa, 0xbb, 0xcc);
+  assert(binary->length == 18);
+  assert(binary->buffer[15] == 0xaa);
+  assert(binary->buffer[17] == 0xcc);
+
+  // fill grows the buffer at once
+  binary_fill(binary, 0xff, 1000);
+  assert(binary->length == 1018);
+  assert(binary->capacity == 1024);
+  for (int i = 18; i < 1018; i++) {
+    assert(binary->buffer[i] == 0xff);
+  }
+
+  char data[300];
+  for (int i = 0; i < 300; i++) {
+    data[i] = i % 128;
+  }
+  binary_write(binary, data, 300);
+  assert(binary->length == 1318);
+  assert(binary->capacity == 2048);
+  for (int i = 0; i < 300; i++) {
+    assert(binary->buffer[1018 + i] == i % 128);
+  }
+
+  binary_reserve(binary, 10000);
+  assert(binary->length == 1318);
+  assert(binary->capacity == 16384);
+
+  return 0;
+}
@@ -4,6 +4,9 @@
 char keys[1024][8];
 int values[1024], values2[1024];
 
+#define LARGE 1000000
+char large_keys[LARGE][8];
+
 int main(void) {
   Map *map = map_new();
 
@@ -33,5 +36,22 @@ int main(void) {
     assert(*((int *) map_lookup(map, keys[i])) == i * 3 + 1);
   }
 
+  // scaling test
+  Map *large = map_new();
+  for (int i = 0; i < LARGE; i++) {
+    for (int j = 0, n = i; j < 7; j++, n /= 10) {
+      large_keys[i][6 - j] = '0' + n % 10;
+    }
+    large_keys[i][7] = '\0';
+    map_puti(large, large_keys[i], i);
+  }
+  assert(large->count == LARGE);
+
+  for (int i = 0; i < LARGE; i++) {
+    assert(large->keys[i] == large_keys[i]);
+    assert(map_lookupi(large, large_keys[i]) == i);
+  }
+  assert(map_lookup(large, "10000000") == NULL);
+
   return 0;
 }
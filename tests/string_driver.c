@@ -31,5 +31,34 @@ int main(void) {
   assert(string->length == 128);
   assert(string->capacity == 256);
 
+  // bulk operations
+  String *bulk = string_new();
+
+  string_write(bulk, "hello");
+  assert(bulk->length == 5);
+  assert(strcmp(bulk->buffer, "hello") == 0);
+
+  string_append(bulk, ", world!!", 7);
+  assert(bulk->length == 12);
+  assert(strcmp(bulk->buffer, "hello, world") == 0);
+
+  string_fill(bulk, '-', 100);
+  assert(bulk->length == 112);
+  assert(bulk->capacity == 128);
+  assert(bulk->buffer[11] == 'd');
+  assert(bulk->buffer[12] == '-');
+  assert(bulk->buffer[111] == '-');
+  assert(bulk->buffer[112] == '\0');
+
+  // there is always a room for '\0'
+  string_fill(bulk, '-', 16);
+  assert(bulk->length == 128);
+  assert(bulk->capacity == 256);
+  assert(bulk->buffer[128] == '\0');
+
+  string_reserve(bulk, 1000);
+  assert(bulk->length == 128);
+  assert(bulk->capacity == 2048);
+
   return 0;
 }
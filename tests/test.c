@@ -268,8 +268,76 @@ void test_expression() {
   expect(8 * 7 < 50 || 10 > 2 * 5 || 3 % 2 == 1 || 5 * 7 < 32, 1);
   expect(8 * 7 < 50 || 10 > 2 * 5 || 3 % 2 != 1 || 5 * 7 < 32, 0);
   expect(3 * 7 > 20 && 2 * 4 <= 7 || 8 % 2 == 0 && 5 / 2 >= 2, 1);
+
+  // constant folding
+  expect((1 << 4) | 3, 19);
+  expect(4 * sizeof(int) + 1, 17);
+  expect(-7 / 2, -3);
+  expect(-7 % 2, -1);
+  expect(7 / -2, -3);
+  expect(0xffffffffu >> 28, 15);
+  expect(-16 >> 2, -4);
+  expect(0xffffffffu + 2u, 1);
+  expect(2147483647 + 0u > 0u, 1);
+  expect(-1 < 0u, 0);
+  expect(-1L < 0, 1);
+  expect((char) 300, 44);
+  expect((unsigned char) -1, 255);
+  expect((short) 65537, 1);
+  expect((_Bool) 256, 1);
+  expect(~0 == -1, 1);
+  expect(!5, 0);
+  expect((int) ((1L << 40) >> 38), 4);
+  expect((int) (0x123456789L & 0xffff), 0x6789);
+  { int x = 3; expect(0 && x++, 0); expect(1 || x++, 1); expect(x, 3); }
+  { int x = 3; expect(1 ? x : x++, 3); expect(0 ? x++ : x, 3); expect(x, 3); }
+
+  // immediate operands
+  { int x = 5; expect(x + 3, 8); expect(x - -3, 8); expect(x & 6, 4); expect(x | 2, 7); expect(x ^ 1, 4); }
+  { int x = -5; expect(x < -4, 1); expect(x <= -6, 0); expect(x == -5, 1); expect(x != -5, 0); }
+  { unsigned int x = 3000000000u; expect(x < 4000000000u, 1); expect(x > 2000000000u, 1); }
+  { long x = -1; expect(x == -1, 1); expect(x + 1, 0); expect(x < 1, 1); }
+  { long x = 1L << 40; expect(x == 1L << 40, 1); expect((int) ((x + (1L << 33)) >> 33), 129); }
+  { int a[4] = { 1, 2, 3, 4 }, *p = a + 3; expect(*(p - 2), 2); expect(*(a + 2), 3); }
+
+  // peephole optimization (-O1)
+  { int x = 3, y = x; x = 5; expect(y, 3); expect(x + y, 8); }
+  { long x = -1; int y = x; expect(y, -1); expect(x == -1, 1); }
+  { char c = 300; short s = c; expect(c, 44); expect(s, 44); }
+  { int x = 0x12345678; char *p = (char *) &x; *p = 0; expect(x, 0x12345600); }
+  { struct { char a; int b; long c; } t, *p = &t; t.a = 1; p->b = 2; t.c = p->a + p->b; expect(t.c, 3); }
+  { int a[3] = { 1, 2, 3 }, i = 1; a[i] = a[i - 1] + a[i + 1]; expect(a[1], 4); }
+  { int x = 2; expect(x * (x + (x * (x + (x * (x + (x * (x + 1))))))), 2 * (2 + 2 * (2 + 2 * (2 + 2 * 3)))); }
+  { int x = 3, n = 0; if (x == 3) n++; if (x != 3) n++; while (x != 0) x--; expect(n, 1); expect(x == 0, 1); }
+
+  // register promotion (-O1)
+  { int x = 7; int y = x++; expect(y, 7); expect(x, 8); expect(x--, 8); expect(--x, 6); }
+  { char c = 127; int d = c++; expect(d, 127); expect(c, -128); unsigned char u = 0; u--; expect(u, 255); }
+  { bool b = 1; expect(b++, 1); expect(b, 1); short s = -1; s += 2; expect(s, 1); }
+  { int a[4] = { 1, 2, 3, 4 }, *p = a; long s = 0; for (int i = 0; i < 4; i++) s += *p++; expect(s, 10); expect(*(p - 1), 4); }
+  { int x = 3, *p = &x; *p = 4; expect(x, 4); }
+  { long a[2] = { 1, 2 }, *p = a, *q = p + 1; *p += 5; *q += *p; expect(a[0], 6); expect(a[1], 8); }
+  { int a = 1, b = 2, c = 3, d = 4, e = 5, f = 6, g = 7; a += b; c *= d; e -= f; g /= 2; expect(a + c + e + f + g, 3 + 12 - 1 + 6 + 3); }
+
+  // strength reduction
+  { int x = -7; expect(x * 8, -56); expect(x * 3, -21); expect(x * 9, -63); expect(x * 10, -70); expect(4 * x, -28); }
+  { long x = 1L << 33; expect(x * 5 == 5L << 33, 1); expect((x >> 31) * 0x100000003L == 0x40000000cL, 1); expect(x * -1 == -(1L << 33), 1); }
+  { int x = -9; expect(x / 4, -2); expect(x % 4, -1); expect(x / 2, -4); expect(x % 2, -1); expect(x / 1, -9); expect(x % 1, 0); }
+  { int x = 2147483647; expect(x / 7, 306783378); expect(x % 7, 1); expect(x / 1000, 2147483); expect(-x % 10, -7); }
+  { int x = -2147483647 - 1; expect(x / 3, -715827882); expect(x % 3, -2); expect(x / 65536, -32768); expect(x % 641, -320); }
+  { unsigned int x = 4294967295u; expect(x / 3, 1431655765); expect(x % 10, 5); expect(x / 16, 268435455); expect(x % 16, 15); }
+  { unsigned int x = 3000000000u; expect(x / 3000000001u, 0); expect(x % 2147483649u, 852516351); expect(x >> 30, 2); }
+  { long x = -1000000000000L; expect(x / 7 == -142857142857L, 1); expect(x % 7, -1); expect(x / 1024 == -976562500L, 1); }
+  { long x = 9223372036854775807L; expect(x / 10 == 922337203685477580L, 1); expect(x % 10, 7); expect(x % (1L << 40) == (1L << 40) - 1, 1); }
+  { unsigned long x = 18446744073709551615ul; expect(x / 7 == 2635249153387078802ul, 1); expect(x % 7, 1); expect(x >> 63, 1); }
+  { unsigned long x = 18446744073709551615ul; expect(x / 10 == 1844674407370955161ul, 1); expect(x % 9223372036854775809ul == 9223372036854775806ul, 1); }
+  { short a[5] = { 1, 2, 3, 4, 5 }; long i = 3; expect(a[i], 4); expect(*(a + i - 1), 3); }
+  { struct { int a, b, c; } t[3]; int i = 2; t[i].b = 5; expect(t[2].b, 5); expect((t + i)->b, 5); }
 }
 
+int folded_global = (1 << 4) | 3;
+int folded_globals[2 * 2] = { -1, 2 * 3, sizeof(long) };
+
 void test_declaration() {
   // boolean
   { _Bool b = 0; expect(b, 0); }
@@ -383,6 +451,15 @@ void test_statement() {
   { int x = 0, a, *p = &a; if (p) x = 1; else x = 2; expect(x, 1); }
   { int x = 0, *p = 0; if (p) x = 1; else x = 2; expect(x, 2); }
 
+  // constant expressions
+  { int a[2 * 3 + 1]; expect(sizeof(a), 28); }
+  { enum { A = 1 << 3, B = A * 2 + 1 }; expect(B, 17); }
+  expect(folded_global, 19);
+  expect(folded_globals[0], -1);
+  expect(folded_globals[1], 6);
+  expect(folded_globals[2], 8);
+  expect(folded_globals[3], 0);
+
   // switch-statement
   {
     int x = 0, y = 0, z = 0, w = 0;
@@ -411,6 +488,102 @@ void test_statement() {
     expect(w, 1);
   }
 
+  {
+    int x = 0;
+    switch (-1) {
+      case 1 << 1: x = 1; break;
+      case -1: x = 2; break;
+    }
+    expect(x, 2);
+  }
+  {
+    int x = 0;
+    switch (1L << 40) {
+      case 1: x = 1; break;
+      case 1L << 40: x = 2; break;
+    }
+    expect(x, 2);
+  }
+  { int x = 0; switch (5) { x = 3; case 1: x = 1; } expect(x, 0); }
+  {
+    // dense cases are dispatched through a jump table.
+    int s = 0;
+    for (int i = -2; i < 12; i++) {
+      switch (i) {
+        case 0: s += 1; break;
+        case 1: s += 2; break;
+        case 2: s += 4; break;
+        case 3: s += 8; break;
+        case 5: s += 16; break;
+        case 6:
+        case 7: s += 32; break;
+        case 9: s += 64; break;
+        default: s += 1000;
+      }
+    }
+    expect(s, 1 + 2 + 4 + 8 + 16 + 32 + 32 + 64 + 6000);
+  }
+  {
+    // sparse cases are searched by comparisons.
+    unsigned s = 0, v[8] = { 1, 100, 1000, 4000000000u, 7, 99, 10000, 3 };
+    for (int i = 0; i < 8; i++) {
+      switch (v[i]) {
+        case 1: s += 1; break;
+        case 1000: s += 2; break;
+        default: s += 100; break;
+        case 4000000000u: s += 4; break;
+        case 10000: s += 8; break;
+        case 3: s += 16; break;
+        case 99: s += 32; break;
+      }
+    }
+    expect(s, 1 + 100 + 2 + 4 + 100 + 32 + 8 + 16);
+  }
+  {
+    long s = 0, v[6] = { -70000, -5, 0, 50, 70000, 1L << 40 };
+    for (int i = 0; i < 6; i++) {
+      switch (v[i]) {
+        case -70000: s += 1; break;
+        case -100: s += 1000; break;
+        case -5: s += 2; break;
+        case -4: s += 1000; break;
+        case -3: s += 1000; break;
+        case -2: s += 1000; break;
+        case 50: s += 4; break;
+        case 70000: s += 8; break;
+        case 1L << 40: s += 16; break;
+      }
+    }
+    expect(s, 31);
+  }
+  {
+    // the tables end at the maximum values of the types.
+    long s = 0, v[5] = { 9223372036854775804L, 9223372036854775805L, 9223372036854775806L, 9223372036854775807L, 0 };
+    for (int i = 0; i < 5; i++) {
+      switch (v[i]) {
+        case 9223372036854775804L: s += 1; break;
+        case 9223372036854775805L: s += 2; break;
+        case 9223372036854775806L: s += 4; break;
+        case 9223372036854775807L: s += 8; break;
+        default: s += 16; break;
+      }
+    }
+    expect(s, 31);
+  }
+  {
+    unsigned long s = 0, v[5] = { 18446744073709551612ul, 18446744073709551613ul, 18446744073709551614ul, 18446744073709551615ul, 0 };
+    for (int i = 0; i < 5; i++) {
+      switch (v[i]) {
+        case 18446744073709551612ul: s += 1; break;
+        case 18446744073709551613ul: s += 2; break;
+        case 18446744073709551614ul: s += 4; break;
+        case 18446744073709551615ul: s += 8; break;
+        default: s += 16; break;
+      }
+    }
+    expect(s, 31);
+  }
+
   // while-statement
   { int x = 15; while (x < 10) { x++; } expect(x, 15); }
   { int x = 15; while (x < 15) { x++; } expect(x, 15); }
@@ -537,6 +710,21 @@ lbl2:
     }
     expect(x, 2);
   }
+
+  // conditional branch
+  { int x = -1, n = 0; if (x < 0) n++; if (x <= -1) n++; if (x > -2) n++; if (x >= 0) n = 0; expect(n, 3); }
+  { unsigned int x = -1; int n = 0; if (x > 0) n++; if (x < 1) n = 0; if (x >= 4000000000u) n++; expect(n, 2); }
+  { long x = -1; unsigned long y = x; int n = 0; if (x < 0) n++; if (y < 0) n = 0; if (y > 1) n++; expect(n, 2); }
+  { int a = 1, b = 0, c = 1, n = 0; if (a && (b || c)) n++; if (!(a && b) && !b) n++; if (b || !c || a == b) n = 0; expect(n, 2); }
+  { int i = 0, n = 0; while (i < 10 && !(i == 7)) i++; for (; i > 0 || n < 3; i--) n++; expect(i, 0); expect(n, 7); }
+  { int x = 0, n = 0; do n++; while (x++ < 5 && x != 3); expect(n, 3); expect(x, 3); }
+  { int *p = 0, x = 3, n = 0; if (!p) n++; p = &x; if (p && *p == 3) n++; while (1) { if (0) n = 0; break; } expect(n, 2); }
+}
+
+int promoted_args(char a, short b, int c, long d, char e, int f, char g, long h) {
+  int n = 0;
+  for (int i = 0; i < 3; i++) n += a + b + c;
+  return n + d + e + f + g + h;
 }
 
 void test_call_abi() {
@@ -557,6 +745,16 @@ void test_call_abi() {
   expect(stub_arg6(1, 2, 3, 4, 5, 6), 91);
   expect(stub_arg7(1, 2, 3, 4, 5, 6, 7), 140);
   expect(stub_arg8(1, 2, 3, 4, 5, 6, 7, 8), 204);
+
+  // arguments with nested calls and deep expressions
+  expect(stub_arg6(stub_arg1(1), 1 + 1, stub_arg2(1, 2) - 2, 1 + (1 + (1 + (1 + (1 + (1 + (1 + 0)))))) - 3, 5, stub_arg1(1) * 6), 91);
+  expect(stub_arg8(1, stub_arg1(1) + 1, 3, 4, stub_arg2(1, 2), 6, 7, stub_arg1(1) * 8), 204);
+  {
+    int a = 1, b = 2, c = 3, d = 4;
+    expect(a + (b * (c + (d * (a + (b * (c + (d * (a + b)))))))), 1 + 2 * (3 + 4 * (1 + 2 * (3 + 4 * 3))));
+    expect(stub_arg4(a, b, c, d + (a && b) * (c || d) * (a ? 0 : b)), 30);
+  }
+  expect(promoted_args(-1, 300, 5, 10000000000L - 9999999990L, 20, -3, -128, 5), 3 * 304 + 10 + 20 - 3 - 128 + 5);
 }
 
 void test_bool_abi() {
@@ -603,6 +801,514 @@ void test_struct_abi() {
   expect(s.v.z, 1);
 }
 
+int ir_params(int a, int b, int c, int d, int e, int f, int g, int h) {
+  // the parameters are rotated through a cycle of registers.
+  for (int i = 0; i < 3; i++) {
+    int t = a;
+    a = b; b = c; c = d; d = e; e = f; f = g; g = h; h = t;
+  }
+  return a * 1 + b * 10 + c * 100 + d * 1000 + e * 10000 + f * 100000 + g * 1000000 + h * 10000000;
+}
+
+int ir_fib(int n) {
+  int a = 0, b = 1;
+  while (n-- > 0) {
+    int t = a + b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+int ir_square_sum(int a, int b) {
+  return a * a + b * b;
+}
+
+void test_ir() {
+  // phi functions of a swap
+  {
+    int a = 1, b = 2;
+    for (int i = 0; i < 5; i++) { int t = a; a = b; b = t; }
+    expect(a * 10 + b, 21);
+  }
+  expect(ir_fib(10), 55);
+  expect(ir_params(1, 2, 3, 4, 5, 6, 7, 8), 32187654);
+
+  // values live across calls
+  {
+    int x = 3, y = 4, z = 5;
+    int s = ir_square_sum(x, y) + ir_square_sum(y, z) + x + y + z;
+    expect(s, 25 + 41 + 12);
+  }
+
+  // more values than registers
+  {
+    int a = 1, b = 2, c = 3, d = 4, e = 5, f = 6, g = 7, h = 8, i = 9, j = 10, k = 11, l = 12, m = 13;
+    for (int n = 0; n < 2; n++) {
+      a += b; b += c; c += d; d += e; e += f; f += g; g += h; h += i; i += j; j += k; k += l; l += m; m += a;
+    }
+    expect(a + b + c + d + e + f + g + h + i + j + k + l + m, 373);
+    expect(ir_square_sum(a, m) - a * a, m * m);
+  }
+
+  // narrow values
+  {
+    char c = 200;
+    unsigned char u = 200;
+    short s = -2;
+    int n = 0;
+    for (int i = 0; i < 3; i++) { c++; u++; s--; }
+    expect(c, -53);
+    expect(u, 203);
+    expect(s, -5);
+    if ((bool) (c + 53)) n = 1;
+    if ((char) 256) n = 2;
+    expect(n, 0);
+  }
+
+  // division and shifts by variables
+  {
+    int x = -17, y = 5;
+    unsigned int u = 4000000000u;
+    long l = -1;
+    expect(x / y, -3);
+    expect(x % y, -2);
+    expect(u / (unsigned int) y, 800000000);
+    expect(u % 7u, 4000000000u % 7u);
+    expect(1 << y, 32);
+    expect(x >> 2, -5);
+    expect((int) ((unsigned long) l >> (y + 55)), 15);
+  }
+
+  // negative indices and pointers
+  {
+    int a[4] = { 1, 2, 3, 4 };
+    int *p = a + 3;
+    long i = -2;
+    expect(p[i], 2);
+    expect(*(p - 3), 1);
+  }
+
+  // switch in a loop with the values of the logical operators
+  {
+    int n = 0;
+    for (int i = 0; i < 6; i++) {
+      switch (i) {
+        case 0: n += 1; break;
+        case 2: n += i > 1 && i < 3; break;
+        case 3: n += i == 2 || i == 3 ? 10 : 20; break;
+        case 4: continue;
+        default: n += 100;
+      }
+      n += 1000;
+    }
+    expect(n, 5212);
+  }
+}
+
+static int inline_abs(int x) {
+  if (x < 0) return -x;
+  return x;
+}
+
+static int inline_local(int x) {
+  int y = x;
+  int *p = &y;
+  *p = *p + 1;
+  return y;
+}
+
+static void inline_store(int *p, int x) {
+  if (x < 0) return;
+  *p = x;
+}
+
+static int inline_goto(int n) {
+  int s = 0;
+again:
+  s += n;
+  if (--n > 0) goto again;
+  return s;
+}
+
+static int inline_fact(int n) {
+  return n <= 1 ? 1 : n * inline_fact(n - 1);
+}
+
+int inline_even(int n);
+
+int inline_odd(int n) {
+  return n == 0 ? 0 : inline_even(n - 1);
+}
+
+int inline_even(int n) {
+  return n == 0 ? 1 : inline_odd(n - 1);
+}
+
+void test_inline() {
+  expect(inline_abs(-7) + inline_abs(3), 10);
+  expect(inline_abs(inline_abs(-2) - 5), 3);
+
+  // the local variables of the inlined copies do not overlap.
+  {
+    int a = 1;
+    int *p = &a;
+    expect(inline_local(4) + inline_local(10) + *p, 17);
+  }
+
+  {
+    int n = 5;
+    inline_store(&n, -1);
+    expect(n, 5);
+    inline_store(&n, 8);
+    expect(n, 8);
+  }
+
+  expect(inline_goto(4) + inline_goto(1), 11);
+  expect(inline_fact(6), 720);
+  expect(inline_even(10) * 10 + inline_odd(7), 11);
+}
+
+int leaf_sum(int n) {
+  int a[8];
+  for (int i = 0; i < 8; i++) {
+    a[i] = i * n;
+  }
+  int sum = 0;
+  for (int i = 0; i < 8; i++) {
+    sum += a[i];
+  }
+  return sum;
+}
+
+long leaf_args(long a, long b, long c, long d, long e, long f, long g, long h) {
+  long x = g;
+  long *p = &x;
+  *p = *p * 10 + h;
+  return a + b + c + d + e + f + x;
+}
+
+int leaf_spill(int a, int b) {
+  int x[2];
+  x[0] = a;
+  x[1] = x[0] + (a && b) + (a || b ? 10 : 20);
+  return x[1];
+}
+
+int leaf_large(int n) {
+  int a[64];
+  for (int i = 0; i < 64; i++) {
+    a[i] = i;
+  }
+  return a[n] + a[63 - n];
+}
+
+void test_leaf() {
+  expect(leaf_sum(2), 56);
+  expect(leaf_args(1, 2, 3, 4, 5, 6, 7, 8), 99);
+  expect(leaf_spill(3, 0), 13);
+  expect(leaf_spill(0, 0), 20);
+  expect(leaf_large(10), 63);
+}
+
+_Noreturn void dead_exit(int status);
+
+_Noreturn void dead_exit(int status) {
+  exit(status);
+}
+
+static int dead_unused(int x) {
+  return x + 1;
+}
+
+int dead_check(int x) {
+  if (x < 0) {
+    dead_exit(1);
+    x = 100;
+  }
+  return x;
+}
+
+int dead_store(int x) {
+  int a[4];
+  int y = x * 2;
+  a[0] = x;
+  a[1] = y;
+  y = 3;
+  return x;
+}
+
+int dead_goto(int x) {
+  goto skip;
+  x = 100;
+skip:
+  return x + 1;
+  x = 200;
+  {
+  again:
+    x = x + 10;
+  }
+  if (x < 50) goto again;
+  return x;
+}
+
+int dead_switch(int x) {
+  int n = 0;
+  switch (x) {
+    n = 100;
+    case 1: n = n + 1;
+    case 2: n = n + 2; break;
+    default: return 7; break;
+  }
+  return n;
+}
+
+void test_dead() {
+  expect(dead_check(5), 5);
+  expect(dead_store(9), 9);
+  expect(dead_goto(1), 2);
+  expect(dead_switch(1), 3);
+  expect(dead_switch(2), 2);
+  expect(dead_switch(3), 7);
+}
+
+typedef struct { int a; char b; long c; } BlockSmall;
+typedef struct { char s[7]; } BlockOdd;
+typedef struct { char s[77]; } BlockLarge;
+
+void block_dirty() {
+  char buf[8192];
+  for (int i = 0; i < 8192; i++) buf[i] = -1;
+  expect(buf[100], -1);
+}
+
+int block_zero() {
+  char d[3] = { 7, 8, 9 };
+  char c[5] = { 1 };
+  int a[8] = { 1, 0, 3 };
+  int m[3][3] = { { 1 }, { 2, 3 } };
+  char buf[4096] = { 0 };
+  long sum = 0;
+  for (int i = 0; i < 4096; i++) sum += buf[i];
+  for (int i = 0; i < 8; i++) sum += a[i];
+  for (int i = 0; i < 3; i++) for (int j = 0; j < 3; j++) sum += m[i][j];
+  for (int i = 0; i < 5; i++) sum += c[i];
+  return sum * 10 + d[0];
+}
+
+int block_copy_small() {
+  BlockSmall s, t, u;
+  BlockOdd x, *p = &x;
+  s.a = 1; s.b = 2; s.c = 3;
+  u = t = s;
+  BlockSmall v = u;
+  for (int i = 0; i < 7; i++) x.s[i] = i + 1;
+  BlockOdd y = *p;
+  return v.a + v.b + v.c + t.a + y.s[0] + y.s[6];
+}
+
+int block_copy_large(int n) {
+  BlockLarge s, t, *p = &t;
+  for (int i = 0; i < 77; i++) s.s[i] = i;
+  *p = s;
+  BlockLarge u = *p;
+  int sum = 0;
+  for (int i = 0; i < 77; i++) sum += u.s[i];
+  return n * 10000 + ((u = s), u.s[76]) + sum;
+}
+
+int loop_global[16];
+
+int loop_kernel(int *a, int *b, int k, int n) {
+  for (int i = 0; i < n; i++) a[i] = b[i] + k;
+  int sum = 0;
+  for (int i = n - 1; i >= 0; i -= 2) sum += a[i];
+  return sum;
+}
+
+int loop_invariant(int k, int m, int n) {
+  int sum = 0;
+  for (int i = 0; i < n; i++) {
+    loop_global[i] = k * m + i;
+    sum += loop_global[i];
+  }
+  return sum;
+}
+
+long loop_nested(long *a, int rows, int cols) {
+  long s = 0;
+  for (int i = 0; i < rows; i++)
+    for (int j = 0; j < cols; j++)
+      s += a[i * cols + j] * (i + 1);
+  return s;
+}
+
+int loop_struct(int n) {
+  struct { int x, y, z; } t[8];
+  int i = 0;
+  do {
+    t[i].x = i;
+    t[i].y = i * 2;
+    t[i].z = t[i].x + t[i].y;
+    i++;
+  } while (i < n);
+  int sum = 0;
+  long j = 0;
+  while (j < n) {
+    sum += t[j].z;
+    j++;
+  }
+  return sum;
+}
+
+void test_loop() {
+  int a[10], b[10];
+  long c[12];
+  for (int i = 0; i < 10; i++) b[i] = i;
+  expect(loop_kernel(a, b, 3, 10), 40);
+  expect(a[9], 12);
+  expect(loop_kernel(a, b, 3, 0), 0);
+  expect(loop_invariant(2, 5, 16), 280);
+  expect(loop_global[15], 25);
+  for (int i = 0; i < 12; i++) c[i] = i;
+  expect(loop_nested(c, 3, 4), 164);
+  expect(loop_struct(8), 84);
+  expect(loop_struct(1), 0);
+}
+
+int vector_sum(int *a, int n) {
+  int s = 0;
+  for (int i = 0; i < n; i++) s += a[i];
+  return s;
+}
+
+void vector_fill(int *a, int n, int x) {
+  for (int i = 0; i < n; i++) a[i] = x;
+}
+
+void vector_copy(int *a, int *b, int n) {
+  for (int i = 0; i < n; i++) a[i] = b[i];
+}
+
+void vector_add(int *a, int *b, int *c, int n) {
+  for (int i = 0; i < n; i++) a[i] = b[i] + c[i];
+}
+
+void vector_add_char(char *a, char *b, int n, char x) {
+  for (int i = 0; i < n; i++) a[i] = b[i] + x;
+}
+
+long vector_find(char *s, long n, char c) {
+  long i;
+  for (i = 0; i < n; i++) {
+    if (s[i] == c) break;
+  }
+  return i;
+}
+
+// the comma steps write other symbols, which should not be vectorized.
+int vector_fill_comma(int *a, int n, int x) {
+  int i;
+  for (i = 0; i < n; i += 1, n--) a[i] = x;
+  return i;
+}
+
+int vector_count_comma(int *a, int n) {
+  int k = 0;
+  for (int i = 0; i < n; i++, k++) a[i] = k;
+  return k;
+}
+
+void test_vector() {
+  int a[37], b[37], c[37];
+  for (int i = 0; i < 37; i++) {
+    b[i] = i;
+    c[i] = i * 100;
+  }
+  vector_add(a, b, c, 37);
+  expect(a[36], 3636);
+  expect(vector_sum(a, 37), 67266);
+  expect(vector_sum(a, 3), 303);
+  vector_fill(a, 37, 7);
+  expect(vector_sum(a, 37), 259);
+
+  // overlapping copies
+  vector_copy(b + 1, b, 36);
+  expect(vector_sum(b, 37), 0);
+  for (int i = 0; i < 37; i++) b[i] = i;
+  vector_copy(b, b + 1, 36);
+  expect(b[35], 36);
+  expect(vector_sum(b, 37), 702);
+  vector_copy(b + 8, b, 20);
+  expect(b[27], 4);
+
+  char s[50], t[50];
+  for (int i = 0; i < 50; i++) s[i] = 'a';
+  s[41] = 'z';
+  expect(vector_find(s, 50, 'z'), 41);
+  expect(vector_find(s, 30, 'z'), 30);
+  expect(vector_find(s, 50, 'a'), 0);
+  vector_add_char(t, s, 50, -32);
+  expect(t[0], 'A');
+  expect(t[41], 'Z');
+  expect(t[49], 'A');
+
+  for (int i = 0; i < 37; i++) a[i] = 0;
+  expect(vector_fill_comma(a, 37, 1), 19);
+  expect(vector_sum(a, 37), 19);
+  expect(vector_count_comma(a, 37), 37);
+  expect(a[36], 36);
+}
+
+int builtin_compare(char *a, char *b) {
+  int c = __builtin_strcmp(a, b);
+  return c < 0 ? -1 : c > 0;
+}
+
+void test_builtin() {
+  char a[100], b[100];
+  for (int i = 0; i < 100; i++) b[i] = i;
+  expect(__builtin_memset(a, 'x', 100) == a, 1);
+  expect(__builtin_memcpy(a, b, 23) == a, 1);
+  expect(a[22], 22);
+  expect(a[23], 'x');
+  long n = 77;
+  __builtin_memcpy(a + 1, b, n);
+  expect(a[77], 76);
+  expect(a[78], 'x');
+  __builtin_memset(a, 0, 13);
+  expect(a[12], 0);
+  expect(a[13], 12);
+  int c = 300;
+  __builtin_memset(a, c, n);
+  expect(a[76], 44);
+  expect(a[77], 76);
+
+  struct { long x, y; int z; char w; } s, t;
+  s.x = 1;
+  s.y = 2;
+  s.z = 3;
+  s.w = 4;
+  __builtin_memcpy(&t, &s, sizeof(s));
+  expect(t.y + t.z + t.w, 9);
+
+  expect(__builtin_strlen("hello"), 5);
+  a[99] = 0;
+  expect(__builtin_strlen(a + 90), 9);
+  expect(builtin_compare("abc", "abd"), -1);
+  expect(builtin_compare("b", "abc"), 1);
+  expect(builtin_compare("abc", "abc"), 0);
+  expect(builtin_compare("ab", "abc"), -1);
+  expect(builtin_compare("", ""), 0);
+}
+
+void test_block() {
+  block_dirty();
+  expect(block_zero(), 117);
+  expect(block_copy_small(), 15);
+  expect(block_copy_large(3), 33002);
+}
+
 void test_va_list1(int a, int b, ...) {
   va_list ap;
   va_start(ap, b);
@@ -667,6 +1373,14 @@ int main() {
   test_call_abi();
   test_bool_abi();
   test_struct_abi();
+  test_ir();
+  test_inline();
+  test_leaf();
+  test_dead();
+  test_block();
+  test_loop();
+  test_vector();
+  test_builtin();
 
   test_va_list1(1, 2, 3, 4);
   test_va_list2(1, 2, 3, 4, 5, 6, 7);
@@ -368,6 +368,22 @@ int func(void) { return 42; }
 int main(void) { return func(); }
 EOS
 
+# the arguments of the builtin strcmp are addresses computed by lea,
+# which should survive the branches of the inline comparison (-O1).
+target="$target -O1" expect_return 0 <<-EOS
+int main() {
+  char buf[4];
+  buf[0] = 'a';
+  buf[1] = 'b';
+  buf[2] = 0;
+  char *p = buf;
+  if (__builtin_strcmp(buf, "ab") != 0) return 1;
+  if (__builtin_strcmp(p + 1, "a") <= 0) return 2;
+  if (__builtin_strcmp(buf, "ac") >= 0) return 3;
+  return 0;
+}
+EOS
+
 # testing error case
 test_error "int main() { 2 * (3 + 4; }"
 test_error "int main() { 5 + *; }"
@@ -404,5 +420,6 @@ test_error "int main() { int a[4] = { 4, 5, 6, 7, 8 }; return 0; }"
 test_error "int main() { goto label; }"
 test_error "int main() { label: return 0; label: return 1; }"
 test_error "int f() { label: return 0; } int main() { goto label; }"
+test_error "int main() { return __builtin_strlen(1); }"
 
 exit 0
@@ -0,0 +1,55 @@
+#!/bin/bash
+
+target=$1
+
+# the report of the vectorizer is not as expected
+failed() {
+  expect=$1
+  actual=$2
+  echo "[failed]"
+  echo "\"$expect\" is expected, but got \"$actual\"."
+  echo "[input]"
+  cat tmp/vectorize_test.c
+  exit 1
+}
+
+expect_report() {
+  expect=$1
+  cat - > tmp/vectorize_test.c
+  $target -O2 --vectorize-report tmp/vectorize_test.c > /dev/null 2> tmp/vectorize_test.log || failed "$expect" "error"
+  actual=`cat tmp/vectorize_test.log`
+  [ "$actual" != "$expect" ] && failed "$expect" "$actual"
+  return 0
+}
+
+expect_report "fill: loop 1: vectorized (fill, 4 x 32-bit)" <<-EOS
+void fill(int *a, int n, int x) {
+  for (int i = 0; i < n; i++) a[i] = x;
+}
+EOS
+
+expect_report "fill: loop 1: vectorized (fill, 4 x 32-bit)" <<-EOS
+void fill(int *a, int n, int x) {
+  for (int i = 0; i < n; i += 1) a[i] = x;
+}
+EOS
+
+expect_report "fill: loop 1: not vectorized (not a unit stride)" <<-EOS
+void fill(int *a, int n, int x) {
+  for (int i = 0; i < n; i += 1, n--) a[i] = x;
+}
+EOS
+
+expect_report "fill: loop 1: not vectorized (not a unit stride)" <<-EOS
+int fill(int *a, int n) {
+  int k = 0;
+  for (int i = 0; i < n; i++, k++) a[i] = k;
+  return k;
+}
+EOS
+
+expect_report "fill: loop 1: not vectorized (not a unit stride)" <<-EOS
+void fill(int *a, int n, int x) {
+  for (int i = 0; i < n; i = i + 1, n = n - 1) a[i] = x;
+}
+EOS
@@ -0,0 +1,129 @@
+// definitions of x86-64 shared by the assembler and the code generator
+
+// register size
+typedef enum {
+  REG_BYTE, // 8-bit
+  REG_WORD, // 16-bit
+  REG_LONG, // 32-bit
+  REG_QUAD, // 64-bit
+  REG_XMM,  // 128-bit (SSE)
+} RegSize;
+
+// register code
+// the values of constants are important
+// because they are used in the instruction encoding.
+typedef enum {
+  REG_AX,
+  REG_CX,
+  REG_DX,
+  REG_BX,
+  REG_SP,
+  REG_BP,
+  REG_SI,
+  REG_DI,
+  REG_R8,
+  REG_R9,
+  REG_R10,
+  REG_R11,
+  REG_R12,
+  REG_R13,
+  REG_R14,
+  REG_R15,
+} RegCode;
+
+// statement type
+typedef enum {
+  // label
+  ST_LABEL,
+
+  // directives
+  ST_TEXT,
+  ST_DATA,
+  ST_SECTION,
+  ST_GLOBAL,
+  ST_ZERO,
+  ST_LONG,
+  ST_QUAD,
+  ST_ASCII,
+
+  // instructions
+  ST_PUSH,
+  ST_POP,
+  ST_CLTD,
+  ST_CQTO,
+  ST_MOV,
+  ST_MOVZB,
+  ST_MOVZW,
+  ST_MOVSB,
+  ST_MOVSW,
+  ST_MOVSL,
+  ST_LEA,
+  ST_NEG,
+  ST_NOT,
+  ST_ADD,
+  ST_SUB,
+  ST_MUL,
+  ST_IMUL,
+  ST_DIV,
+  ST_IDIV,
+  ST_AND,
+  ST_XOR,
+  ST_OR,
+  ST_SAL,
+  ST_SAR,
+  ST_SHR,
+  ST_CMP,
+  ST_TEST,
+  ST_SETE,
+  ST_SETNE,
+  ST_SETB,
+  ST_SETL,
+  ST_SETG,
+  ST_SETBE,
+  ST_SETLE,
+  ST_SETGE,
+  ST_JMP,
+  ST_JE,
+  ST_JNE,
+  ST_JB,
+  ST_JBE,
+  ST_JA,
+  ST_JAE,
+  ST_JL,
+  ST_JLE,
+  ST_JG,
+  ST_JGE,
+  ST_JS,
+  ST_JNS,
+  ST_CALL,
+  ST_LEAVE,
+  ST_RET,
+  ST_REP_STOS,
+  ST_REP_MOVS,
+  ST_MOVD,
+  ST_MOVDQU,
+  ST_PADDB,
+  ST_PADDD,
+  ST_PXOR,
+  ST_PCMPEQB,
+  ST_PMOVMSKB,
+  ST_PSHUFD,
+} StmtType;
+
+// scale of memory operand
+// the values of constants are important
+// because they are used in instruction encoding.
+typedef enum {
+  SCALE1,
+  SCALE2,
+  SCALE4,
+  SCALE8,
+} Scale;
+
+// instruction suffix
+typedef enum {
+  INST_BYTE,
+  INST_WORD,
+  INST_LONG,
+  INST_QUAD,
+} InstSuffix;